@@ -168,11 +168,11 @@ syntax keyword vifmOption contained aproposprg autocd autochpos caseoptions
 		\ previewoptions previewprg quickview relativenumber rnu rulerformat ruf
 		\ runexec scrollbind scb scrolloff sessionoptions ssop so sort sortgroups
 		\ sortorder sortnumbers shell sh shellflagcmd shcf shortmess shm showtabline
-		\ stal sizefmt slowfs smartcase scs statusline stl suggestoptions syncregs
-		\ syscalls tablabel tabline tabprefix tabscope tabstop tabsuffix tal timefmt
-		\ timeoutlen title tm trash trashdir ts tuioptions to uioptions undolevels
-		\ ul vicmd viewcolumns vifminfo vimhelp vixcmd wildinc wildmenu wmnu
-		\ wildstyle wordchars wrap wrapscan ws
+		\ stal sizefmt slowfs slowfspoll smartcase scs statusline stl suggestoptions
+		\ syncregs syscalls tablabel tabline tabprefix tabscope tabstop tabsuffix
+		\ tal timefmt timeoutlen title tm trash trashdir ts tuioptions to uioptions
+		\ undolevels ul vicmd viewcolumns vifminfo vimhelp vixcmd wildinc wildmenu
+		\ wmnu wildstyle wordchars wrap wrapscan ws
 
 " Disabled boolean options
 syntax keyword vifmOption contained noautocd noautochpos nocf nochaselinks
@@ -184,6 +184,7 @@ cfg_init(void)
 	cfg.short_term_mux_titles = 0;
 
 	cfg.slow_fs_list = strdup("");
+	cfg.slow_fs_poll = 10;
 
 	cfg.cd_path = strdup(env_get_def("CDPATH", DEFAULT_CD_PATH));
 	replace_char(cfg.cd_path, ':', ',');
@@ -239,6 +240,7 @@ cfg_init(void)
 
 	cfg.fast_file_cloning = 1;
 	cfg.data_sync = 1;
+	cfg.sparse_files = 0;
 
 	cfg.cvoptions = 0;
 
@@ -146,7 +146,9 @@ enum
 	VINFO_MCHISTORY = 1 << 16, /* Command-line history of menus. */
 	VINFO_SAVEDIRS  = 1 << 17, /* Restore last used directories on startup. */
 	VINFO_TABS      = 1 << 18, /* Restore global or pane tabs. */
-	NUM_VINFO       = 19,      /* Number of VINFO_* constants. */
+	VINFO_DCACHE    = 1 << 19, /* Cached sizes of directories. */
+	VINFO_HASHES    = 1 << 20, /* Cached digests of contents of files. */
+	NUM_VINFO       = 21,      /* Number of VINFO_* constants. */
 
 	EMPTY_VINFO = 0,                   /* Empty set of flags. */
 	FULL_VINFO  = (1 << NUM_VINFO) - 1 /* Full set of flags. */
@@ -304,6 +306,9 @@ typedef struct config_t
 
 	/* Comma-separated list of file system types which are slow to respond. */
 	char *slow_fs_list;
+	/* Period of checking directories on slow file systems for changes in
+	 * seconds, zero disables the checks. */
+	int slow_fs_poll;
 
 	/* Comma-separated list of places to look for relative path to directories. */
 	char *cd_path;
@@ -377,6 +382,8 @@ typedef struct config_t
 	int fast_file_cloning;
 	/* Force writing data onto media during file copying. */
 	int data_sync;
+	/* Preserve holes of sparse files during file copying. */
+	int sparse_files;
 
 	/* Whether various things should be reset on entering/leaving custom views. */
 	int cvoptions;
@@ -19,13 +19,17 @@
 
 #include "info.h"
 
+#include <sys/stat.h> /* stat */
+
 #include <assert.h> /* assert() */
 #include <ctype.h> /* isdigit() */
+#include <inttypes.h> /* PRIu64 PRIx64 SCNu64 SCNx64 */
 #include <locale.h> /* setlocale() LC_ALL */
 #include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
 #include <stdio.h> /* FILE fpos_t fclose() fgetpos() fgets() fprintf() fputc()
-                      fscanf() fsetpos() snprintf() */
-#include <stdlib.h> /* abs() free() */
+                      fscanf() fsetpos() fwrite() setvbuf() snprintf() */
+#include <stdlib.h> /* abs() free() malloc() */
 #include <string.h> /* memcpy() memset() strtol() strcmp() strchr() strlen() */
 #include <time.h> /* time_t time() */
 
@@ -61,6 +65,7 @@
 #include "../flist_hist.h"
 #include "../filetype.h"
 #include "../filtering.h"
+#include "../hcache.h"
 #include "../marks.h"
 #include "../opt_handlers.h"
 #include "../registers.h"
@@ -146,6 +151,19 @@
  *      right-file = "right-file"
  *  } ]
  *  options = [ "opt1=val1", "opt2=val2" ]
+ *  dcache = {
+ *      "/some/directory" = {
+ *          size = 4096
+ *          inode = 12
+ *          ts = 1440801895 # timestamp
+ *      }
+ *  }
+ *  hashes = {
+ *      "dev:inode:size:mtime-ns" = {
+ *          digest = "0123456789abcdef0123456789abcdef"
+ *          used = 1440801895 # timestamp
+ *      }
+ *  }
  *  cmd-hist = [ {
  *      text = "item1"
  *      ts = 1440801895 # timestamp (optional)
@@ -182,8 +200,40 @@
  *  - for elements of arrays timestamps act more like generation numbers and
  *    while merging happens per element, effectively it's generations (defined
  *    by time of storing of the array) which are being merged
+ *
+ * Large vifminfo.json isn't rewritten on every store.  Instead, nodes of the
+ * state that changed since the file was last read or written by the instance
+ * are appended as a single line to vifminfo.journal:
+ *  { info-size = 123456, info-mtime = 1440801895 } # header
+ *  { vinfo = 1234, kept = [ "cmd-hist" ], state = { ... } } # record
+ *  ...
+ *
+ * Header binds the journal to a specific version of vifminfo.json and journals
+ * that don't match it are ignored.  Records are merged one after another on top
+ * of vifminfo.json in the same way as state is merged on writing the file,
+ * nodes listed in "kept" are left as they were.  Once the journal grows large
+ * enough, it's folded into vifminfo.json, which is rewritten as usual.
  */
 
+/* Cached size of a directory collected for storing. */
+typedef struct
+{
+	char *path;     /* Path to the directory. */
+	uint64_t inode; /* Inode of the directory. */
+	uint64_t size;  /* Size of the directory. */
+	time_t ts;      /* When the size was calculated. */
+}
+dcache_rec_t;
+
+/* List of cached sizes of directories collected for storing. */
+typedef struct
+{
+	dcache_rec_t *recs; /* Records. */
+	int count;          /* Number of used elements in recs. */
+	int capacity;       /* Number of allocated elements in recs. */
+}
+dcache_recs_t;
+
 static JSON_Value * read_legacy_info_file(const char info_file[]);
 static void load_state(JSON_Object *root, int reread);
 static void load_gtabs(JSON_Object *root, int reread);
@@ -202,6 +252,8 @@ static void load_bmarks(JSON_Object *root);
 static void load_regs(JSON_Object *root);
 static void load_dir_stack(JSON_Object *root);
 static void load_trash(JSON_Object *root);
+static void load_dcache(JSON_Object *root);
+static void load_hashes(JSON_Object *root);
 static void load_history(JSON_Object *root, const char node[], hist_t *hist);
 static void load_sorting(JSON_Object *ptab, view_t *view);
 static void ensure_history_not_full(hist_t *hist);
@@ -209,8 +261,26 @@ static void put_dhistory_entry(view_t *view, int reread, const char dir[],
 		const char file[], int rel_pos, time_t timestamp);
 static void set_manual_filter(view_t *view, const char value[]);
 TSTATIC void write_info_file(void);
+TSTATIC void state_set_journal_threshold(uint64_t threshold);
+TSTATIC void state_set_dcache_limit(int limit);
 static int copy_file(const char src[], const char dst[]);
-static void update_info_file(const char filename[], int vinfo, int merge);
+static JSON_Value * read_info_file(const char info_file[]);
+static int append_to_journal(const char info_file[], const char journal[],
+		int vinfo);
+static int write_journal_line(const char journal[], const char info_file[],
+		const char line[]);
+static JSON_Value * replay_journal(JSON_Value *state, const char journal[],
+		const char info_file[]);
+static int journal_is_current(const char journal[], const char info_file[]);
+static int read_journal_header(FILE *fp, const char info_file[]);
+static JSON_Value * apply_journal_record(JSON_Value *state,
+		const JSON_Object *record);
+static void forget_nodes(void);
+static void remember_nodes(const JSON_Object *state);
+static int is_known_node(const char name[], uint64_t hash);
+static uint64_t hash_node(const JSON_Value *value);
+static void update_info_file(const char filename[], const char journal[],
+		const char info_file[], int vinfo, int merge);
 TSTATIC char * drop_locale(void);
 TSTATIC void restore_locale(char locale[]);
 TSTATIC JSON_Value * serialize_state(int vinfo);
@@ -239,6 +309,15 @@ static void merge_regs(JSON_Object *current, const JSON_Object *admixture);
 static void merge_dir_stack(JSON_Object *current, const JSON_Object *admixture);
 static void merge_options(JSON_Object *current, const JSON_Object *admixture);
 static void merge_trash(JSON_Object *current, const JSON_Object *admixture);
+static void merge_dcache(JSON_Object *current, const JSON_Object *admixture);
+static void merge_hashes(JSON_Object *current, const JSON_Object *admixture);
+static void trim_by_timestamp(JSON_Object *obj, const char key[],
+		int max_count);
+static int get_trim_threshold(JSON_Object *obj, const char key[],
+		int max_count, double *threshold, int *ties);
+static double get_timestamp(JSON_Object *entry, const char key[]);
+static int dcache_rec_sorter(const void *first, const void *second);
+static int used_sorter(const void *first, const void *second);
 static void store_gtab(int vinfo, JSON_Object *gtab, const char name[],
 		const tab_layout_t *layout, view_t *left, view_t *right);
 static void store_pane(int vinfo, JSON_Object *pane, view_t *view, int right);
@@ -259,6 +338,12 @@ static void store_bmark(const char path[], const char tags[], time_t timestamp,
 static void store_regs(JSON_Object *root);
 static void store_dir_stack(JSON_Object *root);
 static void store_trash(JSON_Object *root);
+static void store_dcache(JSON_Object *root);
+static void collect_dcache_entry(const char path[], uint64_t inode,
+		uint64_t size, time_t ts, void *arg);
+static void store_hashes(JSON_Object *root);
+static void store_hashes_entry(const hcache_key_t *key,
+		const hcache_digest_t *digest, time_t used, void *arg);
 static char * convert_old_trash_path(const char trash_path[]);
 static void store_dhistory(JSON_Object *obj, view_t *view);
 static char * read_vifminfo_line(FILE *fp, char buffer[]);
@@ -288,8 +373,10 @@ static void clone_array(JSON_Object *parent, const JSON_Array *array,
 		const char node[]);
 static void set_session(const char new_session[]);
 static void write_session_file(void);
-static void store_file(const char path[], filemon_t *mon, int vinfo);
+static void store_file(const char path[], const char journal[],
+		filemon_t *mon, int vinfo);
 static void get_session_dir(char buf[], size_t buf_size);
+static void get_journal_file(char buf[], size_t buf_size);
 
 /* Monitor to check for changes of vifminfo file. */
 static filemon_t vifminfo_mon;
@@ -298,6 +385,21 @@ static filemon_t session_mon;
 /* Callback to be invoked when active session has changed.  Can be NULL. */
 static sessions_changed session_changed_cb;
 
+/* Size of vifminfo.json starting with which updates are appended to the journal
+ * instead of rewriting the whole file. */
+static uint64_t journal_threshold = 256*1024;
+
+/* Maximum number of cached sizes of directories that are stored.  The newest
+ * ones are kept. */
+static int dcache_limit = 10000;
+
+/* Names of top-level nodes of vifminfo.json as it was last read or written. */
+static char **node_names;
+/* Hashes of serialized values of the nodes. */
+static uint64_t *node_hashes;
+/* Number of elements in node_names and node_hashes arrays. */
+static int node_count;
+
 void
 state_store(void)
 {
@@ -315,10 +417,7 @@ state_load(int reread)
 	char info_file[PATH_MAX + 16];
 	snprintf(info_file, sizeof(info_file), "%s/vifminfo.json", cfg.config_dir);
 
-	char *locale = drop_locale();
-	JSON_Value *state = json_parse_file(info_file);
-	restore_locale(locale);
-
+	JSON_Value *state = read_info_file(info_file);
 	if(state == NULL)
 	{
 		char legacy_info_file[PATH_MAX + 16];
@@ -679,6 +778,8 @@ load_state(JSON_Object *root, int reread)
 	load_regs(root);
 	load_dir_stack(root);
 	load_trash(root);
+	load_dcache(root);
+	load_hashes(root);
 	load_history(root, "cmd-hist", &curr_stats.cmd_hist);
 	load_history(root, "exprreg-hist", &curr_stats.exprreg_hist);
 	load_history(root, "search-hist", &curr_stats.search_hist);
@@ -1169,6 +1270,74 @@ load_trash(JSON_Object *root)
 	}
 }
 
+/* Loads cached sizes of directories from JSON. */
+static void
+load_dcache(JSON_Object *root)
+{
+	JSON_Object *dcache = json_object_get_object(root, "dcache");
+
+	/* Files written by older versions might have too many entries, so only the
+	 * newest ones are loaded. */
+	double threshold;
+	int ties;
+	const int trim = get_trim_threshold(dcache, "ts", dcache_limit,
+			&threshold, &ties);
+
+	int i, n;
+	for(i = 0, n = json_object_get_count(dcache); i < n; ++i)
+	{
+		const char *path = json_object_get_name(dcache, i);
+		JSON_Object *entry = json_object(json_object_get_value_at(dcache, i));
+
+		double size, inode, ts;
+		if(!get_double(entry, "size", &size) || !get_double(entry, "inode", &inode)
+				|| !get_double(entry, "ts", &ts))
+		{
+			continue;
+		}
+
+		if(trim && (ts < threshold || (ts == threshold && ties-- <= 0)))
+		{
+			continue;
+		}
+
+		(void)dcache_restore_size(path, (uint64_t)inode, (uint64_t)size,
+				(time_t)ts);
+	}
+}
+
+/* Loads cached digests of contents of files from JSON. */
+static void
+load_hashes(JSON_Object *root)
+{
+	JSON_Object *hashes = json_object_get_object(root, "hashes");
+
+	int i, n;
+	for(i = 0, n = json_object_get_count(hashes); i < n; ++i)
+	{
+		const char *name = json_object_get_name(hashes, i);
+		JSON_Object *entry = json_object(json_object_get_value_at(hashes, i));
+
+		hcache_key_t key;
+		hcache_digest_t digest;
+		const char *digest_str;
+		double used;
+		/* Entries with fewer fields come from older versions which didn't store
+		 * enough information to identify state of a file. */
+		if(sscanf(name, "%" SCNu64 ":%" SCNu64 ":%" SCNu64 ":%" SCNu64 ":%" SCNu64
+					":%" SCNu64, &key.dev, &key.inode, &key.size, &key.mtime_ns,
+					&key.ctime_ns, &key.prefix) == 6 &&
+				get_str(entry, "digest", &digest_str) &&
+				strlen(digest_str) == 32 &&
+				sscanf(digest_str, "%16" SCNx64 "%16" SCNx64, &digest.high,
+					&digest.low) == 2 &&
+				get_double(entry, "used", &used))
+		{
+			hcache_restore(&key, &digest, (time_t)used);
+		}
+	}
+}
+
 /* Loads history data from JSON. */
 static void
 load_history(JSON_Object *root, const char node[], hist_t *hist)
@@ -1292,8 +1461,27 @@ write_info_file(void)
 {
 	char info_file[PATH_MAX + 16];
 	snprintf(info_file, sizeof(info_file), "%s/vifminfo.json", cfg.config_dir);
+	char journal[PATH_MAX + 32];
+	get_journal_file(journal, sizeof(journal));
+
+	if(append_to_journal(info_file, journal, cfg.vifm_info) != 0)
+	{
+		store_file(info_file, journal, &vifminfo_mon, cfg.vifm_info);
+	}
+}
+
+/* Changes size of vifminfo.json starting with which journal is used. */
+TSTATIC void
+state_set_journal_threshold(uint64_t threshold)
+{
+	journal_threshold = threshold;
+}
 
-	store_file(info_file, &vifminfo_mon, cfg.vifm_info);
+/* Changes maximum number of cached sizes of directories that are stored. */
+TSTATIC void
+state_set_dcache_limit(int limit)
+{
+	dcache_limit = limit;
 }
 
 /* Copies the src file to the dst location.  Returns zero on success. */
@@ -1309,10 +1497,343 @@ copy_file(const char src[], const char dst[])
 	return (iop_cp(&args) == IO_RES_SUCCEEDED ? 0 : 1);
 }
 
+/* Reads vifminfo.json and applies journal to it.  Returns JSON value or NULL
+ * on error. */
+static JSON_Value *
+read_info_file(const char info_file[])
+{
+	char journal[PATH_MAX + 32];
+	get_journal_file(journal, sizeof(journal));
+
+	char *locale = drop_locale();
+	JSON_Value *state = json_parse_file(info_file);
+	if(state != NULL)
+	{
+		state = replay_journal(state, journal, info_file);
+		forget_nodes();
+		remember_nodes(json_object(state));
+	}
+	restore_locale(locale);
+
+	return state;
+}
+
+/* Appends changes of state of the current instance to the journal instead of
+ * rewriting info file.  This is done only for large info files and while the
+ * journal is small compared to them.  Returns zero on success and non-zero if
+ * info file needs to be rewritten. */
+static int
+append_to_journal(const char info_file[], const char journal[], int vinfo)
+{
+	const uint64_t info_size = get_file_size(info_file);
+	if(info_size == 0U || info_size < journal_threshold)
+	{
+		return 1;
+	}
+
+	const uint64_t journal_size = get_file_size(journal);
+	if(journal_size > info_size/2U)
+	{
+		/* It's time to fold the journal into the info file. */
+		return 1;
+	}
+	if(journal_size != 0U && !journal_is_current(journal, info_file))
+	{
+		return 1;
+	}
+
+	char *locale = drop_locale();
+
+	JSON_Value *current = serialize_state(vinfo);
+	JSON_Object *root = json_object(current);
+
+	char **unchanged = NULL;
+	int nunchanged = 0;
+
+	int i, n;
+	for(i = 0, n = json_object_get_count(root); i < n; ++i)
+	{
+		const char *name = json_object_get_name(root, i);
+		if(is_known_node(name, hash_node(json_object_get_value_at(root, i))))
+		{
+			nunchanged = add_to_string_array(&unchanged, nunchanged, name);
+		}
+	}
+
+	JSON_Value *record_value = json_value_init_object();
+	JSON_Object *record = json_object(record_value);
+	set_int(record, "vinfo", vinfo);
+	JSON_Array *kept = add_array(record, "kept");
+	for(i = 0; i < nunchanged; ++i)
+	{
+		json_array_append_string(kept, unchanged[i]);
+		json_object_remove(root, unchanged[i]);
+	}
+	free_string_array(unchanged, nunchanged);
+	json_object_set_value(record, "state", current);
+
+	char *line = json_serialize_to_string(record_value);
+	int error = (line == NULL || write_journal_line(journal, info_file, line));
+	json_free_serialized_string(line);
+
+	if(!error)
+	{
+		/* What was written is now the base for the next record. */
+		remember_nodes(root);
+	}
+
+	json_value_free(record_value);
+	restore_locale(locale);
+	return error;
+}
+
+/* Appends a line to the journal creating it if necessary.  Returns zero on
+ * success. */
+static int
+write_journal_line(const char journal[], const char info_file[],
+		const char line[])
+{
+	struct stat st;
+	if(os_stat(info_file, &st) != 0)
+	{
+		return 1;
+	}
+
+	const int new_journal = (get_file_size(journal) == 0U);
+
+	FILE *fp = os_fopen(journal, "ab");
+	if(fp == NULL)
+	{
+		return 1;
+	}
+
+	/* Other instances might be appending at the same time, so don't let the
+	 * stream split lines into several writes. */
+	setvbuf(fp, NULL, _IONBF, 0);
+
+	int error = 0;
+
+	if(new_journal)
+	{
+		error |= (fprintf(fp, "{\"info-size\":%" PRIu64 ",\"info-mtime\":%" PRIu64
+					"}\n", (uint64_t)st.st_size, (uint64_t)st.st_mtime) < 0);
+	}
+
+	const size_t len = strlen(line);
+	char *const buf = malloc(len + 2U);
+	if(buf == NULL)
+	{
+		error = 1;
+	}
+	else
+	{
+		memcpy(buf, line, len);
+		buf[len] = '\n';
+		buf[len + 1U] = '\0';
+		error |= (fwrite(buf, 1U, len + 1U, fp) != len + 1U);
+		free(buf);
+	}
+
+	error |= (fclose(fp) != 0);
+	return error;
+}
+
+/* Applies records of the journal on top of the state if the journal belongs to
+ * current version of info file.  Returns new state. */
+static JSON_Value *
+replay_journal(JSON_Value *state, const char journal[], const char info_file[])
+{
+	FILE *fp = os_fopen(journal, "rb");
+	if(fp == NULL)
+	{
+		return state;
+	}
+
+	if(read_journal_header(fp, info_file))
+	{
+		char *line = NULL;
+		while((line = read_line(fp, line)) != NULL)
+		{
+			/* Incomplete or malformed records are skipped. */
+			JSON_Value *record = json_parse_string(line);
+			if(record != NULL)
+			{
+				state = apply_journal_record(state, json_object(record));
+				json_value_free(record);
+			}
+		}
+	}
+
+	fclose(fp);
+	return state;
+}
+
+/* Checks whether the journal belongs to current version of info file.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+journal_is_current(const char journal[], const char info_file[])
+{
+	FILE *fp = os_fopen(journal, "rb");
+	if(fp == NULL)
+	{
+		return 0;
+	}
+
+	const int current = read_journal_header(fp, info_file);
+	fclose(fp);
+	return current;
+}
+
+/* Reads header of the journal and compares it against info file.  Returns
+ * non-zero if they match, otherwise zero is returned. */
+static int
+read_journal_header(FILE *fp, const char info_file[])
+{
+	char *line = read_line(fp, NULL);
+	if(line == NULL)
+	{
+		return 0;
+	}
+
+	JSON_Value *header = json_parse_string(line);
+	free(line);
+	if(header == NULL)
+	{
+		return 0;
+	}
+
+	struct stat st;
+	double size, mtime;
+	const int match = os_stat(info_file, &st) == 0
+	               && get_double(json_object(header), "info-size", &size)
+	               && get_double(json_object(header), "info-mtime", &mtime)
+	               && size == (double)st.st_size
+	               && mtime == (double)st.st_mtime;
+
+	json_value_free(header);
+	return match;
+}
+
+/* Applies a record of the journal to the state in the same way as it would have
+ * been merged into info file at the time the record was made.  Returns new
+ * state. */
+static JSON_Value *
+apply_journal_record(JSON_Value *state, const JSON_Object *record)
+{
+	int vinfo;
+	JSON_Object *changes = json_object_get_object(record, "state");
+	if(changes == NULL || !get_int(record, "vinfo", &vinfo))
+	{
+		return state;
+	}
+
+	JSON_Value *current_value =
+		json_value_deep_copy(json_object_get_wrapping_value(changes));
+	JSON_Object *current = json_object(current_value);
+
+	merge_states(vinfo, 0, current, json_object(state));
+
+	/* Nodes that weren't changed by the writer remain as they are. */
+	JSON_Array *kept = json_object_get_array(record, "kept");
+	int i, n;
+	for(i = 0, n = json_array_get_count(kept); i < n; ++i)
+	{
+		const char *name = json_array_get_string(kept, i);
+		JSON_Value *value = (name == NULL)
+		                  ? NULL
+		                  : json_object_get_value(json_object(state), name);
+		if(value != NULL)
+		{
+			json_object_set_value(current, name, json_value_deep_copy(value));
+		}
+	}
+
+	json_value_free(state);
+	return current_value;
+}
+
+/* Forgets hashes of top-level nodes of info file. */
+static void
+forget_nodes(void)
+{
+	free_string_array(node_names, node_count);
+	free(node_hashes);
+	node_names = NULL;
+	node_hashes = NULL;
+	node_count = 0;
+}
+
+/* Remembers hashes of top-level nodes of the state as those of info file. */
+static void
+remember_nodes(const JSON_Object *state)
+{
+	int i, n;
+	for(i = 0, n = json_object_get_count(state); i < n; ++i)
+	{
+		const char *name = json_object_get_name(state, i);
+		const uint64_t hash = hash_node(json_object_get_value_at(state, i));
+
+		int j = string_array_pos(node_names, node_count, name);
+		if(j < 0)
+		{
+			uint64_t *hashes = reallocarray(node_hashes, node_count + 1,
+					sizeof(*hashes));
+			if(hashes == NULL)
+			{
+				continue;
+			}
+			node_hashes = hashes;
+
+			j = node_count;
+			if(add_to_string_array(&node_names, node_count, name) == node_count)
+			{
+				continue;
+			}
+			++node_count;
+		}
+
+		node_hashes[j] = hash;
+	}
+}
+
+/* Checks whether the node with specified hash is the same in info file.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+is_known_node(const char name[], uint64_t hash)
+{
+	const int pos = string_array_pos(node_names, node_count, name);
+	return (pos >= 0 && node_hashes[pos] == hash);
+}
+
+/* Computes hash of serialized form of a JSON value.  Returns the hash. */
+static uint64_t
+hash_node(const JSON_Value *value)
+{
+	char *str = json_serialize_to_string(value);
+	if(str == NULL)
+	{
+		return 0U;
+	}
+
+	/* FNV-1a. */
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	const char *p;
+	for(p = str; *p != '\0'; ++p)
+	{
+		hash = (hash ^ (unsigned char)*p)*0x100000001b3ULL;
+	}
+
+	json_free_serialized_string(str);
+	return hash;
+}
+
 /* Reads contents of the filename file as a JSON info file and updates it with
- * the state of current instance. */
+ * the state of current instance.  info_file is NULL for session files,
+ * otherwise filename is a copy of it and journal (can be NULL) is applied to
+ * its contents. */
 static void
-update_info_file(const char filename[], int vinfo, int merge)
+update_info_file(const char filename[], const char journal[],
+		const char info_file[], int vinfo, int merge)
 {
 	char *locale = drop_locale();
 	JSON_Value *current = serialize_state(vinfo);
@@ -1322,6 +1843,10 @@ update_info_file(const char filename[], int vinfo, int merge)
 		JSON_Value *admixture = json_parse_file(filename);
 		if(admixture != NULL)
 		{
+			if(journal != NULL)
+			{
+				admixture = replay_journal(admixture, journal, info_file);
+			}
 			merge_states(vinfo, 0, json_object(current), json_object(admixture));
 			json_value_free(admixture);
 		}
@@ -1332,6 +1857,12 @@ update_info_file(const char filename[], int vinfo, int merge)
 		LOG_ERROR_MSG("Error storing state to: %s", filename);
 	}
 
+	if(info_file != NULL)
+	{
+		forget_nodes();
+		remember_nodes(json_object(current));
+	}
+
 	json_value_free(current);
 	restore_locale(locale);
 }
@@ -1472,6 +2003,16 @@ serialize_state(int vinfo)
 		set_str(root, "color-scheme", cfg.cs.name);
 	}
 
+	if(vinfo & VINFO_DCACHE)
+	{
+		store_dcache(root);
+	}
+
+	if(vinfo & VINFO_HASHES)
+	{
+		store_hashes(root);
+	}
+
 	return root_value;
 }
 
@@ -1550,6 +2091,16 @@ merge_states(int vinfo, int session_load, JSON_Object *current,
 		merge_options(current, admixture);
 	}
 
+	if(vinfo & VINFO_DCACHE)
+	{
+		merge_dcache(current, admixture);
+	}
+
+	if(vinfo & VINFO_HASHES)
+	{
+		merge_hashes(current, admixture);
+	}
+
 	merge_trash(current, admixture);
 
 	if(session_load)
@@ -2110,6 +2661,170 @@ merge_trash(JSON_Object *current, const JSON_Object *admixture)
 	}
 }
 
+/* Merges two sets of cached sizes of directories.  Newer entries win and the
+ * oldest ones are dropped to keep the set bounded. */
+static void
+merge_dcache(JSON_Object *current, const JSON_Object *admixture)
+{
+	JSON_Object *dcache = json_object_get_object(current, "dcache");
+	JSON_Object *updated = json_object_get_object(admixture, "dcache");
+	if(dcache == NULL)
+	{
+		clone_object(current, updated, "dcache");
+		return;
+	}
+
+	int i, n;
+	for(i = 0, n = json_object_get_count(updated); i < n; ++i)
+	{
+		JSON_Object *entry = json_object(json_object_get_value_at(updated, i));
+		const char *path = json_object_get_name(updated, i);
+
+		double ts, current_ts;
+		if(!get_double(entry, "ts", &ts))
+		{
+			continue;
+		}
+
+		JSON_Object *current_entry = json_object_get_object(dcache, path);
+		if(current_entry == NULL || !get_double(current_entry, "ts", &current_ts) ||
+				current_ts < ts)
+		{
+			JSON_Value *value = json_object_get_wrapping_value(entry);
+			json_object_set_value(dcache, path, json_value_deep_copy(value));
+		}
+	}
+
+	trim_by_timestamp(dcache, "ts", dcache_limit);
+}
+
+/* Merges two sets of cached digests of files.  More recently used entries win
+ * and the least recently used ones are dropped to keep the set bounded. */
+static void
+merge_hashes(JSON_Object *current, const JSON_Object *admixture)
+{
+	JSON_Object *hashes = json_object_get_object(current, "hashes");
+	JSON_Object *updated = json_object_get_object(admixture, "hashes");
+	if(hashes == NULL)
+	{
+		clone_object(current, updated, "hashes");
+		return;
+	}
+
+	int i, n;
+	for(i = 0, n = json_object_get_count(updated); i < n; ++i)
+	{
+		JSON_Object *entry = json_object(json_object_get_value_at(updated, i));
+		const char *name = json_object_get_name(updated, i);
+
+		double used, current_used;
+		if(!get_double(entry, "used", &used))
+		{
+			continue;
+		}
+
+		JSON_Object *current_entry = json_object_get_object(hashes, name);
+		if(current_entry == NULL ||
+				!get_double(current_entry, "used", &current_used) ||
+				current_used < used)
+		{
+			JSON_Value *value = json_object_get_wrapping_value(entry);
+			json_object_set_value(hashes, name, json_value_deep_copy(value));
+		}
+	}
+
+	trim_by_timestamp(hashes, "used", hcache_capacity());
+}
+
+/* Removes entries of the object with the oldest timestamps stored under the key
+ * until there are at most max_count of them.  Entries without the timestamp are
+ * considered to be the oldest ones. */
+static void
+trim_by_timestamp(JSON_Object *obj, const char key[], int max_count)
+{
+	double threshold;
+	int ties;
+	if(!get_trim_threshold(obj, key, max_count, &threshold, &ties))
+	{
+		return;
+	}
+
+	int i;
+	for(i = 0; i < (int)json_object_get_count(obj); )
+	{
+		JSON_Object *entry = json_object(json_object_get_value_at(obj, i));
+		const double ts = get_timestamp(entry, key);
+		if(ts > threshold || (ts == threshold && ties-- > 0))
+		{
+			++i;
+			continue;
+		}
+
+		/* The last entry takes place of the removed one. */
+		json_object_remove(obj, json_object_get_name(obj, i));
+	}
+}
+
+/* Determines which entries of the object are left by keeping at most max_count
+ * of them with the newest timestamps stored under the key.  *threshold is set
+ * to the oldest timestamp that's kept and *ties to the number of entries with
+ * exactly that timestamp that fit.  Returns non-zero if some entries need to be
+ * dropped, otherwise zero is returned. */
+static int
+get_trim_threshold(JSON_Object *obj, const char key[], int max_count,
+		double *threshold, int *ties)
+{
+	const int n = json_object_get_count(obj);
+	if(n <= max_count)
+	{
+		return 0;
+	}
+
+	double *stamps = reallocarray(NULL, n, sizeof(*stamps));
+	if(stamps == NULL)
+	{
+		return 0;
+	}
+
+	int i;
+	for(i = 0; i < n; ++i)
+	{
+		stamps[i] = get_timestamp(json_object(json_object_get_value_at(obj, i)),
+				key);
+	}
+
+	safe_qsort(stamps, n, sizeof(*stamps), &used_sorter);
+	*threshold = stamps[max_count - 1];
+
+	*ties = 0;
+	for(i = max_count - 1; i >= 0 && stamps[i] == *threshold; --i)
+	{
+		++*ties;
+	}
+
+	free(stamps);
+	return 1;
+}
+
+/* Retrieves timestamp of an entry stored under the key.  Returns the timestamp
+ * or zero if it's missing. */
+static double
+get_timestamp(JSON_Object *entry, const char key[])
+{
+	double ts;
+	return (get_double(entry, key, &ts) ? ts : 0);
+}
+
+/* qsort() comparer that sorts timestamps in descending order.  Returns standard
+ * -1, 0, 1 for comparisons. */
+static int
+used_sorter(const void *first, const void *second)
+{
+	const double *a = first;
+	const double *b = second;
+	return SORT_CMP(*b, *a);
+}
+
 /* Serializes a global tab into JSON table. */
 static void
 store_gtab(int vinfo, JSON_Object *gtab, const char name[], const
@@ -2309,6 +3024,7 @@ store_global_options(JSON_Object *root)
 #ifndef _WIN32
 	append_dstr(options, format_str("slowfs=%s",
 				escape_spaces(cfg.slow_fs_list)));
+	append_dstr(options, format_str("slowfspoll=%d", cfg.slow_fs_poll));
 #endif
 	append_dstr(options, format_str("%ssmartcase", cfg.smart_case ? "" : "no"));
 	append_dstr(options, format_str("%ssortnumbers",
@@ -2563,6 +3279,106 @@ store_dir_stack(JSON_Object *root)
 	}
 }
 
+/* Serializes cached sizes of directories into JSON table.  Only the newest
+ * entries are stored to keep the table bounded. */
+static void
+store_dcache(JSON_Object *root)
+{
+	JSON_Object *dcache = add_object(root, "dcache");
+
+	dcache_recs_t recs = {};
+	dcache_list_sizes(&collect_dcache_entry, &recs);
+
+	safe_qsort(recs.recs, recs.count, sizeof(*recs.recs), &dcache_rec_sorter);
+
+	int i;
+	for(i = 0; i < recs.count; ++i)
+	{
+		const dcache_rec_t *const rec = &recs.recs[i];
+		if(i < dcache_limit)
+		{
+			JSON_Object *entry = add_object(dcache, rec->path);
+			set_double(entry, "size", rec->size);
+			set_double(entry, "inode", rec->inode);
+			set_double(entry, "ts", rec->ts);
+		}
+		free(rec->path);
+	}
+	free(recs.recs);
+}
+
+/* dcache_list_sizes() callback that collects entries into dcache_recs_t. */
+static void
+collect_dcache_entry(const char path[], uint64_t inode, uint64_t size,
+		time_t ts, void *arg)
+{
+	dcache_recs_t *const recs = arg;
+
+	if(recs->count == recs->capacity)
+	{
+		const int capacity = (recs->capacity == 0 ? 64 : recs->capacity*2);
+		dcache_rec_t *const new_recs = reallocarray(recs->recs, capacity,
+				sizeof(*new_recs));
+		if(new_recs == NULL)
+		{
+			return;
+		}
+		recs->recs = new_recs;
+		recs->capacity = capacity;
+	}
+
+	char *const path_copy = strdup(path);
+	if(path_copy == NULL)
+	{
+		return;
+	}
+
+	dcache_rec_t *const rec = &recs->recs[recs->count++];
+	rec->path = path_copy;
+	rec->inode = inode;
+	rec->size = size;
+	rec->ts = ts;
+}
+
+/* qsort() comparer that sorts dcache_rec_t by timestamp in descending order.
+ * Returns standard -1, 0, 1 for comparisons. */
+static int
+dcache_rec_sorter(const void *first, const void *second)
+{
+	const dcache_rec_t *a = first;
+	const dcache_rec_t *b = second;
+	return SORT_CMP(b->ts, a->ts);
+}
+
+/* Serializes cached digests of contents of files into JSON table. */
+static void
+store_hashes(JSON_Object *root)
+{
+	JSON_Object *hashes = add_object(root, "hashes");
+	hcache_list(&store_hashes_entry, hashes);
+}
+
+/* hcache_list() callback that writes an entry into JSON. */
+static void
+store_hashes_entry(const hcache_key_t *key, const hcache_digest_t *digest,
+		time_t used, void *arg)
+{
+	JSON_Object *hashes = arg;
+
+	char name[128];
+	snprintf(name, sizeof(name), "%" PRIu64 ":%" PRIu64 ":%" PRIu64 ":%" PRIu64
+			":%" PRIu64 ":%" PRIu64, key->dev, key->inode, key->size, key->mtime_ns,
+			key->ctime_ns, key->prefix);
+
+	char digest_str[33];
+	snprintf(digest_str, sizeof(digest_str), "%016" PRIx64 "%016" PRIx64,
+			digest->high, digest->low);
+
+	JSON_Object *entry = add_object(hashes, name);
+	set_str(entry, "digest", digest_str);
+	set_double(entry, "used", used);
+}
+
 /* Serializes trash into JSON table. */
 static void
 store_trash(JSON_Object *root)
@@ -2984,10 +3800,11 @@ sessions_load(const char name[])
 		return 1;
 	}
 
+	restore_locale(locale);
+
 	char info_file[PATH_MAX + 16];
 	snprintf(info_file, sizeof(info_file), "%s/vifminfo.json", cfg.config_dir);
-	JSON_Value *common = json_parse_file(info_file);
-	restore_locale(locale);
+	JSON_Value *common = read_info_file(info_file);
 
 	if(common != NULL)
 	{
@@ -3035,23 +3852,40 @@ write_session_file(void)
 	snprintf(session_file, sizeof(session_file), "%s/%s.json", sessions_dir,
 			cfg.session);
 
-	store_file(session_file, &session_mon, cfg.session_options);
+	store_file(session_file, /*journal=*/NULL, &session_mon,
+			cfg.session_options);
 }
 
-/* Writes file updating it with state of the current instance if necessary. */
+/* Writes file updating it with state of the current instance if necessary.
+ * Journal of the file is folded into it if journal isn't NULL. */
 static void
-store_file(const char path[], filemon_t *mon, int vinfo)
+store_file(const char path[], const char journal[], filemon_t *mon, int vinfo)
 {
 	char tmp_file[PATH_MAX + 64];
 	snprintf(tmp_file, sizeof(tmp_file), "%s_%u", path, get_pid());
 
+	/* Take the journal away to not lose records appended while the file is being
+	 * updated. */
+	char tmp_journal[PATH_MAX + 64];
+	const char *claimed = NULL;
+	if(journal != NULL && path_exists(journal, NODEREF))
+	{
+		snprintf(tmp_journal, sizeof(tmp_journal), "%s_%u", journal, get_pid());
+		if(rename_file(journal, tmp_journal) == 0)
+		{
+			claimed = tmp_journal;
+		}
+	}
+
 	if(os_access(path, R_OK) != 0 || copy_file(path, tmp_file) == 0)
 	{
 		filemon_t current_mon;
 		int file_changed = filemon_from_file(path, FMT_MODIFIED, &current_mon) != 0
-		                || !filemon_equal(mon, &current_mon);
+		                || !filemon_equal(mon, &current_mon)
+		                || claimed != NULL;
 
-		update_info_file(tmp_file, vinfo, file_changed);
+		update_info_file(tmp_file, claimed, journal == NULL ? NULL : path, vinfo,
+				file_changed);
 		(void)filemon_from_file(tmp_file, FMT_MODIFIED, mon);
 
 		if(rename_file(tmp_file, path) != 0)
@@ -3060,6 +3894,11 @@ store_file(const char path[], filemon_t *mon, int vinfo)
 			(void)remove(tmp_file);
 		}
 	}
+
+	if(claimed != NULL)
+	{
+		(void)remove(claimed);
+	}
 }
 
 int
@@ -3109,5 +3948,12 @@ get_session_dir(char buf[], size_t buf_size)
 	snprintf(buf, buf_size, "%s/sessions", cfg.config_dir);
 }
 
+/* Fills buffer with the path of journal of vifminfo.json. */
+static void
+get_journal_file(char buf[], size_t buf_size)
+{
+	snprintf(buf, buf_size, "%s/vifminfo.journal", cfg.config_dir);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
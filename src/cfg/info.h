@@ -75,10 +75,14 @@ int sessions_remove(const char name[]);
 void sessions_complete(const char prefix[]);
 
 #ifdef TEST
+#include <stdint.h> /* uint64_t */
+
 #include "../utils/parson.h"
 #endif
 TSTATIC_DEFS(
 	void write_info_file(void);
+	void state_set_journal_threshold(uint64_t threshold);
+	void state_set_dcache_limit(int limit);
 	char * drop_locale(void);
 	void restore_locale(char locale[]);
 	JSON_Value * serialize_state(int vinfo);
@@ -21,12 +21,14 @@
 #include <assert.h> /* assert() */
 #include <stddef.h> /* size_t */
 #include <stdint.h> /* INTPTR_MAX INT64_MAX */
-#include <stdio.h> /* FILE fclose() feof() fopen() fread() */
-#include <stdlib.h> /* free() malloc() */
-#include <string.h> /* memcmp() */
+#include <stdio.h> /* FILE _IONBF fclose() ferror() fread() setvbuf()
+                      snprintf() */
+#include <stdlib.h> /* calloc() free() malloc() */
+#include <string.h> /* memcmp() strcmp() strdup() */
 
 #include "compat/fs_limits.h"
 #include "compat/os.h"
+#include "compat/pthread.h"
 #include "compat/reallocarray.h"
 #include "modes/dialogs/msg_dialog.h"
 #include "ui/cancellation.h"
@@ -41,52 +43,88 @@
 #include "utils/string_array.h"
 #include "utils/trie.h"
 #include "utils/utils.h"
+#include "utils/workers.h"
 #include "filelist.h"
 #include "filtering.h"
 #include "flist_sel.h"
 #include "fops_common.h"
 #include "fops_cpmv.h"
 #include "fops_misc.h"
+#include "hcache.h"
 #include "running.h"
 #include "undo.h"
 
 /*
  * Optimization for content-based matching.
  *
- * At first fingerprint uses only size of the file, then it's looked up to see
- * if there is any other file of the same size.  If there isn't, store compare
- * record by that fingerprint.
- *
- * If there is, two cases are possible:
- *   - there is only one conflicting file and its contents fingerprint wasn't
- *     yet computed:
- *       * compute contents fingerprint for that file and insert it
- *       * compute contents fingerprint for current file and insert it
- *   - there is more than one conflicting file:
- *       * compute contents fingerprint for current file and insert it
+ * Only files whose size matches size of at least one other file (in any of the
+ * compared lists) can have identical contents.  Digests of prefixes of such
+ * files are computed first and full digests are computed only for files whose
+ * size and digest of prefix match those of another file.  Hashing is done by a
+ * pool of threads.  Files with unique size are fingerprinted by size alone and
+ * those with unique prefix by digest of the prefix.  Files with equal 128-bit
+ * digests are considered to be identical.
  */
 
 /* This is the only unit that uses xxhash, so import it directly here. */
 #define XXH_PRIVATE_API
 #include "utils/xxhash.h"
 
-/* Amount of data to read at once when comparing files in full. */
-#define BLOCK_SIZE (32*1024)
+/* Amount of data to read at once when hashing files. */
+#define HASH_BLOCK_SIZE (1024*1024)
 
-/* Amount of data to hash for coarse comparison. */
+/* Size of prefix of a file that's hashed to find candidates for being
+ * identical. */
 #define PREFIX_SIZE (4*1024)
 
-/* Entry in singly-bounded list of files that have matched fingerprints. */
-typedef struct compare_record_t
+/* State of digest of file contents. */
+typedef enum
+{
+	DS_NONE,   /* Digest isn't needed, file has unique size. */
+	DS_OK,     /* Digest was computed successfully. */
+	DS_FAILED, /* Failed to read the file. */
+}
+DigestState;
+
+/* Digest of contents of a file. */
+typedef struct
+{
+	DigestState state;  /* Whether hash field is meaningful. */
+	int partial;        /* Whether hash covers only prefix of the file. */
+	XXH128_hash_t hash; /* Digest of contents of the file. */
+}
+digest_t;
+
+/* List of files to be compared. */
+typedef struct
+{
+	entries_t list;    /* Entries of the files. */
+	digest_t *digests; /* Digests of entries of the list or NULL. */
+}
+diff_list_t;
+
+/* File whose contents is to be hashed. */
+typedef struct
 {
-	struct compare_record_t *next; /* Next entry in the list of conflicts. */
-	char *path;                    /* Full path to file with sample content. */
-	int id;                        /* Chosen id. */
-	unsigned is_partial : 1;       /* Shows that fingerprinting was lazy. */
-	unsigned is_readable : 1;      /* Shows that this file can be read.  If not,
-	                                  its contents is assumed to be empty. */
+	const dir_entry_t *entry; /* Entry of the file. */
+	digest_t *digest;         /* Where to store the result. */
 }
-compare_record_t;
+hash_job_t;
+
+/* State of parallel hashing of files. */
+typedef struct
+{
+	hash_job_t *jobs;      /* Files to hash. */
+	int count;             /* Number of elements in jobs array. */
+	int prefixes;          /* Whether only prefixes of files are hashed. */
+	uint64_t total_bytes;  /* Amount of data to hash. */
+	pthread_mutex_t lock;  /* Protects fields below. */
+	int done;              /* Number of processed jobs. */
+	uint64_t done_bytes;   /* Amount of data hashed so far. */
+	int last_progress;     /* Last reported progress in percents. */
+	pthread_t owner;       /* Thread that can report progress. */
+}
+hashing_t;
 
 static void make_unique_lists(entries_t curr, entries_t other);
 static void leave_only_dups(entries_t *curr, entries_t *other);
@@ -100,27 +138,40 @@ static void put_side_by_side_pair(dir_entry_t *curr, dir_entry_t *other,
 		int flags, compare_stats_t *stats);
 static int id_sorter(const void *first, const void *second);
 static void put_or_free(view_t *view, dir_entry_t *entry, int id, int take);
-static entries_t make_diff_list(trie_t *trie, view_t *view, int *next_id,
+static diff_list_t make_diff_list(view_t *view, int flags);
+static void compute_digests(diff_list_t *lists[], int nlists);
+static int size_is_shared(const uint64_t sizes[], int nsizes, uint64_t size);
+static int uint64_sorter(const void *first, const void *second);
+static void run_hashing(hash_job_t jobs[], int njobs, int prefixes);
+static int partition_for_full_hashing(hash_job_t jobs[], int njobs);
+static int hash_job_sorter(const void *first, const void *second);
+static int prefix_sorter(const void *first, const void *second);
+static int prefixes_match(const digest_t *a, const digest_t *b);
+static void hash_files(void *arg, int from, int to);
+static void update_progress(hashing_t *hashing, uint64_t bytes, int jobs);
+static entries_t assign_ids(trie_t *trie, diff_list_t *list, int *next_id,
 		CompareType ct, int dups_only, int flags);
+static void free_diff_list(diff_list_t *list);
 static void list_view_entries(const view_t *view, strlist_t *list);
 static int append_valid_nodes(const char name[], int valid,
 		const void *parent_data, void *data, void *arg);
 static void list_files_recursively(const view_t *view, const char path[],
 		int skip_dot_files, int flags, strlist_t *list);
 static char * get_file_fingerprint(const char path[], const dir_entry_t *entry,
-		CompareType ct, int flags, int lazy);
-static char * get_contents_fingerprint(const char path[], int is_readable,
-		unsigned long long size);
+		CompareType ct, int flags, const digest_t *digest);
 static int add_file_to_diff(trie_t *trie, const char path[], dir_entry_t *entry,
-		CompareType ct, int dups_only, int flags, int *next_id);
+		CompareType ct, int dups_only, int flags, const digest_t *digest,
+		int *next_id);
 static int filetype_is_readable(FileType type);
-static int files_are_identical(const char a[], int a_readable, const char b[],
-		int b_readable);
-static int file_is_empty(const char path[]);
-static void put_file_id(trie_t *trie, const char path[],
-		const char fingerprint[], int id, int is_readable, int is_partial,
-		CompareType ct);
-static void free_compare_records(void *ptr);
+static DigestState hash_prefix(const dir_entry_t *entry, digest_t *digest);
+static DigestState hash_file(const dir_entry_t *entry, XXH128_hash_t *hash,
+		hashing_t *hashing);
+static int get_cached_digest(const hcache_key_t *key, XXH128_hash_t *hash);
+static void cache_digest(const char path[], const hcache_key_t *key,
+		const XXH128_hash_t *hash);
+static DigestState read_and_hash(const char path[], XXH128_hash_t *hash,
+		hashing_t *hashing);
+static void put_file_id(trie_t *trie, const char fingerprint[], int id);
 static void compare_move_entry(ops_t *ops, view_t *from, view_t *to, int idx);
 
 int
@@ -143,11 +194,19 @@ compare_two_panes(CompareType ct, ListType lt, int flags)
 	int next_id = 1;
 	entries_t curr, other;
 
-	trie_t *const trie = trie_create(&free_compare_records);
+	trie_t *const trie = trie_create(&free);
 	ui_cancellation_push_on();
 
-	curr = make_diff_list(trie, curr_view, &next_id, ct, /*dups_only=*/0, flags);
-	other = make_diff_list(trie, other_view, &next_id, ct, lt == LT_DUPS, flags);
+	diff_list_t curr_list = make_diff_list(curr_view, flags);
+	diff_list_t other_list = make_diff_list(other_view, flags);
+	if(ct == CT_CONTENTS)
+	{
+		diff_list_t *lists[] = { &curr_list, &other_list };
+		compute_digests(lists, ARRAY_LEN(lists));
+	}
+
+	curr = assign_ids(trie, &curr_list, &next_id, ct, /*dups_only=*/0, flags);
+	other = assign_ids(trie, &other_list, &next_id, ct, lt == LT_DUPS, flags);
 
 	ui_cancellation_pop();
 	trie_free(trie);
@@ -610,10 +669,17 @@ compare_one_pane(view_t *view, CompareType ct, ListType lt, int flags)
 	int next_id = 1;
 	entries_t curr;
 
-	trie_t *trie = trie_create(&free_compare_records);
+	trie_t *trie = trie_create(&free);
 	ui_cancellation_push_on();
 
-	curr = make_diff_list(trie, view, &next_id, ct, /*dups_only=*/0, flags);
+	diff_list_t list = make_diff_list(view, flags);
+	if(ct == CT_CONTENTS)
+	{
+		diff_list_t *lists[] = { &list };
+		compute_digests(lists, ARRAY_LEN(lists));
+	}
+
+	curr = assign_ids(trie, &list, &next_id, ct, /*dups_only=*/0, flags);
 
 	ui_cancellation_pop();
 	trie_free(trie);
@@ -715,18 +781,16 @@ put_or_free(view_t *view, dir_entry_t *entry, int id, int take)
 	}
 }
 
-/* Makes sorted by path list of entries that.  The trie is used to keep track of
- * identical files.  With non-zero dups_only, new files aren't added to the
- * trie. */
-static entries_t
-make_diff_list(trie_t *trie, view_t *view, int *next_id, CompareType ct,
-		int dups_only, int flags)
+/* Makes sorted by path list of entries of files to be compared.  Ids of the
+ * entries aren't assigned yet.  Returns the list. */
+static diff_list_t
+make_diff_list(view_t *view, int flags)
 {
 	const int skip_empty = flags & CF_SKIP_EMPTY;
 
 	int i;
 	strlist_t files = {};
-	entries_t r = {};
+	diff_list_t r = {};
 	int last_progress = 0;
 
 	show_progress("Listing...", 0);
@@ -746,8 +810,8 @@ make_diff_list(trie_t *trie, view_t *view, int *next_id, CompareType ct,
 	{
 		int progress;
 		const char *const path = files.items[i];
-		dir_entry_t *const entry = entry_list_add(view, &r.entries, &r.nentries,
-				path);
+		dir_entry_t *const entry = entry_list_add(view, &r.list.entries,
+				&r.list.nentries, path);
 		if(entry == NULL)
 		{
 			/* Maybe the file doesn't exist anymore, maybe we've lost access to it or
@@ -758,19 +822,11 @@ make_diff_list(trie_t *trie, view_t *view, int *next_id, CompareType ct,
 		if(skip_empty && entry->size == 0)
 		{
 			fentry_free(entry);
-			--r.nentries;
+			--r.list.nentries;
 			continue;
 		}
 
 		entry->tag = i;
-		entry->id = add_file_to_diff(trie, path, entry, ct, dups_only, flags,
-				next_id);
-
-		if(entry->id == -1)
-		{
-			fentry_free(entry);
-			--r.nentries;
-		}
 
 		progress = (i*100)/files.nitems;
 		if(progress != last_progress)
@@ -788,6 +844,310 @@ make_diff_list(trie_t *trie, view_t *view, int *next_id, CompareType ct,
 	return r;
 }
 
+/* Computes digests of contents of files which have at least one other file of
+ * the same size in any of the lists.  Hashing is done by a pool of threads. */
+static void
+compute_digests(diff_list_t *lists[], int nlists)
+{
+	int i, j;
+
+	int nsizes = 0;
+	for(i = 0; i < nlists; ++i)
+	{
+		nsizes += lists[i]->list.nentries;
+	}
+
+	uint64_t *const sizes = reallocarray(NULL, nsizes, sizeof(*sizes));
+	hash_job_t *const jobs = reallocarray(NULL, nsizes, sizeof(*jobs));
+	if(sizes == NULL || jobs == NULL)
+	{
+		free(sizes);
+		free(jobs);
+		return;
+	}
+
+	nsizes = 0;
+	for(i = 0; i < nlists; ++i)
+	{
+		diff_list_t *const list = lists[i];
+		list->digests = calloc(list->list.nentries, sizeof(*list->digests));
+		for(j = 0; j < list->list.nentries; ++j)
+		{
+			sizes[nsizes++] = list->list.entries[j].size;
+		}
+	}
+	safe_qsort(sizes, nsizes, sizeof(*sizes), &uint64_sorter);
+
+	int njobs = 0;
+	for(i = 0; i < nlists; ++i)
+	{
+		diff_list_t *const list = lists[i];
+		for(j = 0; j < list->list.nentries && list->digests != NULL; ++j)
+		{
+			const dir_entry_t *const entry = &list->list.entries[j];
+			if(size_is_shared(sizes, nsizes, entry->size))
+			{
+				jobs[njobs].entry = entry;
+				jobs[njobs].digest = &list->digests[j];
+				++njobs;
+			}
+		}
+	}
+	free(sizes);
+
+	if(njobs != 0)
+	{
+		show_progress("Hashing...", 0);
+	}
+
+	/* Digests of all files being compared should fit in the cache, or cyclic
+	 * comparisons of large sets of files would evict all of them. */
+	hcache_reserve(njobs);
+	run_hashing(jobs, njobs, /*prefixes=*/1);
+	if(!ui_cancellation_requested())
+	{
+		const int nfull = partition_for_full_hashing(jobs, njobs);
+		hcache_reserve(njobs + nfull);
+		run_hashing(jobs, nfull, /*prefixes=*/0);
+	}
+
+	free(jobs);
+}
+
+/* Hashes files of the jobs (or only their prefixes) by a pool of threads. */
+static void
+run_hashing(hash_job_t jobs[], int njobs, int prefixes)
+{
+	/* Process large files first to balance load of threads. */
+	safe_qsort(jobs, njobs, sizeof(*jobs), &hash_job_sorter);
+
+	hashing_t hashing = {
+		.jobs = jobs,
+		.count = njobs,
+		.prefixes = prefixes,
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.owner = pthread_self(),
+	};
+
+	int i;
+	for(i = 0; i < njobs; ++i)
+	{
+		const uint64_t size = jobs[i].entry->size;
+		hashing.total_bytes += (prefixes ? MIN(size, PREFIX_SIZE) : size);
+	}
+
+	workers_for(njobs, /*chunk=*/1, workers_cpu_count(), &hash_files, &hashing);
+
+	pthread_mutex_destroy(&hashing.lock);
+}
+
+/* Moves jobs for files whose size and digest of prefix match those of another
+ * file to the beginning of the array.  Returns number of such jobs. */
+static int
+partition_for_full_hashing(hash_job_t jobs[], int njobs)
+{
+	safe_qsort(jobs, njobs, sizeof(*jobs), &prefix_sorter);
+
+	/* Swaps don't touch elements past the current one, but the previous one
+	 * can be moved, so it's remembered. */
+	const digest_t *prev = NULL;
+	int i, nfull = 0;
+	for(i = 0; i < njobs; ++i)
+	{
+		const digest_t *const digest = jobs[i].digest;
+		const int matches = (prev != NULL && prefixes_match(prev, digest))
+		                 || (i + 1 < njobs &&
+		                     prefixes_match(jobs[i + 1].digest, digest));
+		prev = digest;
+
+		if(matches)
+		{
+			const hash_job_t job = jobs[i];
+			jobs[i] = jobs[nfull];
+			jobs[nfull++] = job;
+		}
+	}
+	return nfull;
+}
+
+/* Checks whether there is more than one element with the specified value in
+ * the sorted array.  Returns non-zero if so, otherwise zero is returned. */
+static int
+size_is_shared(const uint64_t sizes[], int nsizes, uint64_t size)
+{
+	int l = 0, r = nsizes;
+	while(l < r)
+	{
+		const int m = l + (r - l)/2;
+		if(sizes[m] < size)
+		{
+			l = m + 1;
+		}
+		else
+		{
+			r = m;
+		}
+	}
+	return (l + 1 < nsizes && sizes[l] == size && sizes[l + 1] == size);
+}
+
+/* qsort() comparer that sorts numbers in ascending order.  Returns standard -1,
+ * 0, 1 for comparisons. */
+static int
+uint64_sorter(const void *first, const void *second)
+{
+	const uint64_t *a = first;
+	const uint64_t *b = second;
+	return SORT_CMP(*a, *b);
+}
+
+/* qsort() comparer that sorts hashing jobs by size of files in descending
+ * order.  Returns standard -1, 0, 1 for comparisons. */
+static int
+hash_job_sorter(const void *first, const void *second)
+{
+	const hash_job_t *a = first;
+	const hash_job_t *b = second;
+	return SORT_CMP(b->entry->size, a->entry->size);
+}
+
+/* qsort() comparer that groups hashing jobs by size of files and digests of
+ * their prefixes.  Returns standard -1, 0, 1 for comparisons. */
+static int
+prefix_sorter(const void *first, const void *second)
+{
+	const hash_job_t *a = first;
+	const hash_job_t *b = second;
+
+	if(a->entry->size != b->entry->size)
+	{
+		return SORT_CMP(a->entry->size, b->entry->size);
+	}
+	if(a->digest->hash.high64 != b->digest->hash.high64)
+	{
+		return SORT_CMP(a->digest->hash.high64, b->digest->hash.high64);
+	}
+	return SORT_CMP(a->digest->hash.low64, b->digest->hash.low64);
+}
+
+/* Checks whether two digests of prefixes are equal.  Returns non-zero if so,
+ * otherwise zero is returned. */
+static int
+prefixes_match(const digest_t *a, const digest_t *b)
+{
+	return a->state == DS_OK && b->state == DS_OK
+	    && a->partial && b->partial
+	    && XXH128_isEqual(a->hash, b->hash);
+}
+
+/* workers_for() callback that hashes a range of files. */
+static void
+hash_files(void *arg, int from, int to)
+{
+	hashing_t *const hashing = arg;
+
+	int i;
+	for(i = from; i < to && !ui_cancellation_requested(); ++i)
+	{
+		hash_job_t *const job = &hashing->jobs[i];
+		if(hashing->prefixes)
+		{
+			job->digest->state = hash_prefix(job->entry, job->digest);
+			update_progress(hashing, MIN(job->entry->size, PREFIX_SIZE), 1);
+		}
+		else
+		{
+			/* Progress is updated by bytes while the file is being read. */
+			job->digest->state = hash_file(job->entry, &job->digest->hash, hashing);
+			job->digest->partial = 0;
+			update_progress(hashing, 0U, 1);
+		}
+	}
+}
+
+/* Accounts for hashed data and processed jobs.  Progress is reported only by
+ * the thread that started hashing, but it's computed from work of all threads
+ * and is updated while a large file is being read. */
+static void
+update_progress(hashing_t *hashing, uint64_t bytes, int jobs)
+{
+	pthread_mutex_lock(&hashing->lock);
+	hashing->done += jobs;
+	hashing->done_bytes += bytes;
+	const int done = hashing->done;
+	const uint64_t done_bytes = MIN(hashing->done_bytes, hashing->total_bytes);
+	const int progress = (hashing->total_bytes == 0U)
+	                   ? (done*100)/hashing->count
+	                   : (int)((done_bytes*100)/hashing->total_bytes);
+	const int report = pthread_equal(pthread_self(), hashing->owner)
+	                && progress != hashing->last_progress;
+	if(report)
+	{
+		hashing->last_progress = progress;
+	}
+	pthread_mutex_unlock(&hashing->lock);
+
+	if(report)
+	{
+		char progress_msg[128];
+		snprintf(progress_msg, sizeof(progress_msg), "Hashing... %d (%2d%%)",
+				done, progress);
+		show_progress(progress_msg, -1);
+	}
+}
+
+/* Assigns ids to entries of the list dropping entries which should be skipped.
+ * The trie is used to keep track of identical files.  With non-zero dups_only,
+ * new files aren't added to the trie.  Frees the list.  Returns entries of the
+ * list. */
+static entries_t
+assign_ids(trie_t *trie, diff_list_t *list, int *next_id, CompareType ct,
+		int dups_only, int flags)
+{
+	entries_t r = list->list;
+
+	int i, j;
+	for(i = 0, j = 0; i < r.nentries; ++i)
+	{
+		dir_entry_t *const entry = &r.entries[i];
+
+		char path[PATH_MAX + 1];
+		get_full_path_of(entry, sizeof(path), path);
+
+		const digest_t *const digest = (list->digests == NULL)
+		                             ? NULL
+		                             : &list->digests[i];
+		entry->id = add_file_to_diff(trie, path, entry, ct, dups_only, flags,
+				digest, next_id);
+
+		if(entry->id == -1)
+		{
+			fentry_free(entry);
+			continue;
+		}
+
+		if(i != j)
+		{
+			r.entries[j] = *entry;
+		}
+		++j;
+	}
+	r.nentries = j;
+
+	list->list = (entries_t){};
+	free_diff_list(list);
+	return r;
+}
+
+/* Frees resources of the list, but not the list itself. */
+static void
+free_diff_list(diff_list_t *list)
+{
+	free_dir_entries(&list->list.entries, &list->list.nentries);
+	free(list->digests);
+	list->digests = NULL;
+}
+
 /* Fills the list with entries of the view in hierarchical order (pre-order tree
  * traversal). */
 static void
@@ -908,18 +1268,19 @@ list_files_recursively(const view_t *view, const char path[],
 }
 
 /* Computes fingerprint of the file specified by path and entry.  Type of the
- * fingerprint is determined by ct parameter.  Lazy fingerprint is an
- * optimization which prevents computing contents fingerprint until there is
- * more than one file of the given size.  Returns newly allocated string with
- * the fingerprint, which is empty or NULL on error. */
+ * fingerprint is determined by ct parameter.  For comparison by contents,
+ * precomputed digest is used if it's not NULL, otherwise contents is hashed
+ * here.  Returns newly allocated string with the fingerprint, which is empty or
+ * NULL on error. */
 static char *
 get_file_fingerprint(const char path[], const dir_entry_t *entry,
-		CompareType ct, int flags, int lazy)
+		CompareType ct, int flags, const digest_t *digest)
 {
 	switch(ct)
 	{
 		int case_sensitive;
 		char name[NAME_MAX + 1];
+		digest_t local_digest;
 
 		case CT_NAME:
 			if(flags & CF_IGNORE_CASE)
@@ -945,61 +1306,47 @@ get_file_fingerprint(const char path[], const dir_entry_t *entry,
 		case CT_SIZE:
 			return format_str("%" PRINTF_ULL, (unsigned long long)entry->size);
 		case CT_CONTENTS:
-			if(lazy)
+			/* Comparing by contents can't be done if file can't be read. */
+			if(os_access(path, R_OK) != 0)
 			{
-				/* Comparing by contents can't be done if file can't be read. */
-				if(os_access(path, R_OK) != 0)
-				{
-					return strdup("");
-				}
+				return strdup("");
+			}
 
-				return format_str("%" PRINTF_ULL, (unsigned long long)entry->size);
+			if(digest == NULL)
+			{
+				local_digest.state = hash_file(entry, &local_digest.hash, NULL);
+				local_digest.partial = 0;
+				digest = &local_digest;
 			}
-			return get_contents_fingerprint(path, filetype_is_readable(entry->type),
-					entry->size);
+
+			switch(digest->state)
+			{
+				case DS_NONE:
+					/* Size is unique, so it's enough to tell files apart. */
+					return format_str("%" PRINTF_ULL, (unsigned long long)entry->size);
+				case DS_OK:
+					/* Digests of prefixes are marked to never match full digests. */
+					return format_str("%" PRINTF_ULL "|%s%" PRINTF_ULL "|%" PRINTF_ULL,
+							(unsigned long long)entry->size, digest->partial ? "p" : "",
+							(unsigned long long)digest->hash.high64,
+							(unsigned long long)digest->hash.low64);
+				case DS_FAILED:
+					return strdup("");
+			}
+			break;
 	}
 	assert(0 && "Unexpected diffing type.");
 	return strdup("");
 }
 
-/* Makes fingerprint of file contents (all or of its fixed-size prefix,
- * whichever is smaller).  Returns the fingerprint as a string, which is empty
- * or NULL on error. */
-static char *
-get_contents_fingerprint(const char path[], int is_readable,
-		unsigned long long size)
-{
-	char contents[PREFIX_SIZE];
-	size_t len;
-
-	if(is_readable)
-	{
-		FILE *in = os_fopen(path, "rb");
-		if(in == NULL)
-		{
-			return strdup("");
-		}
-		len = fread(&contents, 1, sizeof(contents), in);
-		fclose(in);
-	}
-	else
-	{
-		/* This isn't an error, just treat such files (e.g., pipes and sockets) as
-		 * empty. */
-		len = 0;
-	}
-
-	const unsigned long long digest = XXH3_64bits(contents, len);
-	return format_str("%" PRINTF_ULL "|%" PRINTF_ULL, size, digest);
-}
-
 /* Looks up file in the trie by its fingerprint.  Returns id for the file or -1
  * if it should be skipped. */
 static int
 add_file_to_diff(trie_t *trie, const char path[], dir_entry_t *entry,
-		CompareType ct, int dups_only, int flags, int *next_id)
+		CompareType ct, int dups_only, int flags, const digest_t *digest,
+		int *next_id)
 {
-	char *fingerprint = get_file_fingerprint(path, entry, ct, flags, /*lazy=*/1);
+	char *fingerprint = get_file_fingerprint(path, entry, ct, flags, digest);
 	if(is_null_or_empty(fingerprint))
 	{
 		/* In case we couldn't obtain fingerprint (e.g., comparing by contents and
@@ -1011,73 +1358,11 @@ add_file_to_diff(trie_t *trie, const char path[], dir_entry_t *entry,
 	void *data = NULL;
 	(void)trie_get(trie, fingerprint, &data);
 
-	compare_record_t *record = data;
-	int is_partial = (ct == CT_CONTENTS);
-	int is_readable = filetype_is_readable(entry->type);
-
-	/* Comparison by contents is the only one when we need to account for lazy
-	 * fingerprint computation or resolve fingerprint conflicts. */
-	if(record != NULL && ct == CT_CONTENTS)
+	const int *const known_id = data;
+	if(known_id != NULL)
 	{
 		free(fingerprint);
-		is_partial = 0;
-
-		fingerprint = get_file_fingerprint(path, entry, ct, flags, /*lazy=*/0);
-		if(is_null_or_empty(fingerprint))
-		{
-			/* In case we couldn't obtain fingerprint (e.g., comparing by contents and
-			 * the file isn't readable), ignore the file and keep going. */
-			free(fingerprint);
-			return -1;
-		}
-
-		if(record->is_partial)
-		{
-			/* There is another file of the same size whose contents fingerprint
-			 * hasn't been computed yet.  Do it here.  Using `entry->size` is valid
-			 * because partial hash is just the size, so both entries must share
-			 * it. */
-			char *other_fingerprint = get_contents_fingerprint(record->path,
-					record->is_readable, entry->size);
-			if(is_null_or_empty(fingerprint))
-			{
-				/* That other file has issues, don't update it and skip any other file
-				 * that can conflict with it by size.  The file itself won't be skipped
-				 * though, should it be? */
-				free(other_fingerprint);
-				free(fingerprint);
-				return -1;
-			}
-
-			put_file_id(trie, record->path, other_fingerprint, record->id,
-					record->is_readable, /*is_partial=*/0, ct);
-			free(other_fingerprint);
-
-			record->is_partial = 0;
-		}
-
-		/* Repeat trie lookup with contents fingerprint. */
-		(void)trie_get(trie, fingerprint, &data);
-		record = data;
-
-		/* Fingerprint does not guarantee a match, go through files and find file
-		 * with identical contents. */
-		do
-		{
-			if(files_are_identical(path, is_readable, record->path,
-						record->is_readable))
-			{
-				break;
-			}
-			record = record->next;
-		}
-		while(record != NULL);
-	}
-
-	if(record != NULL)
-	{
-		free(fingerprint);
-		return record->id;
+		return *known_id;
 	}
 
 	if(dups_only)
@@ -1088,7 +1373,7 @@ add_file_to_diff(trie_t *trie, const char path[], dir_entry_t *entry,
 
 	int id = *next_id;
 	++*next_id;
-	put_file_id(trie, path, fingerprint, id, is_readable, is_partial, ct);
+	put_file_id(trie, fingerprint, id);
 
 	free(fingerprint);
 	return id;
@@ -1104,128 +1389,201 @@ filetype_is_readable(FileType type)
 	return (type == FT_LINK || type == FT_REG || type == FT_EXEC);
 }
 
-/* Checks whether two files specified by their names hold identical content.
- * Returns non-zero if so, otherwise zero is returned. */
-static int
-files_are_identical(const char a[], int a_readable, const char b[],
-		int b_readable)
+/* Computes digest of prefix of contents of a file or retrieves it from the
+ * cache.  digest->partial is set if the file is larger than the prefix,
+ * otherwise the digest is the same as full one.  Files that can't be read
+ * (e.g., pipes and sockets) are treated as empty.  Returns state of the
+ * digest. */
+static DigestState
+hash_prefix(const dir_entry_t *entry, digest_t *digest)
 {
-	/* Unreadable files are treated as empty. */
-	if(!a_readable && !b_readable)
+	digest->partial = 0;
+
+	if(!filetype_is_readable(entry->type))
 	{
-		return 1;
+		digest->hash = XXH3_128bits("", 0U);
+		return DS_OK;
 	}
-	if(a_readable && !b_readable)
+
+	char path[PATH_MAX + 1];
+	get_full_path_of(entry, sizeof(path), path);
+
+	/* Digest of a small file is its full digest. */
+	hcache_key_t key;
+	const int have_key = (hcache_key_of(path, &key) == 0);
+	if(have_key)
 	{
-		return file_is_empty(a);
+		key.prefix = (key.size > PREFIX_SIZE ? PREFIX_SIZE : 0);
+		if(get_cached_digest(&key, &digest->hash))
+		{
+			digest->partial = (key.prefix != 0);
+			return DS_OK;
+		}
 	}
-	if(!a_readable && b_readable)
+
+	FILE *const in = os_fopen(path, "rb");
+	if(in == NULL)
+	{
+		return DS_FAILED;
+	}
+
+	/* An extra byte tells whether there is anything past the prefix. */
+	char block[PREFIX_SIZE + 1];
+	const size_t len = fread(block, 1U, sizeof(block), in);
+	const int failed = ferror(in);
+	fclose(in);
+	if(failed)
 	{
-		return file_is_empty(b);
+		return DS_FAILED;
 	}
 
-	FILE *const a_file = fopen(a, "rb");
-	FILE *const b_file = fopen(b, "rb");
+	digest->partial = (len > PREFIX_SIZE);
+	digest->hash = XXH3_128bits(block, MIN(len, PREFIX_SIZE));
 
-	if(a_file == NULL || b_file == NULL)
+	/* Size of the file could have changed after the key was made. */
+	if(have_key && digest->partial == (key.prefix != 0))
 	{
-		if(a_file != NULL)
-		{
-			fclose(a_file);
-		}
-		if(b_file != NULL)
-		{
-			fclose(b_file);
-		}
-		return 0;
+		cache_digest(path, &key, &digest->hash);
 	}
+	return DS_OK;
+}
 
-	while(1)
+/* Computes digest of contents of a file or retrieves it from the cache.  Files
+ * that can't be read (e.g., pipes and sockets) are treated as empty.  hashing
+ * is used to report progress and can be NULL.  Returns state of the digest. */
+static DigestState
+hash_file(const dir_entry_t *entry, XXH128_hash_t *hash, hashing_t *hashing)
+{
+	if(!filetype_is_readable(entry->type))
 	{
-		char a_block[BLOCK_SIZE], b_block[BLOCK_SIZE];
-		const size_t a_read = fread(&a_block, 1, sizeof(a_block), a_file);
-		const size_t b_read = fread(&b_block, 1, sizeof(b_block), b_file);
-		if(a_read == 0U && b_read == 0U && feof(a_file) && feof(b_file))
-		{
-			/* Ends of both files are reached. */
-			break;
-		}
+		/* This isn't an error, just treat such files as empty. */
+		*hash = XXH3_128bits("", 0U);
+		return DS_OK;
+	}
 
-		if(a_read == 0 || b_read == 0U || a_read != b_read ||
-				memcmp(a_block, b_block, a_read) != 0)
-		{
-			fclose(a_file);
-			fclose(b_file);
-			return 0;
-		}
+	char path[PATH_MAX + 1];
+	get_full_path_of(entry, sizeof(path), path);
+
+	hcache_key_t key;
+	const int have_key = (hcache_key_of(path, &key) == 0);
+	if(have_key && get_cached_digest(&key, hash))
+	{
+		return DS_OK;
 	}
 
-	fclose(a_file);
-	fclose(b_file);
-	return 1;
+	DigestState result = read_and_hash(path, hash, hashing);
+	if(result == DS_OK && have_key)
+	{
+		cache_digest(path, &key, hash);
+	}
+
+	return result;
 }
 
-/* Checks that a file is empty.  Returns non-zero if so and there was no
- * error. */
+/* Looks up digest of a file in the cache.  Returns non-zero if *hash was set,
+ * otherwise zero is returned. */
 static int
-file_is_empty(const char path[])
+get_cached_digest(const hcache_key_t *key, XXH128_hash_t *hash)
 {
-	/* get_target_file_size() returns 0 on error as if the file is empty. */
-	struct stat st;
-	return (os_stat(path, &st) == 0 && st.st_size == 0);
+	hcache_digest_t cached;
+	if(!hcache_get(key, &cached))
+	{
+		return 0;
+	}
+
+	hash->high64 = cached.high;
+	hash->low64 = cached.low;
+	return 1;
 }
 
-/* Stores id of a file with given fingerprint in the trie. */
+/* Puts digest of a file into the cache unless the file was changed after the
+ * key was made (possibly while it was being read). */
 static void
-put_file_id(trie_t *trie, const char path[], const char fingerprint[], int id,
-		int is_readable, int is_partial, CompareType ct)
+cache_digest(const char path[], const hcache_key_t *key,
+		const XXH128_hash_t *hash)
 {
-	compare_record_t *const record = malloc(sizeof(*record));
-	if(record == NULL)
+	hcache_key_t key_after;
+	if(hcache_key_of(path, &key_after) != 0)
 	{
 		return;
 	}
 
-	record->next = NULL;
-	record->id = id;
-	record->is_partial = is_partial;
-	record->is_readable = is_readable;
+	key_after.prefix = key->prefix;
+	if(memcmp(key, &key_after, sizeof(*key)) == 0)
+	{
+		const hcache_digest_t digest = { .high = hash->high64, .low = hash->low64 };
+		hcache_put(key, &digest);
+	}
+}
 
-	/* Comparison by contents is the only one when we need to resolve fingerprint
-	 * conflicts. */
-	record->path = (ct == CT_CONTENTS ? strdup(path) : NULL);
+/* Computes digest of contents of a file reading it in large blocks.  hashing
+ * is used to report progress and can be NULL.  Returns state of the digest. */
+static DigestState
+read_and_hash(const char path[], XXH128_hash_t *hash, hashing_t *hashing)
+{
+	FILE *const in = os_fopen(path, "rb");
+	if(in == NULL)
+	{
+		return DS_FAILED;
+	}
 
-	/* Just add new entry to the list if something is already there. */
-	void *data = NULL;
-	(void)trie_get(trie, fingerprint, &data);
-	compare_record_t *prev = data;
-	if(prev != NULL)
+	/* Blocks are large enough, don't copy them through stdio buffer. */
+	(void)setvbuf(in, NULL, _IONBF, 0U);
+
+	void *const block = malloc(HASH_BLOCK_SIZE);
+	XXH3_state_t *const state = XXH3_createState();
+	if(block == NULL || state == NULL || XXH3_128bits_reset(state) != XXH_OK)
 	{
-		record->next = prev->next;
-		prev->next = record;
-		return;
+		XXH3_freeState(state);
+		free(block);
+		fclose(in);
+		return DS_FAILED;
 	}
 
-	/* Otherwise we're the head of the list. */
-	if(trie_set(trie, fingerprint, record) < 0)
+	DigestState result = DS_OK;
+	size_t len;
+	while((len = fread(block, 1U, HASH_BLOCK_SIZE, in)) != 0U)
 	{
-		free(record->path);
-		free(record);
+		if(XXH3_128bits_update(state, block, len) != XXH_OK ||
+				ui_cancellation_requested())
+		{
+			result = DS_FAILED;
+			break;
+		}
+
+		if(hashing != NULL)
+		{
+			update_progress(hashing, len, 0);
+		}
+	}
+
+	if(ferror(in))
+	{
+		result = DS_FAILED;
 	}
+
+	*hash = XXH3_128bits_digest(state);
+
+	XXH3_freeState(state);
+	free(block);
+	fclose(in);
+	return result;
 }
 
-/* Frees list of compare entries.  Implements data free function for
- * trie_free_with_data(). */
+/* Stores id of a file with given fingerprint in the trie. */
 static void
-free_compare_records(void *ptr)
+put_file_id(trie_t *trie, const char fingerprint[], int id)
 {
-	compare_record_t *record = ptr;
-	while(record != NULL)
+	int *const record = malloc(sizeof(*record));
+	if(record == NULL)
 	{
-		compare_record_t *const current = record;
-		record = record->next;
-		free(current->path);
-		free(current);
+		return;
+	}
+
+	*record = id;
+	if(trie_set(trie, fingerprint, record) < 0)
+	{
+		free(record);
 	}
 }
 
@@ -1336,18 +1694,13 @@ compare_move_entry(ops_t *ops, view_t *from, view_t *to, int idx)
 	 * and checking if they match. */
 
 	from_fingerprint = get_file_fingerprint(from_path, curr, ct, flags,
-			/*lazy=*/0);
-	to_fingerprint = get_file_fingerprint(to_path, other, ct, flags, /*lazy=*/0);
+			/*digest=*/NULL);
+	to_fingerprint = get_file_fingerprint(to_path, other, ct, flags,
+			/*digest=*/NULL);
 
 	if(!is_null_or_empty(from_fingerprint) && !is_null_or_empty(to_fingerprint))
 	{
-		int match = (strcmp(from_fingerprint, to_fingerprint) == 0);
-		if(match && ct == CT_CONTENTS)
-		{
-			match = files_are_identical(from_path, filetype_is_readable(curr->type),
-					to_path, filetype_is_readable(other->type));
-		}
-		if(match)
+		if(strcmp(from_fingerprint, to_fingerprint) == 0)
 		{
 			other->id = curr->id;
 		}
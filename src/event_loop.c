@@ -390,6 +390,7 @@ ensure_term_is_ready(void)
  * performing the following tasks while waiting for input:
  *  - checks for new IPC messages;
  *  - checks whether contents of displayed directories changed;
+ *  - merges results of reading huge directories in the background;
  *  - redraws UI if requested.
  * Returns KEY_CODE_YES for functional keys (preprocesses *c in this case), OK
  * for wide character and ERR otherwise (e.g. after timeout). */
@@ -438,6 +439,9 @@ get_char_async_loop(WINDOW *win, wint_t *c, int timeout, int process_callbacks)
 				stats_redraw_later();
 			}
 
+			(void)flist_stream_check(curr_view);
+			(void)flist_stream_check(other_view);
+
 			if(process_callbacks)
 			{
 				bg_check(/*show_errors=*/1);
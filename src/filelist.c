@@ -28,6 +28,13 @@
 
 #include <curses.h>
 
+#ifndef _WIN32
+#include <dirent.h> /* DIR dirfd() */
+#include <fcntl.h> /* AT_FDCWD AT_SYMLINK_NOFOLLOW O_DIRECTORY O_RDONLY open()
+                      fstatat() */
+#include <unistd.h> /* close() */
+#endif
+
 #include <sys/stat.h> /* stat */
 
 #include <assert.h> /* assert() */
@@ -57,6 +64,8 @@
 #include "ui/statusline.h"
 #include "ui/tabs.h"
 #include "ui/ui.h"
+#include "utils/darray.h"
+#include "utils/dirpoll.h"
 #include "utils/dynarray.h"
 #include "utils/env.h"
 #include "utils/fs.h"
@@ -73,6 +82,7 @@
 #include "utils/trie.h"
 #include "utils/utf8.h"
 #include "utils/utils.h"
+#include "utils/workers.h"
 #include "filtering.h"
 #include "flist_hist.h"
 #include "flist_pos.h"
@@ -83,10 +93,31 @@
 #include "opt_handlers.h"
 #include "registers.h"
 #include "running.h"
+#include "search.h"
 #include "sort.h"
 #include "status.h"
 #include "types.h"
 
+/* Minimal number of entries in a directory to query information about them in
+ * parallel. */
+#define PARALLEL_STAT_THRESHOLD 256
+
+/* Number of entries that are processed by a stat() worker at once. */
+#define STAT_CHUNK_SIZE 64
+
+/* Maximum number of threads that query information about files.  This isn't
+ * bound by number of CPUs because stat() on network file systems spends most of
+ * the time waiting. */
+#define MAX_STAT_WORKERS 16
+
+/* Number of entries read from a directory in the foreground after which the
+ * rest of the entries is read in the background. */
+#define DIR_STREAM_THRESHOLD 10000
+
+/* Number of entries that background directory reader accumulates before making
+ * them available to the main thread. */
+#define DIR_STREAM_BATCH_SIZE 1024
+
 /* State of a fold. */
 typedef enum
 {
@@ -99,6 +130,58 @@ typedef enum
 }
 FoldState;
 
+#ifndef _WIN32
+
+/* Parameters of a parallel stat() job. */
+typedef struct
+{
+	dir_entry_t *entries; /* Entries to be filled in place. */
+	int dir_fd;           /* Descriptor of directory that contains entries. */
+	int *errors;          /* Per-entry errno or -1 for unknown type, 0 if OK. */
+}
+stat_job_t;
+
+/* File found by background directory reader. */
+typedef struct
+{
+	char *name;    /* Name of the file. */
+	struct stat s; /* Result of lstat() on the file. */
+	FileType hint; /* Type reported by readdir() or FT_UNK. */
+	int error;     /* errno value if lstat() has failed, otherwise zero. */
+}
+stream_rec_t;
+
+/* State of reading a huge directory in the background.  The reader thread
+ * accumulates files in batches, which are merged into the file list by the
+ * main thread in flist_stream_check(). */
+typedef struct dir_stream_t
+{
+	pthread_mutex_t lock; /* Protects fields up to the next comment. */
+	int refs;             /* Number of owners (reader thread and the view). */
+	int cancelled;        /* View is no longer interested in the results. */
+	int done;             /* Reader has finished. */
+	stream_rec_t *recs;   /* Files that weren't merged yet. */
+	DA_INSTANCE_FIELD(recs);
+
+	/* Fields below are not shared between threads. */
+
+	char *path;      /* Path to the directory being read. */
+	DIR *dir;        /* Directory stream that belongs to the reader thread. */
+	char *last_name; /* Name of file under cursor after previous merge. */
+	int user_moved;  /* Whether user moved the cursor since the first batch. */
+}
+dir_stream_t;
+
+#endif
+
+/* Number of files in a directory starting with which stat() calls are made in
+ * parallel. */
+static int parallel_stat_threshold = PARALLEL_STAT_THRESHOLD;
+
+/* Number of entries in a directory after which the rest is read in the
+ * background. */
+static int dir_stream_threshold = DIR_STREAM_THRESHOLD;
+
 static void init_flist(view_t *view);
 static void reset_view(view_t *view);
 static void init_view_history(view_t *view);
@@ -108,8 +191,23 @@ static int fill_dir_entry_by_path(dir_entry_t *entry, const char path[]);
 static void on_custom_view_leave(view_t *view);
 #ifndef _WIN32
 static int fill_dir_entry(dir_entry_t *entry, const char path[],
-		const struct dirent *d);
+		FileType hint);
+static int fill_dir_entry_from_stat(dir_entry_t *entry, const struct stat *s,
+		FileType hint);
+static FileType get_dirent_hint(const struct dirent *d);
+static void fill_link_entry(dir_entry_t *entry, const char path[]);
 static int data_is_dir_entry(const struct dirent *d, const char path[]);
+static void fill_dir_entries(view_t *view);
+static void stat_entries(void *arg, int from, int to);
+static int enum_dir_streaming(view_t *view);
+static int start_dir_stream(view_t *view, DIR *dir);
+static void * dir_stream_reader(void *arg);
+static int post_stream_batch(dir_stream_t *stream, stream_rec_t **batch,
+		int *len);
+static void merge_stream_recs(view_t *view, stream_rec_t recs[], int len);
+static void free_stream_recs(stream_rec_t recs[], int len);
+static void release_dir_stream(dir_stream_t *stream);
+static void remember_stream_pos(view_t *view);
 #else
 static int fill_dir_entry(dir_entry_t *entry, const char path[],
 		const WIN32_FIND_DATAW *ffd);
@@ -117,6 +215,7 @@ static int data_is_dir_entry(const WIN32_FIND_DATAW *ffd, const char path[]);
 #endif
 static int flist_custom_finish_internal(view_t *view, CVType type, int reload,
 		const char dir[], int allow_empty);
+static void stop_dir_stream(view_t *view);
 static void on_location_change(view_t *view, int force);
 static void disable_view_sorting(view_t *view);
 static void enable_view_sorting(view_t *view);
@@ -154,6 +253,8 @@ static int add_file_entry_to_view(const char name[], const void *data,
 static void sort_dir_list(int msg, view_t *view);
 static void merge_lists(view_t *view, dir_entry_t *entries, int len);
 TSTATIC void check_file_uniqueness(view_t *view);
+TSTATIC void set_parallel_stat_threshold(int threshold);
+TSTATIC void set_dir_stream_threshold(int threshold);
 static void add_to_trie(trie_t *trie, view_t *view, dir_entry_t *entry);
 static int is_in_trie(trie_t *trie, view_t *view, dir_entry_t *entry,
 		void **data);
@@ -163,8 +264,18 @@ static int rescue_from_empty_filelist(view_t *view);
 static void add_parent_entry(view_t *view, dir_entry_t **entries, int *count);
 static void init_dir_entry(view_t *view, dir_entry_t *entry, const char name[]);
 static dir_entry_t * alloc_dir_entry(dir_entry_t **list, int list_size);
+static void check_slow_dir(view_t *view);
+static void free_slow_watch(view_t *view);
+static int patch_dir_list(view_t *view, const fswatch_changes_t *changes);
+static void patch_dir_entry(view_t *view, const fswatch_change_t *change,
+		const entries_t *removed);
+static int fill_changed_entry(dir_entry_t *entry,
+		const fswatch_change_t *change);
+static void insert_dir_entry(view_t *view, const dir_entry_t *entry);
+static int tree_needs_reload(view_t *view);
 static int tree_has_changed(const dir_entry_t *entries, size_t nchildren);
-static FSWatchState poll_watcher(fswatch_t *watch, const char path[]);
+static FSWatchState poll_watcher(fswatch_t *watch, const char path[],
+		fswatch_changes_t *changes);
 static void remove_child_entries(view_t *view, dir_entry_t *entry);
 static void find_dir_in_cdpath(const char base_dir[], const char dst[],
 		char buf[], size_t buf_size);
@@ -187,8 +298,9 @@ static int complete_tree(const char name[], int valid, const void *parent_data,
 static void reset_entry_list(view_t *view, dir_entry_t **entries, int *count);
 static void drop_tops(dir_entry_t *entries, int *nentries, int extra);
 static int add_files_recursively(view_t *view, const char path[],
-		trie_t *excluded_paths, trie_t *folded_paths, int parent_pos,
-		int no_direct_parent, int depth);
+		trie_t *excluded_paths, trie_t *folded_paths, fswatch_set_t **watch,
+		int parent_pos, int no_direct_parent, int depth);
+static void watch_tree_dir(fswatch_set_t **watch, const char path[]);
 static FoldState get_fold_state(trie_t *folded_paths, const char full_path[]);
 static int set_fold_state(trie_t *folded_paths, const char full_path[],
 		FoldState state);
@@ -300,6 +412,11 @@ flist_free_view(view_t *view)
 	fswatch_free(view->watch);
 	view->watch = NULL;
 	update_string(&view->watched_dir, NULL);
+	fswatch_set_free(view->tree_watch);
+	view->tree_watch = NULL;
+	free_slow_watch(view);
+
+	stop_dir_stream(view);
 
 	update_string(&view->last_dir, NULL);
 
@@ -334,6 +451,7 @@ flist_free_view(view_t *view)
 		regfree(&view->primary_group);
 		view->primary_group_set = 0;
 	}
+	sort_free_cache(view);
 
 	marks_clear_view(view);
 
@@ -861,6 +979,9 @@ flist_custom_start(view_t *view, const char title[])
 
 	trie_free(view->custom.paths_cache);
 	view->custom.paths_cache = trie_create(/*free_func=*/NULL);
+
+	fswatch_set_free(view->tree_watch);
+	view->tree_watch = NULL;
 }
 
 dir_entry_t *
@@ -922,14 +1043,15 @@ flist_custom_add_separator(view_t *view, int id)
 static int
 fill_dir_entry_by_path(dir_entry_t *entry, const char path[])
 {
-	return fill_dir_entry(entry, path, NULL);
+	return fill_dir_entry(entry, path, FT_UNK);
 }
 
 /* Fills fields of the entry from stat information of the file specified by its
- * path.  d is optional source of file type.  Returns zero on success, otherwise
- * non-zero is returned. */
+ * path.  hint is type of the file to use if its mode doesn't define it (FT_UNK
+ * if there is none).  Returns zero on success, otherwise non-zero is
+ * returned. */
 static int
-fill_dir_entry(dir_entry_t *entry, const char path[], const struct dirent *d)
+fill_dir_entry(dir_entry_t *entry, const char path[], FileType hint)
 {
 	struct stat s;
 
@@ -940,51 +1062,482 @@ fill_dir_entry(dir_entry_t *entry, const char path[], const struct dirent *d)
 		return 1;
 	}
 
-	entry->type = get_type_from_mode(s.st_mode);
+	if(fill_dir_entry_from_stat(entry, &s, hint) != 0)
+	{
+		LOG_ERROR_MSG("Can't determine type of \"%s\"", path);
+		return 1;
+	}
+
+	if(entry->type == FT_LINK)
+	{
+		fill_link_entry(entry, path);
+	}
+
+	return 0;
+}
+
+/* Fills fields of the entry from result of lstat() call.  hint is type of the
+ * file to use if its mode doesn't define it (FT_UNK if there is none).  Doesn't
+ * log anything, so it can be used from worker threads.  Returns zero on success
+ * and non-zero if file type is unknown. */
+static int
+fill_dir_entry_from_stat(dir_entry_t *entry, const struct stat *s,
+		FileType hint)
+{
+	entry->type = get_type_from_mode(s->st_mode);
 	if(entry->type == FT_UNK)
 	{
-		entry->type = (d == NULL) ? FT_UNK : type_from_dir_entry(d, path);
+		entry->type = hint;
 	}
 	if(entry->type == FT_UNK)
 	{
-		LOG_ERROR_MSG("Can't determine type of \"%s\"", path);
 		return 1;
 	}
 
-	entry->size = (uintmax_t)s.st_size;
-	entry->uid = s.st_uid;
-	entry->gid = s.st_gid;
-	entry->mode = s.st_mode;
-	entry->inode = s.st_ino;
-	entry->mtime = s.st_mtime;
-	entry->atime = s.st_atime;
-	entry->ctime = s.st_ctime;
-	entry->nlinks = s.st_nlink;
+	entry->size = (uintmax_t)s->st_size;
+	entry->uid = s->st_uid;
+	entry->gid = s->st_gid;
+	entry->mode = s->st_mode;
+	entry->inode = s->st_ino;
+	entry->mtime = s->st_mtime;
+	entry->atime = s->st_atime;
+	entry->ctime = s->st_ctime;
+	entry->nlinks = s->st_nlink;
+	return 0;
+}
 
-	if(entry->type == FT_LINK)
+/* Fills symbolic link specific fields of the entry. */
+static void
+fill_link_entry(dir_entry_t *entry, const char path[])
+{
+	struct stat s;
+
+	const SymLinkType symlink_type = get_symlink_type(path);
+	entry->dir_link = (symlink_type != SLT_UNKNOWN);
+	entry->slow_target = (symlink_type == SLT_SLOW);
+
+	/* Query mode of symbolic link target. */
+	if(!entry->slow_target && os_stat(path, &s) == 0)
 	{
+		entry->mode = s.st_mode;
+	}
+}
+
+/* Retrieves type of a file as reported by directory enumeration without
+ * querying file system.  Returns the type or FT_UNK if it's not known. */
+static FileType
+get_dirent_hint(const struct dirent *d)
+{
+#if defined(HAVE_STRUCT_DIRENT_D_TYPE) && HAVE_STRUCT_DIRENT_D_TYPE
+	/* The path isn't used when d_type is available. */
+	return type_from_dir_entry(d, d->d_name);
+#else
+	/* get_dirent_type() would lstat() the file, which is done anyway. */
+	(void)d;
+	return FT_UNK;
+#endif
+}
+
+/* Checks whether file is a directory.  Returns non-zero if so, otherwise zero
+ * is returned. */
+static int
+data_is_dir_entry(const struct dirent *d, const char path[])
+{
+	return is_dirent_targets_dir(path, d);
+}
+
+/* Fills entries of the view that were just added by enumerating current
+ * directory.  Large directories are processed by several threads which issue
+ * fstatat() calls relative to directory descriptor.  Entries that can't be
+ * queried are removed from the list. */
+static void
+fill_dir_entries(view_t *view)
+{
+	const int count = view->list_rows;
+	int *errors = NULL;
+	if(count >= parallel_stat_threshold)
+	{
+		errors = calloc(count, sizeof(*errors));
+	}
+
+	if(errors != NULL)
+	{
+		int dir_fd = open(view->curr_dir, O_RDONLY | O_DIRECTORY);
+		stat_job_t job = {
+			.entries = view->dir_entry,
+			.dir_fd = (dir_fd == -1 ? AT_FDCWD : dir_fd),
+			.errors = errors,
+		};
+
+		workers_for(count, STAT_CHUNK_SIZE, MAX_STAT_WORKERS, &stat_entries, &job);
+
+		if(dir_fd != -1)
+		{
+			close(dir_fd);
+		}
+	}
+
+	int i, j = 0;
+	for(i = 0; i < count; ++i)
+	{
+		dir_entry_t *const entry = &view->dir_entry[i];
+
+		int failed;
+		if(errors == NULL)
+		{
+			/* Type from enumeration is stored in the entry until it's filled. */
+			failed = (fill_dir_entry(entry, entry->name, entry->type) != 0);
+		}
+		else if(errors[i] == 0)
+		{
+			if(entry->type == FT_LINK)
+			{
+				/* Not done in workers as it's not thread-safe. */
+				fill_link_entry(entry, entry->name);
+			}
+			failed = 0;
+		}
+		else
+		{
+			if(errors[i] == -1)
+			{
+				LOG_ERROR_MSG("Can't determine type of \"%s\"", entry->name);
+			}
+			else
+			{
+				LOG_SERROR_MSG(errors[i], "Can't lstat() \"%s\"", entry->name);
+			}
+			failed = 1;
+		}
+
+		if(failed)
+		{
+			fentry_free(entry);
+			continue;
+		}
+
+		if(i != j)
+		{
+			view->dir_entry[j] = *entry;
+		}
+		++j;
+	}
+	view->list_rows = j;
+
+	free(errors);
+}
+
+/* Worker that fills a range of entries of a stat_job_t. */
+static void
+stat_entries(void *arg, int from, int to)
+{
+	stat_job_t *const job = arg;
+
+	int i;
+	for(i = from; i < to; ++i)
+	{
+		dir_entry_t *const entry = &job->entries[i];
+
 		struct stat s;
+		if(fstatat(job->dir_fd, entry->name, &s, AT_SYMLINK_NOFOLLOW) != 0)
+		{
+			job->errors[i] = errno;
+		}
+		else if(fill_dir_entry_from_stat(entry, &s, entry->type) != 0)
+		{
+			job->errors[i] = -1;
+		}
+	}
+}
 
-		const SymLinkType symlink_type = get_symlink_type(path);
-		entry->dir_link = (symlink_type != SLT_UNKNOWN);
-		entry->slow_target = (symlink_type == SLT_SLOW);
+/* Enumerates current directory of the view adding its files to the list.  If
+ * the directory turns out to be huge, only its first part is read here and the
+ * rest is handed over to a background thread (see flist_stream_check()).
+ * Returns zero on success and non-zero on failure to open the directory. */
+static int
+enum_dir_streaming(view_t *view)
+{
+	DIR *dir = os_opendir(view->curr_dir);
+	if(dir == NULL)
+	{
+		return 1;
+	}
+
+	int nread = 0;
+	struct dirent *d = NULL;
+	while(nread < dir_stream_threshold && (d = os_readdir(dir)) != NULL)
+	{
+		if(is_builtin_dir(d->d_name))
+		{
+			continue;
+		}
+
+		if(add_file_entry_to_view(d->d_name, d, view) != 0)
+		{
+			os_closedir(dir);
+			return 0;
+		}
+		++nread;
+	}
 
-		/* Query mode of symbolic link target. */
-		if(!entry->slow_target && os_stat(entry->name, &s) == 0)
+	if(nread < dir_stream_threshold || start_dir_stream(view, dir) != 0)
+	{
+		/* Either everything was read or we need to read the rest right now. */
+		while((d = os_readdir(dir)) != NULL)
 		{
-			entry->mode = s.st_mode;
+			if(add_file_entry_to_view(d->d_name, d, view) != 0)
+			{
+				break;
+			}
 		}
+		os_closedir(dir);
 	}
 
 	return 0;
 }
 
-/* Checks whether file is a directory.  Returns non-zero if so, otherwise zero
- * is returned. */
+/* Starts reading the rest of the directory in the background.  Takes ownership
+ * of the dir on success.  Returns zero on success, otherwise non-zero is
+ * returned. */
 static int
-data_is_dir_entry(const struct dirent *d, const char path[])
+start_dir_stream(view_t *view, DIR *dir)
 {
-	return is_dirent_targets_dir(path, d);
+	dir_stream_t *const stream = calloc(1, sizeof(*stream));
+	if(stream == NULL)
+	{
+		return 1;
+	}
+
+	stream->path = strdup(view->curr_dir);
+	if(stream->path == NULL || pthread_mutex_init(&stream->lock, NULL) != 0)
+	{
+		free(stream->path);
+		free(stream);
+		return 1;
+	}
+
+	stream->dir = dir;
+	stream->refs = 2;
+
+	pthread_t id;
+	if(pthread_create(&id, NULL, &dir_stream_reader, stream) != 0)
+	{
+		pthread_mutex_destroy(&stream->lock);
+		free(stream->path);
+		free(stream);
+		return 1;
+	}
+	(void)pthread_detach(id);
+
+	stop_dir_stream(view);
+	view->dir_stream = stream;
+	return 0;
+}
+
+/* Entry point of a thread that reads the rest of a directory.  Returns
+ * NULL. */
+static void *
+dir_stream_reader(void *arg)
+{
+	dir_stream_t *const stream = arg;
+	const int dir_fd = dirfd(stream->dir);
+
+	stream_rec_t *batch = NULL;
+	int len = 0;
+
+	struct dirent *d;
+	while((d = os_readdir(stream->dir)) != NULL)
+	{
+		if(is_builtin_dir(d->d_name))
+		{
+			continue;
+		}
+
+		if(batch == NULL)
+		{
+			batch = reallocarray(NULL, DIR_STREAM_BATCH_SIZE, sizeof(*batch));
+			if(batch == NULL)
+			{
+				break;
+			}
+		}
+
+		batch[len].name = strdup(d->d_name);
+		if(batch[len].name == NULL)
+		{
+			break;
+		}
+
+		batch[len].hint = get_dirent_hint(d);
+		batch[len].error = 0;
+		if(fstatat(dir_fd, d->d_name, &batch[len].s, AT_SYMLINK_NOFOLLOW) != 0)
+		{
+			batch[len].error = errno;
+		}
+
+		if(++len == DIR_STREAM_BATCH_SIZE &&
+				post_stream_batch(stream, &batch, &len) != 0)
+		{
+			break;
+		}
+	}
+
+	os_closedir(stream->dir);
+	stream->dir = NULL;
+
+	(void)post_stream_batch(stream, &batch, &len);
+	free_stream_recs(batch, len);
+	free(batch);
+
+	pthread_mutex_lock(&stream->lock);
+	stream->done = 1;
+	pthread_mutex_unlock(&stream->lock);
+
+	release_dir_stream(stream);
+	return NULL;
+}
+
+/* Makes batch of records available to the main thread.  Resets *batch and *len
+ * on success.  Returns zero on success and non-zero if reading should stop. */
+static int
+post_stream_batch(dir_stream_t *stream, stream_rec_t **batch, int *len)
+{
+	int result = 0;
+
+	pthread_mutex_lock(&stream->lock);
+	if(stream->cancelled)
+	{
+		result = 1;
+	}
+	else if(DA_SIZE(stream->recs) == 0)
+	{
+		free(stream->recs);
+		stream->recs = *batch;
+		DA_SIZE(stream->recs) = *len;
+		*batch = NULL;
+		*len = 0;
+	}
+	else
+	{
+		stream_rec_t *const recs = reallocarray(stream->recs,
+				DA_SIZE(stream->recs) + *len, sizeof(*recs));
+		if(recs == NULL)
+		{
+			result = 1;
+		}
+		else
+		{
+			memcpy(&recs[DA_SIZE(stream->recs)], *batch, sizeof(**batch)*(*len));
+			stream->recs = recs;
+			DA_SIZE(stream->recs) += *len;
+			*len = 0;
+		}
+	}
+	pthread_mutex_unlock(&stream->lock);
+
+	return result;
+}
+
+/* Adds files found by background reader to the list of the view. */
+static void
+merge_stream_recs(view_t *view, stream_rec_t recs[], int len)
+{
+	const char *const dir = view->dir_stream->path;
+
+	int i;
+	for(i = 0; i < len; ++i)
+	{
+		const stream_rec_t *const rec = &recs[i];
+		char full_path[PATH_MAX + 1];
+		snprintf(full_path, sizeof(full_path), "%s/%s", dir, rec->name);
+
+		if(rec->error != 0)
+		{
+			LOG_SERROR_MSG(rec->error, "Can't lstat() \"%s\"", full_path);
+			continue;
+		}
+
+		if(view->hide_dot && rec->name[0] == '.')
+		{
+			++view->filtered;
+			continue;
+		}
+
+		dir_entry_t *const entry = alloc_dir_entry(&view->dir_entry,
+				view->list_rows);
+		if(entry == NULL)
+		{
+			show_error_msg("Memory Error", "Unable to allocate enough memory");
+			break;
+		}
+
+		init_dir_entry(view, entry, rec->name);
+		if(fill_dir_entry_from_stat(entry, &rec->s, rec->hint) != 0)
+		{
+			LOG_ERROR_MSG("Can't determine type of \"%s\"", full_path);
+			fentry_free(entry);
+			continue;
+		}
+
+		if(entry->type == FT_LINK)
+		{
+			fill_link_entry(entry, full_path);
+		}
+
+		if(!filters_file_is_visible(view, dir, entry->name, fentry_is_dir(entry),
+					/*apply_local_filter=*/1))
+		{
+			++view->filtered;
+			fentry_free(entry);
+			continue;
+		}
+
+		++view->list_rows;
+	}
+}
+
+/* Frees records of the background reader. */
+static void
+free_stream_recs(stream_rec_t recs[], int len)
+{
+	int i;
+	for(i = 0; i < len; ++i)
+	{
+		free(recs[i].name);
+	}
+}
+
+/* Drops a reference to the stream freeing it if it was the last one. */
+static void
+release_dir_stream(dir_stream_t *stream)
+{
+	pthread_mutex_lock(&stream->lock);
+	const int last = (--stream->refs == 0);
+	pthread_mutex_unlock(&stream->lock);
+
+	if(!last)
+	{
+		return;
+	}
+
+	free_stream_recs(stream->recs, DA_SIZE(stream->recs));
+	free(stream->recs);
+	free(stream->path);
+	free(stream->last_name);
+	pthread_mutex_destroy(&stream->lock);
+	free(stream);
+}
+
+/* Records file under cursor to be able to detect whether user has moved the
+ * cursor before the next merge. */
+static void
+remember_stream_pos(view_t *view)
+{
+	dir_stream_t *const stream = view->dir_stream;
+	if(stream != NULL && view->list_pos < view->list_rows)
+	{
+		replace_string(&stream->last_name, get_current_file_name(view));
+	}
 }
 
 #else
@@ -1372,6 +1925,9 @@ flist_custom_clone(view_t *to, const view_t *from, int as_tree)
 	replace_string(&to->custom.orig_dir, from->custom.orig_dir);
 	to->curr_dir[0] = '\0';
 
+	fswatch_set_free(to->tree_watch);
+	to->tree_watch = NULL;
+
 	replace_string(&to->custom.title,
 			(from_tree && !as_tree) ? "from tree" : from->custom.title);
 	to->custom.type = (ui_view_unsorted(from) || from_tree)
@@ -1711,6 +2267,8 @@ populate_dir_list_internal(view_t *view, int reload)
 {
 	char *saved_cwd;
 
+	stop_dir_stream(view);
+
 	view->filtered = 0;
 
 	/* List reload usually implies that something related to file list has
@@ -1751,7 +2309,7 @@ populate_dir_list_internal(view_t *view, int reload)
 			stroscmp(view->watched_dir, view->curr_dir) == 0)
 	{
 		/* Drain all events that happened before this point. */
-		(void)poll_watcher(view->watch, view->curr_dir);
+		(void)poll_watcher(view->watch, view->curr_dir, /*changes=*/NULL);
 	}
 
 	if(is_unc_root(view->curr_dir))
@@ -1801,6 +2359,9 @@ populate_dir_list_internal(view_t *view, int reload)
 	{
 		/* XXX: why cursor is positioned in code that loads the list? */
 		flist_hist_lookup(view, view);
+#ifndef _WIN32
+		remember_stream_pos(view);
+#endif
 	}
 
 	if(view->location_changed)
@@ -2299,13 +2860,28 @@ update_dir_list(view_t *view, int reload)
 
 	start_dir_list_change(view, &prev_dir_entries, &prev_list_rows, reload);
 
-	if(enum_dir_content(view->curr_dir, &add_file_entry_to_view, view) != 0)
+#ifndef _WIN32
+	/* Previous list is merged with the new one on reload, which requires having
+	 * full list. */
+	const int failed = reload
+	                 ? enum_dir_content(view->curr_dir, &add_file_entry_to_view,
+	                                    view)
+	                 : enum_dir_streaming(view);
+#else
+	const int failed = enum_dir_content(view->curr_dir, &add_file_entry_to_view,
+			view);
+#endif
+	if(failed != 0)
 	{
 		LOG_SERROR_MSG(errno, "Can't opendir() \"%s\"", view->curr_dir);
 		free_dir_entries(&prev_dir_entries, &prev_list_rows);
 		return 1;
 	}
 
+#ifndef _WIN32
+	fill_dir_entries(view);
+#endif
+
 	if(cfg_parent_dir_is_visible(is_root_dir(view->curr_dir)) ||
 			view->list_rows == 0)
 	{
@@ -2389,6 +2965,13 @@ add_file_entry_to_view(const char name[], const void *data, void *param)
 
 	init_dir_entry(view, entry, name);
 
+#ifndef _WIN32
+	/* Information about files is queried in bulk by fill_dir_entries(), until
+	 * then the type reported by enumeration is kept as a fallback for the case
+	 * when lstat() doesn't define it. */
+	entry->type = (data == NULL) ? FT_UNK : get_dirent_hint(data);
+	++view->list_rows;
+#else
 	if(fill_dir_entry(entry, entry->name, data) == 0)
 	{
 		++view->list_rows;
@@ -2397,6 +2980,7 @@ add_file_entry_to_view(const char name[], const void *data, void *param)
 	{
 		fentry_free(entry);
 	}
+#endif
 
 	return 0;
 }
@@ -2743,141 +3327,464 @@ free_dir_entries(dir_entry_t **entries, int *count)
 	*count = 0;
 }
 
-void
-fentry_free(dir_entry_t *entry)
+void
+fentry_free(dir_entry_t *entry)
+{
+	free(entry->name);
+	entry->name = NULL;
+
+	if(entry->owns_origin)
+	{
+		free(entry->origin);
+		entry->origin = NULL;
+	}
+}
+
+dir_entry_t *
+add_dir_entry(dir_entry_t **list, size_t *list_size, const dir_entry_t *entry)
+{
+	dir_entry_t *const new_entry = alloc_dir_entry(list, *list_size);
+	if(new_entry == NULL)
+	{
+		return NULL;
+	}
+
+	*new_entry = *entry;
+	++*list_size;
+	return new_entry;
+}
+
+dir_entry_t *
+entry_list_add(view_t *view, dir_entry_t **list, int *list_size,
+		const char path[])
+{
+	dir_entry_t *const dir_entry = alloc_dir_entry(list, *list_size);
+	if(dir_entry == NULL)
+	{
+		return NULL;
+	}
+
+	init_dir_entry(view, dir_entry, get_last_path_component(path));
+
+	dir_entry->origin = strdup(path);
+	dir_entry->owns_origin = 1;
+	remove_last_path_component(dir_entry->origin);
+
+	if(fill_dir_entry_by_path(dir_entry, path) != 0)
+	{
+		fentry_free(dir_entry);
+		return NULL;
+	}
+
+	++*list_size;
+	return dir_entry;
+}
+
+/* Allocates one more directory entry for the *list of size list_size by
+ * extending it.  Returns pointer to new entry or NULL on failure. */
+static dir_entry_t *
+alloc_dir_entry(dir_entry_t **list, int list_size)
+{
+	dir_entry_t *new_entry_list = dynarray_extend(*list, sizeof(dir_entry_t));
+	if(new_entry_list == NULL)
+	{
+		return NULL;
+	}
+
+	*list = new_entry_list;
+	return &new_entry_list[list_size];
+}
+
+void
+check_if_filelist_has_changed(view_t *view)
+{
+	int failed, changed;
+	FSWatchState state = FSWS_UPDATED;
+	fswatch_changes_t changes = {};
+	const char *const curr_dir = flist_get_dir(view);
+
+	if(view->on_slow_fs)
+	{
+		/* Changes that happen while directory is being read in the background are
+		 * handled after it's fully loaded. */
+		if(view->dir_stream == NULL && !flist_custom_active(view))
+		{
+			check_slow_dir(view);
+		}
+		return;
+	}
+
+	/* Polling isn't needed outside of slow file systems. */
+	free_slow_watch(view);
+
+	/* Changes that happen while directory is being read in the background are
+	 * handled after it's fully loaded. */
+	if(view->dir_stream != NULL ||
+			(flist_custom_active(view) && !cv_tree(view->custom.type)) ||
+			is_unc_root(curr_dir))
+	{
+		return;
+	}
+
+	if(view->watch == NULL)
+	{
+		/* If watch is not initialized, try to do this, but don't fail on error. */
+
+		update_dir_watcher(view);
+		failed = 0;
+		changed = (view->watch != NULL);
+	}
+	else
+	{
+		state = poll_watcher(view->watch, curr_dir, &changes);
+		changed = (state != FSWS_UNCHANGED);
+		failed = (state == FSWS_ERRORED);
+	}
+
+	/* Check if we still have permission to visit this directory. */
+	if(os_access(curr_dir, X_OK) != 0)
+	{
+		LOG_SERROR_MSG(errno, "Can't access(X_OK) \"%s\"", curr_dir);
+		log_cwd();
+		failed = 1;
+	}
+
+	if(failed)
+	{
+		fswatch_changes_free(&changes);
+
+		show_error_msgf("Directory Check", "Cannot open %s", curr_dir);
+
+		leave_invalid_dir(view);
+		(void)change_directory(view, curr_dir);
+		flist_sel_stash(view);
+		ui_view_schedule_reload(view);
+		return;
+	}
+
+	if(changed)
+	{
+		/* Updating only changed files is much cheaper than rereading large
+		 * directory in which few files change often. */
+		if(state == FSWS_UPDATED && patch_dir_list(view, &changes) == 0)
+		{
+			ui_view_schedule_redraw(view);
+		}
+		else
+		{
+			ui_view_schedule_reload(view);
+		}
+		fswatch_changes_free(&changes);
+	}
+	else if(flist_custom_active(view) && cv_tree(view->custom.type))
+	{
+		if(flist_is_fs_backed(view) && tree_needs_reload(view))
+		{
+			ui_view_schedule_reload(view);
+		}
+	}
+	else
+	{
+		if(flist_update_cache(view, &view->left_column, view->left_column.dir) ||
+				flist_update_cache(view, &view->right_column, view->right_column.dir))
+		{
+			ui_view_schedule_redraw(view);
+		}
+	}
+}
+
+/* Checks for changes of a directory on a slow file system by querying results
+ * of a background poller, so that this never waits for the file system. */
+static void
+check_slow_dir(view_t *view)
+{
+#ifndef _WIN32
+	const char *const curr_dir = flist_get_dir(view);
+
+	if(cfg.slow_fs_poll == 0)
+	{
+		free_slow_watch(view);
+		return;
+	}
+
+	if(view->slow_watch == NULL ||
+			!dirpoll_matches(view->slow_watch, curr_dir, cfg.slow_fs_poll))
+	{
+		free_slow_watch(view);
+		view->slow_watch = dirpoll_create(curr_dir, cfg.slow_fs_poll);
+		return;
+	}
+
+	fswatch_changes_t changes = {};
+	if(dirpoll_poll(view->slow_watch, &changes) == FSWS_UPDATED)
+	{
+		if(patch_dir_list(view, &changes) == 0)
+		{
+			ui_view_schedule_redraw(view);
+		}
+		else
+		{
+			ui_view_schedule_reload(view);
+		}
+	}
+	fswatch_changes_free(&changes);
+#else
+	(void)view;
+#endif
+}
+
+/* Stops background poller of the view if it's running. */
+static void
+free_slow_watch(view_t *view)
+{
+#ifndef _WIN32
+	dirpoll_free(view->slow_watch);
+	view->slow_watch = NULL;
+#endif
+}
+
+/* Updates entries of a regular view that correspond to changed files without
+ * rereading the whole directory.  Returns zero on success, otherwise non-zero
+ * is returned and the view needs to be reloaded. */
+static int
+patch_dir_list(view_t *view, const fswatch_changes_t *changes)
 {
-	free(entry->name);
-	entry->name = NULL;
+	if(!changes->complete || changes->count == 0 || flist_custom_active(view) ||
+			view->list_rows <= 1 || !filter_is_empty(&view->local_filter.filter))
+	{
+		return 1;
+	}
 
-	if(entry->owns_origin)
+	trie_t *const names = trie_create(/*free_func=*/NULL);
+	if(names == NULL)
 	{
-		free(entry->origin);
-		entry->origin = NULL;
+		return 1;
 	}
-}
 
-dir_entry_t *
-add_dir_entry(dir_entry_t **list, size_t *list_size, const dir_entry_t *entry)
-{
-	dir_entry_t *const new_entry = alloc_dir_entry(list, *list_size);
-	if(new_entry == NULL)
+	int i;
+	for(i = 0; i < changes->count; ++i)
 	{
-		return NULL;
+		(void)trie_put(names, changes->items[i].name);
 	}
 
-	*new_entry = *entry;
-	++*list_size;
-	return new_entry;
-}
+	char *const curr_name = strdup(get_current_file_name(view));
+	const int top_delta = view->list_pos - view->top_line;
 
-dir_entry_t *
-entry_list_add(view_t *view, dir_entry_t **list, int *list_size,
-		const char path[])
-{
-	dir_entry_t *const dir_entry = alloc_dir_entry(list, *list_size);
-	if(dir_entry == NULL)
+	/* Take out entries of changed files, they are reinserted at their new
+	 * positions if files are still there. */
+	entries_t removed = {};
+	int j = 0;
+	for(i = 0; i < view->list_rows; ++i)
 	{
-		return NULL;
-	}
+		dir_entry_t *const entry = &view->dir_entry[i];
+		void *data;
+		if(trie_get(names, entry->name, &data) == 0)
+		{
+			dir_entry_t *const copy = alloc_dir_entry(&removed.entries,
+					removed.nentries);
+			if(copy == NULL)
+			{
+				fentry_free(entry);
+				continue;
+			}
 
-	init_dir_entry(view, dir_entry, get_last_path_component(path));
+			*copy = *entry;
+			++removed.nentries;
+			continue;
+		}
 
-	dir_entry->origin = strdup(path);
-	dir_entry->owns_origin = 1;
-	remove_last_path_component(dir_entry->origin);
+		if(i != j)
+		{
+			view->dir_entry[j] = *entry;
+		}
+		++j;
+	}
+	view->list_rows = j;
+	trie_free(names);
 
-	if(fill_dir_entry_by_path(dir_entry, path) != 0)
+	for(i = 0; i < changes->count; ++i)
 	{
-		fentry_free(dir_entry);
-		return NULL;
+		patch_dir_entry(view, &changes->items[i], &removed);
 	}
+	free_dir_entries(&removed.entries, &removed.nentries);
 
-	++*list_size;
-	return dir_entry;
-}
+	view->selected_files = 0;
+	view->matches = 0;
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		view->selected_files += (view->dir_entry[i].selected != 0);
+		view->matches += (view->dir_entry[i].search_match != 0);
+	}
+	/* New entries aren't marked even if they match. */
+	search_list_changed(view);
 
-/* Allocates one more directory entry for the *list of size list_size by
- * extending it.  Returns pointer to new entry or NULL on failure. */
-static dir_entry_t *
-alloc_dir_entry(dir_entry_t **list, int list_size)
-{
-	dir_entry_t *new_entry_list = dynarray_extend(*list, sizeof(dir_entry_t));
-	if(new_entry_list == NULL)
+	if(view->list_rows == 0)
 	{
-		return NULL;
+		free(curr_name);
+		return 1;
 	}
 
-	*list = new_entry_list;
-	return &new_entry_list[list_size];
+	if(curr_name != NULL)
+	{
+		const int pos = fpos_find_by_name(view, curr_name);
+		if(pos >= 0)
+		{
+			view->list_pos = pos;
+			view->top_line = MAX(0, view->list_pos - top_delta);
+		}
+		free(curr_name);
+	}
+	if(view->list_pos >= view->list_rows)
+	{
+		view->list_pos = view->list_rows - 1;
+	}
+
+	fview_list_updated(view);
+	return 0;
 }
 
-void
-check_if_filelist_has_changed(view_t *view)
+/* Updates file list of the view according to change of a single file.  Entries
+ * of changed files that were removed from the list are provided to preserve
+ * their state. */
+static void
+patch_dir_entry(view_t *view, const fswatch_change_t *change,
+		const entries_t *removed)
 {
-	int failed, changed;
-	const char *const curr_dir = flist_get_dir(view);
-
-	if(view->on_slow_fs ||
-			(flist_custom_active(view) && !cv_tree(view->custom.type)) ||
-			is_unc_root(curr_dir))
+	if(strcmp(change->name, ".") == 0 || strcmp(change->name, "..") == 0)
 	{
 		return;
 	}
 
-	if(view->watch == NULL)
+	const dir_entry_t *prev = NULL;
+	int i;
+	for(i = 0; i < removed->nentries; ++i)
 	{
-		/* If watch is not initialized, try to do this, but don't fail on error. */
-
-		update_dir_watcher(view);
-		failed = 0;
-		changed = (view->watch != NULL);
+		if(strcmp(removed->entries[i].name, change->name) == 0)
+		{
+			prev = &removed->entries[i];
+			break;
+		}
 	}
-	else
+
+	/* File that existed and wasn't in the list must have been filtered out. */
+	if(prev == NULL && change->existed && view->filtered > 0)
 	{
-		FSWatchState state = poll_watcher(view->watch, curr_dir);
-		changed = (state != FSWS_UNCHANGED);
-		failed = (state == FSWS_ERRORED);
+		--view->filtered;
 	}
 
-	/* Check if we still have permission to visit this directory. */
-	if(os_access(curr_dir, X_OK) != 0)
+	dir_entry_t entry;
+	init_dir_entry(view, &entry, change->name);
+
+	if(fill_changed_entry(&entry, change) != 0)
 	{
-		LOG_SERROR_MSG(errno, "Can't access(X_OK) \"%s\"", curr_dir);
-		log_cwd();
-		failed = 1;
+		fentry_free(&entry);
+		return;
 	}
 
-	if(failed)
+	/* Not using entry_is_visible() as there is no dirent to query type from. */
+	if((view->hide_dot && entry.name[0] == '.') ||
+			!filters_file_is_visible(view, flist_get_dir(view), entry.name,
+				fentry_is_dir(&entry), /*apply_local_filter=*/1))
 	{
-		show_error_msgf("Directory Check", "Cannot open %s", curr_dir);
-
-		leave_invalid_dir(view);
-		(void)change_directory(view, curr_dir);
-		flist_sel_stash(view);
-		ui_view_schedule_reload(view);
+		++view->filtered;
+		fentry_free(&entry);
 		return;
 	}
 
-	if(changed)
+	if(prev != NULL)
 	{
-		ui_view_schedule_reload(view);
+		merge_entries(&entry, prev);
 	}
-	else if(flist_custom_active(view) && cv_tree(view->custom.type))
+
+	insert_dir_entry(view, &entry);
+}
+
+/* Fills entry of a changed file using information from the change if it's
+ * available, in which case file system isn't accessed.  Returns zero on success
+ * and non-zero if the file doesn't exist or can't be queried. */
+static int
+fill_changed_entry(dir_entry_t *entry, const fswatch_change_t *change)
+{
+	char full_path[PATH_MAX + 1];
+	get_full_path_of(entry, sizeof(full_path), full_path);
+
+#ifndef _WIN32
+	if(change->stated)
 	{
-		if(flist_is_fs_backed(view) &&
-				tree_has_changed(view->dir_entry, view->list_rows))
+		if(!change->exists ||
+				fill_dir_entry_from_stat(entry, &change->s, FT_UNK) != 0)
 		{
-			ui_view_schedule_reload(view);
+			return 1;
+		}
+
+		if(entry->type == FT_LINK)
+		{
+			/* Same as what fill_link_entry() does, but using results of the
+			 * producer. */
+			entry->slow_target = (change->target != NULL)
+			                  && refers_to_slower_fs(full_path, change->target);
+			entry->dir_link = entry->slow_target
+			               || (change->target_exists &&
+			                   S_ISDIR(change->target_s.st_mode));
+			if(!entry->slow_target && change->target_exists)
+			{
+				entry->mode = change->target_s.st_mode;
+			}
 		}
+		return 0;
 	}
-	else
+#endif
+
+	return !path_exists(full_path, NODEREF)
+	    || fill_dir_entry_by_path(entry, full_path) != 0;
+}
+
+/* Inserts entry into sorted list of entries of a view at a position that keeps
+ * the list sorted.  The entry is freed on failure. */
+static void
+insert_dir_entry(view_t *view, const dir_entry_t *entry)
+{
+	/* Find position right after the last entry that isn't greater than the new
+	 * one. */
+	int l = 0, r = view->list_rows;
+	while(l < r)
 	{
-		if(flist_update_cache(view, &view->left_column, view->left_column.dir) ||
-				flist_update_cache(view, &view->right_column, view->right_column.dir))
+		const int m = l + (r - l)/2;
+		if(sort_compare_entries(view, &view->dir_entry[m], entry) <= 0)
 		{
-			ui_view_schedule_redraw(view);
+			l = m + 1;
+		}
+		else
+		{
+			r = m;
 		}
 	}
+
+	dir_entry_t *const new_entry = alloc_dir_entry(&view->dir_entry,
+			view->list_rows);
+	if(new_entry == NULL)
+	{
+		dir_entry_t copy = *entry;
+		fentry_free(&copy);
+		return;
+	}
+
+	memmove(&view->dir_entry[l + 1], &view->dir_entry[l],
+			(view->list_rows - l)*sizeof(*view->dir_entry));
+	view->dir_entry[l] = *entry;
+	++view->list_rows;
+}
+
+/* Checks whether tree-view needs a reload.  Returns non-zero if so, otherwise
+ * zero is returned. */
+static int
+tree_needs_reload(view_t *view)
+{
+	if(view->tree_watch != NULL)
+	{
+		return (fswatch_set_poll(view->tree_watch) != FSWS_UNCHANGED);
+	}
+	return tree_has_changed(view->dir_entry, view->list_rows);
 }
 
 /* Checks whether tree-view needs a reload (any of subdirectories were changed).
@@ -2939,7 +3846,8 @@ flist_update_cache(view_t *view, cached_entries_t *cache, const char path[])
 		update = 1;
 	}
 
-	if(poll_watcher(cache->watch, path) != FSWS_UNCHANGED || update)
+	if(poll_watcher(cache->watch, path, /*changes=*/NULL) != FSWS_UNCHANGED ||
+			update)
 	{
 		free_dir_entries(&cache->entries.entries, &cache->entries.nentries);
 		cache->entries = flist_list_in(view, path, 0, 1);
@@ -2952,9 +3860,11 @@ flist_update_cache(view_t *view, cached_entries_t *cache, const char path[])
 /* Polls file-system watcher and re-enters current working directory of the
  * process if necessary.  Returns watcher's state. */
 static FSWatchState
-poll_watcher(fswatch_t *watch, const char path[])
+poll_watcher(fswatch_t *watch, const char path[], fswatch_changes_t *changes)
 {
-	FSWatchState state = fswatch_poll(watch);
+	FSWatchState state = (changes == NULL)
+	                   ? fswatch_poll(watch)
+	                   : fswatch_poll_changes(watch, changes);
 
 	if(state == FSWS_ERRORED || state == FSWS_REPLACED)
 	{
@@ -3851,6 +4761,7 @@ fentry_rename(view_t *view, dir_entry_t *entry, const char to[])
 	 * the caches. */
 	entry->hi_num = -1;
 	entry->name_dec_num = -1;
+	search_list_changed(view);
 
 	/* Update origins of entries which include the one we're renaming. */
 	if(flist_custom_active(view) && fentry_is_dir(entry))
@@ -4059,6 +4970,7 @@ make_tree(view_t *view, const char path[], int reload, trie_t *excluded_paths,
 	char canonic_path[PATH_MAX + 1];
 	int nfiltered;
 	CVType type;
+	fswatch_set_t *watch = NULL;
 	const int from_custom = flist_custom_active(view)
 	                     && ONE_OF(view->custom.type, CV_REGULAR, CV_VERY);
 
@@ -4075,8 +4987,11 @@ make_tree(view_t *view, const char path[], int reload, trie_t *excluded_paths,
 	}
 	else
 	{
+		/* Directories are watched before they are listed, so that changes made
+		 * while the tree is being built aren't missed. */
+		watch = fswatch_set_create();
 		nfiltered = add_files_recursively(view, path, excluded_paths, folded_paths,
-				-1, 0, depth);
+				&watch, -1, 0, depth);
 		type = CV_TREE;
 	}
 	ui_cancellation_pop();
@@ -4085,11 +5000,13 @@ make_tree(view_t *view, const char path[], int reload, trie_t *excluded_paths,
 
 	if(ui_cancellation_requested())
 	{
+		fswatch_set_free(watch);
 		return 1;
 	}
 
 	if(nfiltered < 0)
 	{
+		fswatch_set_free(watch);
 		show_error_msg("Tree View", "Failed to list directory");
 		return 1;
 	}
@@ -4099,12 +5016,22 @@ make_tree(view_t *view, const char path[], int reload, trie_t *excluded_paths,
 
 	if(flist_custom_finish_internal(view, type, reload, canonic_path, 1) != 0)
 	{
+		fswatch_set_free(watch);
 		return 1;
 	}
 	view->filtered = nfiltered;
 
 	replace_string(&view->custom.orig_dir, canonic_path);
 
+	if(flist_is_fs_backed(view))
+	{
+		view->tree_watch = watch;
+	}
+	else
+	{
+		fswatch_set_free(watch);
+	}
+
 	return 0;
 }
 
@@ -4273,16 +5200,20 @@ drop_tops(dir_entry_t *entries, int *nentries, int extra)
 /* Adds custom view entries corresponding to file system tree.  parent_pos is
  * expected to be negative for the outermost invocation.  The depth parameter
  * is used to limit nesting level, when it's negative, parent node is just
- * marked as folded.  Returns number of filtered out files on success or partial
- * success and negative value on serious error. */
+ * marked as folded.  Directories are added to *watch before being listed.
+ * Returns number of filtered out files on success or partial success and
+ * negative value on serious error. */
 static int
 add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
-		trie_t *folded_paths, int parent_pos, int no_direct_parent, int depth)
+		trie_t *folded_paths, fswatch_set_t **watch, int parent_pos,
+		int no_direct_parent, int depth)
 {
 	int i;
 	const int prev_count = view->custom.entry_count;
 	int nfiltered = 0;
 
+	watch_tree_dir(watch, path);
+
 	int len;
 	char **lst = list_all_files(path, &len);
 	if(len < 0)
@@ -4334,7 +5265,7 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 				if(state != FOLD_AUTO_CLOSED && state != FOLD_USER_CLOSED)
 				{
 					nfiltered += add_files_recursively(view, full_path, excluded_paths,
-							folded_paths, parent_pos, 1, depth - 1);
+							folded_paths, watch, parent_pos, 1, depth - 1);
 				}
 			}
 
@@ -4362,11 +5293,19 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 		entry->folded = (entry->type == FT_DIR)
 		             && (state == FOLD_USER_CLOSED || state == FOLD_AUTO_CLOSED);
 
+		/* Contents of folded directories isn't listed, but changes in them still
+		 * need a reload. */
+		if(entry->folded)
+		{
+			watch_tree_dir(watch, full_path);
+		}
+
 		if(entry->type == FT_DIR && !entry->folded)
 		{
 			if(depth == 0 ||
 					(state == FOLD_UNDEFINED && parent_fold == FOLD_AUTO_OPENED))
 			{
+				watch_tree_dir(watch, full_path);
 				if(set_fold_state(folded_paths, full_path, FOLD_AUTO_CLOSED))
 				{
 					entry->folded = 1;
@@ -4376,7 +5315,7 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 			{
 				const int idx = view->custom.entry_count - 1;
 				const int filtered = add_files_recursively(view, full_path,
-						excluded_paths, folded_paths, idx, 0, depth - 1);
+						excluded_paths, folded_paths, watch, idx, 0, depth - 1);
 				/* Keep going in case of error and load partial list. */
 				if(filtered >= 0)
 				{
@@ -4413,6 +5352,19 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 	return nfiltered;
 }
 
+/* Starts watching a directory of a tree.  On failure the watcher is dropped
+ * and set to NULL, which makes changes of the tree be detected by comparing
+ * modification times. */
+static void
+watch_tree_dir(fswatch_set_t **watch, const char path[])
+{
+	if(*watch != NULL && fswatch_set_add(*watch, path) != 0)
+	{
+		fswatch_set_free(*watch);
+		*watch = NULL;
+	}
+}
+
 /* Retrieves state of the fold if present.  Returns the state or
  * FOLD_UNDEFINED. */
 static FoldState
@@ -4553,5 +5505,128 @@ flist_is_fs_backed(const view_t *view)
 	return (!flist_custom_active(view) || view->custom.type == CV_TREE);
 }
 
+int
+flist_stream_check(view_t *view)
+{
+#ifndef _WIN32
+	dir_stream_t *const stream = view->dir_stream;
+	if(stream == NULL)
+	{
+		return 0;
+	}
+
+	if(flist_custom_active(view) || stroscmp(stream->path, view->curr_dir) != 0)
+	{
+		stop_dir_stream(view);
+		return 0;
+	}
+
+	/* Merging reorders the list, don't do this while it's being worked with. */
+	if(vle_mode_is(VISUAL_MODE) || view->local_filter.in_progress)
+	{
+		return 0;
+	}
+
+	pthread_mutex_lock(&stream->lock);
+	const int done = stream->done;
+	stream_rec_t *recs = stream->recs;
+	int len = DA_SIZE(stream->recs);
+	/* Merging involves sorting of the whole list, so wait for the number of new
+	 * entries to become comparable to the size of the list to keep the total
+	 * amount of sorting reasonable. */
+	if(!done && len < MAX(DIR_STREAM_BATCH_SIZE, view->list_rows/2))
+	{
+		recs = NULL;
+		len = 0;
+	}
+	else
+	{
+		stream->recs = NULL;
+		DA_SIZE(stream->recs) = 0;
+	}
+	pthread_mutex_unlock(&stream->lock);
+
+	if(!done && len == 0)
+	{
+		return 0;
+	}
+
+	merge_stream_recs(view, recs, len);
+	free_stream_recs(recs, len);
+	free(recs);
+
+	if(!stream->user_moved && stream->last_name != NULL &&
+			(view->list_pos >= view->list_rows ||
+			 strcmp(get_current_file_name(view), stream->last_name) != 0))
+	{
+		stream->user_moved = 1;
+	}
+
+	if(stream->user_moved)
+	{
+		resort_dir_list(0, view);
+	}
+	else
+	{
+		/* Position from history might have just become available. */
+		sort_dir_list(0, view);
+		flist_hist_lookup(view, view);
+	}
+
+	if(done)
+	{
+		view->dir_entry = dynarray_shrink(view->dir_entry);
+		stop_dir_stream(view);
+	}
+	else
+	{
+		remember_stream_pos(view);
+	}
+
+	fview_list_updated(view);
+	ui_view_schedule_redraw(view);
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/* Stops reading directory of the view in the background if it's in
+ * progress. */
+static void
+stop_dir_stream(view_t *view)
+{
+#ifndef _WIN32
+	dir_stream_t *const stream = view->dir_stream;
+	if(stream == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&stream->lock);
+	stream->cancelled = 1;
+	pthread_mutex_unlock(&stream->lock);
+
+	release_dir_stream(stream);
+	view->dir_stream = NULL;
+#endif
+}
+
+/* Changes number of files in a directory after which the rest is read in the
+ * background. */
+TSTATIC void
+set_dir_stream_threshold(int threshold)
+{
+	dir_stream_threshold = threshold;
+}
+
+/* Changes number of files in a directory starting with which information about
+ * them is queried in parallel. */
+TSTATIC void
+set_parallel_stat_threshold(int threshold)
+{
+	parallel_stat_threshold = threshold;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
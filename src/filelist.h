@@ -321,9 +321,15 @@ void flist_toggle_fold(view_t *view);
 /* Checks whether file list synchronizes with FS.  Returns non-zero if so,
  * otherwise zero is returned. */
 int flist_is_fs_backed(const view_t *view);
+/* Merges files found by background reading of a huge directory into the file
+ * list of the view.  Returns non-zero if the list has changed, otherwise zero
+ * is returned. */
+int flist_stream_check(view_t *view);
 
 TSTATIC_DEFS(
 	void check_file_uniqueness(view_t *view);
+	void set_parallel_stat_threshold(int threshold);
+	void set_dir_stream_threshold(int threshold);
 )
 
 #endif /* VIFM__FILELIST_H__ */
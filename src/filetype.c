@@ -22,13 +22,14 @@
 #include <assert.h> /* assert() */
 #include <ctype.h> /* isspace() */
 #include <stddef.h> /* NULL */
-#include <stdlib.h> /* free() */
+#include <stdlib.h> /* calloc() free() */
 #include <string.h> /* strchr() strdup() strcasecmp() */
 
 #include "compat/fs_limits.h"
 #include "compat/reallocarray.h"
 #include "modes/dialogs/msg_dialog.h"
 #include "utils/darray.h"
+#include "utils/globidx.h"
 #include "utils/matchers.h"
 #include "utils/mem.h"
 #include "utils/str.h"
@@ -60,6 +61,36 @@ typedef struct
 }
 reordering_data_t;
 
+/* Index of a list of associations that finds associations matching a file
+ * without trying each of them in turn.  Associations whose patterns consist
+ * of literal names and "*suffix" globs are put into globs index, the rest are
+ * checked one by one. */
+typedef struct
+{
+	globidx_t *globs; /* Simple globs identified by indexes of associations. */
+	int *others;      /* Indexes of associations that aren't in globs index or
+	                     are only partially there. */
+	int other_count;  /* Number of elements in others. */
+}
+assoc_index_t;
+
+/* Type of callback invoked for each association that matches a file.  Returns
+ * non-zero to stop the search, otherwise zero should be returned. */
+typedef int (*assoc_visitor_t)(const assoc_t *assoc, void *arg);
+
+/* State of looking up matching associations through an index. */
+typedef struct
+{
+	const assoc_list_t *list;    /* List of associations. */
+	const assoc_index_t *index;  /* Index of the list. */
+	const char *file;            /* File that's being matched. */
+	int next_other;              /* Position in index->others. */
+	assoc_visitor_t visitor;     /* Callback for matching associations. */
+	void *arg;                   /* Argument of the callback. */
+	int stopped;                 /* Whether visitor asked to stop. */
+}
+assoc_search_t;
+
 static const char * find_existing_cmd(const assoc_list_t *record_list,
 		const char file[]);
 static assoc_record_t find_existing_cmd_record(const assoc_records_t *records);
@@ -88,6 +119,19 @@ static void safe_free(char **adr);
 static int is_assoc_record_empty(const assoc_record_t *record);
 static int mg_match(const matchers_group_t *mg, const char str[]);
 static void mg_free(matchers_group_t *mg);
+static void for_each_match(const assoc_list_t *list, const char file[],
+		assoc_visitor_t visitor, void *arg);
+static int visit_indexed_match(int id, void *arg);
+static int visit_others(assoc_search_t *search, int until);
+static assoc_index_t * get_index(const assoc_list_t *list);
+static assoc_index_t * build_index(const assoc_list_t *list);
+static int index_assoc(assoc_index_t *index, const assoc_t *assoc, int id);
+static void drop_indexes(void);
+static void free_index(assoc_index_t *index);
+TSTATIC int ft_viewers_are_indexed(void);
+static int add_viewers(const assoc_t *assoc, void *arg);
+static int find_existing(const assoc_t *assoc, void *arg);
+static int add_records(const assoc_t *assoc, void *arg);
 
 const assoc_record_t NONE_PSEUDO_PROG = {
 	.command = "",
@@ -109,6 +153,14 @@ static AssocRecordType new_records_type = ART_CUSTOM;
 /* Pointer to external command existence check function. */
 static external_command_exists_t external_command_exists_func;
 
+/* Lazily built indexes of lists of associations or NULL. */
+static assoc_index_t *active_filetypes_index;
+static assoc_index_t *fileviewers_index;
+/* Whether building of corresponding index failed, in which case it's not
+ * attempted again until indexes are dropped. */
+static int active_filetypes_index_failed;
+static int fileviewers_index_failed;
+
 void
 ft_init(external_command_exists_t ece_func)
 {
@@ -145,31 +197,30 @@ strlist_t
 ft_get_viewers(const char file[])
 {
 	strlist_t viewers = {};
+	for_each_match(&fileviewers, file, &add_viewers, &viewers);
+	return viewers;
+}
+
+/* Adds existing viewers of an association to a list of viewers skipping
+ * duplicates.  Returns zero to continue the search. */
+static int
+add_viewers(const assoc_t *assoc, void *arg)
+{
+	strlist_t *const viewers = arg;
 
 	int i;
-	for(i = 0; i < fileviewers.count; ++i)
+	for(i = 0; i < assoc->records.count; ++i)
 	{
-		assoc_t *const assoc = &fileviewers.list[i];
-
-		if(!mg_match(&assoc->mg, file))
-		{
-			continue;
-		}
-
-		int j;
-		for(j = 0; j < assoc->records.count; ++j)
+		const char *cmd = assoc->records.list[i].command;
+		if(!is_in_string_array(viewers->items, viewers->nitems, cmd) &&
+				ft_exists(cmd))
 		{
-			const char *cmd = assoc->records.list[j].command;
-			if(!is_in_string_array(viewers.items, viewers.nitems, cmd) &&
-					ft_exists(cmd))
-			{
-				viewers.nitems = add_to_string_array(&viewers.items, viewers.nitems,
-						cmd);
-			}
+			viewers->nitems = add_to_string_array(&viewers->items, viewers->nitems,
+					cmd);
 		}
 	}
 
-	return viewers;
+	return 0;
 }
 
 /* Finds first existing command which pattern matches given file.  Returns the
@@ -177,26 +228,26 @@ ft_get_viewers(const char file[])
 static const char *
 find_existing_cmd(const assoc_list_t *record_list, const char file[])
 {
-	int i;
-
-	for(i = 0; i < record_list->count; ++i)
-	{
-		assoc_record_t prog;
-		assoc_t *const assoc = &record_list->list[i];
+	const char *cmd = NULL;
+	for_each_match(record_list, file, &find_existing, &cmd);
+	return cmd;
+}
 
-		if(!mg_match(&assoc->mg, file))
-		{
-			continue;
-		}
+/* Looks for an existing command of an association.  Returns non-zero and sets
+ * *arg to the command if one is found, otherwise zero is returned. */
+static int
+find_existing(const assoc_t *assoc, void *arg)
+{
+	const char **const cmd = arg;
 
-		prog = find_existing_cmd_record(&assoc->records);
-		if(!is_assoc_record_empty(&prog))
-		{
-			return prog.command;
-		}
+	assoc_record_t prog = find_existing_cmd_record(&assoc->records);
+	if(is_assoc_record_empty(&prog))
+	{
+		return 0;
 	}
 
-	return NULL;
+	*cmd = prog.command;
+	return 1;
 }
 
 /* Finds record that corresponds to an external command that is available.
@@ -367,6 +418,8 @@ make_pivot_first(reordering_data_t *d)
 	{
 		fileviewers.list[fileviewers.count++] = split_prefix;
 	}
+
+	drop_indexes();
 }
 
 void
@@ -435,6 +488,8 @@ make_pivot_last(reordering_data_t *d)
 		assert(d->j == fileviewers.count - 1);
 		fileviewers.list[d->j] = last_item;
 	}
+
+	drop_indexes();
 }
 
 /* Finds a matching entry in the list of viewers either by checking for its
@@ -632,21 +687,20 @@ ft_get_all_viewers(const char file[])
 static assoc_records_t
 clone_all_matching_records(const char file[], const assoc_list_t *record_list)
 {
-	int i;
 	assoc_records_t result = {};
-
-	for(i = 0; i < record_list->count; ++i)
-	{
-		assoc_t *const assoc = &record_list->list[i];
-		if(mg_match(&assoc->mg, file))
-		{
-			ft_assoc_record_add_all(&result, &assoc->records);
-		}
-	}
-
+	for_each_match(record_list, file, &add_records, &result);
 	return result;
 }
 
+/* Adds clones of records of an association to a list of records.  Returns zero
+ * to continue the search. */
+static int
+add_records(const assoc_t *assoc, void *arg)
+{
+	ft_assoc_record_add_all(arg, &assoc->records);
+	return 0;
+}
+
 void
 ft_set_viewers(matchers_group_t mg, const char viewers[])
 {
@@ -687,6 +741,8 @@ add_assoc(assoc_list_t *assoc_list, assoc_t assoc)
 	assoc_list->list = p;
 	assoc_list->list[assoc_list->count] = assoc;
 	assoc_list->count++;
+
+	drop_indexes();
 	return 1;
 }
 
@@ -804,6 +860,8 @@ reset_list(assoc_list_t *assoc_list)
 static void
 reset_list_head(assoc_list_t *assoc_list)
 {
+	drop_indexes();
+
 	free(assoc_list->list);
 	assoc_list->list = NULL;
 	assoc_list->count = 0;
@@ -1027,6 +1085,237 @@ mg_match(const matchers_group_t *mg, const char str[])
 	return 0;
 }
 
+/* Invokes the visitor for every association of the list that matches the file
+ * in the order of the list. */
+static void
+for_each_match(const assoc_list_t *list, const char file[],
+		assoc_visitor_t visitor, void *arg)
+{
+	assoc_index_t *const index = get_index(list);
+	if(index != NULL)
+	{
+		assoc_search_t search = {
+			.list = list,
+			.index = index,
+			.file = file,
+			.visitor = visitor,
+			.arg = arg,
+		};
+
+		/* Globs are matched against the last path component. */
+		if(globidx_find(index->globs, get_last_path_component(file),
+					&visit_indexed_match, &search) == 0)
+		{
+			if(!search.stopped)
+			{
+				(void)visit_others(&search, list->count);
+			}
+			return;
+		}
+	}
+
+	int i;
+	for(i = 0; i < list->count; ++i)
+	{
+		const assoc_t *const assoc = &list->list[i];
+		if(mg_match(&assoc->mg, file) && visitor(assoc, arg))
+		{
+			break;
+		}
+	}
+}
+
+/* Visits association found through globs index after associations that aren't
+ * in the globs index and precede it.  Returns non-zero to stop the search. */
+static int
+visit_indexed_match(int id, void *arg)
+{
+	assoc_search_t *const search = arg;
+	if(visit_others(search, id))
+	{
+		return 1;
+	}
+
+	/* Association that's only partially in the index is checked along with
+	 * others. */
+	const assoc_index_t *const index = search->index;
+	if(search->next_other < index->other_count &&
+			index->others[search->next_other] == id)
+	{
+		return 0;
+	}
+
+	search->stopped = search->visitor(&search->list->list[id], search->arg);
+	return search->stopped;
+}
+
+/* Visits associations that aren't in the globs index and precede association
+ * at position until if they match.  Returns non-zero to stop the search. */
+static int
+visit_others(assoc_search_t *search, int until)
+{
+	const assoc_index_t *const index = search->index;
+	while(search->next_other < index->other_count &&
+			index->others[search->next_other] < until)
+	{
+		const assoc_t *const assoc =
+			&search->list->list[index->others[search->next_other++]];
+		if(mg_match(&assoc->mg, search->file) &&
+				search->visitor(assoc, search->arg))
+		{
+			search->stopped = 1;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Retrieves index of the list building it if necessary.  Returns the index or
+ * NULL if the list isn't indexed or on error. */
+static assoc_index_t *
+get_index(const assoc_list_t *list)
+{
+	assoc_index_t **index;
+	int *failed;
+	if(list == &active_filetypes)
+	{
+		index = &active_filetypes_index;
+		failed = &active_filetypes_index_failed;
+	}
+	else if(list == &fileviewers)
+	{
+		index = &fileviewers_index;
+		failed = &fileviewers_index_failed;
+	}
+	else
+	{
+		return NULL;
+	}
+
+	if(*index == NULL && !*failed)
+	{
+		*index = build_index(list);
+		*failed = (*index == NULL);
+	}
+	return *index;
+}
+
+/* Builds index of a list of associations.  Returns the index or NULL on
+ * error. */
+static assoc_index_t *
+build_index(const assoc_list_t *list)
+{
+	assoc_index_t *const index = calloc(1, sizeof(*index));
+	if(index == NULL)
+	{
+		return NULL;
+	}
+
+	index->globs = globidx_create();
+	index->others = reallocarray(NULL, list->count + 1, sizeof(*index->others));
+	if(index->globs == NULL || index->others == NULL)
+	{
+		free_index(index);
+		return NULL;
+	}
+
+	int i;
+	for(i = 0; i < list->count; ++i)
+	{
+		switch(index_assoc(index, &list->list[i], i))
+		{
+			case 0:
+				break;
+			case 1:
+				index->others[index->other_count++] = i;
+				break;
+			default:
+				free_index(index);
+				return NULL;
+		}
+	}
+
+	return index;
+}
+
+/* Puts globs of an association into globs index if all of its matchers consist
+ * of simple globs.  Returns zero if association was added, 1 if it has to be
+ * checked separately (globs that did get into the index are still correct
+ * matches) and -1 on error (index might be in inconsistent state). */
+static int
+index_assoc(assoc_index_t *index, const assoc_t *assoc, int id)
+{
+	int i;
+	for(i = 0; i < assoc->mg.count; ++i)
+	{
+		int count;
+		char **globs = matchers_get_simple_globs(assoc->mg.list[i], &count);
+		if(globs == NULL)
+		{
+			return 1;
+		}
+		free_string_array(globs, count);
+	}
+
+	for(i = 0; i < assoc->mg.count; ++i)
+	{
+		int count;
+		char **globs = matchers_get_simple_globs(assoc->mg.list[i], &count);
+		if(globs == NULL)
+		{
+			return -1;
+		}
+
+		int j = 0;
+		while(j < count && globidx_add(index->globs, globs[j], id) == 0)
+		{
+			++j;
+		}
+		free_string_array(globs, count);
+
+		/* For example, the glob is too long to be put into the index. */
+		if(j != count)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* Frees indexes of lists of associations, they are rebuilt on next use. */
+static void
+drop_indexes(void)
+{
+	free_index(active_filetypes_index);
+	active_filetypes_index = NULL;
+	free_index(fileviewers_index);
+	fileviewers_index = NULL;
+
+	active_filetypes_index_failed = 0;
+	fileviewers_index_failed = 0;
+}
+
+/* Frees an index.  index can be NULL. */
+static void
+free_index(assoc_index_t *index)
+{
+	if(index != NULL)
+	{
+		globidx_free(index->globs);
+		free(index->others);
+		free(index);
+	}
+}
+
+/* Checks whether lookup of viewers goes through an index.  Returns non-zero if
+ * so, otherwise zero is returned. */
+TSTATIC int
+ft_viewers_are_indexed(void)
+{
+	return (get_index(&fileviewers) != NULL);
+}
+
 int
 ft_mg_from_string(const char str[], matchers_group_t *mg, char **error)
 {
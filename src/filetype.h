@@ -20,6 +20,8 @@
 #ifndef VIFM__FILETYPE_H__
 #define VIFM__FILETYPE_H__
 
+#include "utils/test_helpers.h"
+
 #define VIFM_PSEUDO_CMD "vifm"
 
 struct matchers_t;
@@ -184,6 +186,10 @@ int ft_mg_from_string(const char str[], matchers_group_t *mg, char **error);
  * errors. */
 char * ft_mg_to_string(const matchers_group_t *mg);
 
+TSTATIC_DEFS(
+	int ft_viewers_are_indexed(void);
+)
+
 #endif /* VIFM__FILETYPE_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
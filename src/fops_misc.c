@@ -22,10 +22,12 @@
 #include <sys/stat.h> /* stat */
 #include <sys/types.h> /* gid_t uid_t */
 
+#include <stdlib.h> /* free() */
 #include <string.h> /* strdup() strlen() */
 
 #include "cfg/config.h"
 #include "compat/os.h"
+#include "compat/reallocarray.h"
 #include "modes/dialogs/msg_dialog.h"
 #include "ui/cancellation.h"
 #include "ui/fileview.h"
@@ -33,11 +35,13 @@
 #include "ui/ui.h"
 #include "utils/cancellation.h"
 #include "utils/fs.h"
+#include "utils/macros.h"
 #include "utils/path.h"
 #include "utils/str.h"
 #include "utils/string_array.h"
 #include "utils/test_helpers.h"
 #include "utils/utils.h"
+#include "utils/workers.h"
 #include "cmd_completion.h"
 #include "filelist.h"
 #include "flist_pos.h"
@@ -47,6 +51,9 @@
 #include "trash.h"
 #include "undo.h"
 
+/* Maximum number of threads used to calculate size of a directory. */
+#define MAX_DIR_SIZE_WORKERS 8
+
 /* Arguments pack for dir_size_bg() background function. */
 typedef struct
 {
@@ -55,6 +62,17 @@ typedef struct
 }
 dir_size_args_t;
 
+/* Subdirectories whose sizes are calculated in parallel. */
+typedef struct
+{
+	strlist_t list;    /* Full paths to subdirectories. */
+	uint64_t *sizes;   /* Sizes of subdirectories (same length as the list). */
+	int nworkers;      /* Number of threads available for each subdirectory. */
+	int force_update;  /* Whether cached values should be ignored. */
+	const cancellation_t *cancellation; /* Cancellation information. */
+}
+subdirs_t;
+
 /* Arguments pack for fops_query_list() verification function. */
 typedef struct
 {
@@ -90,6 +108,9 @@ static void start_dir_size_calc(const char path[], int force);
 static void dir_size_bg(bg_op_t *bg_op, void *arg);
 static void dir_size(bg_op_t *bg_op, const char path[], int force);
 static int bg_cancellation_hook(void *arg);
+static uint64_t dir_size_par(const char path[], int force_update,
+		const cancellation_t *cancellation, int nworkers);
+static void subdirs_size(void *arg, int from, int to);
 #ifndef _WIN32
 static void change_owner_cb(const char new_owner[], void *arg);
 static int complete_owner(const char str[], void *arg);
@@ -1326,6 +1347,17 @@ bg_cancellation_hook(void *arg)
 uint64_t
 fops_dir_size(const char path[], int force_update,
 		const cancellation_t *cancellation)
+{
+	const int nworkers = MIN(MAX_DIR_SIZE_WORKERS, 2*workers_cpu_count());
+	return dir_size_par(path, force_update, cancellation, nworkers);
+}
+
+/* Calculates size of a directory using at most nworkers threads including the
+ * calling one.  Subdirectories are split among workers, each of which gets an
+ * equal share of threads for processing its subdirectory.  Returns the size. */
+static uint64_t
+dir_size_par(const char path[], int force_update,
+		const cancellation_t *cancellation, int nworkers)
 {
 	struct dirent *dentry;
 	const char *slash;
@@ -1358,6 +1390,11 @@ fops_dir_size(const char path[], int force_update,
 		return 0U;
 	}
 
+	subdirs_t subdirs = {
+		.force_update = force_update,
+		.cancellation = cancellation,
+	};
+
 	slash = (ends_with_slash(path) ? "" : "/");
 	size = 0U;
 	while((dentry = os_readdir(dir)) != NULL)
@@ -1371,30 +1408,78 @@ fops_dir_size(const char path[], int force_update,
 
 		snprintf(full_path, sizeof(full_path), "%s%s%s", path, slash,
 				dentry->d_name);
-		if(fops_is_dir_entry(full_path, dentry))
+		if(!fops_is_dir_entry(full_path, dentry))
+		{
+			size += get_file_size(full_path);
+		}
+		else if(nworkers > 1)
 		{
-			size += fops_dir_size(full_path, force_update, cancellation);
+			/* Postpone processing to do it in parallel. */
+			subdirs.list.nitems = add_to_string_array(&subdirs.list.items,
+					subdirs.list.nitems, full_path);
 		}
 		else
 		{
-			size += get_file_size(full_path);
+			size += dir_size_par(full_path, force_update, cancellation, 1);
 		}
 
 		if(cancellation_requested(cancellation))
 		{
 			os_closedir(dir);
+			free_string_array(subdirs.list.items, subdirs.list.nitems);
 			return 0U;
 		}
 	}
 
 	os_closedir(dir);
 
+	if(subdirs.list.nitems != 0)
+	{
+		subdirs.sizes = reallocarray(NULL, subdirs.list.nitems,
+				sizeof(*subdirs.sizes));
+		if(subdirs.sizes != NULL)
+		{
+			const int n = MIN(nworkers, subdirs.list.nitems);
+			subdirs.nworkers = nworkers/n;
+			workers_for(subdirs.list.nitems, /*chunk=*/1, n, &subdirs_size,
+					&subdirs);
+
+			int i;
+			for(i = 0; i < subdirs.list.nitems; ++i)
+			{
+				size += subdirs.sizes[i];
+			}
+			free(subdirs.sizes);
+		}
+		free_string_array(subdirs.list.items, subdirs.list.nitems);
+
+		if(subdirs.sizes == NULL || cancellation_requested(cancellation))
+		{
+			return 0U;
+		}
+	}
+
 	/* Could calculate nitems here, but they aren't recursive and might only take
 	 * up memory, because interest in size sort of excludes interest in nitems. */
 	(void)dcache_set_at(path, inode, size, DCACHE_UNKNOWN);
 	return size;
 }
 
+/* workers_for() callback that calculates sizes of a range of
+ * subdirectories. */
+static void
+subdirs_size(void *arg, int from, int to)
+{
+	subdirs_t *const subdirs = arg;
+
+	int i;
+	for(i = from; i < to; ++i)
+	{
+		subdirs->sizes[i] = dir_size_par(subdirs->list.items[i],
+				subdirs->force_update, subdirs->cancellation, subdirs->nworkers);
+	}
+}
+
 #ifndef _WIN32
 
 int
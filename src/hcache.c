@@ -0,0 +1,415 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "hcache.h"
+
+#include <sys/stat.h> /* stat */
+
+#include <stddef.h> /* NULL */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* free() */
+#include <time.h> /* time_t time() */
+
+#include "compat/os.h"
+#include "compat/pthread.h"
+#include "compat/reallocarray.h"
+#include "utils/macros.h"
+#include "utils/utils.h"
+
+/* Default maximum number of entries in the cache. */
+#define DEFAULT_CAPACITY 8192
+
+/* Maximum amount of memory the cache can take in bytes. */
+#define MAX_BYTES (64*1024*1024)
+
+/* Single entry of the cache. */
+typedef struct
+{
+	hcache_key_t key;       /* Identity of the file. */
+	hcache_digest_t digest; /* Digest of file's contents. */
+	time_t used;            /* When the entry was last used. */
+}
+entry_t;
+
+static entry_t * find_entry(const hcache_key_t *key);
+static void add_entry(const hcache_key_t *key, const hcache_digest_t *digest,
+		time_t used);
+static int ensure_allocated(void);
+static int grow_storage(int new_capacity);
+static int get_table_size(int count);
+static void evict_entries(void);
+static int used_sorter(const void *first, const void *second);
+static void rebuild_table(void);
+static int find_slot(const hcache_key_t *key);
+static uint64_t hash_key(const hcache_key_t *key);
+static int keys_equal(const hcache_key_t *a, const hcache_key_t *b);
+
+/* Protects all the state below. */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Storage of entries of the cache, allocated on first use. */
+static entry_t *entries;
+/* Number of used elements of entries array. */
+static int nentries;
+/* Maximum number of entries. */
+static int capacity = DEFAULT_CAPACITY;
+
+/* Open-addressing hash table of indexes into entries array, -1 marks empty
+ * slots. */
+static int *slots;
+/* Number of elements in slots array, always a power of two. */
+static int nslots;
+
+int
+hcache_key_of(const char path[], hcache_key_t *key)
+{
+#ifndef _WIN32
+	struct stat st;
+	if(os_stat(path, &st) != 0)
+	{
+		return 1;
+	}
+
+	key->dev = st.st_dev;
+	key->inode = st.st_ino;
+	key->size = st.st_size;
+	key->mtime_ns = (uint64_t)st.st_mtime*1000000000U;
+	key->ctime_ns = (uint64_t)st.st_ctime*1000000000U;
+	key->prefix = 0;
+#if defined(HAVE_STRUCT_STAT_ST_MTIM)
+	key->mtime_ns += st.st_mtim.tv_nsec;
+	key->ctime_ns += st.st_ctim.tv_nsec;
+#elif defined(__APPLE__)
+	key->mtime_ns += st.st_mtimespec.tv_nsec;
+	key->ctime_ns += st.st_ctimespec.tv_nsec;
+#else
+	/* A file can be changed within a second after it was hashed without
+	 * changing its key. */
+	return 1;
+#endif
+	return 0;
+#else
+	/* Inode numbers aren't available, so files can't be identified. */
+	(void)path;
+	(void)key;
+	return 1;
+#endif
+}
+
+int
+hcache_get(const hcache_key_t *key, hcache_digest_t *digest)
+{
+	pthread_mutex_lock(&lock);
+
+	entry_t *const entry = find_entry(key);
+	if(entry != NULL)
+	{
+		*digest = entry->digest;
+		entry->used = time(NULL);
+	}
+
+	pthread_mutex_unlock(&lock);
+	return (entry != NULL);
+}
+
+void
+hcache_put(const hcache_key_t *key, const hcache_digest_t *digest)
+{
+	pthread_mutex_lock(&lock);
+
+	entry_t *const entry = find_entry(key);
+	if(entry != NULL)
+	{
+		entry->digest = *digest;
+		entry->used = time(NULL);
+	}
+	else
+	{
+		add_entry(key, digest, time(NULL));
+	}
+
+	pthread_mutex_unlock(&lock);
+}
+
+void
+hcache_restore(const hcache_key_t *key, const hcache_digest_t *digest,
+		time_t used)
+{
+	pthread_mutex_lock(&lock);
+
+	entry_t *const entry = find_entry(key);
+	if(entry == NULL)
+	{
+		add_entry(key, digest, used);
+	}
+	else if(entry->used < used)
+	{
+		entry->digest = *digest;
+		entry->used = used;
+	}
+
+	pthread_mutex_unlock(&lock);
+}
+
+void
+hcache_list(hcache_list_cb cb, void *arg)
+{
+	pthread_mutex_lock(&lock);
+
+	int i;
+	for(i = 0; i < nentries; ++i)
+	{
+		cb(&entries[i].key, &entries[i].digest, entries[i].used, arg);
+	}
+
+	pthread_mutex_unlock(&lock);
+}
+
+void
+hcache_reserve(int count)
+{
+	const int max_capacity = MAX_BYTES/(sizeof(*entries) + 2*sizeof(*slots));
+	count = MIN(count, max_capacity);
+
+	pthread_mutex_lock(&lock);
+	if(count > capacity && grow_storage(count) == 0)
+	{
+		capacity = count;
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+int
+hcache_capacity(void)
+{
+	pthread_mutex_lock(&lock);
+	const int result = capacity;
+	pthread_mutex_unlock(&lock);
+	return result;
+}
+
+TSTATIC void
+hcache_reset(int new_capacity)
+{
+	pthread_mutex_lock(&lock);
+
+	free(entries);
+	entries = NULL;
+	nentries = 0;
+	free(slots);
+	slots = NULL;
+	nslots = 0;
+	capacity = (new_capacity > 0 ? new_capacity : DEFAULT_CAPACITY);
+
+	pthread_mutex_unlock(&lock);
+}
+
+/* Looks up an entry by its key.  Returns pointer to the entry or NULL. */
+static entry_t *
+find_entry(const hcache_key_t *key)
+{
+	if(slots == NULL)
+	{
+		return NULL;
+	}
+
+	const int idx = slots[find_slot(key)];
+	return (idx == -1 ? NULL : &entries[idx]);
+}
+
+/* Adds new entry evicting least recently used ones if the cache is full. */
+static void
+add_entry(const hcache_key_t *key, const hcache_digest_t *digest, time_t used)
+{
+	if(ensure_allocated() != 0)
+	{
+		return;
+	}
+
+	if(nentries == capacity)
+	{
+		evict_entries();
+	}
+
+	entries[nentries].key = *key;
+	entries[nentries].digest = *digest;
+	entries[nentries].used = used;
+	slots[find_slot(key)] = nentries;
+	++nentries;
+}
+
+/* Allocates storage of the cache if it's not allocated yet.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+ensure_allocated(void)
+{
+	if(entries != NULL)
+	{
+		return 0;
+	}
+
+	const int table_size = get_table_size(capacity);
+	entries = reallocarray(NULL, capacity, sizeof(*entries));
+	slots = reallocarray(NULL, table_size, sizeof(*slots));
+	if(entries == NULL || slots == NULL)
+	{
+		free(entries);
+		entries = NULL;
+		free(slots);
+		slots = NULL;
+		return 1;
+	}
+
+	nslots = table_size;
+	rebuild_table();
+	return 0;
+}
+
+/* Resizes allocated storage of the cache to fit new number of entries.  Returns
+ * zero on success, otherwise non-zero is returned and the storage is left
+ * intact. */
+static int
+grow_storage(int new_capacity)
+{
+	if(entries == NULL)
+	{
+		/* Will be allocated with the new size on first use. */
+		return 0;
+	}
+
+	const int table_size = get_table_size(new_capacity);
+	int *const new_slots = reallocarray(NULL, table_size, sizeof(*slots));
+	entry_t *const new_entries = reallocarray(entries, new_capacity,
+			sizeof(*entries));
+	if(new_entries != NULL)
+	{
+		entries = new_entries;
+	}
+	if(new_slots == NULL || new_entries == NULL)
+	{
+		free(new_slots);
+		return 1;
+	}
+
+	free(slots);
+	slots = new_slots;
+	nslots = table_size;
+	rebuild_table();
+	return 0;
+}
+
+/* Computes size of hash table for the specified number of entries that keeps
+ * load factor of the table at or below 50%.  Returns the size, which is a power
+ * of two. */
+static int
+get_table_size(int count)
+{
+	int table_size = 1;
+	while(table_size < 2*count)
+	{
+		table_size *= 2;
+	}
+	return table_size;
+}
+
+/* Drops least recently used quarter of entries (at least one entry), so that
+ * eviction doesn't happen on every insertion into a full cache. */
+static void
+evict_entries(void)
+{
+	safe_qsort(entries, nentries, sizeof(*entries), &used_sorter);
+	nentries = MIN(nentries - 1, capacity - capacity/4);
+	rebuild_table();
+}
+
+/* qsort() comparer that puts more recently used entries first.  Returns
+ * standard -1, 0, 1 for comparisons. */
+static int
+used_sorter(const void *first, const void *second)
+{
+	const entry_t *a = first;
+	const entry_t *b = second;
+	return SORT_CMP(b->used, a->used);
+}
+
+/* Fills hash table from scratch. */
+static void
+rebuild_table(void)
+{
+	int i;
+	for(i = 0; i < nslots; ++i)
+	{
+		slots[i] = -1;
+	}
+
+	for(i = 0; i < nentries; ++i)
+	{
+		slots[find_slot(&entries[i].key)] = i;
+	}
+}
+
+/* Finds slot of hash table that either holds the key or is empty.  Returns
+ * index of the slot. */
+static int
+find_slot(const hcache_key_t *key)
+{
+	const int mask = nslots - 1;
+	int slot = hash_key(key) & mask;
+	while(slots[slot] != -1 && !keys_equal(&entries[slots[slot]].key, key))
+	{
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+/* Mixes fields of the key.  Returns the hash. */
+static uint64_t
+hash_key(const hcache_key_t *key)
+{
+	const uint64_t fields[] = {
+		key->dev, key->inode, key->size, key->mtime_ns, key->ctime_ns, key->prefix
+	};
+
+	uint64_t hash = 0;
+	size_t i;
+	for(i = 0U; i < ARRAY_LEN(fields); ++i)
+	{
+		/* Finalizer of splitmix64 applied to each field in turn. */
+		hash ^= fields[i] + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+		hash = (hash ^ (hash >> 30))*0xbf58476d1ce4e5b9ULL;
+		hash = (hash ^ (hash >> 27))*0x94d049bb133111ebULL;
+		hash ^= hash >> 31;
+	}
+	return hash;
+}
+
+/* Compares two keys.  Returns non-zero if they are equal, otherwise zero is
+ * returned. */
+static int
+keys_equal(const hcache_key_t *a, const hcache_key_t *b)
+{
+	return a->dev == b->dev
+	    && a->inode == b->inode
+	    && a->size == b->size
+	    && a->mtime_ns == b->mtime_ns
+	    && a->ctime_ns == b->ctime_ns
+	    && a->prefix == b->prefix;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
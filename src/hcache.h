@@ -0,0 +1,95 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__HCACHE_H__
+#define VIFM__HCACHE_H__
+
+/* This unit caches digests of contents of files or of their prefixes.  Entries
+ * are identified by device, inode, size, modification and status change times
+ * of a file, so any change of a file makes its entry unreachable.  Timestamps
+ * need to have sub-second precision, caching isn't done on systems that lack
+ * it.  Number of entries is bounded, least recently used ones are evicted
+ * first.  The bound grows to fit sets of files that are being processed up to a
+ * limit on memory.  All functions are thread-safe. */
+
+#include <stdint.h> /* uint64_t */
+#include <time.h> /* time_t */
+
+#include "utils/test_helpers.h"
+
+/* Identifies particular state of a file. */
+typedef struct
+{
+	uint64_t dev;      /* Device of the file. */
+	uint64_t inode;    /* Inode number of the file. */
+	uint64_t size;     /* Size of the file in bytes. */
+	uint64_t mtime_ns; /* Modification time in nanoseconds. */
+	uint64_t ctime_ns; /* Status change time in nanoseconds. */
+	uint64_t prefix;   /* Number of leading bytes that were digested or zero if
+	                      it's the whole file. */
+}
+hcache_key_t;
+
+/* Digest of contents of a file. */
+typedef struct
+{
+	uint64_t high; /* Upper half of the digest. */
+	uint64_t low;  /* Lower half of the digest. */
+}
+hcache_digest_t;
+
+/* Type of callback for hcache_list(). */
+typedef void (*hcache_list_cb)(const hcache_key_t *key,
+		const hcache_digest_t *digest, time_t used, void *arg);
+
+/* Builds key for the whole file at the path (symbolic links are resolved).
+ * Returns zero on success, otherwise non-zero is returned (including when the
+ * key can't reliably identify the file on this system). */
+int hcache_key_of(const char path[], hcache_key_t *key);
+
+/* Looks up digest of a file and marks the entry as recently used.  Returns
+ * non-zero if *digest was set, otherwise zero is returned. */
+int hcache_get(const hcache_key_t *key, hcache_digest_t *digest);
+
+/* Adds or updates digest of a file marking it as recently used. */
+void hcache_put(const hcache_key_t *key, const hcache_digest_t *digest);
+
+/* Restores previously saved digest of a file that was last used at the
+ * specified time.  Entry that was used more recently is left intact. */
+void hcache_restore(const hcache_key_t *key, const hcache_digest_t *digest,
+		time_t used);
+
+/* Lists all entries of the cache. */
+void hcache_list(hcache_list_cb cb, void *arg);
+
+/* Grows capacity of the cache to fit at least count entries, so that repeated
+ * processing of the same set of files doesn't evict its own entries.  The
+ * capacity never shrinks and is limited by amount of memory it takes. */
+void hcache_reserve(int count);
+
+/* Retrieves maximum number of entries in the cache.  Returns the number. */
+int hcache_capacity(void);
+
+TSTATIC_DEFS(
+	void hcache_reset(int capacity);
+)
+
+#endif /* VIFM__HCACHE_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
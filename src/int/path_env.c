@@ -18,9 +18,13 @@
 
 #include "path_env.h"
 
+#include <sys/stat.h> /* stat */
+
+#include <ctype.h> /* tolower() */
 #include <stdio.h> /* snprintf() sprintf() */
 #include <stdlib.h> /* malloc() free() */
 #include <string.h> /* strchr() strlen() */
+#include <time.h> /* time() time_t */
 
 #include "../cfg/config.h"
 #include "../compat/dtype.h"
@@ -33,16 +37,40 @@
 #include "../utils/path.h"
 #include "../utils/str.h"
 #include "../utils/string_array.h"
+#include "../utils/test_helpers.h"
+#include "../utils/trie.h"
 
 static int path_env_was_changed(int force);
 static void append_scripts_dirs(void);
 static void add_dirs_to_path(const char *path);
 static void add_to_path(const char *path);
 static void split_path_list(void);
+static int index_is_outdated(void);
+static void build_index(void);
+static int index_dir(trie_t *index, const char path[], time_t *mtime);
+static void drop_index(void);
+static void fold_case(const char name[], char buf[], size_t buf_len);
+TSTATIC void path_env_set_check_interval(int seconds);
 
 static char **paths;
 static int paths_count;
 
+/* Index of names of files in directories of $PATH (in lower case, which is
+ * fine for a set that's only allowed to have false positives).  NULL if it
+ * wasn't built or can't be used. */
+static trie_t *index_names;
+/* Whether building of the index failed for current value of $PATH, in which
+ * case it's not attempted again until $PATH is re-parsed. */
+static int index_unavailable;
+/* Modification times of directories from paths at the moment of indexing. */
+static time_t *index_mtimes;
+/* When the index was built. */
+static time_t index_time;
+/* When the directories were last checked for modifications. */
+static time_t index_checked;
+/* Minimal interval between checks of the directories in seconds. */
+static int check_interval = 1;
+
 static char *clean_path;
 static char *real_path;
 
@@ -61,7 +89,185 @@ update_path_env(int force)
 	{
 		append_scripts_dirs();
 		split_path_list();
+		drop_index();
+	}
+}
+
+int
+path_env_may_have(const char name[])
+{
+#ifdef _WIN32
+	/* Executables are found by adding extensions to their names, don't bother
+	 * with this. */
+	return 1;
+#else
+	if(strchr(name, '/') != NULL)
+	{
+		return 1;
+	}
+
+	update_path_env(0);
+
+	if(index_unavailable)
+	{
+		return 1;
+	}
+
+	if(index_names == NULL || index_is_outdated())
+	{
+		build_index();
+		if(index_names == NULL)
+		{
+			index_unavailable = 1;
+			return 1;
+		}
+	}
+
+	char folded[NAME_MAX + 1];
+	if(strlen(name) >= sizeof(folded))
+	{
+		return 1;
+	}
+	fold_case(name, folded, sizeof(folded));
+
+	void *data;
+	return (trie_get(index_names, folded, &data) == 0);
+#endif
+}
+
+/* Checks whether directories of the index were modified since it was built.
+ * Checks are rate-limited by check_interval.  Returns non-zero if so,
+ * otherwise zero is returned. */
+static int
+index_is_outdated(void)
+{
+	const time_t now = time(NULL);
+	if(now - index_checked < check_interval)
+	{
+		return 0;
+	}
+	index_checked = now;
+
+	int i;
+	for(i = 0; i < paths_count; ++i)
+	{
+		struct stat st;
+		const time_t mtime = (os_stat(paths[i], &st) == 0 ? st.st_mtime : -1);
+		/* Directory changed during the second in which it was listed might have
+		 * changed after that. */
+		if(mtime != index_mtimes[i] || mtime >= index_time)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Lists directories of $PATH and puts names of their files into the index.
+ * Leaves index_names set to NULL on failure. */
+static void
+build_index(void)
+{
+	drop_index();
+
+	trie_t *const names = trie_create(NULL);
+	time_t *const mtimes = reallocarray(NULL, paths_count + 1, sizeof(*mtimes));
+	if(names == NULL || mtimes == NULL)
+	{
+		trie_free(names);
+		free(mtimes);
+		return;
 	}
+
+	index_time = time(NULL);
+	index_checked = index_time;
+
+	int i;
+	for(i = 0; i < paths_count; ++i)
+	{
+		if(index_dir(names, paths[i], &mtimes[i]) != 0)
+		{
+			trie_free(names);
+			free(mtimes);
+			return;
+		}
+	}
+
+	index_names = names;
+	index_mtimes = mtimes;
+}
+
+/* Adds names of files of a directory to the index and retrieves modification
+ * time of the directory.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+index_dir(trie_t *index, const char path[], time_t *mtime)
+{
+	/* Contents of relative paths depend on current directory. */
+	if(!is_path_absolute(path))
+	{
+		return 1;
+	}
+
+	struct stat st;
+	if(os_stat(path, &st) != 0)
+	{
+		/* Directory that doesn't exist can't contain anything. */
+		*mtime = -1;
+		return 0;
+	}
+	*mtime = st.st_mtime;
+
+	DIR *const dir = os_opendir(path);
+	if(dir == NULL)
+	{
+		return 1;
+	}
+
+	int error = 0;
+	struct dirent *dentry;
+	while((dentry = os_readdir(dir)) != NULL)
+	{
+		char folded[NAME_MAX + 1];
+		fold_case(dentry->d_name, folded, sizeof(folded));
+		if(trie_put(index, folded) < 0)
+		{
+			error = 1;
+			break;
+		}
+	}
+
+	os_closedir(dir);
+	return error;
+}
+
+/* Frees the index and allows building it anew. */
+static void
+drop_index(void)
+{
+	index_unavailable = 0;
+	trie_free(index_names);
+	index_names = NULL;
+	free(index_mtimes);
+	index_mtimes = NULL;
+}
+
+/* Converts a name to lower case byte by byte. */
+static void
+fold_case(const char name[], char buf[], size_t buf_len)
+{
+	size_t i;
+	for(i = 0U; name[i] != '\0' && i < buf_len - 1U; ++i)
+	{
+		buf[i] = tolower((unsigned char)name[i]);
+	}
+	buf[i] = '\0';
+}
+
+TSTATIC void
+path_env_set_check_interval(int seconds)
+{
+	check_interval = seconds;
 }
 
 /* Checks if PATH environment variable was changed. Returns non-zero if path was
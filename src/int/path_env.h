@@ -21,6 +21,8 @@
 
 #include <stddef.h> /* size_t */
 
+#include "../utils/test_helpers.h"
+
 /* Asks for updating of PATH if needed (or if force parameters is true). */
 void update_path_env(int force);
 
@@ -29,6 +31,15 @@ void update_path_env(int force);
  * the count argument. */
 char ** get_paths(size_t *count);
 
+/* Checks whether a file with the name might be in one of directories of PATH.
+ * Answers through an index of those directories which is rebuilt when PATH or
+ * any of the directories changes (the latter is checked at most once a
+ * second).  If the index can't be built (e.g., because of relative or
+ * unreadable directories), every name is reported until PATH is re-parsed.
+ * Returns zero if there is definitely no such file, otherwise non-zero is
+ * returned. */
+int path_env_may_have(const char name[]);
+
 /* Sets PATH to its value that was set by user or another program. Use
  * load_real_path_env() function to revert this effect. */
 void load_clean_path_env(void);
@@ -37,6 +48,10 @@ void load_clean_path_env(void);
  * needs. */
 void load_real_path_env(void);
 
+TSTATIC_DEFS(
+	void path_env_set_check_interval(int seconds);
+)
+
 #endif /* VIFM__INT__PATH_ENV_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -23,10 +23,21 @@
 #include <stdint.h> /* uint64_t */
 #include <stdlib.h> /* calloc() free() */
 
+#include "../compat/pthread.h"
 #include "private/ioc.h"
 #include "private/ioeta.h"
 #include "private/traverser.h"
 
+/* State of estimation calculation. */
+typedef struct
+{
+	ioeta_estim_t *estim; /* Estimation being calculated. */
+	pthread_mutex_t lock; /* Protects estim. */
+	pthread_t owner;      /* Thread that started calculation, only it notifies
+	                         about progress. */
+}
+eta_state_t;
+
 static VisitResult eta_visitor(const char full_path[], VisitAction action,
 		int deep, void *param);
 
@@ -63,30 +74,47 @@ ioeta_calculate(ioeta_estim_t *estim, const char path[], int shallow, int deep)
 	}
 	else
 	{
-		(void)traverse(path, deep, &eta_visitor, estim);
+		eta_state_t state = {
+			.estim = estim,
+			.lock = PTHREAD_MUTEX_INITIALIZER,
+			.owner = pthread_self(),
+		};
+		(void)traverse_parallel(path, deep, &eta_visitor, &state);
+		pthread_mutex_destroy(&state.lock);
 	}
 }
 
-/* Implementation of traverse() visitor for subtree copying.  Returns 0 on
- * success, otherwise non-zero is returned. */
+/* Implementation of traverse_parallel() visitor for estimation calculation.
+ * Sizes are queried outside of the lock.  Returns 0 on success, otherwise
+ * non-zero is returned. */
 static VisitResult
 eta_visitor(const char full_path[], VisitAction action, int deep, void *param)
 {
-	ioeta_estim_t *const estim = param;
+	eta_state_t *const state = param;
+	ioeta_estim_t *const estim = state->estim;
 
 	if(cancelled(&estim->cancellation))
 	{
 		return VR_CANCELLED;
 	}
 
+	const int notify = pthread_equal(pthread_self(), state->owner);
+
 	switch(action)
 	{
 		case VA_DIR_ENTER:
-			ioeta_add_dir(estim, full_path);
+			pthread_mutex_lock(&state->lock);
+			ioeta_add_sized(estim, full_path, /*size=*/0, notify);
+			pthread_mutex_unlock(&state->lock);
 			return VR_SKIP_DIR_LEAVE;
 		case VA_FILE:
-			ioeta_add_file(estim, full_path, deep);
-			return VR_OK;
+			{
+				const uint64_t size = ioeta_file_size(full_path, deep);
+				pthread_mutex_lock(&state->lock);
+				ioeta_add_sized(estim, full_path, size, notify);
+				pthread_mutex_unlock(&state->lock);
+				return VR_OK;
+			}
 		case VA_DIR_LEAVE:
 			assert(0 && "Can't get here because of VR_SKIP_DIR_LEAVE.");
 			return VR_OK;
@@ -23,7 +23,11 @@
 #include "iop.h"
 
 #ifndef _WIN32
-#include <sys/ioctl.h> /* ioctl() */
+#include <sys/ioctl.h> /* _IOW() ioctl() */
+#endif
+#ifdef __linux__
+#include <sys/sendfile.h> /* sendfile() */
+#include <sys/syscall.h> /* SYS_copy_file_range */
 #endif
 #include <sys/stat.h> /* stat */
 #include <sys/types.h> /* mode_t */
@@ -32,10 +36,12 @@
 #include <assert.h> /* assert() */
 #include <errno.h> /* EEXIST ENOENT EISDIR errno */
 #include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* UINT64_MAX uint64_t */
 #include <stdio.h> /* FILE fpos_t fclose() fgetpos() fflush() fread() fseek()
                       fsetpos() fwrite() snprintf() */
-#include <stdlib.h> /* free() */
+#include <stdlib.h> /* free() malloc() */
 #include <string.h> /* strchr() */
+#include <time.h> /* clock_gettime() */
 
 #include "../compat/fs_limits.h"
 #include "../compat/os.h"
@@ -51,12 +57,42 @@
 #include "private/ioeta.h"
 #include "ioc.h"
 
-/* Amount of data to transfer at once. */
-#define BLOCK_SIZE 32*1024
+/* Amount of data to transfer at once in user space. */
+#define BLOCK_SIZE 1024*1024
+
+/* Amount of data to transfer at once in user space if allocating a buffer of
+ * BLOCK_SIZE bytes has failed. */
+#define SMALL_BLOCK_SIZE 32*1024
+
+/* Initial, minimal and maximal amounts of data to transfer at once inside the
+ * kernel. */
+#define KERNEL_CHUNK_SIZE 1024*1024
+#define MIN_KERNEL_CHUNK_SIZE 128*1024
+#define MAX_KERNEL_CHUNK_SIZE 64*1024*1024
+
+/* Desired duration of copying a single chunk inside the kernel in nanoseconds,
+ * which keeps progress reporting and cancellation responsive. */
+#define KERNEL_CHUNK_NS 100*1000*1000LL
+
+/* Whether holes of sparse files can be detected. */
+#if !defined(_WIN32) && defined(SEEK_DATA) && defined(SEEK_HOLE)
+#define SPARSE_COPYING
+#endif
 
 /* Amount of data after which data flush should be performed. */
 #define FLUSH_SIZE 256*1024*1024
 
+#ifdef __linux__
+/* Methods of copying data inside the kernel in the order of preference. */
+typedef enum
+{
+	KCM_COPY_FILE_RANGE, /* copy_file_range() system call. */
+	KCM_SENDFILE,        /* sendfile() system call. */
+	KCM_COUNT            /* Number of methods. */
+}
+KernelCopyMethod;
+#endif
+
 /* Type of io function used by retry_wrapper(). */
 typedef IoRes (*iop_func)(io_args_t *args);
 
@@ -66,6 +102,21 @@ static IoRes iop_rmfile_internal(io_args_t *args);
 static IoRes iop_rmdir_internal(io_args_t *args);
 static IoRes iop_cp_internal(io_args_t *args);
 static int clone_file(int dst_fd, int src_fd);
+#ifdef __linux__
+static int copy_in_kernel(io_args_t *args, int dst_fd, int src_fd,
+		uint64_t len, int *error);
+static ssize_t kernel_copy_chunk(KernelCopyMethod method, int dst_fd,
+		int src_fd, size_t len);
+static size_t next_chunk_size(size_t chunk, ssize_t copied, long long ns);
+static long long monotonic_ns(void);
+#endif
+#ifdef SPARSE_COPYING
+static int copy_sparse(io_args_t *args, int dst_fd, int src_fd, off_t size,
+		int *error);
+static int copy_range(io_args_t *args, int dst_fd, int src_fd, off_t from,
+		off_t to);
+#endif
+static int copy_in_user_space(io_args_t *args, FILE *out, FILE *in);
 #ifdef _WIN32
 static DWORD CALLBACK win_progress_cb(LARGE_INTEGER total,
 		LARGE_INTEGER transferred, LARGE_INTEGER stream_size,
@@ -547,60 +598,28 @@ iop_cp_internal(io_args_t *args)
 		}
 	}
 
-	/* TODO: use sendfile() if platform supports it. */
-
 	if(!error && !cloned)
 	{
-		char block[BLOCK_SIZE];
-		/* Suppress possible false-positive compiler warning. */
-		size_t nread = (size_t)-1;
-#ifndef _WIN32
-		size_t ncopied = 0U;
-		const int data_sync = args->arg4.data_sync;
-#endif
-		while((nread = fread(&block, 1, sizeof(block), in)) != 0U)
+		/* Nothing was read or written through the streams yet, so it's fine to
+		 * operate on their descriptors directly. */
+		int copied = 0;
+#ifdef SPARSE_COPYING
+		if(args->arg4.sparse_copying && crs != IO_CRS_APPEND_TO_FILES)
 		{
-			if(io_cancelled(args))
-			{
-				error = 1;
-				break;
-			}
-
-			if(fwrite(&block, 1, nread, out) != nread)
-			{
-				(void)ioe_errlst_append(&args->result.errors, dst, errno,
-						"Write to destination file failed");
-				error = 1;
-				break;
-			}
-
-			ioeta_update(args->estim, NULL, NULL, 0, nread);
-
-#ifndef _WIN32
-			/* Force flushing data to disk to not pollute RAM with this data too
-			 * much. */
-			ncopied += nread;
-			if(data_sync && ncopied >= FLUSH_SIZE)
-			{
-				(void)os_fdatasync(fileno(out));
-				ncopied -= FLUSH_SIZE;
-			}
-#endif
+			copied = (copy_sparse(args, fileno(out), fileno(in), st.st_size,
+						&error) == 0);
 		}
-
-		if(nread == 0U && !feof(in) && ferror(in))
+#endif
+#ifdef __linux__
+		if(!copied)
 		{
-			(void)ioe_errlst_append(&args->result.errors, src, errno,
-					"Read from source file failed");
+			copied = (copy_in_kernel(args, fileno(out), fileno(in), UINT64_MAX,
+						&error) == 0);
 		}
-
-		/* fwrite() does caching, so we need to force flush to catch output errors
-		 * before fclose() (which also does fflush() internally). */
-		if(fflush(out) != 0)
+#endif
+		if(!copied)
 		{
-			(void)ioe_errlst_append(&args->result.errors, dst, errno,
-					"Write to destination file failed");
-			error = 1;
+			error = copy_in_user_space(args, out, in);
 		}
 	}
 
@@ -653,17 +672,16 @@ iop_cp_internal(io_args_t *args)
 	return io_res_from_code(error);
 }
 
-/* Try to clone file fast on btrfs.  Returns 0 on success, otherwise non-zero is
- * returned. */
+/* Try to clone file fast on file systems that support reflinks (btrfs, xfs,
+ * etc.).  Returns 0 on success, otherwise non-zero is returned. */
 static int
 clone_file(int dst_fd, int src_fd)
 {
 #ifdef __linux__
-#undef BTRFS_IOCTL_MAGIC
-#define BTRFS_IOCTL_MAGIC 0x94
-#undef BTRFS_IOC_CLONE
-#define BTRFS_IOC_CLONE _IOW(BTRFS_IOCTL_MAGIC, 9, int)
-	return ioctl(dst_fd, BTRFS_IOC_CLONE, src_fd);
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+	return ioctl(dst_fd, FICLONE, src_fd);
 #else
 	(void)dst_fd;
 	(void)src_fd;
@@ -671,6 +689,403 @@ clone_file(int dst_fd, int src_fd)
 #endif
 }
 
+#ifdef __linux__
+
+/* Copies at most len bytes (UINT64_MAX for the whole rest of the file) from
+ * current position of src_fd to current position of dst_fd without passing it
+ * through user space.  Tries
+ * copy_file_range() first and sendfile() after it, switching to the next
+ * method if the current one is not supported for this pair of files.  Sets
+ * *error on failure or cancellation.  Returns zero if copying is done (or has
+ * failed), otherwise non-zero is returned to indicate that the rest of the data
+ * should be copied by other means. */
+static int
+copy_in_kernel(io_args_t *args, int dst_fd, int src_fd, uint64_t len,
+		int *error)
+{
+	const int data_sync = args->arg4.data_sync;
+	size_t chunk = KERNEL_CHUNK_SIZE;
+	uint64_t ncopied = 0U;
+
+	KernelCopyMethod method = KCM_COPY_FILE_RANGE;
+	/* Whether current method has copied anything yet. */
+	int method_worked = 0;
+
+	while(method < KCM_COUNT)
+	{
+		if(len == 0U)
+		{
+			return 0;
+		}
+
+		if(io_cancelled(args))
+		{
+			*error = 1;
+			return 0;
+		}
+
+		const long long start = monotonic_ns();
+		const ssize_t copied = kernel_copy_chunk(method, dst_fd, src_fd,
+				MIN(chunk, len));
+		if(copied < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if(copied < 0)
+		{
+			if(method_worked || (errno != ENOSYS && errno != EXDEV &&
+					errno != EINVAL && errno != EBADF && errno != EOPNOTSUPP &&
+					errno != ETXTBSY && errno != EPERM))
+			{
+				(void)ioe_errlst_append(&args->result.errors, args->arg2.dst, errno,
+						"Failed to copy file data");
+				*error = 1;
+				return 0;
+			}
+
+			method = (KernelCopyMethod)(method + 1);
+			continue;
+		}
+
+		if(copied == 0)
+		{
+			/* Some pseudo file systems report no data via these interfaces, so use
+			 * the next method if nothing was copied. */
+			if(method_worked)
+			{
+				return 0;
+			}
+			method = (KernelCopyMethod)(method + 1);
+			continue;
+		}
+
+		method_worked = 1;
+		if(len != UINT64_MAX)
+		{
+			len -= copied;
+		}
+		ioeta_update(args->estim, NULL, NULL, 0, copied);
+		chunk = next_chunk_size(chunk, copied, monotonic_ns() - start);
+
+		/* Force flushing data to disk to not pollute RAM with this data too
+		 * much. */
+		ncopied += copied;
+		if(data_sync && ncopied >= FLUSH_SIZE)
+		{
+			(void)os_fdatasync(dst_fd);
+			ncopied -= FLUSH_SIZE;
+		}
+	}
+
+	return 1;
+}
+
+/* Copies up to len bytes between current positions of the files using the
+ * specified method.  Returns number of copied bytes (zero on end of file) or -1
+ * on error with errno set. */
+static ssize_t
+kernel_copy_chunk(KernelCopyMethod method, int dst_fd, int src_fd, size_t len)
+{
+	if(method == KCM_COPY_FILE_RANGE)
+	{
+#ifdef SYS_copy_file_range
+		/* Invoking the system call directly to not depend on libc version. */
+		return syscall(SYS_copy_file_range, src_fd, NULL, dst_fd, NULL, len, 0U);
+#else
+		errno = ENOSYS;
+		return -1;
+#endif
+	}
+
+	return sendfile(dst_fd, src_fd, NULL, len);
+}
+
+/* Picks size of the next chunk based on the time it took to copy the previous
+ * one.  Returns the size. */
+static size_t
+next_chunk_size(size_t chunk, ssize_t copied, long long ns)
+{
+	if((size_t)copied < chunk)
+	{
+		/* Partial copy tells nothing about throughput. */
+		return chunk;
+	}
+
+	if(ns < KERNEL_CHUNK_NS/2 && chunk < MAX_KERNEL_CHUNK_SIZE)
+	{
+		return chunk*2;
+	}
+	if(ns > KERNEL_CHUNK_NS*2 && chunk > MIN_KERNEL_CHUNK_SIZE)
+	{
+		return chunk/2;
+	}
+	return chunk;
+}
+
+/* Retrieves value of a monotonic clock.  Returns the value in nanoseconds. */
+static long long
+monotonic_ns(void)
+{
+	struct timespec ts;
+	if(clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+	{
+		return 0;
+	}
+	return ts.tv_sec*1000000000LL + ts.tv_nsec;
+}
+
+#endif
+
+#ifdef SPARSE_COPYING
+
+/* Copies only data regions of a file leaving holes in the destination.  Skipped
+ * holes are accounted in progress at once as they take no time to process.
+ * Sets *error on failure or cancellation.  Returns zero if copying is done (or
+ * has failed), otherwise non-zero is returned to indicate that file system
+ * doesn't report holes and the data should be copied by other means. */
+static int
+copy_sparse(io_args_t *args, int dst_fd, int src_fd, off_t size, int *error)
+{
+	if(size <= 0)
+	{
+		return 1;
+	}
+
+	off_t pos = 0;
+	while(pos < size)
+	{
+		off_t data = lseek(src_fd, pos, SEEK_DATA);
+		if(data == (off_t)-1)
+		{
+			if(errno != ENXIO)
+			{
+				if(pos == 0)
+				{
+					/* Seeking is not supported, so nothing is copied yet. */
+					return 1;
+				}
+
+				(void)ioe_errlst_append(&args->result.errors, args->arg1.src, errno,
+						"Failed to find data in source file");
+				*error = 1;
+				return 0;
+			}
+
+			/* The rest of the file is a hole. */
+			data = size;
+		}
+
+		off_t hole = size;
+		if(data < size)
+		{
+			hole = lseek(src_fd, data, SEEK_HOLE);
+			if(hole == (off_t)-1)
+			{
+				(void)ioe_errlst_append(&args->result.errors, args->arg1.src, errno,
+						"Failed to find hole in source file");
+				*error = 1;
+				return 0;
+			}
+		}
+
+		if(data > pos)
+		{
+			ioeta_update(args->estim, NULL, NULL, 0, MIN(data, size) - pos);
+		}
+
+		if(data < hole && copy_range(args, dst_fd, src_fd, data, hole) != 0)
+		{
+			*error = 1;
+			return 0;
+		}
+
+		pos = hole;
+	}
+
+	/* Size of the file has to be set explicitly if it ends with a hole.  The
+	 * file might have also grown while it was being copied. */
+	if(ftruncate(dst_fd, pos) != 0)
+	{
+		(void)ioe_errlst_append(&args->result.errors, args->arg2.dst, errno,
+				"Failed to set size of destination file");
+		*error = 1;
+	}
+
+	return 0;
+}
+
+/* Copies data in the [from, to) range of source file to the same range of
+ * destination file.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+copy_range(io_args_t *args, int dst_fd, int src_fd, off_t from, off_t to)
+{
+	if(lseek(src_fd, from, SEEK_SET) == (off_t)-1 ||
+			lseek(dst_fd, from, SEEK_SET) == (off_t)-1)
+	{
+		(void)ioe_errlst_append(&args->result.errors, args->arg2.dst, errno,
+				"Failed to seek in file");
+		return 1;
+	}
+
+#ifdef __linux__
+	int error = 0;
+	if(copy_in_kernel(args, dst_fd, src_fd, to - from, &error) == 0)
+	{
+		return error;
+	}
+#endif
+
+	char small_block[SMALL_BLOCK_SIZE];
+	size_t block_size = BLOCK_SIZE;
+	char *block = malloc(block_size);
+	if(block == NULL)
+	{
+		block = small_block;
+		block_size = sizeof(small_block);
+	}
+
+	int result = 0;
+	off_t left = to - from;
+	while(left > 0)
+	{
+		if(io_cancelled(args))
+		{
+			result = 1;
+			break;
+		}
+
+		const ssize_t nread = read(src_fd, block, MIN((off_t)block_size, left));
+		if(nread < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(nread <= 0)
+		{
+			if(nread < 0)
+			{
+				(void)ioe_errlst_append(&args->result.errors, args->arg1.src, errno,
+						"Read from source file failed");
+				result = 1;
+			}
+			/* The file must have been truncated meanwhile. */
+			break;
+		}
+
+		ssize_t nwritten = 0;
+		while(nwritten < nread)
+		{
+			const ssize_t n = write(dst_fd, block + nwritten, nread - nwritten);
+			if(n < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if(n < 0)
+			{
+				(void)ioe_errlst_append(&args->result.errors, args->arg2.dst, errno,
+						"Write to destination file failed");
+				result = 1;
+				break;
+			}
+			nwritten += n;
+		}
+		if(result != 0)
+		{
+			break;
+		}
+
+		ioeta_update(args->estim, NULL, NULL, 0, nread);
+		left -= nread;
+	}
+
+	if(block != small_block)
+	{
+		free(block);
+	}
+
+	return result;
+}
+
+#endif
+
+/* Copies the rest of the data from one stream to another in user space.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+copy_in_user_space(io_args_t *args, FILE *out, FILE *in)
+{
+	const char *const src = args->arg1.src;
+	const char *const dst = args->arg2.dst;
+
+	char small_block[SMALL_BLOCK_SIZE];
+	size_t block_size = BLOCK_SIZE;
+	char *block = malloc(block_size);
+	if(block == NULL)
+	{
+		block = small_block;
+		block_size = sizeof(small_block);
+	}
+
+	int error = 0;
+	/* Suppress possible false-positive compiler warning. */
+	size_t nread = (size_t)-1;
+#ifndef _WIN32
+	size_t ncopied = 0U;
+	const int data_sync = args->arg4.data_sync;
+#endif
+	while((nread = fread(block, 1, block_size, in)) != 0U)
+	{
+		if(io_cancelled(args))
+		{
+			error = 1;
+			break;
+		}
+
+		if(fwrite(block, 1, nread, out) != nread)
+		{
+			(void)ioe_errlst_append(&args->result.errors, dst, errno,
+					"Write to destination file failed");
+			error = 1;
+			break;
+		}
+
+		ioeta_update(args->estim, NULL, NULL, 0, nread);
+
+#ifndef _WIN32
+		/* Force flushing data to disk to not pollute RAM with this data too
+		 * much. */
+		ncopied += nread;
+		if(data_sync && ncopied >= FLUSH_SIZE)
+		{
+			(void)os_fdatasync(fileno(out));
+			ncopied -= FLUSH_SIZE;
+		}
+#endif
+	}
+
+	if(nread == 0U && !feof(in) && ferror(in))
+	{
+		(void)ioe_errlst_append(&args->result.errors, src, errno,
+				"Read from source file failed");
+	}
+
+	/* fwrite() does caching, so we need to force flush to catch output errors
+	 * before fclose() (which also does fflush() internally). */
+	if(fflush(out) != 0)
+	{
+		(void)ioe_errlst_append(&args->result.errors, dst, errno,
+				"Write to destination file failed");
+		error = 1;
+	}
+
+	if(block != small_block)
+	{
+		free(block);
+	}
+
+	return error;
+}
+
 #ifdef _WIN32
 
 static DWORD CALLBACK win_progress_cb(LARGE_INTEGER total,
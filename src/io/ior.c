@@ -23,29 +23,87 @@
 
 #include <errno.h> /* EEXIST EISDIR ENOTEMPTY EXDEV errno */
 #include <stddef.h> /* NULL */
+#include <stdint.h> /* uint64_t */
 #include <stdio.h> /* remove() snprintf() */
 #include <stdlib.h> /* free() */
-#include <string.h> /* strlen() */
+#include <string.h> /* strdup() strlen() */
 
 #include "../compat/fs_limits.h"
 #include "../compat/os.h"
+#include "../compat/pthread.h"
+#include "../utils/darray.h"
 #include "../utils/fs.h"
 #include "../utils/log.h"
+#include "../utils/macros.h"
 #include "../utils/path.h"
 #include "../utils/str.h"
 #include "../utils/utils.h"
+#include "../utils/workers.h"
 #include "../background.h"
 #include "private/ioc.h"
 #include "private/ioe.h"
 #include "private/ioeta.h"
+#include "private/parcp.h"
 #include "private/traverser.h"
 #include "ioc.h"
 #include "iop.h"
 
+/* Maximum size of a file that's copied by a pool of threads.  Copying of
+ * larger files is limited by throughput rather than by latency of file system
+ * operations. */
+#define PARALLEL_CP_MAX_SIZE (1024*1024)
+
+/* Maximum number of threads copying small files. */
+#define MAX_CP_WORKERS 8
+
+/* State of parallel removal. */
+typedef struct
+{
+	io_args_t *args;      /* Arguments of the operation. */
+	pthread_mutex_t lock; /* Protects args. */
+	pthread_t owner;      /* Thread that started removal, only it notifies about
+	                         progress. */
+}
+rm_state_t;
+
+/* Directory whose attributes are to be set once files queued before leaving it
+ * are copied. */
+typedef struct
+{
+	char *path; /* Source path. */
+	int deep;   /* Deep parameter of the visitor. */
+	int seq;    /* Number of files that must be copied first. */
+}
+deferred_dir_t;
+
+/* State of recursive copying. */
+typedef struct
+{
+	io_args_t *args;       /* Arguments of the operation. */
+	parcp_t *parcp;        /* Pool of threads copying small files or NULL. */
+	int no_parcp;          /* Whether creating the pool has failed. */
+	int nqueued;           /* Number of files handed to the pool so far. */
+	char *done;            /* Whether file with a given sequence number is done. */
+	DA_INSTANCE_FIELD(done);
+	int ndone;             /* Length of done prefix of queued files. */
+	deferred_dir_t *dirs;  /* Directories waiting for their files to be copied. */
+	DA_INSTANCE_FIELD(dirs);
+	size_t dirs_head;      /* Index of the first unprocessed directory. */
+}
+cp_state_t;
+
 static VisitResult rm_visitor(const char full_path[], VisitAction action,
 		int deep, void *param);
+static VisitResult par_rm_visitor(const char full_path[],
+		VisitAction action, int deep, void *param);
 static VisitResult cp_visitor(const char full_path[], VisitAction action,
 		int deep, void *param);
+static int queue_copy(cp_state_t *state, const char full_path[]);
+static int defer_dir(cp_state_t *state, const char full_path[], int deep);
+static VisitResult collect_copies(cp_state_t *state, int wait);
+static VisitResult finish_copy(cp_state_t *state, parcp_job_t *job);
+static char * get_dst_path(const io_args_t *args, const char full_path[]);
+static void cp_state_free(cp_state_t *state);
 static IoRes mv_by_copy(io_args_t *args, int confirmed);
 static IoRes mv_replacing_all(io_args_t *args);
 static IoRes mv_replacing_files(io_args_t *args);
@@ -60,7 +118,22 @@ IoRes
 ior_rm(io_args_t *args)
 {
 	const char *const path = args->arg1.path;
-	return traverse(path, /*deep=*/0, &rm_visitor, args);
+
+	/* Errors can't be handled interactively from several threads. */
+	if(args->result.errors_cb != NULL)
+	{
+		return traverse(path, /*deep=*/0, &rm_visitor, args);
+	}
+
+	rm_state_t state = {
+		.args = args,
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.owner = pthread_self(),
+	};
+	const IoRes result = traverse_parallel(path, /*deep=*/0, &par_rm_visitor,
+			&state);
+	pthread_mutex_destroy(&state.lock);
+	return result;
 }
 
 /* Implementation of traverse() visitor for subtree removal.  Returns 0 on
@@ -117,6 +190,66 @@ rm_visitor(const char full_path[], VisitAction action, int deep, void *param)
 	return result;
 }
 
+/* Implementation of traverse_parallel() visitor for subtree removal.  Files are
+ * removed without holding the lock, which is taken only to report progress and
+ * errors.  Returns 0 on success, otherwise non-zero is returned. */
+static VisitResult
+par_rm_visitor(const char full_path[], VisitAction action, int deep,
+		void *param)
+{
+	rm_state_t *const state = param;
+	io_args_t *const rm_args = state->args;
+
+	if(io_cancelled(rm_args))
+	{
+		return VR_CANCELLED;
+	}
+
+	if(action == VA_DIR_ENTER)
+	{
+		/* Do nothing, directories are removed on leaving them. */
+		return VR_OK;
+	}
+
+	io_args_t args = {
+		.arg1.path = full_path,
+
+		.cancellation = rm_args->cancellation,
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	uint64_t size = 0U;
+	IoRes result;
+	if(action == VA_FILE)
+	{
+		if(rm_args->estim != NULL)
+		{
+			size = get_file_size(full_path);
+		}
+		result = iop_rmfile(&args);
+	}
+	else
+	{
+		result = iop_rmdir(&args);
+	}
+
+	pthread_mutex_lock(&state->lock);
+	ioe_errlst_splice(&rm_args->result.errors, &args.result.errors);
+	if(pthread_equal(pthread_self(), state->owner))
+	{
+		ioeta_update(rm_args->estim, full_path, full_path, /*finished=*/1, size);
+	}
+	else
+	{
+		ioeta_update_quietly(rm_args->estim, full_path, full_path,
+				/*finished=*/1, size);
+	}
+	pthread_mutex_unlock(&state->lock);
+
+	ioe_errlst_free(&args.result.errors);
+	return vr_from_io_res(result);
+}
+
 IoRes
 ior_cp(io_args_t *args)
 {
@@ -155,15 +288,248 @@ ior_cp(io_args_t *args)
 		}
 	}
 
-	return traverse(src, deep_copying, &cp_visitor, args);
+	cp_state_t state = { .args = args };
+	IoRes result = traverse(src, deep_copying, &cp_visitor, &state);
+
+	if(result == IO_RES_SUCCEEDED)
+	{
+		switch(collect_copies(&state, /*wait=*/1))
+		{
+			case VR_OK:        break;
+			case VR_CANCELLED: result = IO_RES_ABORTED; break;
+			default:           result = IO_RES_FAILED; break;
+		}
+	}
+
+	cp_state_free(&state);
+	return result;
 }
 
-/* Implementation of traverse() visitor for subtree copying.  Returns 0 on
+/* Implementation of traverse() visitor for subtree copying.  Small files are
+ * copied by a pool of threads while the tree is being traversed, attributes of
+ * directories are set after all of their files are copied.  Returns 0 on
  * success, otherwise non-zero is returned. */
 static VisitResult
 cp_visitor(const char full_path[], VisitAction action, int deep, void *param)
 {
-	return cp_mv_visitor(full_path, action, param, /*cp=*/1, deep);
+	cp_state_t *const state = param;
+
+	VisitResult result = collect_copies(state, /*wait=*/0);
+	if(result != VR_OK)
+	{
+		return result;
+	}
+
+	switch(action)
+	{
+		case VA_DIR_ENTER:
+			break;
+		case VA_FILE:
+			if(queue_copy(state, full_path) == 0)
+			{
+				return VR_OK;
+			}
+			break;
+		case VA_DIR_LEAVE:
+			if(state->ndone < state->nqueued ||
+					state->dirs_head < DA_SIZE(state->dirs))
+			{
+				if(defer_dir(state, full_path, deep) == 0)
+				{
+					return VR_OK;
+				}
+
+				/* Can't postpone, so wait for all files to be copied instead. */
+				result = collect_copies(state, /*wait=*/1);
+				if(result != VR_OK)
+				{
+					return result;
+				}
+			}
+			break;
+	}
+
+	return cp_mv_visitor(full_path, action, state->args, /*cp=*/1, deep);
+}
+
+/* Hands copying of a small file to the pool of threads if it can be done
+ * without any interaction with the user.  Returns zero if the file was queued,
+ * otherwise non-zero is returned. */
+static int
+queue_copy(cp_state_t *state, const char full_path[])
+{
+	if(state->no_parcp || state->args->arg3.crs == IO_CRS_APPEND_TO_FILES)
+	{
+		return 1;
+	}
+
+	struct stat st;
+	if(os_lstat(full_path, &st) != 0 || !S_ISREG(st.st_mode) ||
+			st.st_size > PARALLEL_CP_MAX_SIZE)
+	{
+		return 1;
+	}
+
+	char *const dst = get_dst_path(state->args, full_path);
+	if(dst == NULL || path_exists(dst, NODEREF))
+	{
+		/* Overwriting requires confirmation. */
+		free(dst);
+		return 1;
+	}
+
+	if(state->parcp == NULL)
+	{
+		const int nworkers = MIN(MAX_CP_WORKERS, 2*workers_cpu_count());
+		state->parcp = parcp_create(state->args, nworkers);
+		if(state->parcp == NULL)
+		{
+			state->no_parcp = 1;
+			free(dst);
+			return 1;
+		}
+	}
+
+	char *const done = DA_EXTEND(state->done);
+	if(done == NULL ||
+			parcp_add(state->parcp, full_path, dst, st.st_size, state->nqueued) != 0)
+	{
+		free(dst);
+		return 1;
+	}
+
+	*done = 0;
+	DA_COMMIT(state->done);
+	++state->nqueued;
+
+	free(dst);
+	return 0;
+}
+
+/* Postpones setting attributes of a directory until all files queued so far
+ * are copied.  Returns zero on success, otherwise non-zero is returned. */
+static int
+defer_dir(cp_state_t *state, const char full_path[], int deep)
+{
+	deferred_dir_t *const dir = DA_EXTEND(state->dirs);
+	if(dir == NULL)
+	{
+		return 1;
+	}
+
+	dir->path = strdup(full_path);
+	if(dir->path == NULL)
+	{
+		return 1;
+	}
+
+	dir->deep = deep;
+	dir->seq = state->nqueued;
+	DA_COMMIT(state->dirs);
+	return 0;
+}
+
+/* Accounts files copied by the pool of threads and processes directories that
+ * were waiting for them.  Optionally waits for all queued files to be copied.
+ * Returns status of the processing. */
+static VisitResult
+collect_copies(cp_state_t *state, int wait)
+{
+	if(state->parcp == NULL)
+	{
+		return VR_OK;
+	}
+
+	parcp_job_t *job;
+	while((job = parcp_take(state->parcp, wait)) != NULL)
+	{
+		const VisitResult result = finish_copy(state, job);
+		parcp_job_free(job);
+		if(result != VR_OK)
+		{
+			return result;
+		}
+	}
+
+	while(state->ndone < state->nqueued && state->done[state->ndone])
+	{
+		++state->ndone;
+	}
+
+	/* Directories are deferred in the order of leaving them, which makes all
+	 * children get processed before their parents. */
+	while(state->dirs_head < DA_SIZE(state->dirs))
+	{
+		deferred_dir_t *const dir = &state->dirs[state->dirs_head];
+		if(dir->seq > state->ndone)
+		{
+			break;
+		}
+
+		++state->dirs_head;
+		const VisitResult result = cp_mv_visitor(dir->path, VA_DIR_LEAVE,
+				state->args, /*cp=*/1, dir->deep);
+		if(result != VR_OK)
+		{
+			return result;
+		}
+	}
+
+	return VR_OK;
+}
+
+/* Accounts result of copying a file by the pool of threads.  Failed copies are
+ * redone in the current thread to report errors in a regular way.  Returns
+ * status of the processing. */
+static VisitResult
+finish_copy(cp_state_t *state, parcp_job_t *job)
+{
+	io_args_t *const args = state->args;
+	VisitResult result = VR_OK;
+
+	if(io_cancelled(args))
+	{
+		result = VR_CANCELLED;
+	}
+	else if(job->failed)
+	{
+		result = cp_mv_visitor(job->src, VA_FILE, args, /*cp=*/1, /*deep=*/0);
+	}
+	else
+	{
+		/* Mimic progress reporting of copying a file. */
+		ioeta_update(args->estim, job->src, job->dst, /*finished=*/0, /*size=*/0);
+		ioeta_update(args->estim, NULL, NULL, /*finished=*/1, job->size);
+	}
+
+	state->done[job->seq] = 1;
+	return result;
+}
+
+/* Builds destination path for a path inside the source tree.  Returns newly
+ * allocated string or NULL on error. */
+static char *
+get_dst_path(const io_args_t *args, const char full_path[])
+{
+	const char *const rel_part = full_path + strlen(args->arg1.src);
+	return (rel_part[0] == '\0')
+	     ? strdup(args->arg2.dst)
+	     : join_paths(args->arg2.dst, rel_part);
+}
+
+/* Stops copying in background and frees resources of the state. */
+static void
+cp_state_free(cp_state_t *state)
+{
+	parcp_free(state->parcp);
+
+	size_t i;
+	for(i = 0U; i < DA_SIZE(state->dirs); ++i)
+	{
+		free(state->dirs[i].path);
+	}
+	DA_REMOVE_ALL(state->dirs);
+	DA_REMOVE_ALL(state->done);
 }
 
 IoRes
@@ -434,6 +800,7 @@ cp_mv_visitor(const char full_path[], VisitAction action, void *param, int cp,
 					/* It's safe to always use fast file cloning on moving files. */
 					.arg4.fast_file_cloning = cp ? cp_args->arg4.fast_file_cloning : 1,
 					.arg4.data_sync = cp_args->arg4.data_sync,
+					.arg4.sparse_copying = cp_args->arg4.sparse_copying,
 					/* Deep copying may be suppressed for links that can't be copied. */
 					.arg4.deep_copying = cp ? deep && cp_args->arg4.deep_copying : 0,
 
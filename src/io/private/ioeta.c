@@ -28,6 +28,9 @@
 #include "../ioeta.h"
 #include "ionotif.h"
 
+static void update(ioeta_estim_t *estim, const char path[],
+		const char target[], int finished, uint64_t bytes, int notify);
+
 void
 ioeta_release(ioeta_estim_t *estim)
 {
@@ -37,27 +40,39 @@ ioeta_release(ioeta_estim_t *estim)
 
 void
 ioeta_add_item(ioeta_estim_t *estim, const char path[])
+{
+	ioeta_add_sized(estim, path, /*size=*/0, /*notify=*/1);
+}
+
+void
+ioeta_add_file(ioeta_estim_t *estim, const char path[], int deep)
+{
+	ioeta_add_sized(estim, path, ioeta_file_size(path, deep), /*notify=*/1);
+}
+
+void
+ioeta_add_sized(ioeta_estim_t *estim, const char path[], uint64_t size,
+		int notify)
 {
 	++estim->total_items;
+	estim->total_bytes += size;
 
 	replace_string(&estim->item, path);
 
-	ionotif_notify(IO_PS_ESTIMATING, estim);
+	if(notify)
+	{
+		ionotif_notify(IO_PS_ESTIMATING, estim);
+	}
 }
 
-void
-ioeta_add_file(ioeta_estim_t *estim, const char path[], int deep)
+uint64_t
+ioeta_file_size(const char path[], int deep)
 {
 	if(deep)
 	{
-		estim->total_bytes += get_target_file_size(path);
+		return get_target_file_size(path);
 	}
-	else if(!is_symlink(path))
-	{
-		estim->total_bytes += get_file_size(path);
-	}
-
-	ioeta_add_item(estim, path);
+	return (is_symlink(path) ? 0U : get_file_size(path));
 }
 
 void
@@ -70,6 +85,21 @@ ioeta_add_dir(ioeta_estim_t *estim, const char path[])
 void
 ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 		int finished, uint64_t bytes)
+{
+	update(estim, path, target, finished, bytes, /*notify=*/1);
+}
+
+void
+ioeta_update_quietly(ioeta_estim_t *estim, const char path[],
+		const char target[], int finished, uint64_t bytes)
+{
+	update(estim, path, target, finished, bytes, /*notify=*/0);
+}
+
+/* Implementation of ioeta_update() and ioeta_update_quietly(). */
+static void
+update(ioeta_estim_t *estim, const char path[], const char target[],
+		int finished, uint64_t bytes, int notify)
 {
 	if(estim == NULL || estim->silent)
 	{
@@ -111,7 +141,10 @@ ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 		replace_string(&estim->target, target);
 	}
 
-	ionotif_notify(IO_PS_IN_PROGRESS, estim);
+	if(notify)
+	{
+		ionotif_notify(IO_PS_IN_PROGRESS, estim);
+	}
 }
 
 int
@@ -35,6 +35,15 @@ void ioeta_add_item(ioeta_estim_t *estim, const char path[]);
 /* Adds file to the estimation.  Deep estimation resolves symlinks. */
 void ioeta_add_file(ioeta_estim_t *estim, const char path[], int deep);
 
+/* Adds item of specified size to the estimation.  Notification about the change
+ * is issued only if notify is non-zero. */
+void ioeta_add_sized(ioeta_estim_t *estim, const char path[], uint64_t size,
+		int notify);
+
+/* Computes size of a file for the purposes of estimation.  Deep estimation
+ * resolves symlinks.  Returns the size. */
+uint64_t ioeta_file_size(const char path[], int deep);
+
 /* Adds directory to the estimation. */
 void ioeta_add_dir(ioeta_estim_t *estim, const char path[]);
 
@@ -48,6 +57,11 @@ void ioeta_add_dir(ioeta_estim_t *estim, const char path[]);
 void ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 		int finished, uint64_t bytes);
 
+/* Same as ioeta_update(), but doesn't call progress changed notification
+ * handler.  Meant for threads other than the one that owns the operation. */
+void ioeta_update_quietly(ioeta_estim_t *estim, const char path[],
+		const char target[], int finished, uint64_t bytes);
+
 /* Silence future progress reports.  Returns previous state to be passed to
  * ioeta_silent_set() later.  If estim is NULL, returns zero. */
 int ioeta_silent_on(ioeta_estim_t *estim);
@@ -0,0 +1,289 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "parcp.h"
+
+#include <unistd.h> /* unlink() */
+
+#include <errno.h> /* EEXIST */
+#include <stddef.h> /* NULL */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* calloc() free() */
+#include <string.h> /* strdup() */
+
+#include "../../compat/pthread.h"
+#include "../../compat/reallocarray.h"
+#include "../iop.h"
+#include "ioc.h"
+
+/* List of jobs. */
+typedef struct
+{
+	parcp_job_t *head; /* First job or NULL. */
+	parcp_job_t *tail; /* Last job or NULL. */
+}
+job_list_t;
+
+struct parcp_t
+{
+	pthread_mutex_t lock;    /* Protects fields below. */
+	pthread_cond_t queued;   /* Signaled when a job is queued or on stop. */
+	pthread_cond_t finished; /* Signaled when a job is finished. */
+	job_list_t queue;        /* Jobs waiting for a worker. */
+	job_list_t done;         /* Finished jobs. */
+	int unfinished;          /* Number of queued and running jobs. */
+	int stop;                /* Whether workers should quit. */
+
+	pthread_t *threads; /* Worker threads. */
+	int nthreads;       /* Number of elements in threads. */
+
+	io_args_t tmpl; /* Flags and cancellation settings for copying. */
+};
+
+static void * worker_thread(void *arg);
+static void copy_file(const parcp_t *pc, parcp_job_t *job);
+static void list_append(job_list_t *list, parcp_job_t *job);
+static parcp_job_t * list_pop(job_list_t *list);
+static void list_free(job_list_t *list);
+
+parcp_t *
+parcp_create(const io_args_t *args, int nworkers)
+{
+	parcp_t *const pc = calloc(1, sizeof(*pc));
+	if(pc == NULL)
+	{
+		return NULL;
+	}
+
+	pc->threads = reallocarray(NULL, nworkers, sizeof(*pc->threads));
+	if(pc->threads == NULL || pthread_mutex_init(&pc->lock, NULL) != 0)
+	{
+		free(pc->threads);
+		free(pc);
+		return NULL;
+	}
+	pthread_cond_init(&pc->queued, NULL);
+	pthread_cond_init(&pc->finished, NULL);
+
+	pc->tmpl.arg4 = args->arg4;
+	pc->tmpl.cancellation = args->cancellation;
+
+	while(pc->nthreads < nworkers)
+	{
+		if(pthread_create(&pc->threads[pc->nthreads], NULL, &worker_thread,
+					pc) != 0)
+		{
+			break;
+		}
+		++pc->nthreads;
+	}
+
+	if(pc->nthreads == 0)
+	{
+		parcp_free(pc);
+		return NULL;
+	}
+
+	return pc;
+}
+
+void
+parcp_free(parcp_t *pc)
+{
+	if(pc == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&pc->lock);
+	pc->stop = 1;
+	pthread_cond_broadcast(&pc->queued);
+	pthread_mutex_unlock(&pc->lock);
+
+	int i;
+	for(i = 0; i < pc->nthreads; ++i)
+	{
+		(void)pthread_join(pc->threads[i], NULL);
+	}
+
+	list_free(&pc->queue);
+	list_free(&pc->done);
+
+	pthread_cond_destroy(&pc->finished);
+	pthread_cond_destroy(&pc->queued);
+	pthread_mutex_destroy(&pc->lock);
+	free(pc->threads);
+	free(pc);
+}
+
+int
+parcp_add(parcp_t *pc, const char src[], const char dst[], uint64_t size,
+		int seq)
+{
+	parcp_job_t *const job = calloc(1, sizeof(*job));
+	if(job == NULL)
+	{
+		return 1;
+	}
+
+	job->src = strdup(src);
+	job->dst = strdup(dst);
+	job->size = size;
+	job->seq = seq;
+	if(job->src == NULL || job->dst == NULL)
+	{
+		parcp_job_free(job);
+		return 1;
+	}
+
+	pthread_mutex_lock(&pc->lock);
+	list_append(&pc->queue, job);
+	++pc->unfinished;
+	pthread_cond_signal(&pc->queued);
+	pthread_mutex_unlock(&pc->lock);
+	return 0;
+}
+
+parcp_job_t *
+parcp_take(parcp_t *pc, int wait)
+{
+	pthread_mutex_lock(&pc->lock);
+	while(wait && pc->done.head == NULL && pc->unfinished != 0)
+	{
+		pthread_cond_wait(&pc->finished, &pc->lock);
+	}
+	parcp_job_t *const job = list_pop(&pc->done);
+	pthread_mutex_unlock(&pc->lock);
+
+	return job;
+}
+
+void
+parcp_job_free(parcp_job_t *job)
+{
+	free(job->src);
+	free(job->dst);
+	free(job);
+}
+
+/* Entry point of a worker thread.  Returns NULL. */
+static void *
+worker_thread(void *arg)
+{
+	parcp_t *const pc = arg;
+
+	pthread_mutex_lock(&pc->lock);
+	while(1)
+	{
+		while(!pc->stop && pc->queue.head == NULL)
+		{
+			pthread_cond_wait(&pc->queued, &pc->lock);
+		}
+		if(pc->stop)
+		{
+			break;
+		}
+
+		parcp_job_t *const job = list_pop(&pc->queue);
+		pthread_mutex_unlock(&pc->lock);
+
+		copy_file(pc, job);
+
+		pthread_mutex_lock(&pc->lock);
+		list_append(&pc->done, job);
+		--pc->unfinished;
+		pthread_cond_signal(&pc->finished);
+	}
+	pthread_mutex_unlock(&pc->lock);
+
+	return NULL;
+}
+
+/* Copies a single file recording the outcome in the job. */
+static void
+copy_file(const parcp_t *pc, parcp_job_t *job)
+{
+	io_args_t args = {
+		.arg1.src = job->src,
+		.arg2.dst = job->dst,
+		.arg3.crs = IO_CRS_FAIL,
+		.arg4 = pc->tmpl.arg4,
+
+		.cancellation = pc->tmpl.cancellation,
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	job->failed = (iop_cp(&args) != IO_RES_SUCCEEDED)
+	           || args.result.errors.error_count != 0U;
+
+	/* Don't leave partial copies behind unless the file was created by someone
+	 * else. */
+	if(job->failed && (args.result.errors.error_count == 0U ||
+				args.result.errors.errors[0].error_code != EEXIST))
+	{
+		(void)unlink(job->dst);
+	}
+
+	ioe_errlst_free(&args.result.errors);
+}
+
+/* Appends a job to the list. */
+static void
+list_append(job_list_t *list, parcp_job_t *job)
+{
+	job->next = NULL;
+	if(list->tail == NULL)
+	{
+		list->head = job;
+	}
+	else
+	{
+		list->tail->next = job;
+	}
+	list->tail = job;
+}
+
+/* Removes the first job of the list.  Returns the job or NULL. */
+static parcp_job_t *
+list_pop(job_list_t *list)
+{
+	parcp_job_t *const job = list->head;
+	if(job != NULL)
+	{
+		list->head = job->next;
+		if(list->head == NULL)
+		{
+			list->tail = NULL;
+		}
+	}
+	return job;
+}
+
+/* Frees all jobs of the list. */
+static void
+list_free(job_list_t *list)
+{
+	parcp_job_t *job;
+	while((job = list_pop(list)) != NULL)
+	{
+		parcp_job_free(job);
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
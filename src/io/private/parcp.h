@@ -0,0 +1,72 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__IO__PRIVATE__PARCP_H__
+#define VIFM__IO__PRIVATE__PARCP_H__
+
+#include <stdint.h> /* uint64_t */
+
+#include "../ioc.h"
+
+/* parcp - pool of threads that copy files concurrently with traversal of a
+ * tree.  Copies are performed silently (no progress, no prompts, no error
+ * dialogs), the client is responsible for accounting results in the order of
+ * completion. */
+
+/* Opaque declaration of the pool. */
+typedef struct parcp_t parcp_t;
+
+/* Result of copying a single file. */
+typedef struct parcp_job_t
+{
+	char *src;                /* Source path. */
+	char *dst;                /* Destination path. */
+	uint64_t size;            /* Size of the file at the moment of queueing. */
+	int seq;                  /* Sequence number specified by the client. */
+	int failed;               /* Whether copying has failed or was cancelled. */
+	struct parcp_job_t *next; /* Next job in a queue. */
+}
+parcp_job_t;
+
+/* Starts up to nworkers threads that copy files with flags and cancellation
+ * settings of the args.  Returns the pool or NULL if no threads could be
+ * started. */
+parcp_t * parcp_create(const io_args_t *args, int nworkers);
+
+/* Stops the pool dropping jobs that weren't started yet and waiting for the
+ * running ones to finish.  The parameter can be NULL. */
+void parcp_free(parcp_t *pc);
+
+/* Queues copying of a regular file to a destination that doesn't exist.  On
+ * failure destination is removed, so the copy can be retried.  Returns zero on
+ * success, otherwise non-zero is returned. */
+int parcp_add(parcp_t *pc, const char src[], const char dst[], uint64_t size,
+		int seq);
+
+/* Retrieves a finished job optionally waiting for one.  Returns the job, which
+ * should be freed with parcp_job_free(), or NULL if there are no finished jobs
+ * (and no unfinished ones if waiting). */
+parcp_job_t * parcp_take(parcp_t *pc, int wait);
+
+/* Frees a job. */
+void parcp_job_free(parcp_job_t *job);
+
+#endif /* VIFM__IO__PRIVATE__PARCP_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
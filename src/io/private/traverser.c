@@ -18,15 +18,530 @@
 
 #include "traverser.h"
 
+#ifndef _WIN32
+#include <sys/stat.h> /* S_ISDIR fstat() fstatat() stat */
+#include <dirent.h> /* DIR DT_DIR DT_LNK DT_UNKNOWN closedir() dirfd()
+                       fdopendir() */
+#include <fcntl.h> /* AT_FDCWD AT_SYMLINK_NOFOLLOW O_CLOEXEC O_DIRECTORY
+                      O_NOFOLLOW O_RDONLY openat() */
+#include <unistd.h> /* close() */
+#endif
+
 #include <stddef.h> /* NULL */
 #include <stdio.h> /* snprintf() */
-#include <stdlib.h> /* free() */
+#include <stdlib.h> /* calloc() free() */
+#include <string.h> /* strdup() */
 
+#include "../../compat/dtype.h"
 #include "../../compat/os.h"
+#include "../../compat/pthread.h"
 #include "../../utils/fs.h"
+#include "../../utils/macros.h"
 #include "../../utils/path.h"
 #include "../../utils/str.h"
 #include "../../utils/trie.h"
+#include "../../utils/workers.h"
+
+/* Maximum number of threads used by parallel traversal. */
+#define MAX_TRAVERSE_WORKERS 8
+
+#ifndef _WIN32
+
+/* Directory on the way from the root of traversal to the current one, used to
+ * detect symbolic link cycles. */
+typedef struct ancestor_t
+{
+	dev_t dev;                       /* Device of the directory. */
+	ino_t ino;                       /* Inode of the directory. */
+	const struct ancestor_t *parent; /* Parent directory or NULL. */
+}
+ancestor_t;
+
+/* Data used by traverse_subtree(). */
+typedef struct
+{
+	subtree_visitor visitor; /* Callback to invoke for directories and files. */
+	void *param;             /* Parameter to pass to the visitor. */
+	int deep;                /* Whether symlinks in source path are resolved. */
+}
+traverse_data_t;
+
+/* Directory of parallel traversal. */
+typedef struct par_dir_t
+{
+	char *path;               /* Full path to the directory. */
+	ancestor_t self;          /* Identity of the directory. */
+	struct par_dir_t *parent; /* Parent directory or NULL for the root. */
+	int pending;              /* Number of unfinished subdirectories plus one for
+	                             reading the directory itself. */
+	int skip_leave;           /* Whether VA_DIR_LEAVE shouldn't be reported. */
+	struct par_dir_t *next;   /* Next directory in the stack of unread ones. */
+}
+par_dir_t;
+
+/* State of parallel traversal. */
+typedef struct
+{
+	pthread_mutex_t lock; /* Protects fields below. */
+	pthread_cond_t cond;  /* Signaled on adding a directory and on finishing. */
+	par_dir_t *stack;     /* Directories that weren't read yet. */
+	int busy;             /* Number of threads that are reading directories. */
+	VisitResult result;   /* First failure of the traversal or VR_OK. */
+	int spawned;          /* Whether helper threads were started. */
+	pthread_t threads[MAX_TRAVERSE_WORKERS - 1]; /* Helper threads. */
+	int nthreads;         /* Number of started helper threads. */
+
+	traverse_data_t data; /* Visitor and its parameters. */
+}
+par_state_t;
+
+static VisitResult traverse_subtree(int parent_fd, const char name[],
+		const char path[], const ancestor_t *parent, traverse_data_t *data);
+static DIR * open_dir(int parent_fd, const char name[], int deep,
+		struct stat *st);
+static int is_ancestor(const ancestor_t *ancestor, const struct stat *st);
+static int entry_is_dir_at(DIR *dir, const struct dirent *d, int deep);
+static IoRes io_res_from_vr(VisitResult result);
+static void * par_worker(void *arg);
+static void par_work(par_state_t *state);
+static void par_read_dir(par_state_t *state, par_dir_t *dir);
+static void par_push(par_state_t *state, par_dir_t *dir);
+static void par_finish_dir(par_state_t *state, par_dir_t *dir);
+static void par_fail(par_state_t *state, VisitResult result);
+static int par_failed(par_state_t *state);
+
+IoRes
+traverse(const char path[], int deep, subtree_visitor visitor, void *param)
+{
+	/* Optionally treat symbolic links to directories as files as well. */
+	if((!deep && is_symlink(path)) || !is_dir(path))
+	{
+		return io_res_from_vr(visitor(path, VA_FILE, deep, param));
+	}
+
+	traverse_data_t data = {
+		.deep = deep,
+		.visitor = visitor,
+		.param = param,
+	};
+	return io_res_from_vr(traverse_subtree(AT_FDCWD, path, path, NULL, &data));
+}
+
+/* A generic subtree traversing.  Directory is opened relative to its parent and
+ * its entries are examined relative to it, which saves the kernel from
+ * resolving full paths over and over again.  Returns status of visitation. */
+static VisitResult
+traverse_subtree(int parent_fd, const char name[], const char path[],
+		const ancestor_t *parent, traverse_data_t *data)
+{
+	const int deep = data->deep;
+	subtree_visitor visitor = data->visitor;
+	void *param = data->param;
+
+	struct stat dir_st;
+	DIR *const dir = open_dir(parent_fd, name, deep, &dir_st);
+	if(dir == NULL)
+	{
+		return VR_ERROR;
+	}
+
+	if(deep && is_ancestor(parent, &dir_st))
+	{
+		(void)closedir(dir);
+		/* Copy this symbolic link to a directory which makes a cycle as a file. */
+		return visitor(path, VA_FILE, /*deep=*/0, param);
+	}
+
+	const ancestor_t self = {
+		.dev = dir_st.st_dev,
+		.ino = dir_st.st_ino,
+		.parent = parent,
+	};
+
+	const VisitResult enter_result = visitor(path, VA_DIR_ENTER, deep, param);
+	if(enter_result == VR_ERROR || enter_result == VR_CANCELLED)
+	{
+		(void)closedir(dir);
+		return enter_result;
+	}
+
+	VisitResult result = VR_OK;
+	struct dirent *d;
+	while((d = os_readdir(dir)) != NULL)
+	{
+		if(is_builtin_dir(d->d_name))
+		{
+			continue;
+		}
+
+		char *const full_path = join_paths(path, d->d_name);
+		/* Optionally treat symbolic links to directories as files as well. */
+		if(entry_is_dir_at(dir, d, deep))
+		{
+			result = traverse_subtree(dirfd(dir), d->d_name, full_path, &self, data);
+		}
+		else
+		{
+			result = visitor(full_path, VA_FILE, deep, param);
+		}
+		free(full_path);
+
+		if(result != VR_OK)
+		{
+			break;
+		}
+	}
+	(void)closedir(dir);
+
+	if(result == VR_OK && enter_result != VR_SKIP_DIR_LEAVE)
+	{
+		result = visitor(path, VA_DIR_LEAVE, deep, param);
+	}
+
+	return result;
+}
+
+/* Opens directory relative to directory descriptor of its parent.  Symbolic
+ * links are followed only for deep traversal.  Returns directory stream or
+ * NULL on error. */
+static DIR *
+open_dir(int parent_fd, const char name[], int deep, struct stat *st)
+{
+	const int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC
+	                | (deep ? 0 : O_NOFOLLOW);
+
+	const int fd = openat(parent_fd, name, flags);
+	if(fd == -1)
+	{
+		return NULL;
+	}
+
+	DIR *const dir = (fstat(fd, st) == 0 ? fdopendir(fd) : NULL);
+	if(dir == NULL)
+	{
+		(void)close(fd);
+	}
+	return dir;
+}
+
+/* Checks whether directory is among the ancestors.  Returns non-zero if so,
+ * otherwise zero is returned. */
+static int
+is_ancestor(const ancestor_t *ancestor, const struct stat *st)
+{
+	for(; ancestor != NULL; ancestor = ancestor->parent)
+	{
+		if(ancestor->dev == st->st_dev && ancestor->ino == st->st_ino)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Checks whether directory entry should be traversed as a directory.  Deep
+ * traversal resolves symbolic links.  Returns non-zero if so, otherwise zero is
+ * returned. */
+static int
+entry_is_dir_at(DIR *dir, const struct dirent *d, int deep)
+{
+	unsigned char type = DT_UNKNOWN;
+#if defined(HAVE_STRUCT_DIRENT_D_TYPE) && HAVE_STRUCT_DIRENT_D_TYPE
+	type = d->d_type;
+#endif
+
+	if(type != DT_UNKNOWN && !(deep && type == DT_LNK))
+	{
+		return (type == DT_DIR);
+	}
+
+	struct stat st;
+	return fstatat(dirfd(dir), d->d_name, &st, deep ? 0 : AT_SYMLINK_NOFOLLOW) == 0
+	    && S_ISDIR(st.st_mode);
+}
+
+IoRes
+traverse_parallel(const char path[], int deep, subtree_visitor visitor,
+		void *param)
+{
+	/* Optionally treat symbolic links to directories as files as well. */
+	if((!deep && is_symlink(path)) || !is_dir(path))
+	{
+		return io_res_from_vr(visitor(path, VA_FILE, deep, param));
+	}
+
+	par_dir_t *const root = calloc(1, sizeof(*root));
+	if(root == NULL || (root->path = strdup(path)) == NULL)
+	{
+		free(root);
+		return IO_RES_FAILED;
+	}
+	root->pending = 1;
+
+	par_state_t state = {
+		.result = VR_OK,
+		.stack = root,
+		.data = {
+			.deep = deep,
+			.visitor = visitor,
+			.param = param,
+		},
+	};
+	pthread_mutex_init(&state.lock, NULL);
+	pthread_cond_init(&state.cond, NULL);
+
+	/* The calling thread is one of the workers.  Helpers are started only if
+	 * there is more than one directory to read. */
+	par_work(&state);
+
+	int i;
+	for(i = 0; i < state.nthreads; ++i)
+	{
+		(void)pthread_join(state.threads[i], NULL);
+	}
+
+	pthread_cond_destroy(&state.cond);
+	pthread_mutex_destroy(&state.lock);
+
+	return io_res_from_vr(state.result);
+}
+
+/* Maps result of traversal onto result of I/O operation.  Returns the
+ * result. */
+static IoRes
+io_res_from_vr(VisitResult result)
+{
+	switch(result)
+	{
+		case VR_OK:        return IO_RES_SUCCEEDED;
+		case VR_CANCELLED: return IO_RES_ABORTED;
+
+		default:           return IO_RES_FAILED;
+	}
+}
+
+/* Entry point of a helper thread of parallel traversal.  Returns NULL. */
+static void *
+par_worker(void *arg)
+{
+	par_work(arg);
+	return NULL;
+}
+
+/* Reads directories until there are none left. */
+static void
+par_work(par_state_t *state)
+{
+	pthread_mutex_lock(&state->lock);
+	while(1)
+	{
+		while(state->stack == NULL && state->busy != 0)
+		{
+			pthread_cond_wait(&state->cond, &state->lock);
+		}
+
+		par_dir_t *const dir = state->stack;
+		if(dir == NULL)
+		{
+			/* Nothing to read and nobody can add more directories. */
+			break;
+		}
+
+		state->stack = dir->next;
+		++state->busy;
+		pthread_mutex_unlock(&state->lock);
+
+		if(par_failed(state))
+		{
+			/* Just release the directory. */
+			par_finish_dir(state, dir);
+		}
+		else
+		{
+			par_read_dir(state, dir);
+		}
+
+		pthread_mutex_lock(&state->lock);
+		if(--state->busy == 0 && state->stack == NULL)
+		{
+			pthread_cond_broadcast(&state->cond);
+		}
+	}
+	pthread_mutex_unlock(&state->lock);
+}
+
+/* Visits a directory and its files queueing its subdirectories. */
+static void
+par_read_dir(par_state_t *state, par_dir_t *dir)
+{
+	const int deep = state->data.deep;
+	subtree_visitor visitor = state->data.visitor;
+	void *param = state->data.param;
+
+	struct stat dir_st;
+	DIR *const d = open_dir(AT_FDCWD, dir->path, deep, &dir_st);
+	if(d == NULL)
+	{
+		par_fail(state, VR_ERROR);
+		par_finish_dir(state, dir);
+		return;
+	}
+
+	if(deep && dir->parent != NULL && is_ancestor(&dir->parent->self, &dir_st))
+	{
+		(void)closedir(d);
+		/* Copy this symbolic link to a directory which makes a cycle as a file. */
+		par_fail(state, visitor(dir->path, VA_FILE, /*deep=*/0, param));
+		dir->skip_leave = 1;
+		par_finish_dir(state, dir);
+		return;
+	}
+
+	dir->self.dev = dir_st.st_dev;
+	dir->self.ino = dir_st.st_ino;
+	dir->self.parent = (dir->parent == NULL ? NULL : &dir->parent->self);
+
+	const VisitResult enter_result = visitor(dir->path, VA_DIR_ENTER, deep,
+			param);
+	if(enter_result == VR_ERROR || enter_result == VR_CANCELLED)
+	{
+		(void)closedir(d);
+		par_fail(state, enter_result);
+		par_finish_dir(state, dir);
+		return;
+	}
+	dir->skip_leave = (enter_result == VR_SKIP_DIR_LEAVE);
+
+	struct dirent *entry;
+	while((entry = os_readdir(d)) != NULL && !par_failed(state))
+	{
+		if(is_builtin_dir(entry->d_name))
+		{
+			continue;
+		}
+
+		char *const full_path = join_paths(dir->path, entry->d_name);
+		if(full_path == NULL)
+		{
+			par_fail(state, VR_ERROR);
+			break;
+		}
+
+		if(!entry_is_dir_at(d, entry, deep))
+		{
+			par_fail(state, visitor(full_path, VA_FILE, deep, param));
+			free(full_path);
+			continue;
+		}
+
+		par_dir_t *const child = calloc(1, sizeof(*child));
+		if(child == NULL)
+		{
+			par_fail(state, VR_ERROR);
+			free(full_path);
+			break;
+		}
+
+		child->path = full_path;
+		child->parent = dir;
+		child->pending = 1;
+		par_push(state, child);
+	}
+	(void)closedir(d);
+
+	par_finish_dir(state, dir);
+}
+
+/* Adds a subdirectory to the stack of directories to read starting helper
+ * threads if they weren't started yet. */
+static void
+par_push(par_state_t *state, par_dir_t *dir)
+{
+	pthread_mutex_lock(&state->lock);
+
+	++dir->parent->pending;
+	dir->next = state->stack;
+	state->stack = dir;
+	pthread_cond_signal(&state->cond);
+
+	if(!state->spawned)
+	{
+		state->spawned = 1;
+
+		const int nworkers = MIN(MAX_TRAVERSE_WORKERS, 2*workers_cpu_count());
+		while(state->nthreads < nworkers - 1)
+		{
+			if(pthread_create(&state->threads[state->nthreads], NULL, &par_worker,
+						state) != 0)
+			{
+				break;
+			}
+			++state->nthreads;
+		}
+	}
+
+	pthread_mutex_unlock(&state->lock);
+}
+
+/* Marks part of processing of a directory as done.  Finished directories are
+ * left (VA_DIR_LEAVE) after all of their subdirectories and are freed, which
+ * might in turn finish their parents. */
+static void
+par_finish_dir(par_state_t *state, par_dir_t *dir)
+{
+	while(dir != NULL)
+	{
+		pthread_mutex_lock(&state->lock);
+		const int finished = (--dir->pending == 0);
+		pthread_mutex_unlock(&state->lock);
+
+		if(!finished)
+		{
+			break;
+		}
+
+		if(!dir->skip_leave && !par_failed(state))
+		{
+			par_fail(state, state->data.visitor(dir->path, VA_DIR_LEAVE,
+						state->data.deep, state->data.param));
+		}
+
+		par_dir_t *const parent = dir->parent;
+		free(dir->path);
+		free(dir);
+		dir = parent;
+	}
+}
+
+/* Records result of a visitor if it's the first failure. */
+static void
+par_fail(par_state_t *state, VisitResult result)
+{
+	if(result == VR_OK || result == VR_SKIP_DIR_LEAVE)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&state->lock);
+	if(state->result == VR_OK)
+	{
+		state->result = result;
+	}
+	pthread_mutex_unlock(&state->lock);
+}
+
+/* Checks whether traversal has failed and should stop.  Returns non-zero if
+ * so, otherwise zero is returned. */
+static int
+par_failed(par_state_t *state)
+{
+	pthread_mutex_lock(&state->lock);
+	const int failed = (state->result != VR_OK);
+	pthread_mutex_unlock(&state->lock);
+	return failed;
+}
+
+#else
 
 /* Data used by traverse_subtree(). */
 typedef struct
@@ -225,5 +740,14 @@ remove_parent(traverse_data_t *data, const char path[], const struct stat *st)
 	return 0;
 }
 
+IoRes
+traverse_parallel(const char path[], int deep, subtree_visitor visitor,
+		void *param)
+{
+	return traverse(path, deep, visitor, param);
+}
+
+#endif
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
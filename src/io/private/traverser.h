@@ -51,6 +51,13 @@ typedef VisitResult (*subtree_visitor)(const char full_path[],
 IoRes traverse(const char path[], int deep, subtree_visitor visitor,
 		void *param);
 
+/* Same as traverse(), but reads directories in parallel.  The visitor can be
+ * called concurrently from several threads, although VA_DIR_ENTER of a
+ * directory always precedes visitation of its children and VA_DIR_LEAVE follows
+ * it.  Returns zero on success, otherwise non-zero is returned. */
+IoRes traverse_parallel(const char path[], int deep, subtree_visitor visitor,
+		void *param);
+
 #endif /* VIFM__IO__PRIVATE__TRAVERSER_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -20,12 +20,14 @@
 
 #include <curses.h>
 
+#include <sys/stat.h> /* stat */
 #include <regex.h>
 #include <unistd.h> /* usleep() */
 
 #include <assert.h> /* assert() */
 #include <limits.h> /* INT_MAX */
 #include <stddef.h> /* ptrdiff_t size_t */
+#include <stdint.h> /* uint64_t */
 #include <string.h> /* memset() strdup() */
 #include <stdio.h>  /* snprintf() */
 #include <stdlib.h> /* free() */
@@ -39,6 +41,7 @@
 #include "../engine/mode.h"
 #include "../int/vim.h"
 #include "../modes/dialogs/msg_dialog.h"
+#include "../ui/cancellation.h"
 #include "../ui/colors.h"
 #include "../ui/escape.h"
 #include "../ui/fileview.h"
@@ -47,6 +50,7 @@
 #include "../ui/ui.h"
 #include "../utils/filemon.h"
 #include "../utils/fs.h"
+#include "../utils/lineidx.h"
 #include "../utils/macros.h"
 #include "../utils/path.h"
 #include "../utils/regexp.h"
@@ -66,6 +70,13 @@
 #include "normal.h"
 #include "wk.h"
 
+/* Files of at least this size are paged through instead of being read in
+ * whole. */
+#define PAGING_THRESHOLD (32*1024*1024)
+
+/* Number of lines of a paged file that are kept in memory. */
+#define WINDOW_LINES 4096
+
 /* Named boolean values of "silent" parameter for better readability. */
 enum
 {
@@ -77,13 +88,20 @@ enum
 struct modview_info_t
 {
 	/* Data of the view. */
-	char **lines;     /* List of real lines (owned by vcache unit). */
+	char **lines;     /* List of real lines (owned by vcache unit unless the file
+	                     is paged through). */
 	int (*widths)[2]; /* (virtual line, screen width) pair per real line. */
 	int nlines;       /* Number of real lines. */
 	int nlinesv;      /* Number of virtual (possibly wrapped) lines. */
 	int line;         /* Current real line number (first visible line). */
 	int linev;        /* Current virtual line number. */
 
+	/* Paging through a large file, lines above contain only part of it. */
+	lineidx_t *idx;     /* Index of lines of the file or NULL. */
+	uint64_t win_start; /* Offset of the first loaded line. */
+	uint64_t win_end;   /* Offset after the last loaded line. */
+	int win_line;       /* Number of the first loaded line or -1. */
+
 	/* Dimensions, units of actions. */
 	int win_size; /* Scroll window size. */
 	int half_win; /* Height of a "page" (can be changed). */
@@ -129,10 +147,20 @@ static void reset_view_info(modview_info_t *vi);
 static void init_view_info(modview_info_t *vi);
 static void free_view_info(modview_info_t *vi);
 static void redraw(void);
-static void calc_vlines(void);
+static void calc_vlines(modview_info_t *vi);
 static void calc_vlines_wrapped(modview_info_t *vi);
 static void calc_vlines_non_wrapped(modview_info_t *vi);
 static void draw(void);
+static lineidx_t * open_index(const char path[]);
+static int load_window(modview_info_t *vi, uint64_t offset);
+static int goto_offset(modview_info_t *vi, uint64_t offset);
+static uint64_t current_offset(modview_info_t *vi);
+static void slide_window(modview_info_t *vi);
+static int jump_by(modview_info_t *vi, int count);
+static void fit_to_bottom(modview_info_t *vi);
+static void set_linev(modview_info_t *vi, int linev);
+static int search_outside_window(modview_info_t *vi, int backward);
+static int get_line_number(const modview_info_t *vi);
 static int get_part(const char line[], int offset, size_t max_len, char part[]);
 static void display_error(const char error_msg[]);
 static void cmd_ctrl_l(key_info_t key_info, keys_info_t *keys_info);
@@ -211,11 +239,17 @@ TSTATIC int modview_is_detached(modview_info_t *vi);
 TSTATIC const char * modview_current_viewer(modview_info_t *vi);
 TSTATIC int modview_current_line(modview_info_t *vi);
 TSTATIC strlist_t modview_lines(modview_info_t *vi);
+TSTATIC void modview_set_paging(uint64_t threshold, int window);
 
 /* Points to current (for quick view) or last used (for explore mode)
  * modview_info_t structure. */
 static modview_info_t *vi;
 
+/* Size starting from which files are paged through. */
+static uint64_t paging_threshold = PAGING_THRESHOLD;
+/* Number of lines loaded at a time when paging through a file. */
+static int window_lines = WINDOW_LINES;
+
 static keys_add_info_t builtin_cmds[] = {
 	{WK_C_b,           {{&cmd_b},      .descr = "scroll page up"}},
 	{WK_C_d,           {{&cmd_d},      .descr = "scroll half-page down"}},
@@ -590,6 +624,11 @@ free_view_info(modview_info_t *vi)
 {
 	free_string_array(vi->viewers.items, vi->viewers.nitems);
 	free(vi->widths);
+	if(vi->idx != NULL)
+	{
+		free_string_array(vi->lines, vi->nlines);
+		lineidx_free(vi->idx);
+	}
 	if(vi->last_search_backward != -1)
 	{
 		regfree(&vi->re);
@@ -603,13 +642,13 @@ static void
 redraw(void)
 {
 	ui_view_title_update(vi->view);
-	calc_vlines();
+	calc_vlines(vi);
 	draw();
 }
 
 /* Recalculates virtual lines of a view if display options require it. */
 static void
-calc_vlines(void)
+calc_vlines(modview_info_t *vi)
 {
 	/* Skip the recalculation if window size and wrapping options are the same. */
 	if(ui_qv_width(vi->view) == vi->width && vi->wrap == cfg.wrap_quick_view)
@@ -661,6 +700,11 @@ calc_vlines_non_wrapped(modview_info_t *vi)
 static void
 draw(void)
 {
+	if(vi->idx != NULL)
+	{
+		slide_window(vi);
+	}
+
 	int l, vl;
 	const int height = ui_qv_height(vi->view);
 	const int width = ui_qv_width(vi->view);
@@ -719,6 +763,246 @@ draw(void)
 	checked_wmove(vi->view->win, ui_qv_top(vi->view), ui_qv_left(vi->view));
 }
 
+/* Opens index of the file if it's large enough to be paged through.  Returns
+ * the index or NULL. */
+static lineidx_t *
+open_index(const char path[])
+{
+	struct stat s;
+	if(os_stat(path, &s) != 0 || !S_ISREG(s.st_mode) ||
+			(uint64_t)s.st_size < paging_threshold)
+	{
+		return NULL;
+	}
+
+	return lineidx_open(path);
+}
+
+/* Loads lines of a paged file starting with the one at the offset.  Returns
+ * zero on success, otherwise non-zero is returned. */
+static int
+load_window(modview_info_t *vi, uint64_t offset)
+{
+	uint64_t end;
+	strlist_t lines = lineidx_read(vi->idx, offset, window_lines, &end);
+	if(lines.nitems == 0 && offset != 0)
+	{
+		/* The file must have gotten shorter. */
+		offset = 0;
+		lines = lineidx_read(vi->idx, offset, window_lines, &end);
+	}
+
+	int (*widths)[2] = reallocarray(NULL, MAX(lines.nitems, 1), sizeof(*widths));
+	if(widths == NULL)
+	{
+		free_string_array(lines.items, lines.nitems);
+		return 1;
+	}
+
+	free_string_array(vi->lines, vi->nlines);
+	free(vi->widths);
+
+	vi->lines = lines.items;
+	vi->nlines = lines.nitems;
+	vi->widths = widths;
+	vi->win_start = offset;
+	vi->win_end = end;
+	vi->win_line = lineidx_line_number(vi->idx, offset);
+
+	/* Force recalculation of virtual lines. */
+	vi->width = -1;
+	calc_vlines(vi);
+	return 0;
+}
+
+/* Makes line of a paged file that starts at the offset current loading lines
+ * around it.  Returns zero on success, otherwise non-zero is returned. */
+static int
+goto_offset(modview_info_t *vi, uint64_t offset)
+{
+	int moved;
+	const uint64_t start = lineidx_move(vi->idx, offset, -window_lines/2, &moved);
+	if(load_window(vi, start) != 0)
+	{
+		return 1;
+	}
+
+	vi->line = MIN(-moved, MAX(vi->nlines - 1, 0));
+	vi->linev = (vi->nlines == 0 ? 0 : vi->widths[vi->line][0]);
+	return 0;
+}
+
+/* Retrieves offset of the current line of a paged file.  Returns the
+ * offset. */
+static uint64_t
+current_offset(modview_info_t *vi)
+{
+	int moved;
+	return lineidx_move(vi->idx, vi->win_start, vi->line, &moved);
+}
+
+/* Loads another part of a paged file if current line got close to an edge of
+ * the loaded part and there is more data in that direction. */
+static void
+slide_window(modview_info_t *vi)
+{
+	const int margin = window_lines/8;
+	const int more_above = (vi->win_start != 0);
+	const int more_below = (vi->win_end < lineidx_size(vi->idx));
+
+	if((vi->line < margin && more_above) ||
+			(vi->line >= vi->nlines - margin && more_below))
+	{
+		/* Preserve position within a wrapped line. */
+		const int subline = (vi->line < vi->nlines)
+		                  ? vi->linev - vi->widths[vi->line][0]
+		                  : 0;
+		if(goto_offset(vi, current_offset(vi)) == 0)
+		{
+			vi->linev += subline;
+		}
+	}
+
+	if(vi->win_line < 0)
+	{
+		vi->win_line = lineidx_line_number(vi->idx, vi->win_start);
+	}
+}
+
+/* Moves current line of a paged file by count lines if the destination is
+ * outside of the loaded part.  Returns non-zero if the movement was performed,
+ * otherwise zero is returned. */
+static int
+jump_by(modview_info_t *vi, int count)
+{
+	if(vi->idx == NULL)
+	{
+		return 0;
+	}
+
+	const int target = vi->line + count;
+	if(target >= 0 && target < vi->nlines)
+	{
+		return 0;
+	}
+
+	int moved;
+	const uint64_t offset = lineidx_move(vi->idx, current_offset(vi), count,
+			&moved);
+	if(goto_offset(vi, offset) != 0)
+	{
+		return 0;
+	}
+
+	fit_to_bottom(vi);
+	return 1;
+}
+
+/* Scrolls a paged file up if there is empty space at the bottom of the view
+ * while it could be filled. */
+static void
+fit_to_bottom(modview_info_t *vi)
+{
+	const int height = ui_qv_height(vi->view);
+	if(vi->win_end < lineidx_size(vi->idx) || vi->linev + height <= vi->nlinesv)
+	{
+		return;
+	}
+
+	set_linev(vi, MAX(vi->nlinesv - height, 0));
+}
+
+/* Sets current virtual line updating current real line accordingly. */
+static void
+set_linev(modview_info_t *vi, int linev)
+{
+	vi->linev = linev;
+	for(vi->line = 0; vi->line < vi->nlines - 1; ++vi->line)
+	{
+		if(vi->linev < vi->widths[vi->line + 1][0])
+		{
+			break;
+		}
+	}
+}
+
+/* Looks for a match of the last pattern among lines of a paged file that aren't
+ * loaded and makes the first match current.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+search_outside_window(modview_info_t *vi, int backward)
+{
+	/* Number of lines to examine at a time. */
+	enum { BATCH = 1024 };
+
+	if(vi->idx == NULL)
+	{
+		return 1;
+	}
+
+	int found = 0;
+	uint64_t match = 0;
+	uint64_t offset = (backward ? vi->win_start : vi->win_end);
+
+	ui_cancellation_push_on();
+	while(!found && !ui_cancellation_requested())
+	{
+		int moved;
+		uint64_t from = offset;
+		int count = BATCH;
+		if(backward)
+		{
+			if(offset == 0)
+			{
+				break;
+			}
+			from = lineidx_move(vi->idx, offset, -BATCH, &moved);
+			count = -moved;
+		}
+
+		uint64_t end;
+		strlist_t lines = lineidx_read(vi->idx, from, count, &end);
+		if(lines.nitems == 0)
+		{
+			break;
+		}
+
+		int i;
+		for(i = 0; i < lines.nitems; ++i)
+		{
+			const int j = (backward ? lines.nitems - 1 - i : i);
+			if(regexec(&vi->re, lines.items[j], 0, NULL, 0) == 0)
+			{
+				match = lineidx_move(vi->idx, from, j, &moved);
+				found = 1;
+				break;
+			}
+		}
+		free_string_array(lines.items, lines.nitems);
+
+		offset = (backward ? from : end);
+	}
+	ui_cancellation_pop();
+
+	return (found ? goto_offset(vi, match) : 1);
+}
+
+/* Computes number of the current line within the file.  Returns the number or
+ * -1 if it's not known yet. */
+static int
+get_line_number(const modview_info_t *vi)
+{
+	if(vi->idx == NULL)
+	{
+		return vi->line;
+	}
+
+	const int first = (vi->win_line >= 0)
+	                ? vi->win_line
+	                : lineidx_line_number(vi->idx, vi->win_start);
+	return (first < 0 ? -1 : first + vi->line);
+}
+
 int
 modview_find(const char pattern[], int backward)
 {
@@ -960,6 +1244,19 @@ cmd_percent(key_info_t key_info, keys_info_t *keys_info)
 	if(key_info.count > 100)
 		key_info.count = 100;
 
+	if(vi->idx != NULL)
+	{
+		const uint64_t size = lineidx_size(vi->idx);
+		const uint64_t offset = size/100*key_info.count
+		                      + size%100*key_info.count/100;
+		if(goto_offset(vi, lineidx_line_start(vi->idx, offset)) == 0)
+		{
+			fit_to_bottom(vi);
+			draw();
+		}
+		return;
+	}
+
 	vi->line = (key_info.count*vi->nlinesv)/100;
 	if(vi->line >= vi->nlines)
 		vi->line = vi->nlines - 1;
@@ -1106,6 +1403,12 @@ load_view_data(modview_info_t *vi, const char action[],
 		return 1;
 	}
 
+	if(vi->idx != NULL)
+	{
+		/* Widths were allocated along with the lines. */
+		return 0;
+	}
+
 	if(vi->nlines == 0)
 	{
 		vi->widths = NULL;
@@ -1132,6 +1435,17 @@ get_view_data(modview_info_t *vi, const char file_to_view[])
 {
 	pick_current_viewer(vi);
 
+	/* Large files are paged through if they are displayed as is. */
+	if(vi->idx == NULL && (vi->raw || vi->curr_viewer == NULL))
+	{
+		vi->idx = open_index(file_to_view);
+	}
+	if(vi->idx != NULL)
+	{
+		vi->kind = VK_TEXTUAL;
+		return (load_window(vi, vi->win_start) == 0 ? NULL : "Not enough memory");
+	}
+
 	const ViewerKind kind = ft_viewer_kind(vi->curr_viewer);
 	view_t *const curr = curr_view;
 	curr_view = (curr_stats.preview.on ? curr_view : vi->view);
@@ -1323,6 +1637,33 @@ cmd_g(key_info_t key_info, keys_info_t *keys_info)
 	if(key_info.count == NO_COUNT_GIVEN)
 		key_info.count = 1;
 
+	if(vi->idx != NULL)
+	{
+		uint64_t offset = 0;
+		if(key_info.count > 1 &&
+				lineidx_line_offset(vi->idx, key_info.count - 1, &offset) != 0)
+		{
+			int complete;
+			(void)lineidx_nlines(vi->idx, &complete);
+			if(!complete)
+			{
+				display_error("The line wasn't indexed yet");
+			}
+			else if(scroll_to_bottom(vi))
+			{
+				draw();
+			}
+			return;
+		}
+
+		if(goto_offset(vi, offset) == 0)
+		{
+			fit_to_bottom(vi);
+			draw();
+		}
+		return;
+	}
+
 	key_info.count = MIN(vi->nlinesv - ui_qv_height(vi->view), key_info.count);
 	key_info.count = MAX(1, key_info.count);
 
@@ -1354,6 +1695,12 @@ cmd_i(key_info_t key_info, keys_info_t *keys_info)
 static void
 cmd_j(key_info_t key_info, keys_info_t *keys_info)
 {
+	if(jump_by(vi, def_count(key_info.count)))
+	{
+		draw();
+		return;
+	}
+
 	if(key_info.reg == NO_REG_GIVEN)
 	{
 		if((vi->linev + 1) + ui_qv_height(vi->view) > vi->nlinesv)
@@ -1388,6 +1735,12 @@ cmd_j(key_info_t key_info, keys_info_t *keys_info)
 static void
 cmd_k(key_info_t key_info, keys_info_t *keys_info)
 {
+	if(jump_by(vi, -def_count(key_info.count)))
+	{
+		draw();
+		return;
+	}
+
 	if(vi->linev == 0)
 		return;
 
@@ -1446,7 +1799,7 @@ search(int repeat_count, int backward)
 static int
 find_previous(void)
 {
-	if(vi->linev == 0)
+	if(vi->linev == 0 && (vi->idx == NULL || vi->win_start == 0))
 	{
 		draw();
 		display_error("Nothing to search");
@@ -1491,6 +1844,12 @@ find_previous(void)
 		--vl;
 	}
 
+	if(vi->linev != vl && search_outside_window(vi, 1) == 0)
+	{
+		draw();
+		return 0;
+	}
+
 	draw();
 
 	if(vi->linev != vl || vi->nlines == 0)
@@ -1545,6 +1904,12 @@ find_next(void)
 		++vl;
 	}
 
+	if(vi->linev != vl && search_outside_window(vi, 0) == 0)
+	{
+		draw();
+		return 0;
+	}
+
 	draw();
 
 	if(vi->linev != vl || vi->nlines == 0)
@@ -1618,7 +1983,8 @@ cmd_v(key_info_t key_info, keys_info_t *keys_info)
 {
 	char path[PATH_MAX + 1];
 	get_current_full_path(curr_view, sizeof(path), path);
-	(void)vim_view_file(path, 1 + vi->line + ui_qv_height(vi->view)/2, -1, 1);
+	const int line = MAX(get_line_number(vi), 0);
+	(void)vim_view_file(path, 1 + line + ui_qv_height(vi->view)/2, -1, 1);
 	/* In some cases two redraw operations are needed, otherwise TUI is not fully
 	 * redrawn. */
 	update_screen(UT_REDRAW);
@@ -1774,7 +2140,12 @@ forward_if_changed(modview_info_t *vi)
 	}
 
 	vi->file_mon = mon;
-	reload_view(vi, SILENT);
+
+	/* Appended data of a paged file becomes available without rereading it. */
+	if(vi->idx == NULL || lineidx_refresh(vi->idx) <= 0)
+	{
+		reload_view(vi, SILENT);
+	}
 	return scroll_to_bottom(vi);
 }
 
@@ -1783,20 +2154,19 @@ forward_if_changed(modview_info_t *vi)
 static int
 scroll_to_bottom(modview_info_t *vi)
 {
-	if(vi->linev + 1 + ui_qv_height(vi->view) > vi->nlinesv)
+	int moved = 0;
+	if(vi->idx != NULL && vi->win_end < lineidx_size(vi->idx))
 	{
-		return 0;
+		const uint64_t last = lineidx_line_start(vi->idx, lineidx_size(vi->idx));
+		moved = (goto_offset(vi, last) == 0);
 	}
 
-	vi->linev = vi->nlinesv - ui_qv_height(vi->view);
-	for(vi->line = 0; vi->line < vi->nlines - 1; ++vi->line)
+	if(vi->linev + 1 + ui_qv_height(vi->view) > vi->nlinesv)
 	{
-		if(vi->linev < vi->widths[vi->line + 1][0])
-		{
-			break;
-		}
+		return moved;
 	}
 
+	set_linev(vi, vi->nlinesv - ui_qv_height(vi->view));
 	return 1;
 }
 
@@ -1814,6 +2184,7 @@ reload_view(modview_info_t *vi, int silent)
 	new_vi.ext_viewer = vi->ext_viewer;
 	new_vi.viewers = vi->viewers;
 	new_vi.raw = vi->raw;
+	new_vi.win_start = vi->win_start;
 
 	if(load_view_data(&new_vi, "File exploring reload", vi->filename, silent)
 			== 0)
@@ -1936,12 +2307,38 @@ modview_get_ruler_width(void)
 static void
 format_ruler(const modview_info_t *vi, char buf[], size_t buf_len)
 {
+	if(vi->idx == NULL)
+	{
+		char rel_pos[32];
+		format_position(rel_pos, sizeof(rel_pos), vi->line, vi->nlines,
+				vi->view->window_rows);
+
+		int curr_line = vi->line + (vi->nlines > 0 ? 1 : 0);
+		snprintf(buf, buf_len, "%d-%d %s", curr_line, vi->nlines, rel_pos);
+		return;
+	}
+
+	/* Total number of lines of a paged file is known only after it's indexed,
+	 * which is signified by "+" after the number. */
+	int complete;
+	int nlines = lineidx_nlines(vi->idx, &complete);
+	const int line = get_line_number(vi);
+	const char *const more = (complete ? "" : "+");
+
+	if(line < 0)
+	{
+		const uint64_t size = lineidx_size(vi->idx);
+		const int percent = (size == 0 ? 0 : vi->win_start*100/size);
+		snprintf(buf, buf_len, "?-%d%s %d%%", nlines, more, percent);
+		return;
+	}
+
+	nlines = MAX(nlines, line + 1);
+
 	char rel_pos[32];
-	format_position(rel_pos, sizeof(rel_pos), vi->line, vi->nlines,
+	format_position(rel_pos, sizeof(rel_pos), line, nlines,
 			vi->view->window_rows);
-
-	int curr_line = vi->line + (vi->nlines > 0 ? 1 : 0);
-	snprintf(buf, buf_len, "%d-%d %s", curr_line, vi->nlines, rel_pos);
+	snprintf(buf, buf_len, "%d-%d%s %s", line + 1, nlines, more, rel_pos);
 }
 
 TSTATIC int
@@ -1965,7 +2362,7 @@ modview_current_viewer(modview_info_t *vi)
 TSTATIC int
 modview_current_line(modview_info_t *vi)
 {
-	return vi->line;
+	return get_line_number(vi);
 }
 
 TSTATIC strlist_t
@@ -1975,5 +2372,12 @@ modview_lines(modview_info_t *vi)
 	return lines;
 }
 
+TSTATIC void
+modview_set_paging(uint64_t threshold, int window)
+{
+	paging_threshold = threshold;
+	window_lines = window;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
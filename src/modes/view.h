@@ -19,6 +19,8 @@
 #ifndef VIFM__MODES__VIEW_H__
 #define VIFM__MODES__VIEW_H__
 
+#include <stdint.h> /* uint64_t */
+
 #include "../utils/test_helpers.h"
 #include "../macros.h"
 
@@ -105,6 +107,7 @@ TSTATIC_DEFS(
 	int modview_current_line(modview_info_t *vi);
 	struct strlist_t;
 	struct strlist_t modview_lines(modview_info_t *vi);
+	void modview_set_paging(uint64_t threshold, int window);
 )
 
 #endif /* VIFM__MODES__VIEW_H__ */
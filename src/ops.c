@@ -200,6 +200,7 @@ ops_alloc(OPS main_op, int bg, const char descr[], const char base_dir[],
 	ops->use_system_calls = cfg.use_system_calls;
 	ops->fast_file_cloning = cfg.fast_file_cloning;
 	ops->data_sync = cfg.data_sync;
+	ops->sparse_files = cfg.sparse_files;
 	ops->shell_type = curr_stats.shell_type;
 
 	ops->choose = choose;
@@ -518,6 +519,9 @@ op_cp(ops_t *ops, void *data, const char src[], const char dst[],
 	                             ? cfg.fast_file_cloning
 	                             : ops->fast_file_cloning;
 	const int data_sync = (ops == NULL ? cfg.data_sync : ops->data_sync);
+	const int sparse_files = (ops == NULL)
+	                       ? cfg.sparse_files
+	                       : ops->sparse_files;
 
 	if(!ops_uses_syscalls(ops))
 	{
@@ -599,6 +603,7 @@ op_cp(ops_t *ops, void *data, const char src[], const char dst[],
 		.arg4 = {
 			.fast_file_cloning = fast_file_cloning,
 			.data_sync = data_sync,
+			.sparse_copying = sparse_files,
 			.deep_copying = deep_copy,
 		},
 	};
@@ -700,6 +705,9 @@ op_mv(ops_t *ops, void *data, const char src[], const char dst[],
 				/* It's safe to always use fast file cloning on moving files. */
 				.fast_file_cloning = 1,
 				.data_sync = (ops == NULL ? cfg.data_sync : ops->data_sync),
+				.sparse_copying = (ops == NULL)
+				                ? cfg.sparse_files
+				                : ops->sparse_files,
 			},
 		};
 
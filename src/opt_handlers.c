@@ -175,6 +175,7 @@ static void sizefmt_handler(OPT_OP op, optval_t val);
 static optval_t make_sizefmt_value(void);
 #ifndef _WIN32
 static void slowfs_handler(OPT_OP op, optval_t val);
+static void slowfspoll_handler(OPT_OP op, optval_t val);
 #endif
 static void smartcase_handler(OPT_OP op, optval_t val);
 static void sortnumbers_handler(OPT_OP op, optval_t val);
@@ -374,6 +375,7 @@ ARRAY_GUARD(suggestoptions_vals, NUM_SUGGESTION_FLAGS);
 static const char *iooptions_vals[][2] = {
 	{ "fastfilecloning", "use COW if FS supports it" },
 	{ "datasync",        "synchronize writes to storage" },
+	{ "sparsefiles",     "preserve holes in sparse files" },
 };
 
 /* Possible flags of 'shortmess' and their count. */
@@ -569,6 +571,8 @@ static const char *vifminfo_set[][2] = {
 	[BIT(VINFO_FHISTORY)]  = { "fhistory",  "local filter history" },
 	[BIT(VINFO_MCHISTORY)] = { "mchistory", "menu cmdline history" },
 	[BIT(VINFO_TABS)]      = { "tabs",      "global or pane tabs" },
+	[BIT(VINFO_DCACHE)]    = { "dcache",    "cached sizes of directories" },
+	[BIT(VINFO_HASHES)]    = { "hashes",    "cached digests of files" },
 };
 ARRAY_GUARD(vifminfo_set, NUM_VINFO);
 
@@ -819,6 +823,10 @@ options[] = {
 	  OPT_STRLIST, 0, NULL, &slowfs_handler, NULL,
 	  { .ref.str_val = &cfg.slow_fs_list },
 	},
+	{ "slowfspoll", "", "period of checking slow filesystems for changes",
+	  OPT_INT, 0, NULL, &slowfspoll_handler, NULL,
+	  { .ref.int_val = &cfg.slow_fs_poll },
+	},
 #endif
 	{ "smartcase", "scs", "pick pattern sensitivity based on case",
 	  OPT_BOOL, 0, NULL, &smartcase_handler, NULL,
@@ -1348,7 +1356,8 @@ static void
 init_iooptions(optval_t *val)
 {
 	val->set_items = (cfg.fast_file_cloning != 0) << 0
-	               | (cfg.data_sync         != 0) << 1;
+	               | (cfg.data_sync         != 0) << 1
+	               | (cfg.sparse_files      != 0) << 2;
 }
 
 /* Default-initializes whether to display file numbers. */
@@ -2412,6 +2421,7 @@ iooptions_handler(OPT_OP op, optval_t val)
 {
 	cfg.fast_file_cloning = ((val.set_items & 1) != 0);
 	cfg.data_sync = ((val.set_items & 2) != 0);
+	cfg.sparse_files = ((val.set_items & 4) != 0);
 }
 
 /* Handles changes of 'keepsel'. */
@@ -2882,6 +2892,22 @@ slowfs_handler(OPT_OP op, optval_t val)
 {
 	(void)replace_string(&cfg.slow_fs_list, val.str_val);
 }
+
+/* Handles changes of 'slowfspoll' which sets period of polling directories on
+ * slow file systems. */
+static void
+slowfspoll_handler(OPT_OP op, optval_t val)
+{
+	if(val.int_val < 0)
+	{
+		vle_tb_append_linef(vle_err, "Argument must be >= 0: %d", val.int_val);
+		error = 1;
+		vle_opts_restore_default("slowfspoll", OPT_GLOBAL);
+		return;
+	}
+
+	cfg.slow_fs_poll = val.int_val;
+}
 #endif
 
 static void
@@ -19,14 +19,17 @@
 
 #include "search.h"
 
-#include <regex.h> /* regmatch_t regexec() regfree() */
+#include <regex.h> /* regex_t regmatch_t regexec() regfree() */
 
 #include <assert.h> /* assert() */
+#include <stddef.h> /* NULL */
 #include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* free() */
 #include <string.h>
 
 #include "cfg/config.h"
 #include "compat/fs_limits.h"
+#include "compat/reallocarray.h"
 #include "engine/mode.h"
 #include "modes/modes.h"
 #include "ui/fileview.h"
@@ -34,13 +37,61 @@
 #include "ui/ui.h"
 #include "utils/path.h"
 #include "utils/regexp.h"
+#include "utils/macros.h"
 #include "utils/str.h"
+#include "utils/test_helpers.h"
 #include "utils/utils.h"
+#include "utils/workers.h"
 #include "filelist.h"
 #include "flist_sel.h"
 #include "status.h"
 
+/* Number of entries to check starting with which it's done by several
+ * threads. */
+#define PARALLEL_SEARCH_THRESHOLD 16384
+
+/* Maximum number of threads to check entries with. */
+#define MAX_SEARCH_WORKERS 16
+
+/* State of checking entries of a view against a pattern, possibly in parallel.
+ * Entries are split into runs of width items, each processed as a whole by a
+ * single thread. */
+typedef struct
+{
+	dir_entry_t *entries; /* Entries of the view. */
+	const int *indexes;   /* Indexes of entries to check or NULL for all. */
+	int count;            /* Number of entries to check. */
+	int width;            /* Maximum length of a run. */
+	const char *pattern;  /* Pattern to compile in every thread. */
+	int cflags;           /* Flags to compile the pattern with. */
+	const regex_t *re;    /* Compiled pattern to fall back to. */
+}
+match_job_t;
+
 static int find_match(view_t *view, int start, int backward);
+static int * get_refinement(view_t *view, const char pattern[], int cflags);
+static int is_literal(const char pattern[]);
+static void match_entries(match_job_t *job);
+static void match_runs(void *arg, int from, int to);
+static void match_range(const match_job_t *job, const regex_t *re, int from,
+		int to);
+TSTATIC void set_parallel_search(int threshold, int workers);
+
+/* The last search which can be refined by the next one.  Valid only while
+ * view->last_search matches pattern and view->matches is non-zero. */
+static struct
+{
+	const view_t *view;         /* View of the search or NULL. */
+	char pattern[NAME_MAX + 1]; /* Pattern of the search. */
+	int cflags;                 /* Flags of the pattern. */
+}
+last_search;
+
+/* Number of entries to check starting with which it's done by several
+ * threads. */
+static int parallel_search_threshold = PARALLEL_SEARCH_THRESHOLD;
+/* Number of threads to use for parallel search, zero means one per CPU. */
+static int parallel_search_workers;
 
 int
 search_find(view_t *view, const char pattern[], int backward,
@@ -204,7 +255,18 @@ search_pattern(view_t *view, const char pattern[], int stash_selection,
 		flist_sel_stash(view);
 	}
 
+	cflags = get_regexp_cflags(pattern);
+
+	/* Extending a literal pattern can only remove matches, so there is no need
+	 * to check entries that didn't match the last time.  Indexes of matches need
+	 * to be collected before the results are reset. */
+	int *const refinement = (pattern[0] == '\0')
+	                      ? NULL
+	                      : get_refinement(view, pattern, cflags);
+	const int ncandidates = view->matches;
+
 	reset_search_results(view);
+	last_search.view = NULL;
 
 	/* Assuming a redraw is needed is simpler than tracking that it is. */
 	ui_view_schedule_redraw(view);
@@ -214,55 +276,45 @@ search_pattern(view_t *view, const char pattern[], int stash_selection,
 		return err;
 	}
 
-	cflags = get_regexp_cflags(pattern);
-	if((err = regexp_compile(&re, pattern, cflags)) == 0)
+	if((err = regexp_compile(&re, pattern, cflags)) != 0)
 	{
-		int i;
-		for(i = 0; i < view->list_rows; ++i)
-		{
-			regmatch_t matches[1];
-			dir_entry_t *const entry = &view->dir_entry[i];
-			const char *name = entry->name;
-			char *free_this = NULL;
-
-			if(is_parent_dir(name))
-			{
-				continue;
-			}
-
-			if(fentry_is_dir(entry))
-			{
-				free_this = format_str("%s/", name);
-				name = free_this;
-			}
+		regfree(&re);
+		free(refinement);
+		return err;
+	}
 
-			if(regexec(&re, name, 1, matches, 0) != 0)
-			{
-				free(free_this);
-				continue;
-			}
+	match_job_t job = {
+		.entries = view->dir_entry,
+		.indexes = refinement,
+		.count = (refinement == NULL ? view->list_rows : ncandidates),
+		.pattern = pattern,
+		.cflags = cflags,
+		.re = &re,
+	};
+	match_entries(&job);
+	regfree(&re);
 
-			entry->search_match = nmatches + 1;
-			entry->match_left = matches[0].rm_so;
-			entry->match_left += escape_unreadableo(name, matches[0].rm_so);
-			entry->match_right = matches[0].rm_eo;
-			entry->match_right += escape_unreadableo(name, matches[0].rm_eo);
-			if(select_matches)
-			{
-				entry->selected = 1;
-				++view->selected_files;
-			}
-			++nmatches;
+	/* Matches are numbered in the order of entries, which isn't necessarily the
+	 * order in which they were found. */
+	int i;
+	for(i = 0; i < job.count; ++i)
+	{
+		dir_entry_t *const entry = &view->dir_entry[job.indexes == NULL
+		                                            ? i
+		                                            : job.indexes[i]];
+		if(entry->search_match == 0)
+		{
+			continue;
+		}
 
-			free(free_this);
+		entry->search_match = ++nmatches;
+		if(select_matches)
+		{
+			entry->selected = 1;
+			++view->selected_files;
 		}
-		regfree(&re);
-	}
-	else
-	{
-		regfree(&re);
-		return err;
 	}
+	free(refinement);
 
 	other = (view == &lwin) ? &rwin : &lwin;
 	if(other->matches != 0 && strcmp(other->last_search, pattern) != 0)
@@ -273,9 +325,159 @@ search_pattern(view_t *view, const char pattern[], int stash_selection,
 	view->matches = nmatches;
 	copy_str(view->last_search, sizeof(view->last_search), pattern);
 
+	last_search.view = view;
+	copy_str(last_search.pattern, sizeof(last_search.pattern), pattern);
+	last_search.cflags = cflags;
+
 	return err;
 }
 
+/* Checks whether results of the last search in the view can be refined to
+ * obtain results for the pattern.  Returns indexes of entries to check in
+ * ascending order (there are view->matches of them) or NULL if all entries need
+ * to be checked. */
+static int *
+get_refinement(view_t *view, const char pattern[], int cflags)
+{
+	if(last_search.view != view || view->matches == 0 ||
+			last_search.cflags != cflags ||
+			strcmp(last_search.pattern, view->last_search) != 0)
+	{
+		return NULL;
+	}
+
+	/* Non-literal patterns can start matching more (e.g., "a" -> "a|b"). */
+	const size_t len = strlen(last_search.pattern);
+	if(strncmp(pattern, last_search.pattern, len) != 0 ||
+			!is_literal(last_search.pattern) || !is_literal(pattern + len))
+	{
+		return NULL;
+	}
+
+	int *const indexes = reallocarray(NULL, view->matches, sizeof(*indexes));
+	if(indexes == NULL)
+	{
+		return NULL;
+	}
+
+	int i, n = 0;
+	for(i = 0; i < view->list_rows && n < view->matches; ++i)
+	{
+		if(view->dir_entry[i].search_match != 0)
+		{
+			indexes[n++] = i;
+		}
+	}
+
+	if(n != view->matches)
+	{
+		/* Matches are out of sync with the counter. */
+		free(indexes);
+		return NULL;
+	}
+
+	return indexes;
+}
+
+/* Checks whether pattern matches only strings that contain it literally.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+is_literal(const char pattern[])
+{
+	return (strpbrk(pattern, "\\^$.[]|()*+?{}") == NULL);
+}
+
+/* Checks entries of the job against its pattern.  Matching entries get
+ * non-zero search_match and matching region set, other entries are left
+ * untouched. */
+static void
+match_entries(match_job_t *job)
+{
+	const int nworkers = (parallel_search_workers > 0)
+	                   ? parallel_search_workers
+	                   : MIN(workers_cpu_count(), MAX_SEARCH_WORKERS);
+	if(nworkers > 1 && job->count >= parallel_search_threshold)
+	{
+		/* Compiled patterns can be locked while in use (this is the case with
+		 * glibc), so each thread compiles its own copy. */
+		job->width = (job->count + nworkers - 1)/nworkers;
+		workers_for(nworkers, /*chunk=*/1, nworkers, &match_runs, job);
+	}
+	else
+	{
+		match_range(job, job->re, 0, job->count);
+	}
+}
+
+/* workers_for() callback that checks entries of a range of runs. */
+static void
+match_runs(void *arg, int from, int to)
+{
+	const match_job_t *const job = arg;
+
+	regex_t re;
+	const int compiled = (regexp_compile(&re, job->pattern, job->cflags) == 0);
+
+	int i;
+	for(i = from; i < to; ++i)
+	{
+		const int start = MIN(i*job->width, job->count);
+		const int end = MIN(start + job->width, job->count);
+		match_range(job, compiled ? &re : job->re, start, end);
+	}
+
+	regfree(&re);
+}
+
+/* Checks entries of the job with indexes in the [from, to) range. */
+static void
+match_range(const match_job_t *job, const regex_t *re, int from, int to)
+{
+	int i;
+	for(i = from; i < to; ++i)
+	{
+		regmatch_t matches[1];
+		dir_entry_t *const entry =
+			&job->entries[job->indexes == NULL ? i : job->indexes[i]];
+		const char *name = entry->name;
+		char *free_this = NULL;
+
+		if(is_parent_dir(name))
+		{
+			continue;
+		}
+
+		char name_buf[NAME_MAX + 2];
+		if(fentry_is_dir(entry))
+		{
+			const size_t len = strlen(name);
+			if(len + 2U <= sizeof(name_buf))
+			{
+				memcpy(name_buf, name, len);
+				name_buf[len] = '/';
+				name_buf[len + 1U] = '\0';
+				name = name_buf;
+			}
+			else
+			{
+				free_this = format_str("%s/", name);
+				name = free_this;
+			}
+		}
+
+		if(regexec(re, name, 1, matches, 0) == 0)
+		{
+			entry->search_match = 1;
+			entry->match_left = matches[0].rm_so;
+			entry->match_left += escape_unreadableo(name, matches[0].rm_so);
+			entry->match_right = matches[0].rm_eo;
+			entry->match_right += escape_unreadableo(name, matches[0].rm_eo);
+		}
+
+		free(free_this);
+	}
+}
+
 int
 print_search_result(const view_t *view, int found, int backward,
 		print_search_msg_cb cb)
@@ -389,5 +591,23 @@ reset_search_results(view_t *view)
 	ui_view_schedule_redraw(view);
 }
 
+void
+search_list_changed(const view_t *view)
+{
+	if(last_search.view == view)
+	{
+		last_search.view = NULL;
+	}
+}
+
+/* Configures parallel processing.  Negative threshold restores the default
+ * one, workers equal to zero means using the number of CPUs. */
+TSTATIC void
+set_parallel_search(int threshold, int workers)
+{
+	parallel_search_threshold = (threshold < 0 ? PARALLEL_SEARCH_THRESHOLD : threshold);
+	parallel_search_workers = workers;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -20,6 +20,8 @@
 #ifndef VIFM__SEARCH_H__
 #define VIFM__SEARCH_H__
 
+#include "utils/test_helpers.h"
+
 struct view_t;
 
 /* Search and navigation functions. */
@@ -90,6 +92,15 @@ void reset_search_results(struct view_t *view);
 /* Prints the search messages for the n or N commands. */
 void print_search_next_msg(const struct view_t *view, int backward);
 
+/* Notifies search that entries of the view were changed in place (e.g.,
+ * renamed or added without a reload), so results of the last search can't be
+ * refined by checking only its matches. */
+void search_list_changed(const struct view_t *view);
+
+TSTATIC_DEFS(
+	void set_parallel_search(int threshold, int workers);
+)
+
 #endif /* VIFM__SEARCH_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -19,12 +19,13 @@
 
 #include "sort.h"
 
-#include <regex.h> /* regex_t regexec() regfree() */
+#include <regex.h> /* regex_t regfree() */
 
 #include <assert.h> /* assert() */
 #include <ctype.h>
-#include <stdlib.h> /* abs() */
-#include <string.h> /* strcmp() strrchr() */
+#include <stdint.h> /* int64_t uint64_t */
+#include <stdlib.h> /* abs() calloc() free() */
+#include <string.h> /* memcpy() strcmp() strdup() strrchr() */
 
 #include "cfg/config.h"
 #include "compat/fs_limits.h"
@@ -37,15 +38,21 @@
 #include "utils/path.h"
 #include "utils/regexp.h"
 #include "utils/str.h"
-#include "utils/string_array.h"
 #include "utils/test_helpers.h"
 #include "utils/utf8.h"
 #include "utils/utils.h"
+#include "utils/workers.h"
 #include "filelist.h"
 #include "filtering.h"
 #include "status.h"
 #include "types.h"
 
+/* Minimal number of entries in a sequence to sort it by several threads. */
+#define PARALLEL_SORT_THRESHOLD 16384
+
+/* Maximum number of threads that sort a sequence. */
+#define MAX_SORT_WORKERS 16
+
 const char *sort_enum[] = {
 	/* SK_* start with 1. */
 	[0] = "",
@@ -81,34 +88,88 @@ const char *sort_enum[] = {
 };
 ARRAY_GUARD(sort_enum, SK_TOTAL);
 
+/* Way in which values of a sorting key are compared. */
+typedef enum
+{
+	KK_NUMBER, /* Values are unsigned numbers. */
+	KK_STRING, /* Values are strings compared byte by byte. */
+	KK_CUSTOM, /* Entries are compared by compare_entries() using cached keys. */
+}
+KeyKind;
+
+/* Sorting key with its values computed for every entry of a sequence.
+ *
+ * Cached keys of KK_CUSTOM key are indexed by link field of entries.  The value
+ * in principle can be anything, but it's either name or short path at the
+ * moment.  An element can be NULL in which case original entry's value should
+ * be used.  The check for NULL seems to work measurably faster (not using NULLs
+ * doubles Unicode decomposition overhead from around 3% to 6%), otherwise NULLs
+ * could be replaced by those values.  This probably happens because CPU doesn't
+ * need to actually store that NULL anywhere on a check and data to use instead
+ * of NULL is already available in CPU's cache. */
+typedef struct
+{
+	int type;        /* SK_* (SK_NONE is for parent directory check). */
+	int descending;  /* Whether the order is reversed. */
+	KeyKind kind;    /* Which of the fields below hold values. */
+	uint64_t *nums;  /* Values of KK_NUMBER key. */
+	char **strs;     /* Values of KK_STRING key or cached keys of KK_CUSTOM one
+	                    (NULL if the key doesn't use them). */
+}
+seq_key_t;
+
+/* State of sorting positions of a sequence in parallel.  Runs of width
+ * positions are sorted in place and then pairs of neighbouring runs are merged
+ * from src into dst doubling width. */
+typedef struct
+{
+	int *src;  /* Positions that are being sorted or merged. */
+	int *dst;  /* Buffer to merge pairs of runs into. */
+	int count; /* Number of positions. */
+	int width; /* Maximum length of a run. */
+}
+merge_job_t;
+
 static void sort_tree_slice(dir_entry_t *entries, const dir_entry_t *children,
 		size_t nchildren, int root);
 static int prepare_for_sorting(view_t *v, int local);
-static int setup_linking(dir_entry_t *entries, int nentries);
-static void cleanup_linking(void);
 static void sort_sequence(dir_entry_t *entries, size_t nentries);
-static void sort_by_groups(dir_entry_t *entries, signed char key,
+static void sort_in_parallel(int order[], int count, int nworkers);
+static void sort_runs(void *arg, int from, int to);
+static void merge_runs(void *arg, int from, int to);
+static int compare_sequence_items(const void *one, const void *two);
+static int prepare_keys(const dir_entry_t *entries, size_t nentries);
+static int add_group_keys(const dir_entry_t *entries, size_t nentries,
+		int descending);
+static int update_group_regexps(void);
+static int add_key(int type, int descending, const dir_entry_t *entries,
+		size_t nentries, regex_t *regex);
+static int fill_key(seq_key_t *key, const dir_entry_t *entries,
+		size_t nentries, regex_t *regex);
+static int is_number_key(int type);
+static uint64_t get_number_key(int type, const dir_entry_t *entry);
+static uint64_t signed_key(int64_t value);
+static char * get_group(regex_t *regex, const char name[]);
+static void free_keys(void);
+static int compare_keys(int a, int b);
+static int cache_keys(seq_key_t *key, const dir_entry_t *entries,
 		size_t nentries);
-static void sort_by_key(dir_entry_t *entries, size_t nentries, signed char key,
-		void *data);
 static char * map_ascii_clone(const char str[], int ignore_case);
 static char * map_ascii(const char str[], int ignore_case);
 static char * lowerdup(const char str[]);
-static int sort_dir_list(const void *one, const void *two);
+static int compare_entries(const dir_entry_t *first, const dir_entry_t *second,
+		char *keys[], SortingKey sort_type);
 TSTATIC int strnumcmp(const char s[], const char t[]);
 #if HAVE_STRVERSCMP_FUNC
 static char * skip_leading_zeros(const char str[]);
 #endif
 static int compare_file_names(const dir_entry_t *f, const dir_entry_t *s,
-		SortingKey sort_type);
+		char *keys[], SortingKey sort_type);
 static int compare_file_exts(const dir_entry_t *f, int f_dir,
-		const dir_entry_t *s, int s_dir, SortingKey sort_type);
+		const dir_entry_t *s, int s_dir, char *keys[], SortingKey sort_type);
 static int compare_name_part(const char s[], const char t[]);
-static int compare_file_sizes(const dir_entry_t *f, const dir_entry_t *s);
-static int compare_item_count(const dir_entry_t *f, int fdir,
-		const dir_entry_t *s, int sdir);
-static int compare_group(const char f[], const char s[], regex_t *regex);
 static int compare_targets(const dir_entry_t *f, const dir_entry_t *s);
+TSTATIC void set_parallel_sort(int threshold, int workers);
 
 /* The following variables are set by prepare_for_sorting(). */
 
@@ -121,28 +182,23 @@ static const char *view_sort_groups;
 /* Whether the view displays custom file list. */
 static int custom_view;
 
-/* The following variables are set up by setup_linking() and managed by
- * sort_by_key(). */
+/* The following variables are set by prepare_keys() and freed by
+ * free_keys(). */
 
-/* A key per entry in a currently processed sequence of entries.  The value in
- * principle can be anything, but it's either name or short path at the moment.
- *
- * An entry can be NULL in which case original entry's value should be used.
- * The check for NULL seems to work measurably faster (not using NULLs doubles
- * Unicode decomposition overhead from around 3% to 6%), otherwise NULLs could
- * be replaced by those values.  This probably happens because CPU doesn't need
- * to actually store that NULL anywhere on a check and data to use instead of
- * NULL is already available in CPU's cache. */
-static char **cached_keys;
-
-/* The following variables are set by sort_by_key(). */
-
-/* Whether it's descending sort. */
-static int sort_descending;
-/* Key used to sort entries in current sorting round. */
-static SortingKey sort_type;
-/* Sorting key specific data. */
-static void *sort_data;
+/* Sequence of entries being sorted. */
+static const dir_entry_t *seq_entries;
+/* Sorting keys from the most significant one to the least significant one. */
+static seq_key_t *seq_keys;
+/* Number of elements in seq_keys array. */
+static int nseq_keys;
+/* Number of entries in the sequence. */
+static size_t nseq_entries;
+
+/* Number of entries in a sequence starting with which it's sorted by several
+ * threads. */
+static int parallel_sort_threshold = PARALLEL_SORT_THRESHOLD;
+/* Number of threads to use for parallel sorting, zero means one per CPU. */
+static int parallel_sort_workers;
 
 void
 sort_view(view_t *v)
@@ -158,11 +214,7 @@ sort_view(view_t *v)
 	 * resources, so skip it if we can. */
 	if(!custom_view || !cv_tree(v->custom.type))
 	{
-		if(setup_linking(v->dir_entry, v->list_rows) == 0)
-		{
-			sort_sequence(v->dir_entry, v->list_rows);
-			cleanup_linking();
-		}
+		sort_sequence(v->dir_entry, v->list_rows);
 		return;
 	}
 
@@ -174,14 +226,6 @@ sort_view(view_t *v)
 		flist_custom_uncompress_tree(v);
 	}
 
-	/* This must be done after uncompressing custom tree. */
-	if(setup_linking(v->dir_entry, v->list_rows) != 0)
-	{
-		/* Compress custom tree back. */
-		filters_drop_temporaries(v, /*entries=*/NULL);
-		return;
-	}
-
 	unsorted_list = v->dir_entry;
 	v->dir_entry = dynarray_extend(NULL, v->list_rows*sizeof(*v->dir_entry));
 	if(v->dir_entry != NULL)
@@ -195,9 +239,6 @@ sort_view(view_t *v)
 		unsorted_list = NULL;
 	}
 
-	/* Done with linking data by now. */
-	cleanup_linking();
-
 	if(filter_is_empty(&v->local_filter.filter))
 	{
 		dynarray_free(unsorted_list);
@@ -254,11 +295,31 @@ sort_entries(view_t *v, entries_t entries)
 		return;
 	}
 
-	if(setup_linking(entries.entries, entries.nentries) == 0)
+	sort_sequence(entries.entries, entries.nentries);
+}
+
+int
+sort_compare_entries(view_t *v, const dir_entry_t *first,
+		const dir_entry_t *second)
+{
+	if(prepare_for_sorting(v, /*local=*/1) != 0)
+	{
+		return 0;
+	}
+
+	/* Copies are linked to their own storage of keys. */
+	dir_entry_t entries[2] = { *first, *second };
+	entries[0].link = 0;
+	entries[1].link = 1;
+
+	if(prepare_keys(entries, 2U) != 0)
 	{
-		sort_sequence(entries.entries, entries.nentries);
-		cleanup_linking();
+		return 0;
 	}
+
+	const int result = compare_keys(0, 1);
+	free_keys();
+	return result;
 }
 
 /* Prepares globals of this unit for performing sorting.  Returns non-zero if
@@ -280,42 +341,189 @@ prepare_for_sorting(view_t *v, int local)
 	return 0;
 }
 
-/* Initializes cached keys storage and numbers entries to make future access to
- * cache possible.  Use cleanup_linking() to cleanup.  Returns zero on
- * success. */
-static int
-setup_linking(dir_entry_t *entries, int nentries)
+/* Sorts sequence of file entries (plain list, not tree, although it can be some
+ * part of a tree) in a stable way.  Values of all keys are computed once per
+ * entry, then positions of entries are sorted by all keys in one pass and
+ * entries are moved into their places. */
+static void
+sort_sequence(dir_entry_t *entries, size_t nentries)
 {
-	cached_keys = reallocarray(NULL, nentries, sizeof(*cached_keys));
-	if(cached_keys == NULL)
+	if(nentries < 2U)
 	{
-		return 1;
+		return;
 	}
 
-	int i;
-	for(i = 0; i < nentries; ++i)
+	size_t i;
+	for(i = 0U; i < nentries; ++i)
 	{
 		entries[i].link = i;
 	}
-	return 0;
+
+	int *const order = reallocarray(NULL, nentries, sizeof(*order));
+	dir_entry_t *const sorted = reallocarray(NULL, nentries, sizeof(*sorted));
+	if(order == NULL || sorted == NULL || prepare_keys(entries, nentries) != 0)
+	{
+		/* Just do nothing on memory error. */
+		free(order);
+		free(sorted);
+		return;
+	}
+
+	for(i = 0U; i < nentries; ++i)
+	{
+		order[i] = i;
+	}
+
+	/* Keys aren't modified while sorting, so comparisons can be performed
+	 * concurrently. */
+	const int nworkers = (parallel_sort_workers > 0)
+	                   ? parallel_sort_workers
+	                   : MIN(workers_cpu_count(), MAX_SORT_WORKERS);
+	if(nworkers > 1 && nentries >= (size_t)parallel_sort_threshold)
+	{
+		sort_in_parallel(order, nentries, nworkers);
+	}
+	else
+	{
+		safe_qsort(order, nentries, sizeof(*order), &compare_sequence_items);
+	}
+	free_keys();
+
+	for(i = 0U; i < nentries; ++i)
+	{
+		sorted[i] = entries[order[i]];
+	}
+	memcpy(entries, sorted, nentries*sizeof(*entries));
+
+	free(order);
+	free(sorted);
 }
 
-/* Frees resources allocated by setup_linking(). */
+/* Sorts positions of a large sequence by splitting it into a run per worker
+ * and then merging sorted runs by several threads. */
 static void
-cleanup_linking(void)
+sort_in_parallel(int order[], int count, int nworkers)
 {
-	/* Individual array elements are allocated and freed in sort_by_key(). */
-	free(cached_keys);
-	cached_keys = NULL;
+	int *const buf = reallocarray(NULL, count, sizeof(*buf));
+	if(buf == NULL)
+	{
+		safe_qsort(order, count, sizeof(*order), &compare_sequence_items);
+		return;
+	}
+
+	merge_job_t job = {
+		.src = order,
+		.dst = buf,
+		.count = count,
+		.width = (count + nworkers - 1)/nworkers,
+	};
+
+	workers_for(nworkers, /*chunk=*/1, nworkers, &sort_runs, &job);
+
+	while(job.width < count)
+	{
+		const int npairs = (count + 2*job.width - 1)/(2*job.width);
+		workers_for(npairs, /*chunk=*/1, nworkers, &merge_runs, &job);
+
+		int *const tmp = job.src;
+		job.src = job.dst;
+		job.dst = tmp;
+		job.width *= 2;
+	}
+
+	if(job.src != order)
+	{
+		memcpy(order, job.src, count*sizeof(*order));
+	}
+	free(buf);
 }
 
-/* Sorts sequence of file entries (plain list, not tree, although it can be some
- * part of a tree). */
+/* workers_for() callback that sorts a range of runs. */
 static void
-sort_sequence(dir_entry_t *entries, size_t nentries)
+sort_runs(void *arg, int from, int to)
 {
-	int i = SK_COUNT;
-	while(--i >= 0)
+	merge_job_t *const job = arg;
+
+	int i;
+	for(i = from; i < to; ++i)
+	{
+		const int start = MIN(i*job->width, job->count);
+		const int end = MIN(start + job->width, job->count);
+		safe_qsort(&job->src[start], end - start, sizeof(*job->src),
+				&compare_sequence_items);
+	}
+}
+
+/* workers_for() callback that merges a range of pairs of neighbouring runs. */
+static void
+merge_runs(void *arg, int from, int to)
+{
+	merge_job_t *const job = arg;
+
+	int i;
+	for(i = from; i < to; ++i)
+	{
+		const int start = i*2*job->width;
+		const int mid = MIN(start + job->width, job->count);
+		const int end = MIN(start + 2*job->width, job->count);
+
+		int l = start, r = mid, out = start;
+		while(l < mid && r < end)
+		{
+			/* Order is strict, so there are no equal elements to care about. */
+			if(compare_sequence_items(&job->src[l], &job->src[r]) < 0)
+			{
+				job->dst[out++] = job->src[l++];
+			}
+			else
+			{
+				job->dst[out++] = job->src[r++];
+			}
+		}
+		while(l < mid)
+		{
+			job->dst[out++] = job->src[l++];
+		}
+		while(r < end)
+		{
+			job->dst[out++] = job->src[r++];
+		}
+	}
+}
+
+/* Compares two positions within a sequence by keys of their entries falling
+ * back to the positions themselves to make sorting stable.  Returns standard
+ * -1, 0, 1 for comparisons. */
+static int
+compare_sequence_items(const void *one, const void *two)
+{
+	const int a = *(const int *)one;
+	const int b = *(const int *)two;
+	const int result = compare_keys(a, b);
+	return (result != 0 ? result : SORT_CMP(a, b));
+}
+
+/* Computes values of all sorting keys for entries of a sequence, which must be
+ * linked to their positions in it.  Use free_keys() to free the keys.  Returns
+ * zero on success, otherwise non-zero is returned. */
+static int
+prepare_keys(const dir_entry_t *entries, size_t nentries)
+{
+	seq_entries = entries;
+	nseq_entries = nentries;
+	seq_keys = NULL;
+	nseq_keys = 0;
+
+	/* Parent directory always comes first. */
+	int failed = add_key(SK_NONE, /*descending=*/0, entries, nentries, NULL);
+
+	if(!failed && !ui_view_sort_list_contains(view_sort, SK_BY_DIR))
+	{
+		failed = add_key(SK_BY_DIR, /*descending=*/0, entries, nentries, NULL);
+	}
+
+	int i;
+	for(i = 0; i < SK_COUNT && !failed; ++i)
 	{
 		const signed char sorting_key = view_sort[i];
 		const int sorting_type = abs(sorting_key);
@@ -325,118 +533,375 @@ sort_sequence(dir_entry_t *entries, size_t nentries)
 			continue;
 		}
 
-		if(sorting_type == SK_BY_GROUPS)
-		{
-			sort_by_groups(entries, sorting_key, nentries);
-			continue;
-		}
+		failed = (sorting_type == SK_BY_GROUPS)
+		       ? add_group_keys(entries, nentries, sorting_key < 0)
+		       : add_key(sorting_type, sorting_key < 0, entries, nentries, NULL);
+	}
+
+	if(failed)
+	{
+		free_keys();
+	}
+	return failed;
+}
 
-		sort_by_key(entries, nentries, sorting_key, NULL);
+/* Adds a key per group of sorting groups option going from the most significant
+ * group to the least significant one.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+add_group_keys(const dir_entry_t *entries, size_t nentries, int descending)
+{
+	if(update_group_regexps() != 0)
+	{
+		return 1;
 	}
 
-	if(!ui_view_sort_list_contains(view_sort, SK_BY_DIR))
+	int failed = 0;
+	int i;
+	for(i = 0; i < view->nsort_regexps && !failed; ++i)
 	{
-		sort_by_key(entries, nentries, SK_BY_DIR, NULL);
+		failed = add_key(SK_BY_GROUPS, descending, entries, nentries,
+				&view->sort_regexps[i]);
 	}
+	return failed;
 }
 
-/* Sorts specified range of entries according to sorting groups option. */
-static void
-sort_by_groups(dir_entry_t *entries, signed char key, size_t nentries)
+/* Makes sure that regular expressions of sorting groups cached in the view
+ * correspond to the groups being used for sorting.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+update_group_regexps(void)
 {
-	char **groups = NULL;
-	int ngroups = 0;
+	if(view->sort_regexps_src != NULL &&
+			strcmp(view->sort_regexps_src, view_sort_groups) == 0)
+	{
+		return 0;
+	}
+
+	sort_free_cache(view);
 
+	view->sort_regexps_src = strdup(view_sort_groups);
 	char *const copy = strdup(view_sort_groups);
+	if(view->sort_regexps_src == NULL || copy == NULL)
+	{
+		free(copy);
+		sort_free_cache(view);
+		return 1;
+	}
+
 	char *group = copy, *state = NULL;
 	while((group = split_and_get(group, ',', &state)) != NULL)
 	{
-		ngroups = add_to_string_array(&groups, ngroups, group);
+		regex_t *const regexps = reallocarray(view->sort_regexps,
+				view->nsort_regexps + 1, sizeof(*regexps));
+		if(regexps == NULL)
+		{
+			free(copy);
+			sort_free_cache(view);
+			return 1;
+		}
+		view->sort_regexps = regexps;
+
+		/* Groups were checked when the option was set. */
+		(void)regexp_compile(&view->sort_regexps[view->nsort_regexps++], group,
+				REG_EXTENDED | REG_ICASE);
 	}
-	free(copy);
 
-	/* Whether view->primary_group can be used to skip compiling regexp of the
-	 * first group. */
-	const int optimized = (view_sort_groups == view->sort_groups);
+	free(copy);
+	return 0;
+}
 
+void
+sort_free_cache(view_t *view)
+{
 	int i;
-	for(i = ngroups - 1; i >= (optimized ? 1 : 0); --i)
+	for(i = 0; i < view->nsort_regexps; ++i)
 	{
-		regex_t regex;
-		(void)regexp_compile(&regex, groups[i], REG_EXTENDED | REG_ICASE);
-		sort_by_key(entries, nentries, key, &regex);
-		regfree(&regex);
-	}
-	if(optimized && ngroups != 0)
-	{
-		sort_by_key(entries, nentries, key, &view->primary_group);
+		regfree(&view->sort_regexps[i]);
 	}
+	free(view->sort_regexps);
+	view->sort_regexps = NULL;
+	view->nsort_regexps = 0;
 
-	free_string_array(groups, ngroups);
+	update_string(&view->sort_regexps_src, NULL);
 }
 
-/* Sorts specified range of entries by the key in a stable way. */
-static void
-sort_by_key(dir_entry_t *entries, size_t nentries, signed char key, void *data)
+/* Appends a key to the list of keys.  regex is used only by SK_BY_GROUPS key.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+add_key(int type, int descending, const dir_entry_t *entries,
+		size_t nentries, regex_t *regex)
 {
-	sort_descending = (key < 0);
-	sort_type = (SortingKey)abs(key);
-	sort_data = data;
+	seq_key_t *const keys = reallocarray(seq_keys, nseq_keys + 1,
+			sizeof(*seq_keys));
+	if(keys == NULL)
+	{
+		return 1;
+	}
+	seq_keys = keys;
+
+	seq_key_t *const key = &seq_keys[nseq_keys++];
+	key->type = type;
+	key->descending = descending;
+	key->nums = NULL;
+	key->strs = NULL;
+	return fill_key(key, entries, nentries, regex);
+}
 
-	int using_cache = 0;
+/* Computes values of the key for every entry.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+fill_key(seq_key_t *key, const dir_entry_t *entries, size_t nentries,
+		regex_t *regex)
+{
+	size_t i;
 
-	if(sort_type == SK_BY_NAME || sort_type == SK_BY_INAME)
+	if(key->type == SK_BY_GROUPS)
 	{
-		using_cache = 1;
-
-		const int ignore_case = (sort_type == SK_BY_INAME);
+		key->kind = KK_STRING;
+		key->strs = calloc(nentries, sizeof(*key->strs));
+		if(key->strs == NULL)
+		{
+			return 1;
+		}
 
-		unsigned int i;
-		if(custom_view)
+		for(i = 0U; i < nentries; ++i)
 		{
-			for(i = 0; i < nentries; ++i)
+			key->strs[i] = get_group(regex, entries[i].name);
+			if(key->strs[i] == NULL)
 			{
-				char short_path[PATH_MAX + 1];
-				get_short_path_of(view, &entries[i], NF_NONE, 0, sizeof(short_path),
-						short_path);
-				cached_keys[entries[i].link] = map_ascii_clone(short_path, ignore_case);
+				return 1;
 			}
 		}
-		else
+		return 0;
+	}
+
+	if(is_number_key(key->type))
+	{
+		key->kind = KK_NUMBER;
+		key->nums = reallocarray(NULL, nentries, sizeof(*key->nums));
+		if(key->nums == NULL)
+		{
+			return 1;
+		}
+
+		for(i = 0U; i < nentries; ++i)
 		{
-			for(i = 0; i < nentries; ++i)
+			key->nums[i] = get_number_key(key->type, &entries[i]);
+		}
+		return 0;
+	}
+
+	key->kind = KK_CUSTOM;
+	return cache_keys(key, entries, nentries);
+}
+
+/* Checks whether values of the key can be represented by numbers that retain
+ * their order.  Returns non-zero if so, otherwise zero is returned. */
+static int
+is_number_key(int type)
+{
+	switch(type)
+	{
+		case SK_NONE:
+		case SK_BY_DIR:
+		case SK_BY_SIZE:
+		case SK_BY_NITEMS:
+		case SK_BY_TIME_MODIFIED:
+		case SK_BY_TIME_ACCESSED:
+		case SK_BY_TIME_CHANGED:
+#ifndef _WIN32
+		case SK_BY_MODE:
+		case SK_BY_INODE:
+		case SK_BY_OWNER_NAME:
+		case SK_BY_OWNER_ID:
+		case SK_BY_GROUP_NAME:
+		case SK_BY_GROUP_ID:
+		case SK_BY_NLINKS:
+#endif
+			return 1;
+
+		default:
+			return 0;
+	}
+}
+
+/* Computes value of a key for which is_number_key() is true.  Returns the
+ * value. */
+static uint64_t
+get_number_key(int type, const dir_entry_t *entry)
+{
+	switch(type)
+	{
+		case SK_NONE:
+			return !(fentry_is_dir(entry) && is_parent_dir(entry->name));
+		case SK_BY_DIR:
+			return !fentry_is_dir(entry);
+
+		case SK_BY_SIZE:
+			return fentry_get_size(view, entry);
+		case SK_BY_NITEMS:
+			/* We don't want to call fentry_get_nitems() for files as sorting huge
+			 * lists of files can call this function a lot of times, thus even small
+			 * extra performance overhead is not desirable. */
+			return fentry_is_dir(entry) ? fentry_get_nitems(view, entry) : 0U;
+
+		case SK_BY_TIME_MODIFIED:
+			return signed_key(entry->mtime);
+		case SK_BY_TIME_ACCESSED:
+			return signed_key(entry->atime);
+		case SK_BY_TIME_CHANGED:
+			return signed_key(entry->ctime);
+
+#ifndef _WIN32
+		case SK_BY_MODE:
+			return entry->mode;
+		case SK_BY_INODE:
+			return entry->inode;
+		case SK_BY_OWNER_NAME: /* FIXME */
+		case SK_BY_OWNER_ID:
+			return entry->uid;
+		case SK_BY_GROUP_NAME: /* FIXME */
+		case SK_BY_GROUP_ID:
+			return entry->gid;
+		case SK_BY_NLINKS:
+			return signed_key(entry->nlinks);
+#endif
+
+		default:
+			assert(0 && "Unhandled numeric sorting key?");
+			return 0U;
+	}
+}
+
+/* Maps signed value onto unsigned one preserving the order.  Returns the
+ * mapped value. */
+static uint64_t
+signed_key(int64_t value)
+{
+	return (uint64_t)value ^ ((uint64_t)1U << 63);
+}
+
+/* Extracts part of the name matched by a group.  Returns newly allocated string
+ * or NULL on error. */
+static char *
+get_group(regex_t *regex, const char name[])
+{
+	char group[NAME_MAX + 1];
+	regmatch_t match = get_group_match(regex, name);
+	copy_str(group, MIN(sizeof(group), (size_t)match.rm_eo - match.rm_so + 1U),
+			name + match.rm_so);
+	return strdup(group);
+}
+
+/* Frees keys allocated by prepare_keys(). */
+static void
+free_keys(void)
+{
+	int i;
+	for(i = 0; i < nseq_keys; ++i)
+	{
+		seq_key_t *const key = &seq_keys[i];
+		if(key->strs != NULL)
+		{
+			size_t j;
+			for(j = 0U; j < nseq_entries; ++j)
 			{
-				cached_keys[entries[i].link] = map_ascii(entries[i].name, ignore_case);
+				free(key->strs[j]);
 			}
+			free(key->strs);
 		}
+		free(key->nums);
 	}
-	else if(sort_type == SK_BY_FILEEXT || sort_type == SK_BY_EXTENSION)
+
+	free(seq_keys);
+	seq_keys = NULL;
+	nseq_keys = 0;
+	seq_entries = NULL;
+	nseq_entries = 0U;
+}
+
+/* Compares entries at two positions of a sequence by all keys.  Returns
+ * standard -1, 0, 1 for comparisons. */
+static int
+compare_keys(int a, int b)
+{
+	int i;
+	for(i = 0; i < nseq_keys; ++i)
 	{
-		using_cache = 1;
+		const seq_key_t *const key = &seq_keys[i];
 
-		unsigned int i;
-		for(i = 0; i < nentries; ++i)
+		int result = 0;
+		switch(key->kind)
 		{
-			cached_keys[entries[i].link] =
-				map_ascii(entries[i].name, /*ignore_case=*/0);
+			case KK_NUMBER:
+				result = SORT_CMP(key->nums[a], key->nums[b]);
+				break;
+			case KK_STRING:
+				result = strcmp(key->strs[a], key->strs[b]);
+				break;
+			case KK_CUSTOM:
+				result = compare_entries(&seq_entries[a], &seq_entries[b], key->strs,
+						(SortingKey)key->type);
+				break;
+		}
+
+		if(result != 0)
+		{
+			return (key->descending ? -result : result);
 		}
 	}
+	return 0;
+}
 
-	unsigned int i;
-	for(i = 0U; i < nentries; ++i)
+/* Fills cached keys of KK_CUSTOM key if it uses them.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+cache_keys(seq_key_t *key, const dir_entry_t *entries, size_t nentries)
+{
+	const SortingKey sort_type = (SortingKey)key->type;
+	if(sort_type != SK_BY_NAME && sort_type != SK_BY_INAME &&
+			sort_type != SK_BY_FILEEXT && sort_type != SK_BY_EXTENSION)
 	{
-		entries[i].tag = i;
+		return 0;
 	}
 
-	safe_qsort(entries, nentries, sizeof(*entries), &sort_dir_list);
+	key->strs = reallocarray(NULL, nentries, sizeof(*key->strs));
+	if(key->strs == NULL)
+	{
+		return 1;
+	}
 
-	if(using_cache)
+	size_t i;
+	if(sort_type == SK_BY_FILEEXT || sort_type == SK_BY_EXTENSION)
 	{
-		for(i = 0; i < nentries; ++i)
+		for(i = 0U; i < nentries; ++i)
 		{
-			free(cached_keys[entries[i].link]);
+			key->strs[i] = map_ascii(entries[i].name, /*ignore_case=*/0);
 		}
+		return 0;
 	}
+
+	const int ignore_case = (sort_type == SK_BY_INAME);
+
+	if(custom_view)
+	{
+		for(i = 0U; i < nentries; ++i)
+		{
+			char short_path[PATH_MAX + 1];
+			get_short_path_of(view, &entries[i], NF_NONE, 0, sizeof(short_path),
+					short_path);
+			key->strs[i] = map_ascii_clone(short_path, ignore_case);
+		}
+	}
+	else
+	{
+		for(i = 0U; i < nentries; ++i)
+		{
+			key->strs[i] = map_ascii(entries[i].name, ignore_case);
+		}
+	}
+	return 0;
 }
 
 /* Turns non-ASCII strings into normalized UTF-8 strings or just clones it.
@@ -558,164 +1023,44 @@ skip_leading_zeros(const char str[])
 }
 #endif
 
+/* Compares two entries by a key for which is_number_key() is false and which
+ * isn't SK_BY_GROUPS.  keys are cached keys of the sorting key.  Returns
+ * standard < 0, == 0, > 0 comparison result. */
 static int
-sort_dir_list(const void *one, const void *two)
+compare_entries(const dir_entry_t *first, const dir_entry_t *second,
+		char *keys[], SortingKey sort_type)
 {
-	/* TODO: refactor this function sort_dir_list(). */
-
-	int retval;
-	const dir_entry_t *const first = one;
-	const dir_entry_t *const second = two;
-
-	const int first_is_dir = fentry_is_dir(first);
-	const int second_is_dir = fentry_is_dir(second);
-
-	if(first_is_dir && is_parent_dir(first->name))
-	{
-		return -1;
-	}
-	if(second_is_dir && is_parent_dir(second->name))
-	{
-		return 1;
-	}
-
-	retval = 0;
 	switch(sort_type)
 	{
 		case SK_BY_NAME:
 		case SK_BY_INAME:
-			retval = compare_file_names(first, second, sort_type);
-			break;
-
-		case SK_BY_DIR:
-			if(first_is_dir != second_is_dir)
-			{
-				retval = first_is_dir ? -1 : 1;
-			}
-			break;
+			return compare_file_names(first, second, keys, sort_type);
 
 		case SK_BY_TYPE:
-			retval = strcmp(get_type_str(first->type), get_type_str(second->type));
-			break;
+			return strcmp(get_type_str(first->type), get_type_str(second->type));
 
 		case SK_BY_FILEEXT:
 		case SK_BY_EXTENSION:
-			retval = compare_file_exts(first, first_is_dir, second, second_is_dir,
-					sort_type);
-			break;
-
-		case SK_BY_SIZE:
-			retval = compare_file_sizes(first, second);
-			break;
-
-		case SK_BY_NITEMS:
-			retval = compare_item_count(first, first_is_dir, second, second_is_dir);
-			break;
-
-		case SK_BY_GROUPS:
-			retval = compare_group(first->name, second->name, sort_data);
-			break;
+			return compare_file_exts(first, fentry_is_dir(first), second,
+					fentry_is_dir(second), keys, sort_type);
 
 		case SK_BY_TARGET:
-			retval = compare_targets(first, second);
-			break;
-
-		case SK_BY_TIME_MODIFIED:
-			retval = SORT_CMP(first->mtime, second->mtime);
-			break;
-
-		case SK_BY_TIME_ACCESSED:
-			retval = SORT_CMP(first->atime, second->atime);
-			break;
-
-		case SK_BY_TIME_CHANGED:
-			retval = SORT_CMP(first->ctime, second->ctime);
-			break;
+			return compare_targets(first, second);
 
 #ifndef _WIN32
-		case SK_BY_MODE:
-			retval = SORT_CMP(first->mode, second->mode);
-			break;
-
-		case SK_BY_INODE:
-			retval = SORT_CMP(first->inode, second->inode);
-			break;
-
-		case SK_BY_OWNER_NAME: /* FIXME */
-		case SK_BY_OWNER_ID:
-			retval = SORT_CMP(first->uid, second->uid);
-			break;
-
-		case SK_BY_GROUP_NAME: /* FIXME */
-		case SK_BY_GROUP_ID:
-			retval = SORT_CMP(first->gid, second->gid);
-			break;
-
 		case SK_BY_PERMISSIONS:
 			{
 				char first_perm[11], second_perm[11];
 				get_perm_string(first_perm, sizeof(first_perm), first->mode);
 				get_perm_string(second_perm, sizeof(second_perm), second->mode);
-				retval = strcmp(first_perm, second_perm);
+				return strcmp(first_perm, second_perm);
 			}
-			break;
-
-		case SK_BY_NLINKS:
-			retval = SORT_CMP(first->nlinks, second->nlinks);
-			break;
 #endif
-	}
 
-	if(retval == 0)
-	{
-		retval = SORT_CMP(first->tag, second->tag);
+		default:
+			assert(0 && "Unhandled sorting key?");
+			return 0;
 	}
-	else if(sort_descending)
-	{
-		retval = -retval;
-	}
-
-	return retval;
-}
-
-/* Compares two file sizes.  Returns standard -1, 0, 1 for comparisons. */
-static int
-compare_file_sizes(const dir_entry_t *f, const dir_entry_t *s)
-{
-	const uint64_t fsize = fentry_get_size(view, f);
-	const uint64_t ssize = fentry_get_size(view, s);
-	return SORT_CMP(fsize, ssize);
-}
-
-/* Compares number of items in two directories (taken as zero for files).
- * Returns standard -1, 0, 1 for comparisons. */
-static int
-compare_item_count(const dir_entry_t *f, int fdir, const dir_entry_t *s,
-		int sdir)
-{
-	/* We don't want to call fentry_get_nitems() for files as sorting huge lists
-	 * of files can call this function a lot of times, thus even small extra
-	 * performance overhead is not desirable. */
-	const uint64_t fsize = fdir ? fentry_get_nitems(view, f) : 0U;
-	const uint64_t ssize = sdir ? fentry_get_nitems(view, s) : 0U;
-	return SORT_CMP(fsize, ssize);
-}
-
-/* Compares two file names according to grouping regular expression.  Returns
- * standard -1, 0, 1 for comparisons. */
-static int
-compare_group(const char f[], const char s[], regex_t *regex)
-{
-	char fname[NAME_MAX + 1], sname[NAME_MAX + 1];
-	regmatch_t fmatch = get_group_match(regex, f);
-	regmatch_t smatch = get_group_match(regex, s);
-
-	copy_str(fname, MIN(sizeof(fname), (size_t)fmatch.rm_eo - fmatch.rm_so + 1U),
-			f + fmatch.rm_so);
-	copy_str(sname, MIN(sizeof(sname), (size_t)smatch.rm_eo - smatch.rm_so + 1U),
-			s + smatch.rm_so);
-
-	return strcmp(fname, sname);
 }
 
 /* Compares two file names according to symbolic link target.  Returns standard
@@ -758,17 +1103,17 @@ compare_targets(const dir_entry_t *f, const dir_entry_t *s)
  * positive value if s is greater than t, zero if they are equal, otherwise
  * negative value is returned. */
 static int
-compare_file_names(const dir_entry_t *f, const dir_entry_t *s,
+compare_file_names(const dir_entry_t *f, const dir_entry_t *s, char *keys[],
 		SortingKey sort_type)
 {
 	/* NULL check and conditional load is actually faster than just reading a
 	 * value and not by a trivial amount. */
-	const char *f_name = cached_keys[f->link];
+	const char *f_name = keys[f->link];
 	if(f_name == NULL)
 	{
 		f_name = f->name;
 	}
-	const char *s_name = cached_keys[s->link];
+	const char *s_name = keys[s->link];
 	if(s_name == NULL)
 	{
 		s_name = s->name;
@@ -817,16 +1162,16 @@ compare_file_names(const dir_entry_t *f, const dir_entry_t *s,
  * comparison result. */
 static int
 compare_file_exts(const dir_entry_t *f, int f_dir, const dir_entry_t *s,
-		int s_dir, SortingKey sort_type)
+		int s_dir, char *keys[], SortingKey sort_type)
 {
 	/* NULL check and conditional load is actually faster than just reading a
 	 * value and not by a trivial amount. */
-	const char *f_name = cached_keys[f->link];
+	const char *f_name = keys[f->link];
 	if(f_name == NULL)
 	{
 		f_name = f->name;
 	}
-	const char *s_name = cached_keys[s->link];
+	const char *s_name = keys[s->link];
 	if(s_name == NULL)
 	{
 		s_name = s->name;
@@ -915,5 +1260,14 @@ get_secondary_key(SortingKey primary_key)
 	return SK_BY_SIZE;
 }
 
+/* Configures parallel processing.  Negative threshold restores the default
+ * one, workers equal to zero means using the number of CPUs. */
+TSTATIC void
+set_parallel_sort(int threshold, int workers)
+{
+	parallel_sort_threshold = (threshold < 0 ? PARALLEL_SORT_THRESHOLD : threshold);
+	parallel_sort_workers = workers;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
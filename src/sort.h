@@ -32,12 +32,23 @@ void sort_view(view_t *view);
 /* Sorts specified entries using global settings of the view. */
 void sort_entries(view_t *view, entries_t entries);
 
+/* Compares two entries of a non-custom view according to its sorting
+ * configuration.  Position of entries in the list isn't taken into account.
+ * Returns standard -1, 0, 1 for comparisons. */
+int sort_compare_entries(view_t *view, const dir_entry_t *first,
+		const dir_entry_t *second);
+
+/* Frees compiled regular expressions of sorting groups cached in the view by
+ * sorting. */
+void sort_free_cache(view_t *view);
+
 /* Maps primary sort key to second column type.  Returns secondary key that
  * corresponds to the primary one. */
 SortingKey get_secondary_key(SortingKey primary_key);
 
 TSTATIC_DEFS(
 	int strnumcmp(const char s[], const char t[]);
+	void set_parallel_sort(int threshold, int workers);
 )
 
 #endif /* VIFM__SORT_H__ */
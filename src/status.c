@@ -70,6 +70,14 @@ typedef struct
 }
 dcache_data_t;
 
+/* Parameters of dcache_list_sizes(). */
+typedef struct
+{
+	dcache_list_cb cb; /* Callback to invoke for each entry. */
+	void *arg;         /* Argument for the callback. */
+}
+list_sizes_t;
+
 /* Saved view selection. */
 typedef struct
 {
@@ -87,6 +95,7 @@ static void set_last_cmdline_command(const char cmd[]);
 static void dcache_get(const char path[], time_t mtime, uint64_t inode,
 		dcache_result_t *size, dcache_result_t *nitems);
 static void size_updater(void *data, void *arg);
+static int list_size(const char path[], void *data, void *arg);
 TSTATIC time_t dcache_get_size_timestamp(const char path[]);
 TSTATIC void dcache_set_size_timestamp(const char path[], time_t ts);
 
@@ -710,6 +719,58 @@ dcache_set_at(const char path[], uint64_t inode, uint64_t size, uint64_t nitems)
 	return ret;
 }
 
+int
+dcache_restore_size(const char path[], uint64_t inode, uint64_t size, time_t ts)
+{
+	dcache_data_t data = { .value = size, .timestamp = ts };
+#ifndef _WIN32
+	data.inode = (ino_t)inode;
+#endif
+
+	int ret = 0;
+
+	/* Paths come from dcache_list_sizes() and are already resolved.  Those that
+	 * don't exist anymore won't match on lookup because of different inode. */
+	pthread_mutex_lock(&dcache_size_mutex);
+	dcache_data_t current;
+	if(fsdata_get_resolved(dcache_size, path, &current, sizeof(current)) != 0 ||
+			current.timestamp < ts)
+	{
+		ret = fsdata_set_resolved(dcache_size, path, &data, sizeof(data));
+	}
+	pthread_mutex_unlock(&dcache_size_mutex);
+
+	return ret;
+}
+
+void
+dcache_list_sizes(dcache_list_cb cb, void *arg)
+{
+	list_sizes_t list = { .cb = cb, .arg = arg };
+
+	pthread_mutex_lock(&dcache_size_mutex);
+	(void)fsdata_list(dcache_size, &list_size, &list);
+	pthread_mutex_unlock(&dcache_size_mutex);
+}
+
+/* fsdata_list() callback that reports an entry of the size cache.  Returns
+ * zero. */
+static int
+list_size(const char path[], void *data, void *arg)
+{
+	const list_sizes_t *const list = arg;
+	const dcache_data_t *const size_data = data;
+
+#ifndef _WIN32
+	const uint64_t inode = size_data->inode;
+#else
+	const uint64_t inode = 0U;
+#endif
+
+	list->cb(path, inode, size_data->value, size_data->timestamp, list->arg);
+	return 0;
+}
+
 TSTATIC time_t
 dcache_get_size_timestamp(const char path[])
 {
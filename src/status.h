@@ -100,6 +100,11 @@ typedef struct
 }
 dcache_result_t;
 
+/* Type of callback for dcache_list_sizes().  The inode is zero on systems which
+ * lack inodes. */
+typedef void (*dcache_list_cb)(const char path[], uint64_t inode,
+		uint64_t size, time_t ts, void *arg);
+
 /* Current preview (quickview) parameters. */
 typedef struct
 {
@@ -363,6 +368,16 @@ void dcache_update_parent_sizes(const char path[], uint64_t by);
 int dcache_set_at(const char path[], uint64_t inode, uint64_t size,
 		uint64_t nitems);
 
+/* Restores previously saved size of the path, which was computed at the
+ * specified time.  The path should be one listed by dcache_list_sizes(), it's
+ * not resolved.  Newer information that's already present is left intact.
+ * Returns zero on success, otherwise non-zero is returned. */
+int dcache_restore_size(const char path[], uint64_t inode, uint64_t size,
+		time_t ts);
+
+/* Lists all cached sizes of directories. */
+void dcache_list_sizes(dcache_list_cb cb, void *arg);
+
 /* Selection history. */
 
 /* Adds/updates saved selection of files for a particular directory.  Takes
@@ -120,6 +120,7 @@ const char *tags[] = {
 	"vifm-'showtabline'",
 	"vifm-'sizefmt'",
 	"vifm-'slowfs'",
+	"vifm-'slowfspoll'",
 	"vifm-'smartcase'",
 	"vifm-'so'",
 	"vifm-'sort'",
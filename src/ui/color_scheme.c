@@ -27,7 +27,7 @@
 #include <math.h> /* abs() */
 #include <stddef.h> /* NULL size_t */
 #include <stdio.h> /* snprintf() */
-#include <stdlib.h> /* free() */
+#include <stdlib.h> /* calloc() free() */
 #include <string.h> /* memcpy() memset() strcpy() strlen() */
 
 #include "../cfg/config.h"
@@ -39,8 +39,10 @@
 #include "../modes/dialogs/msg_dialog.h"
 #include "../utils/fs.h"
 #include "../utils/fsddata.h"
+#include "../utils/globidx.h"
 #include "../utils/macros.h"
 #include "../utils/matchers.h"
+#include "../utils/path.h"
 #include "../utils/str.h"
 #include "../utils/string_array.h"
 #include "../utils/utils.h"
@@ -530,10 +532,21 @@ static const col_attr_t default_cs[] = {
 };
 ARRAY_GUARD(default_cs, MAXNUM_COLOR);
 
+/* Index of file highlight rules that finds rule for a file name without trying
+ * every rule in turn.  Rules that consist of literal names and "*suffix" globs
+ * are looked up in globs index, the rest are kept in a list. */
+struct file_hi_index_t
+{
+	globidx_t *globs; /* Simple globs of rules identified by indexes of rules. */
+	int *others;      /* Indexes of rules that aren't in the globs index. */
+	int other_count;  /* Number of elements in others. */
+};
+
 static char ** list_cs_files(int *len);
 static void restore_primary_cs(const col_scheme_t *cs);
 static void reset_to_default_cs(col_scheme_t *cs);
 static void free_cs_highlights(col_scheme_t *cs);
+static void invalidate_file_hi_index(col_scheme_t *cs);
 static file_hi_t * clone_file_highlights(const col_scheme_t *from);
 static col_attr_t * clone_column_highlights(const col_scheme_t *from);
 static void reset_cs_colors(col_scheme_t *cs);
@@ -548,6 +561,12 @@ static void overlap_cterm_colors(col_attr_t *color,
 static void overlap_gui_colors(col_attr_t *color, const col_attr_t *admixture);
 static col_attr_t convert_to_gui(const col_attr_t *color);
 static int color_diff(int a, int b);
+static int find_file_hi(const col_scheme_t *cs, const char fname[]);
+static int find_indexed_file_hi(const file_hi_index_t *index,
+		const col_scheme_t *cs, const char fname[]);
+static int take_first_file_hi(int id, void *arg);
+static file_hi_index_t * build_file_hi_index(const col_scheme_t *cs);
+static void free_file_hi_index(file_hi_index_t *index);
 
 /* Mapping of color schemes associations onto file system tree. */
 static fsddata_t *dir_map;
@@ -939,6 +958,8 @@ cs_assign(col_scheme_t *to, const col_scheme_t *from)
 {
 	free_cs_highlights(to);
 	*to = *from;
+	/* Index refers to the rules of the source, a new one is built on demand. */
+	to->file_hi_index = NULL;
 	to->file_hi = clone_file_highlights(from);
 	to->column_hi = clone_column_highlights(from);
 }
@@ -961,6 +982,8 @@ free_cs_highlights(col_scheme_t *cs)
 {
 	int i;
 
+	invalidate_file_hi_index(cs);
+
 	for(i = 0; i < cs->file_hi_count; ++i)
 	{
 		matchers_free(cs->file_hi[i].matchers);
@@ -975,6 +998,15 @@ free_cs_highlights(col_scheme_t *cs)
 	cs->column_hi_count = 0;
 }
 
+/* Drops index of file highlight rules of the color scheme, it's rebuilt on next
+ * lookup. */
+static void
+invalidate_file_hi_index(col_scheme_t *cs)
+{
+	free_file_hi_index(cs->file_hi_index);
+	cs->file_hi_index = NULL;
+}
+
 /* Clones filename specific highlight array of the *from color scheme and
  * returns it. */
 static file_hi_t *
@@ -1346,6 +1378,8 @@ cs_add_file_hi(struct matchers_t *matchers, const col_attr_t *hi)
 	}
 	cs->file_hi = p;
 
+	invalidate_file_hi_index(cs);
+
 	file_hi = &cs->file_hi[cs->file_hi_count];
 
 	file_hi->matchers = matchers;
@@ -1368,19 +1402,143 @@ cs_get_file_hi(const col_scheme_t *cs, const char fname[], int *hi_hint)
 		return &cs->file_hi[*hi_hint].hi;
 	}
 
+	const int i = find_file_hi(cs, fname);
+	if(i == INT_MAX)
+	{
+		*hi_hint = INT_MAX;
+		return NULL;
+	}
+
+	*hi_hint = i;
+	return &cs->file_hi[i].hi;
+}
+
+/* Finds the first file highlight rule that matches the file.  Returns index of
+ * the rule or INT_MAX if there is no match. */
+static int
+find_file_hi(const col_scheme_t *cs, const char fname[])
+{
+	if(cs->file_hi_index == NULL && cs->file_hi_count != 0)
+	{
+		/* The index is a cache of the rules, so building it doesn't really change
+		 * the color scheme. */
+		((col_scheme_t *)cs)->file_hi_index = build_file_hi_index(cs);
+	}
+
+	if(cs->file_hi_index != NULL)
+	{
+		const int i = find_indexed_file_hi(cs->file_hi_index, cs, fname);
+		if(i >= 0)
+		{
+			return i;
+		}
+	}
+
+	int i;
+	for(i = 0; i < cs->file_hi_count; ++i)
+	{
+		if(matchers_match(cs->file_hi[i].matchers, fname))
+		{
+			return i;
+		}
+	}
+	return INT_MAX;
+}
+
+/* Finds the first file highlight rule that matches the file using the index.
+ * Returns index of the rule, INT_MAX if there is no match or -1 if the index
+ * can't handle the name. */
+static int
+find_indexed_file_hi(const file_hi_index_t *index, const col_scheme_t *cs,
+		const char fname[])
+{
+	/* Globs are matched against the last path component. */
+	int best = INT_MAX;
+	if(globidx_find(index->globs, get_last_path_component(fname),
+				&take_first_file_hi, &best) != 0)
+	{
+		return -1;
+	}
+
+	/* Only rules that precede the best one so far can change the result. */
+	int i;
+	for(i = 0; i < index->other_count && index->others[i] < best; ++i)
+	{
+		const int rule = index->others[i];
+		if(matchers_match(cs->file_hi[rule].matchers, fname))
+		{
+			return rule;
+		}
+	}
+
+	return best;
+}
+
+/* Remembers the first index of a rule found by globidx_find().  Returns
+ * non-zero to stop the search. */
+static int
+take_first_file_hi(int id, void *arg)
+{
+	int *const best = arg;
+	*best = id;
+	return 1;
+}
+
+/* Builds index of file highlight rules of the color scheme.  Returns the index
+ * or NULL on error. */
+static file_hi_index_t *
+build_file_hi_index(const col_scheme_t *cs)
+{
+	file_hi_index_t *const index = calloc(1, sizeof(*index));
+	if(index == NULL)
+	{
+		return NULL;
+	}
+
+	index->globs = globidx_create();
+	index->others = reallocarray(NULL, cs->file_hi_count, sizeof(*index->others));
+	if(index->globs == NULL || index->others == NULL)
+	{
+		free_file_hi_index(index);
+		return NULL;
+	}
+
 	int i;
 	for(i = 0; i < cs->file_hi_count; ++i)
 	{
-		const file_hi_t *const file_hi = &cs->file_hi[i];
-		if(matchers_match(file_hi->matchers, fname))
+		int count;
+		char **globs = matchers_get_simple_globs(cs->file_hi[i].matchers, &count);
+
+		int j = 0;
+		if(globs != NULL)
+		{
+			while(j < count && globidx_add(index->globs, globs[j], i) == 0)
+			{
+				++j;
+			}
+		}
+
+		if(globs == NULL || j != count)
 		{
-			*hi_hint = i;
-			return &file_hi->hi;
+			/* Globs that did get into the index are still correct matches. */
+			index->others[index->other_count++] = i;
 		}
+		free_string_array(globs, count);
 	}
 
-	*hi_hint = INT_MAX;
-	return NULL;
+	return index;
+}
+
+/* Frees the index.  index can be NULL. */
+static void
+free_file_hi_index(file_hi_index_t *index)
+{
+	if(index != NULL)
+	{
+		globidx_free(index->globs);
+		free(index->others);
+		free(index);
+	}
 }
 
 int
@@ -1393,6 +1551,7 @@ cs_del_file_hi(const char matchers_expr[])
 	{
 		if(strcmp(matchers_get_expr(cs->file_hi[i].matchers), matchers_expr) == 0)
 		{
+			invalidate_file_hi_index(cs);
 			matchers_free(cs->file_hi[i].matchers);
 			memmove(&cs->file_hi[i], &cs->file_hi[i + 1],
 					sizeof(*cs->file_hi)*((cs->file_hi_count - 1) - i));
@@ -43,6 +43,9 @@ ColorSchemeState;
 
 struct matchers_t;
 
+/* Opaque index of file highlight rules. */
+typedef struct file_hi_index_t file_hi_index_t;
+
 /* Single file highlight description. */
 typedef struct
 {
@@ -61,6 +64,7 @@ typedef struct
 
 	file_hi_t *file_hi; /* List of file highlight preferences. */
 	int file_hi_count;  /* Number of file highlight definitions. */
+	file_hi_index_t *file_hi_index; /* Lazily built index of file_hi or NULL. */
 
 	col_attr_t *column_hi; /* List of column highlight preferences.
 	                          Unused entries are filled with 0xff. */
@@ -61,6 +61,10 @@
 /* Maximum number of lines used for preview. */
 enum { MAX_PREVIEW_LINES = 256 };
 
+/* Number of entries in each direction from the current one for which viewers
+ * are started in advance. */
+enum { PREFETCH_DISTANCE = 2 };
+
 /* Cached information about a single file's preview. */
 typedef struct
 {
@@ -101,6 +105,8 @@ static void update_cache(quickview_cache_t *cache, const char path[],
 		const char viewer[], ViewerKind kind, const preview_area_t *parea,
 		int max_lines);
 static strlist_t get_lines(const quickview_cache_t *cache);
+static void prefetch_neighbours(view_t *view, const preview_area_t *parea);
+static void prefetch_entry(view_t *view, int pos);
 static void print_tree_stats(tree_print_state_t *s);
 static int print_dir_tree(tree_print_state_t *s, const char path[], int last);
 static void collect_subtree_stats(tree_print_state_t *s, const char path[]);
@@ -220,6 +226,7 @@ qv_draw(view_t *view)
 			.h = ui_qv_height(other_view),
 		};
 		(void)view_entry(curr, &parea, &qv_cache);
+		prefetch_neighbours(view, &parea);
 	}
 
 	refresh_view_win(other_view);
@@ -450,6 +457,67 @@ get_lines(const quickview_cache_t *cache)
 	return lines;
 }
 
+/* Starts viewers of files around the current one in background, so that their
+ * previews are likely to be ready by the time cursor gets there. */
+static void
+prefetch_neighbours(view_t *view, const preview_area_t *parea)
+{
+	vcache_prefetch_begin();
+
+	view_t *const curr = curr_view;
+	const int pos = view->list_pos;
+	curr_view = view;
+	curr_stats.preview_hint = parea;
+
+	/* Closer entries are more likely to be viewed. */
+	int i;
+	for(i = 1; i <= PREFETCH_DISTANCE; ++i)
+	{
+		prefetch_entry(view, pos + i);
+		prefetch_entry(view, pos - i);
+	}
+
+	view->list_pos = pos;
+	curr_stats.preview_hint = NULL;
+	curr_view = curr;
+
+	vcache_prefetch_end();
+}
+
+/* Starts viewer of an entry of the view if it's a regular file with a textual
+ * viewer. */
+static void
+prefetch_entry(view_t *view, int pos)
+{
+	if(pos < 0 || pos >= view->list_rows)
+	{
+		return;
+	}
+
+	const dir_entry_t *const entry = &view->dir_entry[pos];
+	if(fentry_is_fake(entry) || (entry->type != FT_REG && entry->type != FT_EXEC))
+	{
+		return;
+	}
+
+	char path[PATH_MAX + 1];
+	qv_get_path_to_explore(entry, path, sizeof(path));
+
+	const char *const viewer = qv_get_viewer(path);
+	if(viewer == NULL || ft_viewer_kind(viewer) != VK_TEXTUAL)
+	{
+		return;
+	}
+
+	/* Macros are expanded for the current entry. */
+	view->list_pos = pos;
+
+	MacroFlags flags;
+	char *const expanded = qv_expand_viewer(view, viewer, &flags);
+	vcache_prefetch(path, expanded, flags, VK_TEXTUAL, MAX_PREVIEW_LINES);
+	free(expanded);
+}
+
 FILE *
 qv_view_dir(const char path[], int max_lines)
 {
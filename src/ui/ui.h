@@ -33,8 +33,10 @@
 
 #include "../compat/fs_limits.h"
 #include "../compat/pthread.h"
+#include "../utils/dirpoll.h"
 #include "../utils/filter.h"
 #include "../utils/fswatch.h"
+#include "../utils/fswatch_set.h"
 #include "../utils/test_helpers.h"
 #include "../marks.h"
 #include "../status.h"
@@ -399,6 +401,13 @@ struct view_t
 
 	fswatch_t *watch;  /* Monitor that checks for directory changes. */
 	char *watched_dir; /* Path for which the monitor was created. */
+	/* Monitor of directories of a tree or NULL if it's not set up. */
+	fswatch_set_t *tree_watch;
+	/* Background monitor of a directory on a slow file system or NULL. */
+	dirpoll_t *slow_watch;
+
+	/* Reader of the rest of a huge directory in the background or NULL. */
+	struct dir_stream_t *dir_stream;
 
 	char *last_dir; /* Location visited by the view before the current one. */
 
@@ -457,6 +466,13 @@ struct view_t
 	/* Indicates that primary_group was initialized, which is used to avoid
 	 * freeing uninitialized data or freeing it twice. */
 	int primary_group_set;
+	/* Compiled regular expressions of all groups of either sort_groups or
+	 * sort_groups_g (whichever was used by sorting last). */
+	regex_t *sort_regexps;
+	/* Number of elements in sort_regexps array. */
+	int nsort_regexps;
+	/* Sorting groups from which sort_regexps were compiled or NULL. */
+	char *sort_regexps_src;
 
 	int history_num;    /* Number of used history elements. */
 	int history_pos;    /* Current position in history. */
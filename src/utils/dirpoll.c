@@ -0,0 +1,580 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "dirpoll.h"
+
+#include <sys/stat.h> /* fstatat() stat */
+#include <dirent.h> /* DIR dirent dirfd() */
+#include <fcntl.h> /* AT_SYMLINK_NOFOLLOW */
+
+#include <errno.h> /* ETIMEDOUT */
+#include <stddef.h> /* NULL */
+#include <stdlib.h> /* calloc() free() */
+#include <string.h> /* strcmp() strdup() */
+#include <time.h> /* CLOCK_MONOTONIC clock_gettime() timespec */
+
+#include "../compat/os.h"
+#include "../compat/pthread.h"
+#include "../compat/reallocarray.h"
+#include "fs.h"
+#include "macros.h"
+#include "path.h"
+#include "utils.h"
+
+/* Maximum factor by which polling period grows while nothing changes. */
+#define MAX_BACKOFF 8
+
+/* After this many files it's probably cheaper to assume that everything has
+ * changed. */
+#define MAX_CHANGES 512
+
+/* Information about a single file of a listing. */
+typedef struct
+{
+	char *name;    /* Name of the file. */
+	struct stat s; /* Result of lstat() on the file. */
+}
+file_t;
+
+/* Listing of a directory. */
+typedef struct
+{
+	file_t *files; /* Files sorted by name. */
+	int count;     /* Number of elements in files array. */
+}
+listing_t;
+
+/* Watcher data. */
+struct dirpoll_t
+{
+	pthread_mutex_t lock;      /* Protects fields up to the next comment. */
+	pthread_cond_t cond;       /* Wakes up the thread when it's cancelled. */
+	int refs;                  /* Number of owners (thread and the caller). */
+	int cancelled;             /* Caller is no longer interested in results. */
+	int changed;               /* Whether there are changes to report. */
+	fswatch_changes_t pending; /* Changes that weren't reported yet. */
+
+	/* Fields below are read-only after creation. */
+
+	char *path;   /* Path to the directory. */
+	int interval; /* Base period of polling in seconds. */
+};
+
+static void * poller_thread(void *arg);
+static int wait_for(dirpoll_t *p, long long ms);
+static int list_dir(const char path[], listing_t *listing);
+static int file_sorter(const void *first, const void *second);
+static void free_listing(listing_t *listing);
+static int compare_listings(dirpoll_t *p, const listing_t *old,
+		const listing_t *new);
+static int file_has_changed(const struct stat *old, const struct stat *new);
+static int post_change(dirpoll_t *p, const char name[], int existed,
+		const struct stat *s);
+static void examine_link(const char dir[], fswatch_change_t *change);
+static int add_change(fswatch_changes_t *changes, fswatch_change_t *change);
+static void post_failure(dirpoll_t *p);
+static void release_poller(dirpoll_t *p);
+static long long now_ms(void);
+
+/* Number of milliseconds in a unit of interval. */
+static int unit_ms = 1000;
+
+dirpoll_t *
+dirpoll_create(const char path[], int interval)
+{
+	dirpoll_t *const p = calloc(1, sizeof(*p));
+	if(p == NULL)
+	{
+		return NULL;
+	}
+
+	p->path = strdup(path);
+	if(p->path == NULL)
+	{
+		free(p);
+		return NULL;
+	}
+
+	if(pthread_mutex_init(&p->lock, NULL) != 0)
+	{
+		free(p->path);
+		free(p);
+		return NULL;
+	}
+
+	if(pthread_cond_init(&p->cond, NULL) != 0)
+	{
+		pthread_mutex_destroy(&p->lock);
+		free(p->path);
+		free(p);
+		return NULL;
+	}
+
+	p->interval = MAX(interval, 1);
+	p->refs = 2;
+	p->pending.complete = 1;
+
+	pthread_t id;
+	if(pthread_create(&id, NULL, &poller_thread, p) != 0)
+	{
+		pthread_cond_destroy(&p->cond);
+		pthread_mutex_destroy(&p->lock);
+		free(p->path);
+		free(p);
+		return NULL;
+	}
+	(void)pthread_detach(id);
+
+	return p;
+}
+
+void
+dirpoll_free(dirpoll_t *p)
+{
+	if(p == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&p->lock);
+	p->cancelled = 1;
+	pthread_cond_signal(&p->cond);
+	pthread_mutex_unlock(&p->lock);
+
+	release_poller(p);
+}
+
+int
+dirpoll_matches(const dirpoll_t *p, const char path[], int interval)
+{
+	return strcmp(p->path, path) == 0 && p->interval == MAX(interval, 1);
+}
+
+FSWatchState
+dirpoll_poll(dirpoll_t *p, fswatch_changes_t *changes)
+{
+	pthread_mutex_lock(&p->lock);
+
+	const int changed = p->changed;
+	if(changed)
+	{
+		*changes = p->pending;
+		p->pending.items = NULL;
+		p->pending.count = 0;
+		p->pending.complete = 1;
+		p->changed = 0;
+	}
+
+	pthread_mutex_unlock(&p->lock);
+
+	return (changed ? FSWS_UPDATED : FSWS_UNCHANGED);
+}
+
+/* Entry point of the thread that lists the directory.  Returns NULL. */
+static void *
+poller_thread(void *arg)
+{
+	dirpoll_t *const p = arg;
+
+	/* The listing is valid only while failed is zero. */
+	listing_t listing;
+	int failed = (list_dir(p->path, &listing) != 0);
+	long long delay = (long long)p->interval*unit_ms;
+
+	while(wait_for(p, delay) == 0)
+	{
+		const long long started_at = now_ms();
+
+		int changed;
+		listing_t new_listing;
+		if(list_dir(p->path, &new_listing) != 0)
+		{
+			/* Report a failure only once, reloading will notice the error. */
+			changed = !failed;
+			if(!failed)
+			{
+				free_listing(&listing);
+				post_failure(p);
+				failed = 1;
+			}
+		}
+		else if(failed)
+		{
+			/* Previous state is unknown. */
+			post_failure(p);
+			changed = 1;
+			listing = new_listing;
+			failed = 0;
+		}
+		else
+		{
+			changed = compare_listings(p, &listing, &new_listing);
+			free_listing(&listing);
+			listing = new_listing;
+		}
+
+		const long long base = (long long)p->interval*unit_ms;
+		delay = (changed ? base : MIN(delay*2, base*MAX_BACKOFF));
+
+		/* Don't let polling of a very slow file system take most of the time. */
+		delay = MAX(delay, 2*(now_ms() - started_at));
+	}
+
+	if(!failed)
+	{
+		free_listing(&listing);
+	}
+
+	release_poller(p);
+	return NULL;
+}
+
+/* Waits for the specified number of milliseconds or until the poller is
+ * cancelled.  Returns zero if it's time to poll and non-zero if the thread
+ * should quit. */
+static int
+wait_for(dirpoll_t *p, long long ms)
+{
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += ms/1000;
+	deadline.tv_nsec += (ms%1000)*1000000L;
+	if(deadline.tv_nsec >= 1000000000L)
+	{
+		++deadline.tv_sec;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	pthread_mutex_lock(&p->lock);
+	while(!p->cancelled)
+	{
+		if(pthread_cond_timedwait(&p->cond, &p->lock, &deadline) == ETIMEDOUT)
+		{
+			break;
+		}
+	}
+	const int cancelled = p->cancelled;
+	pthread_mutex_unlock(&p->lock);
+
+	return cancelled;
+}
+
+/* Reads contents of a directory along with information about its files.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+list_dir(const char path[], listing_t *listing)
+{
+	DIR *const dir = os_opendir(path);
+	if(dir == NULL)
+	{
+		return 1;
+	}
+
+	const int dir_fd = dirfd(dir);
+
+	listing->files = NULL;
+	listing->count = 0;
+
+	struct dirent *d;
+	while((d = os_readdir(dir)) != NULL)
+	{
+		if(is_builtin_dir(d->d_name))
+		{
+			continue;
+		}
+
+		file_t file;
+		if(fstatat(dir_fd, d->d_name, &file.s, AT_SYMLINK_NOFOLLOW) != 0)
+		{
+			/* The file must have been removed after it was listed. */
+			continue;
+		}
+
+		file.name = strdup(d->d_name);
+		file_t *const files = reallocarray(listing->files, listing->count + 1,
+				sizeof(*files));
+		if(file.name == NULL || files == NULL)
+		{
+			free(file.name);
+			if(files != NULL)
+			{
+				listing->files = files;
+			}
+			free_listing(listing);
+			os_closedir(dir);
+			return 1;
+		}
+
+		listing->files = files;
+		listing->files[listing->count++] = file;
+	}
+
+	os_closedir(dir);
+
+	safe_qsort(listing->files, listing->count, sizeof(*listing->files),
+			&file_sorter);
+	return 0;
+}
+
+/* qsort() comparer that sorts files by their names.  Returns standard -1, 0, 1
+ * for comparisons. */
+static int
+file_sorter(const void *first, const void *second)
+{
+	const file_t *a = first;
+	const file_t *b = second;
+	return strcmp(a->name, b->name);
+}
+
+/* Frees resources of a listing. */
+static void
+free_listing(listing_t *listing)
+{
+	int i;
+	for(i = 0; i < listing->count; ++i)
+	{
+		free(listing->files[i].name);
+	}
+	free(listing->files);
+
+	listing->files = NULL;
+	listing->count = 0;
+}
+
+/* Reports differences between two listings.  Returns non-zero if there were
+ * any, otherwise zero is returned. */
+static int
+compare_listings(dirpoll_t *p, const listing_t *old, const listing_t *new)
+{
+	int changed = 0;
+	int stop = 0;
+
+	int i = 0, j = 0;
+	while(!stop && (i < old->count || j < new->count))
+	{
+		const int cmp = (i == old->count) ? 1
+		              : (j == new->count) ? -1
+		              : strcmp(old->files[i].name, new->files[j].name);
+
+		if(cmp < 0)
+		{
+			stop = post_change(p, old->files[i].name, 1, NULL);
+			changed = 1;
+			++i;
+		}
+		else if(cmp > 0)
+		{
+			stop = post_change(p, new->files[j].name, 0, &new->files[j].s);
+			changed = 1;
+			++j;
+		}
+		else
+		{
+			if(file_has_changed(&old->files[i].s, &new->files[j].s))
+			{
+				stop = post_change(p, new->files[j].name, 1, &new->files[j].s);
+				changed = 1;
+			}
+			++i;
+			++j;
+		}
+	}
+
+	return changed;
+}
+
+/* Checks whether information about a file has changed in a way that's visible
+ * in a file list.  Returns non-zero if so, otherwise zero is returned. */
+static int
+file_has_changed(const struct stat *old, const struct stat *new)
+{
+	return old->st_size != new->st_size
+	    || old->st_mtime != new->st_mtime
+	    || old->st_ino != new->st_ino
+	    || old->st_mode != new->st_mode;
+}
+
+/* Makes change available to the caller.  s is NULL for removed files.  Targets
+ * of symbolic links are examined here, so that the caller doesn't need to
+ * access the file system.  Returns non-zero if there is no point in reporting
+ * more changes, otherwise zero is returned. */
+static int
+post_change(dirpoll_t *p, const char name[], int existed, const struct stat *s)
+{
+	fswatch_change_t change = {
+		.name = (char *)name,
+		.existed = existed,
+		.stated = 1,
+		.exists = (s != NULL),
+	};
+
+	if(s != NULL)
+	{
+		change.s = *s;
+		if(S_ISLNK(s->st_mode))
+		{
+			examine_link(p->path, &change);
+		}
+	}
+
+	pthread_mutex_lock(&p->lock);
+	p->changed = 1;
+	const int stop = (add_change(&p->pending, &change) != 0);
+	pthread_mutex_unlock(&p->lock);
+	return stop;
+}
+
+/* Reads target of a symbolic link and queries information about it. */
+static void
+examine_link(const char dir[], fswatch_change_t *change)
+{
+	char *const path = join_paths(dir, change->name);
+	if(path == NULL)
+	{
+		return;
+	}
+
+	char target[PATH_MAX + 1];
+	if(get_link_target_abs(path, dir, target, sizeof(target)) == 0)
+	{
+		change->target = strdup(target);
+	}
+	change->target_exists = (os_stat(path, &change->target_s) == 0);
+
+	free(path);
+}
+
+/* Adds change to a set merging it with previous change of the same file.  Takes
+ * ownership of change->target, but not of change->name.  Returns zero on
+ * success and non-zero if the set became incomplete. */
+static int
+add_change(fswatch_changes_t *changes, fswatch_change_t *change)
+{
+	if(!changes->complete)
+	{
+		free(change->target);
+		return 1;
+	}
+
+	fswatch_change_t *item = NULL;
+
+	int i;
+	for(i = 0; i < changes->count; ++i)
+	{
+		if(strcmp(changes->items[i].name, change->name) == 0)
+		{
+			item = &changes->items[i];
+			break;
+		}
+	}
+
+	if(item == NULL)
+	{
+		if(changes->count == MAX_CHANGES)
+		{
+			free(change->target);
+			fswatch_changes_free(changes);
+			changes->complete = 0;
+			return 1;
+		}
+
+		char *const name_copy = strdup(change->name);
+		fswatch_change_t *const items = reallocarray(changes->items,
+				changes->count + 1, sizeof(*items));
+		if(items != NULL)
+		{
+			changes->items = items;
+		}
+		if(name_copy == NULL || items == NULL)
+		{
+			free(name_copy);
+			free(change->target);
+			fswatch_changes_free(changes);
+			changes->complete = 0;
+			return 1;
+		}
+
+		item = &changes->items[changes->count++];
+		*item = *change;
+		item->name = name_copy;
+		return 0;
+	}
+
+	/* Keep the state before the first change. */
+	const int existed = item->existed;
+	char *const name = item->name;
+	free(item->target);
+
+	*item = *change;
+	item->name = name;
+	item->existed = existed;
+	return 0;
+}
+
+/* Reports that contents of the directory is unknown. */
+static void
+post_failure(dirpoll_t *p)
+{
+	pthread_mutex_lock(&p->lock);
+	fswatch_changes_free(&p->pending);
+	p->pending.complete = 0;
+	p->changed = 1;
+	pthread_mutex_unlock(&p->lock);
+}
+
+/* Drops a reference to the poller freeing it if it was the last one. */
+static void
+release_poller(dirpoll_t *p)
+{
+	pthread_mutex_lock(&p->lock);
+	const int last = (--p->refs == 0);
+	pthread_mutex_unlock(&p->lock);
+
+	if(!last)
+	{
+		return;
+	}
+
+	fswatch_changes_free(&p->pending);
+	free(p->path);
+	pthread_cond_destroy(&p->cond);
+	pthread_mutex_destroy(&p->lock);
+	free(p);
+}
+
+/* Retrieves current value of a monotonic clock.  Returns the value in
+ * milliseconds. */
+static long long
+now_ms(void)
+{
+	struct timespec ts;
+	if(clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+	{
+		return 0;
+	}
+	return (long long)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+TSTATIC void
+dirpoll_set_unit(int ms)
+{
+	unit_ms = ms;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,60 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__DIRPOLL_H__
+#define VIFM__UTILS__DIRPOLL_H__
+
+/* Watcher of a directory that periodically lists it in a background thread and
+ * compares name, size, modification time, inode number and mode of its files
+ * with the previous listing.  Meant for file systems on which querying this
+ * information can take long time, so it never blocks the caller.  The period
+ * grows up to eight times while directory stays unchanged and is reset on a
+ * change. */
+
+#include "fswatch.h"
+#include "test_helpers.h"
+
+/* Opaque type of a watcher. */
+typedef struct dirpoll_t dirpoll_t;
+
+/* Starts watching the path by listing it every interval seconds.  Returns the
+ * watcher or NULL on error. */
+dirpoll_t * dirpoll_create(const char path[], int interval);
+
+/* Stops the watcher.  Doesn't wait for the thread to finish.  p can be
+ * NULL. */
+void dirpoll_free(dirpoll_t *p);
+
+/* Checks whether the watcher was created with the specified parameters.
+ * Returns non-zero if so, otherwise zero is returned. */
+int dirpoll_matches(const dirpoll_t *p, const char path[], int interval);
+
+/* Retrieves changes found since the last query.  *changes should be
+ * initialized with zeroes and be freed by fswatch_changes_free() regardless of
+ * the result.  Elements of the set have stat information filled in.  Returns
+ * FSWS_UPDATED or FSWS_UNCHANGED. */
+FSWatchState dirpoll_poll(dirpoll_t *p, fswatch_changes_t *changes);
+
+TSTATIC_DEFS(
+	void dirpoll_set_unit(int ms);
+)
+
+#endif /* VIFM__UTILS__DIRPOLL_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -67,6 +67,8 @@ static int resolve_path(const fsdata_t *fsd, const char path[],
 		char real_path[]);
 static int traverse_node(node_t *node, const node_t *parent,
 		fsdata_traverser_func traverser, void *arg);
+static int list_node(node_t *node, char path[], size_t len,
+		fsdata_list_func func, void *arg);
 
 fsdata_t *
 fsdata_create(int prefix, int resolve_paths)
@@ -131,14 +133,21 @@ nodes_free(node_t *node, fsd_cleanup_func cleanup)
 int
 fsdata_set(fsdata_t *fsd, const char path[], const void *data, size_t len)
 {
-	node_t *node;
 	char real_path[PATH_MAX + 1];
-
 	if(resolve_path(fsd, path, real_path) != 0)
 	{
 		return -1;
 	}
 
+	return fsdata_set_resolved(fsd, real_path, data, len);
+}
+
+int
+fsdata_set_resolved(fsdata_t *fsd, const char path[], const void *data,
+		size_t len)
+{
+	node_t *node;
+
 	/* Create root node lazily, when we know data size. */
 	if(fsd->root == NULL)
 	{
@@ -149,7 +158,7 @@ fsdata_set(fsdata_t *fsd, const char path[], const void *data, size_t len)
 		}
 	}
 
-	node = get_or_create_node(fsd->root, real_path, len, NULL, &fsd->root);
+	node = get_or_create_node(fsd->root, path, len, NULL, &fsd->root);
 	if(node == NULL)
 	{
 		return -1;
@@ -168,9 +177,6 @@ fsdata_set(fsdata_t *fsd, const char path[], const void *data, size_t len)
 int
 fsdata_get(fsdata_t *fsd, const char path[], void *data, size_t len)
 {
-	node_t *last = NULL;
-	node_t *node;
-	const void *src;
 	char real_path[PATH_MAX + 1];
 
 	if(fsd->root == NULL)
@@ -183,7 +189,22 @@ fsdata_get(fsdata_t *fsd, const char path[], void *data, size_t len)
 		return -1;
 	}
 
-	node = get_or_create_node(fsd->root, real_path, NO_CREATE,
+	return fsdata_get_resolved(fsd, real_path, data, len);
+}
+
+int
+fsdata_get_resolved(fsdata_t *fsd, const char path[], void *data, size_t len)
+{
+	node_t *last = NULL;
+	node_t *node;
+	const void *src;
+
+	if(fsd->root == NULL)
+	{
+		return -1;
+	}
+
+	node = get_or_create_node(fsd->root, path, NO_CREATE,
 			fsd->prefix ? &last : NULL, NULL);
 	if((node == NULL || !node->valid) && last == NULL)
 	{
@@ -414,5 +435,70 @@ traverse_node(node_t *node, const node_t *parent,
 	return 0;
 }
 
+int
+fsdata_list(fsdata_t *fsd, fsdata_list_func func, void *arg)
+{
+	char path[PATH_MAX + 1];
+	node_t *node;
+
+	if(fsd->root == NULL)
+	{
+		return 0;
+	}
+
+	if(fsd->root->valid && func("/", &fsd->root->data, arg) != 0)
+	{
+		return 1;
+	}
+
+	for(node = fsd->root->child; node != NULL; node = node->next)
+	{
+		/* Windows paths start with a drive letter rather than with a slash. */
+#ifndef _WIN32
+		path[0] = '/';
+		if(list_node(node, path, 1U, func, arg) != 0)
+#else
+		if(list_node(node, path, 0U, func, arg) != 0)
+#endif
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* fsdata_list() helper which works with node_t type.  The path buffer holds
+ * len characters of path to the parent node.  Return non-zero if listing was
+ * stopped prematurely, otherwise zero is returned. */
+static int
+list_node(node_t *node, char path[], size_t len, fsdata_list_func func,
+		void *arg)
+{
+	if(len + node->name_len + 1U > PATH_MAX)
+	{
+		/* Too long path, skip the subtree. */
+		return 0;
+	}
+
+	memcpy(path + len, node->name, node->name_len);
+	len += node->name_len;
+	path[len] = '\0';
+
+	if(node->valid && func(path, &node->data, arg) != 0)
+	{
+		return 1;
+	}
+
+	path[len++] = '/';
+	for(node = node->child; node != NULL; node = node->next)
+	{
+		if(list_node(node, path, len, func, arg) != 0)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
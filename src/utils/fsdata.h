@@ -34,6 +34,10 @@ typedef struct fsdata_t fsdata_t;
 typedef int (*fsdata_traverser_func)(const char name[], int valid,
 		const void *parent_data, void *data, void *arg);
 
+/* Type of callback for fsdata_list().  Should return non-zero to stop
+ * listing. */
+typedef int (*fsdata_list_func)(const char path[], void *data, void *arg);
+
 /* Type of callback for fsdata_map_parents(). */
 typedef void (*fsdata_visit_func)(void *data, void *arg);
 
@@ -54,6 +58,15 @@ int fsdata_set(fsdata_t *fsd, const char path[], const void *data, size_t len);
  * success and non-zero on error. */
 int fsdata_get(fsdata_t *fsd, const char path[], void *data, size_t len);
 
+/* Same as fsdata_set(), but the path is assumed to be already resolved (e.g.,
+ * it was reported by fsdata_list()), so it's not looked up in file system. */
+int fsdata_set_resolved(fsdata_t *fsd, const char path[], const void *data,
+		size_t len);
+
+/* Same as fsdata_get(), but the path is assumed to be already resolved. */
+int fsdata_get_resolved(fsdata_t *fsd, const char path[], void *data,
+		size_t len);
+
 /* Invokes visitor once per valid parent node of specified path.  Returns zero
  * on success or non-zero if path wasn't found. */
 int fsdata_map_parents(fsdata_t *fsd, const char path[],
@@ -63,6 +76,10 @@ int fsdata_map_parents(fsdata_t *fsd, const char path[],
  * prematurely, otherwise zero is returned. */
 int fsdata_traverse(fsdata_t *fsd, fsdata_traverser_func traverser, void *arg);
 
+/* Calls the callback for each valid node passing full path to it.  Return
+ * non-zero if listing was stopped prematurely, otherwise zero is returned. */
+int fsdata_list(fsdata_t *fsd, fsdata_list_func func, void *arg);
+
 #endif /* VIFM__UTILS__FSDATA_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -21,6 +21,8 @@
 
 /* Implementation of file system changes checks via polling. */
 
+#include <sys/stat.h> /* stat */
+
 /* Kinds of state reports. */
 typedef enum
 {
@@ -34,6 +36,35 @@ FSWatchState;
 /* Opaque type of a watcher. */
 typedef struct fswatch_t fswatch_t;
 
+/* Change of a file inside of the watched directory. */
+typedef struct
+{
+	char *name;    /* Name of the file. */
+	int existed;   /* Whether the file existed before the change. */
+	int stated;    /* Whether producer of the change has examined the file, in
+	                  which case fields below are set. */
+	int exists;    /* Whether the file exists after the change. */
+	struct stat s; /* Result of lstat() for the file if it exists. */
+
+	/* Fields below are set for symbolic links. */
+
+	char *target;         /* Absolute path to target of the link or NULL if it
+	                         couldn't be read. */
+	int target_exists;    /* Whether target of the link exists. */
+	struct stat target_s; /* Result of stat() for the file if target exists. */
+}
+fswatch_change_t;
+
+/* Set of changes of files inside of the watched directory. */
+typedef struct
+{
+	fswatch_change_t *items; /* List of changes, at most one per file. */
+	int count;               /* Number of elements in items array. */
+	int complete;            /* Whether the list describes all of the changes.
+	                            If not, everything should be assumed changed. */
+}
+fswatch_changes_t;
+
 /* Creates new watcher for the specified path.  Returns the watcher or NULL on
  * error. */
 fswatch_t * fswatch_create(const char path[]);
@@ -45,6 +76,14 @@ void fswatch_free(fswatch_t *w);
  * query.  Returns latest state. */
 FSWatchState fswatch_poll(fswatch_t *w);
 
+/* Same as fswatch_poll(), but also describes what has changed if the result is
+ * FSWS_UPDATED.  *changes should be initialized with zeroes and be freed by
+ * fswatch_changes_free() regardless of the result. */
+FSWatchState fswatch_poll_changes(fswatch_t *w, fswatch_changes_t *changes);
+
+/* Frees resources of the set of changes and empties it. */
+void fswatch_changes_free(fswatch_changes_t *changes);
+
 #endif /* VIFM__UTILS__FSWATCH_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -30,11 +30,12 @@
 #include <stddef.h> /* NULL */
 #include <stdint.h> /* uint32_t */
 #include <stdlib.h> /* free() */
-#include <string.h> /* strdup() */
+#include <string.h> /* strcmp() strdup() */
 #include <time.h> /* time_t time() */
 
 #include "../compat/fs_limits.h"
 #include "../compat/os.h"
+#include "../compat/reallocarray.h"
 #include "trie.h"
 
 /* TODO: consider implementation that could reuse already available descriptor
@@ -70,6 +71,8 @@ notif_stat_t;
 static FSWatchState poll_for_replacement(fswatch_t *w);
 static int update_file_stats(fswatch_t *w, const struct inotify_event *e,
 		time_t now);
+static void record_change(fswatch_changes_t *changes,
+		const struct inotify_event *e);
 
 /* Events we're interested in. */
 static const uint32_t EVENTS_MASK = IN_ATTRIB | IN_MODIFY | IN_CLOSE_WRITE
@@ -146,6 +149,12 @@ fswatch_free(fswatch_t *w)
 
 FSWatchState
 fswatch_poll(fswatch_t *w)
+{
+	return fswatch_poll_changes(w, NULL);
+}
+
+FSWatchState
+fswatch_poll_changes(fswatch_t *w, fswatch_changes_t *changes)
 {
 	enum { MAX_READS = 100 };
 	enum { BUF_LEN = (10 * (sizeof(struct inotify_event) + NAME_MAX + 1)) };
@@ -156,6 +165,11 @@ fswatch_poll(fswatch_t *w)
 	int nreads = 0;
 	const time_t now = time(NULL);
 
+	if(changes != NULL)
+	{
+		changes->complete = 1;
+	}
+
 	do
 	{
 		char *p;
@@ -181,9 +195,24 @@ fswatch_poll(fswatch_t *w)
 				return poll_for_replacement(w);
 			}
 
+			if((e->mask & IN_Q_OVERFLOW) != 0)
+			{
+				/* Some events were lost, so nothing is known for sure. */
+				changed = 1;
+				if(changes != NULL)
+				{
+					changes->complete = 0;
+				}
+				continue;
+			}
+
 			if((e->mask & EVENTS_MASK) != 0 && update_file_stats(w, e, now))
 			{
 				changed = 1;
+				if(changes != NULL)
+				{
+					record_change(changes, e);
+				}
 			}
 		}
 
@@ -298,6 +327,58 @@ update_file_stats(fswatch_t *w, const struct inotify_event *e, time_t now)
 	return 1;
 }
 
+/* Adds file of the event to the set of changes unless it's already there. */
+static void
+record_change(fswatch_changes_t *changes, const struct inotify_event *e)
+{
+	/* After this many files it's probably cheaper to assume that everything has
+	 * changed. */
+	enum { MAX_CHANGES = 512 };
+
+	if(!changes->complete)
+	{
+		return;
+	}
+
+	/* Event is about the directory itself. */
+	if(e->len == 0U || changes->count == MAX_CHANGES)
+	{
+		changes->complete = 0;
+		return;
+	}
+
+	int i;
+	for(i = 0; i < changes->count; ++i)
+	{
+		if(strcmp(changes->items[i].name, e->name) == 0)
+		{
+			return;
+		}
+	}
+
+	fswatch_change_t *const items = reallocarray(changes->items,
+			changes->count + 1, sizeof(*items));
+	char *const name = strdup(e->name);
+	if(items == NULL || name == NULL)
+	{
+		if(items != NULL)
+		{
+			changes->items = items;
+		}
+		free(name);
+		changes->complete = 0;
+		return;
+	}
+
+	changes->items = items;
+	changes->items[changes->count].name = name;
+	changes->items[changes->count].existed =
+		((e->mask & (IN_CREATE | IN_MOVED_TO)) == 0);
+	changes->items[changes->count].stated = 0;
+	changes->items[changes->count].target = NULL;
+	++changes->count;
+}
+
 #else
 
 #include "filemon.h"
@@ -349,6 +430,18 @@ fswatch_free(fswatch_t *w)
 FSWatchState
 fswatch_poll(fswatch_t *w)
 {
+	return fswatch_poll_changes(w, NULL);
+}
+
+FSWatchState
+fswatch_poll_changes(fswatch_t *w, fswatch_changes_t *changes)
+{
+	/* Names of changed files aren't known. */
+	if(changes != NULL)
+	{
+		changes->complete = 0;
+	}
+
 	filemon_t filemon;
 	if(filemon_from_file(w->path, FMT_MODIFIED, &filemon) != 0)
 	{
@@ -364,5 +457,20 @@ fswatch_poll(fswatch_t *w)
 
 #endif
 
+void
+fswatch_changes_free(fswatch_changes_t *changes)
+{
+	int i;
+	for(i = 0; i < changes->count; ++i)
+	{
+		free(changes->items[i].name);
+		free(changes->items[i].target);
+	}
+	free(changes->items);
+
+	changes->items = NULL;
+	changes->count = 0;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,295 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "fswatch_set.h"
+
+#ifdef HAVE_INOTIFY
+#include <sys/inotify.h> /* IN_* inotify_* */
+#include <unistd.h> /* close() read() */
+#endif
+#include <sys/stat.h> /* stat */
+
+#include <errno.h> /* ENOSPC errno */
+#include <stddef.h> /* NULL */
+#include <stdint.h> /* uint32_t */
+#include <stdio.h> /* FILE fclose() fopen() fscanf() */
+#include <stdlib.h> /* free() malloc() */
+#include <string.h> /* strdup() */
+#include <time.h> /* time_t */
+
+#include "../compat/fs_limits.h"
+#include "../compat/os.h"
+#include "../compat/reallocarray.h"
+
+/* Directory whose changes are detected by polling. */
+typedef struct
+{
+	char *path;   /* Path to the directory. */
+	time_t mtime; /* Last seen modification time, (time_t)-1 if unknown. */
+}
+polled_dir_t;
+
+/* Watcher data. */
+struct fswatch_set_t
+{
+	int fd;               /* File descriptor for inotify or -1. */
+	int nwatches;         /* Number of inotify watches added to fd. */
+	polled_dir_t *polled; /* Directories that are polled. */
+	int npolled;          /* Number of elements in polled array. */
+};
+
+static int add_polled(fswatch_set_t *s, const char path[]);
+static int poll_events(fswatch_set_t *s);
+static int poll_polled(fswatch_set_t *s);
+static time_t get_mtime(const char path[]);
+#ifdef HAVE_INOTIFY
+static int get_limit(void);
+
+/* Events which correspond to changes of modification time of a directory. */
+static const uint32_t EVENTS_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM
+                                  | IN_MOVED_TO;
+#endif
+
+/* Maximum number of inotify watches all watchers can use, negative value means
+ * that it's not determined yet. */
+static int limit = -1;
+/* Number of inotify watches used by all watchers. */
+static int nwatches_total;
+
+fswatch_set_t *
+fswatch_set_create(void)
+{
+	fswatch_set_t *const s = malloc(sizeof(*s));
+	if(s == NULL)
+	{
+		return NULL;
+	}
+
+#ifdef HAVE_INOTIFY
+	/* Failure isn't fatal, all directories will be polled in this case. */
+	s->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#else
+	s->fd = -1;
+#endif
+	s->nwatches = 0;
+	s->polled = NULL;
+	s->npolled = 0;
+	return s;
+}
+
+void
+fswatch_set_free(fswatch_set_t *s)
+{
+	if(s == NULL)
+	{
+		return;
+	}
+
+#ifdef HAVE_INOTIFY
+	if(s->fd != -1)
+	{
+		/* This also removes all watches. */
+		close(s->fd);
+	}
+#endif
+	nwatches_total -= s->nwatches;
+
+	int i;
+	for(i = 0; i < s->npolled; ++i)
+	{
+		free(s->polled[i].path);
+	}
+	free(s->polled);
+	free(s);
+}
+
+int
+fswatch_set_add(fswatch_set_t *s, const char path[])
+{
+#ifdef HAVE_INOTIFY
+	if(s->fd != -1 && nwatches_total < get_limit())
+	{
+		const int wd = inotify_add_watch(s->fd, path, EVENTS_MASK | IN_ONLYDIR);
+		if(wd != -1)
+		{
+			++s->nwatches;
+			++nwatches_total;
+			return 0;
+		}
+
+		if(errno == ENOSPC)
+		{
+			/* Don't try to go over system limit again, it's lower than we thought
+			 * (e.g., because other applications use watches as well). */
+			limit = nwatches_total;
+		}
+	}
+#endif
+
+	return add_polled(s, path);
+}
+
+/* Adds directory to the list of polled ones.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+add_polled(fswatch_set_t *s, const char path[])
+{
+	polled_dir_t *const polled = reallocarray(s->polled, s->npolled + 1,
+			sizeof(*polled));
+	if(polled == NULL)
+	{
+		return 1;
+	}
+	s->polled = polled;
+
+	char *const path_copy = strdup(path);
+	if(path_copy == NULL)
+	{
+		return 1;
+	}
+
+	s->polled[s->npolled].path = path_copy;
+	s->polled[s->npolled].mtime = get_mtime(path);
+	++s->npolled;
+	return 0;
+}
+
+FSWatchState
+fswatch_set_poll(fswatch_set_t *s)
+{
+	/* Both functions need to be called to drain events or update modification
+	 * times. */
+	const int events = poll_events(s);
+	const int polled = poll_polled(s);
+	return (events || polled) ? FSWS_UPDATED : FSWS_UNCHANGED;
+}
+
+/* Reads all pending inotify events.  Returns non-zero if there were any,
+ * otherwise zero is returned. */
+static int
+poll_events(fswatch_set_t *s)
+{
+#ifdef HAVE_INOTIFY
+	enum { MAX_READS = 100 };
+	enum { BUF_LEN = (10 * (sizeof(struct inotify_event) + NAME_MAX + 1)) };
+
+	if(s->fd == -1)
+	{
+		return 0;
+	}
+
+	/* Any event means that something has changed, including IN_IGNORED (watched
+	 * directory was removed or unmounted) and IN_Q_OVERFLOW (some events were
+	 * lost), so there is no need to look at them. */
+	char buf[BUF_LEN];
+	int changed = 0;
+	int nreads = 0;
+	while(nreads++ < MAX_READS)
+	{
+		const int nread = read(s->fd, buf, BUF_LEN);
+		if(nread <= 0)
+		{
+			/* Even on error, nothing better than reporting a change can be done. */
+			changed |= (nread < 0 && errno != EAGAIN);
+			break;
+		}
+		changed = 1;
+	}
+	return changed;
+#else
+	(void)s;
+	return 0;
+#endif
+}
+
+/* Checks modification times of polled directories.  Returns non-zero if any of
+ * them has changed, otherwise zero is returned. */
+static int
+poll_polled(fswatch_set_t *s)
+{
+	int changed = 0;
+
+	int i;
+	for(i = 0; i < s->npolled; ++i)
+	{
+		const time_t mtime = get_mtime(s->polled[i].path);
+		if(mtime == (time_t)-1 || mtime != s->polled[i].mtime)
+		{
+			s->polled[i].mtime = mtime;
+			changed = 1;
+		}
+	}
+
+	return changed;
+}
+
+/* Queries modification time of a file.  Returns the time or (time_t)-1 on
+ * error. */
+static time_t
+get_mtime(const char path[])
+{
+	struct stat st;
+	return (os_stat(path, &st) == 0 ? st.st_mtime : (time_t)-1);
+}
+
+int
+fswatch_set_polled(const fswatch_set_t *s)
+{
+	return s->npolled;
+}
+
+#ifdef HAVE_INOTIFY
+
+/* Determines how many inotify watches can be used by this process.  Returns the
+ * limit. */
+static int
+get_limit(void)
+{
+	if(limit >= 0)
+	{
+		return limit;
+	}
+
+	/* Default value of the limit on systems with little memory. */
+	int max_user_watches = 8192;
+
+	FILE *const fp = fopen("/proc/sys/fs/inotify/max_user_watches", "r");
+	if(fp != NULL)
+	{
+		if(fscanf(fp, "%d", &max_user_watches) != 1)
+		{
+			max_user_watches = 8192;
+		}
+		fclose(fp);
+	}
+
+	/* The limit is per user, so leave half of it to other applications. */
+	limit = max_user_watches/2;
+	return limit;
+}
+
+#endif
+
+TSTATIC void
+fswatch_set_limit(int new_limit)
+{
+	limit = new_limit;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,60 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__FSWATCH_SET_H__
+#define VIFM__UTILS__FSWATCH_SET_H__
+
+/* Watcher of lists of entries of many directories at once.  Unlike fswatch
+ * this reports only creation, removal and renaming of files, which is the same
+ * set of changes that updates modification time of a directory.  Directories
+ * are watched via inotify where it's available and while system limit on number
+ * of watches allows it, the rest is checked by polling their modification
+ * time. */
+
+#include "fswatch.h"
+#include "test_helpers.h"
+
+/* Opaque type of a watcher. */
+typedef struct fswatch_set_t fswatch_set_t;
+
+/* Creates new empty watcher.  Returns the watcher or NULL on error. */
+fswatch_set_t * fswatch_set_create(void);
+
+/* Frees a watcher.  s can be NULL. */
+void fswatch_set_free(fswatch_set_t *s);
+
+/* Starts watching a directory.  Returns zero on success, otherwise non-zero is
+ * returned. */
+int fswatch_set_add(fswatch_set_t *s, const char path[]);
+
+/* Checks whether list of files of any of the directories has changed since the
+ * last query.  Returns FSWS_UPDATED or FSWS_UNCHANGED. */
+FSWatchState fswatch_set_poll(fswatch_set_t *s);
+
+/* Retrieves number of directories which are checked by polling.  Returns the
+ * number. */
+int fswatch_set_polled(const fswatch_set_t *s);
+
+TSTATIC_DEFS(
+	void fswatch_set_limit(int limit);
+)
+
+#endif /* VIFM__UTILS__FSWATCH_SET_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
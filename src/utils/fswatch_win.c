@@ -89,6 +89,18 @@ fswatch_free(fswatch_t *w)
 FSWatchState
 fswatch_poll(fswatch_t *w)
 {
+	return fswatch_poll_changes(w, NULL);
+}
+
+FSWatchState
+fswatch_poll_changes(fswatch_t *w, fswatch_changes_t *changes)
+{
+	/* Names of changed files aren't known. */
+	if(changes != NULL)
+	{
+		changes->complete = 0;
+	}
+
 	FILETIME ft;
 	if(get_dir_mtime(w->wpath, &ft) != 0)
 	{
@@ -107,6 +119,13 @@ fswatch_poll(fswatch_t *w)
 	return (changed ? FSWS_UPDATED : FSWS_UNCHANGED);
 }
 
+void
+fswatch_changes_free(fswatch_changes_t *changes)
+{
+	/* Changes are never collected here. */
+	(void)changes;
+}
+
 /* Gets last directory modification time.  Returns non-zero on error, otherwise
  * zero is returned. */
 static int
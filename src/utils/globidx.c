@@ -0,0 +1,351 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "globidx.h"
+
+#include <ctype.h> /* tolower() */
+#include <limits.h> /* INT_MAX */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uintptr_t */
+#include <stdlib.h> /* calloc() free() */
+#include <string.h> /* memmove() strchr() strcpy() strlen() */
+
+#include "../compat/fs_limits.h"
+#include "../compat/reallocarray.h"
+#include "trie.h"
+
+/*
+ * Literal names and suffixes are converted to lower case and stored in two
+ * tries.  Each key of a trie refers to a list of numbers of globs with that
+ * key.  A name is looked up as a whole in the first trie and by its suffixes of
+ * every length that occurs among the globs in the second one.  Lists of numbers
+ * of found keys are then merged.  Empty suffix ("*" glob) can't be a key of a
+ * trie and is handled separately.
+ */
+
+/* Maximum number of keys that can match a single name. */
+#define MAX_HITS 64
+
+/* List of numbers of globs that share a key. */
+typedef struct
+{
+	int *ids;  /* Numbers in ascending order. */
+	int count; /* Number of elements in ids. */
+}
+id_list_t;
+
+/* Index of simple globs. */
+struct globidx_t
+{
+	trie_t *names;        /* Literal names -> indexes of lists. */
+	trie_t *suffixes;     /* Suffixes of "*suffix" globs -> indexes of lists. */
+	id_list_t *lists;     /* Lists of numbers of globs. */
+	int list_count;       /* Number of elements in lists. */
+	id_list_t any;        /* Numbers of "*" globs. */
+	int *suffix_lens;     /* Distinct lengths of suffixes in ascending order. */
+	int suffix_len_count; /* Number of elements in suffix_lens. */
+};
+
+static int add_id(globidx_t *idx, trie_t *trie, const char key[], int id);
+static int append_id(id_list_t *list, int id);
+static int add_suffix_len(globidx_t *idx, int len);
+static int lookup(const globidx_t *idx, trie_t *trie, const char key[],
+		const id_list_t *hits[], int *nhits);
+static void merge_hits(const id_list_t *hits[], int nhits,
+		globidx_visitor_t visitor, void *arg);
+static void fold_case(char str[]);
+
+globidx_t *
+globidx_create(void)
+{
+	globidx_t *const idx = calloc(1, sizeof(*idx));
+	if(idx == NULL)
+	{
+		return NULL;
+	}
+
+	idx->names = trie_create(NULL);
+	idx->suffixes = trie_create(NULL);
+	if(idx->names == NULL || idx->suffixes == NULL)
+	{
+		globidx_free(idx);
+		return NULL;
+	}
+
+	return idx;
+}
+
+void
+globidx_free(globidx_t *idx)
+{
+	if(idx == NULL)
+	{
+		return;
+	}
+
+	int i;
+	for(i = 0; i < idx->list_count; ++i)
+	{
+		free(idx->lists[i].ids);
+	}
+	free(idx->lists);
+	free(idx->any.ids);
+
+	trie_free(idx->names);
+	trie_free(idx->suffixes);
+	free(idx->suffix_lens);
+	free(idx);
+}
+
+int
+globidx_add(globidx_t *idx, const char glob[], int id)
+{
+	const int suffix = (glob[0] == '*');
+	const char *const key = suffix ? glob + 1 : glob;
+
+	const size_t len = strlen(key);
+	if(len > NAME_MAX || strchr(key, '*') != NULL)
+	{
+		return 1;
+	}
+
+	if(len == 0U)
+	{
+		/* Literals can't be empty. */
+		return (suffix ? append_id(&idx->any, id) : 1);
+	}
+
+	char folded[NAME_MAX + 1];
+	strcpy(folded, key);
+	fold_case(folded);
+
+	if(add_id(idx, suffix ? idx->suffixes : idx->names, folded, id) != 0)
+	{
+		return 1;
+	}
+
+	return (suffix ? add_suffix_len(idx, len) : 0);
+}
+
+/* Appends a number to the list of a key creating the list if necessary.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+add_id(globidx_t *idx, trie_t *trie, const char key[], int id)
+{
+	void *data;
+	if(trie_get(trie, key, &data) != 0)
+	{
+		id_list_t *const lists = reallocarray(idx->lists, idx->list_count + 1,
+				sizeof(*lists));
+		if(lists == NULL)
+		{
+			return 1;
+		}
+		idx->lists = lists;
+
+		data = (void *)(uintptr_t)idx->list_count;
+		if(trie_set(trie, key, data) < 0)
+		{
+			return 1;
+		}
+
+		lists[idx->list_count].ids = NULL;
+		lists[idx->list_count].count = 0;
+		++idx->list_count;
+	}
+
+	return append_id(&idx->lists[(uintptr_t)data], id);
+}
+
+/* Appends a number to a list unless it's already there.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+append_id(id_list_t *list, int id)
+{
+	if(list->count != 0 && list->ids[list->count - 1] >= id)
+	{
+		/* Can't be smaller, so it's the same number. */
+		return 0;
+	}
+
+	int *const ids = reallocarray(list->ids, list->count + 1, sizeof(*ids));
+	if(ids == NULL)
+	{
+		return 1;
+	}
+	list->ids = ids;
+	list->ids[list->count++] = id;
+	return 0;
+}
+
+/* Adds length of a suffix to the sorted list of lengths if it's not there yet.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+add_suffix_len(globidx_t *idx, int len)
+{
+	int i;
+	for(i = 0; i < idx->suffix_len_count && idx->suffix_lens[i] <= len; ++i)
+	{
+		if(idx->suffix_lens[i] == len)
+		{
+			return 0;
+		}
+	}
+
+	int *const lens = reallocarray(idx->suffix_lens, idx->suffix_len_count + 1,
+			sizeof(*lens));
+	if(lens == NULL)
+	{
+		return 1;
+	}
+	idx->suffix_lens = lens;
+
+	memmove(&lens[i + 1], &lens[i], sizeof(*lens)*(idx->suffix_len_count - i));
+	lens[i] = len;
+	++idx->suffix_len_count;
+	return 0;
+}
+
+int
+globidx_find(const globidx_t *idx, const char name[],
+		globidx_visitor_t visitor, void *arg)
+{
+	const size_t len = strlen(name);
+
+	char folded[NAME_MAX + 2];
+	if(len >= sizeof(folded))
+	{
+		return 1;
+	}
+	strcpy(folded, name);
+	fold_case(folded);
+
+	const id_list_t *hits[MAX_HITS];
+	int nhits = 0;
+
+	if(lookup(idx, idx->names, folded, hits, &nhits) != 0)
+	{
+		return 1;
+	}
+
+	/* "*suffix" globs don't match dot files and need at least one character in
+	 * front of the suffix. */
+	if(name[0] != '.' && len != 0U)
+	{
+		if(idx->any.count != 0)
+		{
+			hits[nhits++] = &idx->any;
+		}
+
+		int i;
+		for(i = 0; i < idx->suffix_len_count; ++i)
+		{
+			const size_t suffix_len = idx->suffix_lens[i];
+			if(suffix_len >= len)
+			{
+				break;
+			}
+
+			if(lookup(idx, idx->suffixes, &folded[len - suffix_len], hits,
+						&nhits) != 0)
+			{
+				return 1;
+			}
+		}
+	}
+
+	merge_hits(hits, nhits, visitor, arg);
+	return 0;
+}
+
+/* Looks up a key and appends its list to hits on success.  Returns zero on
+ * success or when there is no such key and non-zero if there are too many
+ * hits. */
+static int
+lookup(const globidx_t *idx, trie_t *trie, const char key[],
+		const id_list_t *hits[], int *nhits)
+{
+	void *data;
+	if(trie_get(trie, key, &data) != 0)
+	{
+		return 0;
+	}
+
+	if(*nhits == MAX_HITS)
+	{
+		return 1;
+	}
+
+	hits[(*nhits)++] = &idx->lists[(uintptr_t)data];
+	return 0;
+}
+
+/* Visits numbers of sorted lists in ascending order.  Numbers that are present
+ * in several lists are visited once. */
+static void
+merge_hits(const id_list_t *hits[], int nhits, globidx_visitor_t visitor,
+		void *arg)
+{
+	int pos[MAX_HITS] = {};
+
+	while(1)
+	{
+		int min = INT_MAX;
+		int i;
+		for(i = 0; i < nhits; ++i)
+		{
+			if(pos[i] < hits[i]->count && hits[i]->ids[pos[i]] < min)
+			{
+				min = hits[i]->ids[pos[i]];
+			}
+		}
+
+		if(min == INT_MAX)
+		{
+			break;
+		}
+
+		for(i = 0; i < nhits; ++i)
+		{
+			if(pos[i] < hits[i]->count && hits[i]->ids[pos[i]] == min)
+			{
+				++pos[i];
+			}
+		}
+
+		if(visitor(min, arg))
+		{
+			break;
+		}
+	}
+}
+
+/* Converts string to lower case byte by byte the way strcasecmp() compares
+ * strings. */
+static void
+fold_case(char str[])
+{
+	while(*str != '\0')
+	{
+		*str = tolower((unsigned char)*str);
+		++str;
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
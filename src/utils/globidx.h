@@ -0,0 +1,55 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__GLOBIDX_H__
+#define VIFM__UTILS__GLOBIDX_H__
+
+/* Index of simple globs (literal names and "*suffix" globs, see
+ * matcher_get_simple_globs()) which finds all globs that match a file name
+ * without trying them one by one.  Globs are identified by non-negative
+ * numbers, several globs can share the same number. */
+
+/* Opaque type of an index. */
+typedef struct globidx_t globidx_t;
+
+/* Type of callback invoked for each number found by globidx_find().  Returns
+ * non-zero to stop the search, otherwise zero should be returned. */
+typedef int (*globidx_visitor_t)(int id, void *arg);
+
+/* Creates an empty index.  Returns the index or NULL on error. */
+globidx_t * globidx_create(void);
+
+/* Frees the index.  idx can be NULL. */
+void globidx_free(globidx_t *idx);
+
+/* Adds a glob identified by a number, which shouldn't be smaller than numbers
+ * of previously added globs.  Returns zero on success, otherwise (including the
+ * case of globs that aren't simple) non-zero is returned. */
+int globidx_add(globidx_t *idx, const char glob[], int id);
+
+/* Invokes the visitor for every number of globs that match the name ignoring
+ * case in ascending order and without repetitions.  Returns zero on success and
+ * non-zero if the name can't be looked up, in which case the visitor isn't
+ * invoked. */
+int globidx_find(const globidx_t *idx, const char name[],
+		globidx_visitor_t visitor, void *arg);
+
+#endif /* VIFM__UTILS__GLOBIDX_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,753 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "lineidx.h"
+
+#include <sys/stat.h> /* stat */
+
+#include <limits.h> /* INT_MAX */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* FILE SEEK_SET fclose() fread() */
+#include <stdlib.h> /* calloc() free() malloc() */
+#include <string.h> /* memchr() memcmp() memcpy() strdup() */
+
+#include "../compat/os.h"
+#include "../compat/pthread.h"
+#include "../compat/reallocarray.h"
+#include "macros.h"
+
+/* Offset of every STEP-th line is remembered. */
+#define STEP 256
+
+/* Lines longer than this number of bytes are broken into several lines. */
+#define MAX_LINE (16*1024)
+
+/* Size of blocks in which the file is read. */
+#define CHUNK (256*1024)
+
+/* Size of blocks in which the file is searched for a line start backwards. */
+#define BACK_CHUNK (64*1024)
+
+/* How far to look back for a line start in a file that wasn't indexed yet. */
+#define MAX_BACK (16*BACK_CHUNK)
+
+/* Index data. */
+struct lineidx_t
+{
+	pthread_mutex_t lock;  /* Protects fields up to the next comment. */
+	pthread_cond_t cond;   /* Wakes up the thread on growth or cancellation. */
+	int refs;              /* Number of owners (thread and the caller). */
+	int cancelled;         /* Caller is no longer interested in results. */
+	uint64_t size;         /* Size of the file as of last check. */
+	uint64_t *checkpoints; /* Offset of line i*STEP is at index i. */
+	int ncheckpoints;      /* Number of elements in checkpoints array. */
+	int nindexed;          /* Number of terminated lines found so far. */
+	uint64_t indexed_end;  /* Offset right after the last indexed line. */
+	int complete;          /* Whether whole file was processed. */
+
+	/* Fields below are used only by the caller. */
+
+	char *path; /* Path to the file, read-only after creation. */
+	FILE *fp;   /* Stream of the caller. */
+};
+
+/* State of sequential reading of lines. */
+typedef struct
+{
+	FILE *fp;        /* Stream to read from. */
+	uint64_t size;   /* Size of the file. */
+	char *buf;       /* Buffer for file data. */
+	size_t len;      /* Number of bytes in the buffer. */
+	uint64_t offset; /* Offset of the first byte of the buffer. */
+}
+reader_t;
+
+static void * indexer_thread(void *arg);
+static int add_lines(lineidx_t *idx, const uint64_t starts[], int count,
+		int nlines, uint64_t end);
+static uint64_t find_base(lineidx_t *idx, uint64_t offset);
+static uint64_t find_indexed_base(lineidx_t *idx, uint64_t offset);
+static int find_checkpoint(lineidx_t *idx, uint64_t offset);
+static uint64_t walk_forward(lineidx_t *idx, uint64_t from, uint64_t limit,
+		int count, int *walked);
+static int collect_starts(lineidx_t *idx, uint64_t from, uint64_t to,
+		uint64_t **starts);
+static int reader_init(reader_t *r, lineidx_t *idx);
+static size_t reader_line(reader_t *r, uint64_t offset, const char **line);
+static size_t line_length(const char buf[], size_t len, int eof);
+static size_t read_at(FILE *fp, uint64_t offset, void *buf, size_t len);
+static void release_index(lineidx_t *idx);
+
+lineidx_t *
+lineidx_open(const char path[])
+{
+	struct stat s;
+	if(os_stat(path, &s) != 0 || !S_ISREG(s.st_mode))
+	{
+		return NULL;
+	}
+
+	lineidx_t *const idx = calloc(1, sizeof(*idx));
+	if(idx == NULL)
+	{
+		return NULL;
+	}
+
+	idx->path = strdup(path);
+	idx->fp = os_fopen(path, "rb");
+	if(idx->path == NULL || idx->fp == NULL)
+	{
+		if(idx->fp != NULL)
+		{
+			fclose(idx->fp);
+		}
+		free(idx->path);
+		free(idx);
+		return NULL;
+	}
+
+	if(pthread_mutex_init(&idx->lock, NULL) != 0)
+	{
+		fclose(idx->fp);
+		free(idx->path);
+		free(idx);
+		return NULL;
+	}
+
+	if(pthread_cond_init(&idx->cond, NULL) != 0)
+	{
+		pthread_mutex_destroy(&idx->lock);
+		fclose(idx->fp);
+		free(idx->path);
+		free(idx);
+		return NULL;
+	}
+
+	idx->size = s.st_size;
+	idx->refs = 2;
+
+	pthread_t id;
+	if(pthread_create(&id, NULL, &indexer_thread, idx) != 0)
+	{
+		pthread_cond_destroy(&idx->cond);
+		pthread_mutex_destroy(&idx->lock);
+		fclose(idx->fp);
+		free(idx->path);
+		free(idx);
+		return NULL;
+	}
+	(void)pthread_detach(id);
+
+	return idx;
+}
+
+void
+lineidx_free(lineidx_t *idx)
+{
+	if(idx == NULL)
+	{
+		return;
+	}
+
+	fclose(idx->fp);
+	idx->fp = NULL;
+
+	pthread_mutex_lock(&idx->lock);
+	idx->cancelled = 1;
+	pthread_cond_signal(&idx->cond);
+	pthread_mutex_unlock(&idx->lock);
+
+	release_index(idx);
+}
+
+int
+lineidx_refresh(lineidx_t *idx)
+{
+	struct stat s;
+	if(os_stat(idx->path, &s) != 0)
+	{
+		return -1;
+	}
+
+	const uint64_t size = s.st_size;
+
+	pthread_mutex_lock(&idx->lock);
+	const int result = (size > idx->size) ? 1 : (size < idx->size) ? -1 : 0;
+	if(result > 0)
+	{
+		idx->size = size;
+		idx->complete = 0;
+		pthread_cond_signal(&idx->cond);
+	}
+	pthread_mutex_unlock(&idx->lock);
+
+	return result;
+}
+
+uint64_t
+lineidx_size(lineidx_t *idx)
+{
+	pthread_mutex_lock(&idx->lock);
+	const uint64_t size = idx->size;
+	pthread_mutex_unlock(&idx->lock);
+	return size;
+}
+
+int
+lineidx_nlines(lineidx_t *idx, int *complete)
+{
+	pthread_mutex_lock(&idx->lock);
+	*complete = idx->complete;
+	/* Last line of a file might lack a terminator. */
+	const int nlines = idx->nindexed
+	                 + (idx->complete && idx->indexed_end < idx->size);
+	pthread_mutex_unlock(&idx->lock);
+	return nlines;
+}
+
+int
+lineidx_line_offset(lineidx_t *idx, int line, uint64_t *offset)
+{
+	if(line < 0)
+	{
+		return 1;
+	}
+
+	pthread_mutex_lock(&idx->lock);
+	const int nindexed = idx->nindexed;
+	const int unterminated = (idx->complete && idx->indexed_end < idx->size);
+	const uint64_t indexed_end = idx->indexed_end;
+	const uint64_t checkpoint = (line < nindexed)
+	                          ? idx->checkpoints[line/STEP]
+	                          : 0;
+	pthread_mutex_unlock(&idx->lock);
+
+	if(line < nindexed)
+	{
+		int walked;
+		*offset = walk_forward(idx, checkpoint, UINT64_MAX, line%STEP, &walked);
+		return (walked != line%STEP);
+	}
+
+	if(line == nindexed && unterminated)
+	{
+		*offset = indexed_end;
+		return 0;
+	}
+
+	return 1;
+}
+
+int
+lineidx_line_number(lineidx_t *idx, uint64_t offset)
+{
+	pthread_mutex_lock(&idx->lock);
+
+	if(offset >= idx->indexed_end)
+	{
+		const int number = (offset == idx->indexed_end) ? idx->nindexed : -1;
+		pthread_mutex_unlock(&idx->lock);
+		return number;
+	}
+
+	const int checkpoint = find_checkpoint(idx, offset);
+	const uint64_t checkpoint_offset = idx->checkpoints[checkpoint];
+	pthread_mutex_unlock(&idx->lock);
+
+	int walked;
+	(void)walk_forward(idx, checkpoint_offset, offset, INT_MAX, &walked);
+	return checkpoint*STEP + walked;
+}
+
+uint64_t
+lineidx_line_start(lineidx_t *idx, uint64_t offset)
+{
+	int walked;
+	return walk_forward(idx, find_base(idx, offset), offset, INT_MAX, &walked);
+}
+
+uint64_t
+lineidx_move(lineidx_t *idx, uint64_t offset, int count, int *moved)
+{
+	if(count >= 0)
+	{
+		return walk_forward(idx, offset, UINT64_MAX, count, moved);
+	}
+
+	*moved = 0;
+	while(*moved > count && offset > 0)
+	{
+		/* Find a line start before the previous line and go forward from it. */
+		uint64_t *starts;
+		const int nstarts = collect_starts(idx, find_base(idx, offset - 1), offset,
+				&starts);
+		if(nstarts <= 0)
+		{
+			break;
+		}
+
+		const int n = MIN(nstarts, *moved - count);
+		offset = starts[nstarts - n];
+		*moved -= n;
+		free(starts);
+	}
+	return offset;
+}
+
+strlist_t
+lineidx_read(lineidx_t *idx, uint64_t offset, int count, uint64_t *end)
+{
+	strlist_t list = {};
+
+	*end = offset;
+
+	reader_t r;
+	if(reader_init(&r, idx) != 0)
+	{
+		return list;
+	}
+
+	while(list.nitems < count)
+	{
+		const char *line;
+		const size_t len = reader_line(&r, offset, &line);
+		if(len == 0)
+		{
+			break;
+		}
+
+		size_t from = 0, to = len;
+		if(to > from && line[to - 1] == '\n')
+		{
+			--to;
+		}
+		if(to > from && line[to - 1] == '\r')
+		{
+			--to;
+		}
+		if(offset == 0 && to - from >= 3 && memcmp(line, "\xef\xbb\xbf", 3) == 0)
+		{
+			from += 3;
+		}
+
+		char *const copy = malloc(to - from + 1);
+		if(copy == NULL)
+		{
+			break;
+		}
+		memcpy(copy, line + from, to - from);
+		copy[to - from] = '\0';
+
+		const int nitems = put_into_string_array(&list.items, list.nitems, copy);
+		if(nitems == list.nitems)
+		{
+			free(copy);
+			break;
+		}
+		list.nitems = nitems;
+
+		offset += len;
+		*end = offset;
+	}
+
+	free(r.buf);
+	return list;
+}
+
+/* Entry point of the thread that indexes the file.  Returns NULL. */
+static void *
+indexer_thread(void *arg)
+{
+	lineidx_t *const idx = arg;
+
+	FILE *const fp = os_fopen(idx->path, "rb");
+	char *const buf = malloc(CHUNK);
+	uint64_t *const starts = reallocarray(NULL, CHUNK/STEP + 1, sizeof(*starts));
+	if(fp == NULL || buf == NULL || starts == NULL)
+	{
+		pthread_mutex_lock(&idx->lock);
+		idx->complete = 1;
+		pthread_mutex_unlock(&idx->lock);
+		goto finish;
+	}
+
+	/* Offset of the next line to index, number of the line and known size of
+	 * the file. */
+	uint64_t offset = 0;
+	int line = 0;
+	uint64_t size = 0;
+	int caught_up = 1;
+
+	while(1)
+	{
+		pthread_mutex_lock(&idx->lock);
+		while(!idx->cancelled && caught_up && idx->size == size)
+		{
+			idx->complete = 1;
+			pthread_cond_wait(&idx->cond, &idx->lock);
+		}
+		const int cancelled = idx->cancelled;
+		size = idx->size;
+		pthread_mutex_unlock(&idx->lock);
+
+		if(cancelled)
+		{
+			break;
+		}
+
+		const size_t wanted = MIN(CHUNK, size - offset);
+		const size_t len = read_at(fp, offset, buf, wanted);
+		/* A short read means that the file was truncated, which the caller should
+		 * notice on refreshing. */
+		caught_up = (len < wanted || offset + len == size);
+
+		int nstarts = 0;
+		size_t pos = 0;
+		while(pos < len)
+		{
+			const size_t line_len = line_length(buf + pos, len - pos, 0);
+			if(line_len == 0)
+			{
+				break;
+			}
+
+			if(line%STEP == 0)
+			{
+				starts[nstarts++] = offset + pos;
+			}
+			++line;
+			pos += line_len;
+		}
+
+		offset += pos;
+		if(add_lines(idx, starts, nstarts, line, offset) != 0)
+		{
+			break;
+		}
+	}
+
+finish:
+	free(starts);
+	free(buf);
+	if(fp != NULL)
+	{
+		fclose(fp);
+	}
+
+	release_index(idx);
+	return NULL;
+}
+
+/* Publishes results of indexing.  starts contains offsets of count new
+ * checkpoints, nlines is the new number of lines and end is offset after the
+ * last of them.  Returns zero on success, otherwise non-zero is returned. */
+static int
+add_lines(lineidx_t *idx, const uint64_t starts[], int count, int nlines,
+		uint64_t end)
+{
+	pthread_mutex_lock(&idx->lock);
+
+	int error = 0;
+
+	uint64_t *const checkpoints = reallocarray(idx->checkpoints,
+			idx->ncheckpoints + count, sizeof(*checkpoints));
+	if(checkpoints == NULL)
+	{
+		/* Keep what was indexed and stop. */
+		idx->complete = 1;
+		error = 1;
+	}
+	else
+	{
+		idx->checkpoints = checkpoints;
+		memcpy(&idx->checkpoints[idx->ncheckpoints], starts,
+				sizeof(*starts)*count);
+		idx->ncheckpoints += count;
+		idx->nindexed = nlines;
+		idx->indexed_end = end;
+	}
+
+	pthread_mutex_unlock(&idx->lock);
+	return error;
+}
+
+/* Finds start of a line which is not after the offset and from which lines can
+ * be walked to reach the offset.  Returns the offset of the line. */
+static uint64_t
+find_base(lineidx_t *idx, uint64_t offset)
+{
+	uint64_t base = find_indexed_base(idx, offset);
+	if(base != UINT64_MAX)
+	{
+		return base;
+	}
+
+	char *const buf = malloc(BACK_CHUNK);
+	if(buf == NULL)
+	{
+		return offset;
+	}
+
+	/* Look for the earliest newline in a block preceding the offset, this way a
+	 * single walk can provide many lines. */
+	uint64_t end = offset;
+	base = (offset > MAX_BACK ? offset - MAX_BACK : 0);
+	while(end > 0 && offset - end < MAX_BACK)
+	{
+		const uint64_t start = (end > BACK_CHUNK ? end - BACK_CHUNK : 0);
+		const size_t len = read_at(idx->fp, start, buf, end - start);
+		const char *const nl = memchr(buf, '\n', len);
+		if(nl != NULL)
+		{
+			base = start + (nl - buf) + 1;
+			break;
+		}
+		if(start == 0)
+		{
+			base = 0;
+			break;
+		}
+		end = start;
+	}
+
+	free(buf);
+	return base;
+}
+
+/* Finds the last checkpoint that's not after the offset if the offset is in
+ * the indexed part of the file.  Returns the offset of the checkpoint or
+ * UINT64_MAX if there is none. */
+static uint64_t
+find_indexed_base(lineidx_t *idx, uint64_t offset)
+{
+	uint64_t base = UINT64_MAX;
+
+	pthread_mutex_lock(&idx->lock);
+	if(offset < idx->indexed_end && idx->ncheckpoints != 0)
+	{
+		base = idx->checkpoints[find_checkpoint(idx, offset)];
+	}
+	pthread_mutex_unlock(&idx->lock);
+
+	return base;
+}
+
+/* Finds the last checkpoint that's not after the offset.  Must be called with
+ * the lock held and non-empty list of checkpoints.  Returns index of the
+ * checkpoint. */
+static int
+find_checkpoint(lineidx_t *idx, uint64_t offset)
+{
+	int l = 0, u = idx->ncheckpoints - 1;
+	while(l < u)
+	{
+		const int m = l + (u - l + 1)/2;
+		if(idx->checkpoints[m] <= offset)
+		{
+			l = m;
+		}
+		else
+		{
+			u = m - 1;
+		}
+	}
+	return l;
+}
+
+/* Walks at most count lines forward while the next line starts not after the
+ * limit and not stepping past the start of the last line.  *walked is set to
+ * number of lines passed.  Returns offset of the line. */
+static uint64_t
+walk_forward(lineidx_t *idx, uint64_t from, uint64_t limit, int count,
+		int *walked)
+{
+	*walked = 0;
+
+	reader_t r;
+	if(reader_init(&r, idx) != 0)
+	{
+		return from;
+	}
+
+	while(*walked < count)
+	{
+		const char *line;
+		const size_t len = reader_line(&r, from, &line);
+		if(len == 0 || from + len > limit || from + len >= r.size)
+		{
+			break;
+		}
+
+		from += len;
+		++*walked;
+	}
+
+	free(r.buf);
+	return from;
+}
+
+/* Finds starts of all lines that begin in the [from, to) range.  *starts is
+ * allocated and should be freed by the caller on success.  Returns number of
+ * starts or -1 on error. */
+static int
+collect_starts(lineidx_t *idx, uint64_t from, uint64_t to, uint64_t **starts)
+{
+	reader_t r;
+	if(reader_init(&r, idx) != 0)
+	{
+		return -1;
+	}
+
+	int count = 0;
+	*starts = NULL;
+
+	while(from < to)
+	{
+		uint64_t *const new_starts = reallocarray(*starts, count + 1,
+				sizeof(*new_starts));
+		if(new_starts == NULL)
+		{
+			free(*starts);
+			count = -1;
+			break;
+		}
+		*starts = new_starts;
+		(*starts)[count++] = from;
+
+		const char *line;
+		const size_t len = reader_line(&r, from, &line);
+		if(len == 0)
+		{
+			break;
+		}
+		from += len;
+	}
+
+	free(r.buf);
+	return count;
+}
+
+/* Prepares reader for use.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+reader_init(reader_t *r, lineidx_t *idx)
+{
+	r->fp = idx->fp;
+	r->size = lineidx_size(idx);
+	r->buf = malloc(CHUNK);
+	r->len = 0;
+	r->offset = 0;
+	return (r->buf == NULL);
+}
+
+/* Retrieves line at the offset along with its terminator.  *line is set to
+ * point to the contents of the line.  Returns length of the line, which is zero
+ * at the end of the file or on error. */
+static size_t
+reader_line(reader_t *r, uint64_t offset, const char **line)
+{
+	if(offset >= r->size)
+	{
+		return 0;
+	}
+
+	const uint64_t buf_end = r->offset + r->len;
+	if(offset < r->offset || offset > buf_end ||
+			(buf_end - offset <= MAX_LINE && buf_end < r->size))
+	{
+		const size_t wanted = MIN(CHUNK, r->size - offset);
+		r->offset = offset;
+		r->len = read_at(r->fp, offset, r->buf, wanted);
+		if(r->len < wanted)
+		{
+			/* The file got shorter. */
+			r->size = offset + r->len;
+		}
+	}
+
+	const size_t pos = offset - r->offset;
+	*line = r->buf + pos;
+	return line_length(*line, r->len - pos,
+			r->offset + r->len == r->size);
+}
+
+/* Determines length of the first line in the buffer including its terminator.
+ * Unterminated line is accounted for only at the end of file.  Returns the
+ * length or zero if the line doesn't end within the buffer. */
+static size_t
+line_length(const char buf[], size_t len, int eof)
+{
+	const char *const nl = memchr(buf, '\n', MIN(len, MAX_LINE + 1));
+	if(nl != NULL)
+	{
+		return nl - buf + 1;
+	}
+
+	if(len > MAX_LINE)
+	{
+		/* Don't break UTF-8 sequences if possible. */
+		size_t length = MAX_LINE;
+		while(length > MAX_LINE - 4 && ((unsigned char)buf[length] & 0xc0) == 0x80)
+		{
+			--length;
+		}
+		return length;
+	}
+
+	return (eof ? len : 0);
+}
+
+/* Reads a block of the file at the specified offset.  Returns number of bytes
+ * read. */
+static size_t
+read_at(FILE *fp, uint64_t offset, void *buf, size_t len)
+{
+#ifndef _WIN32
+	if(fseeko(fp, offset, SEEK_SET) != 0)
+#else
+	if(_fseeki64(fp, offset, SEEK_SET) != 0)
+#endif
+	{
+		return 0;
+	}
+	return fread(buf, 1, len, fp);
+}
+
+/* Drops a reference to the index freeing it if it was the last one. */
+static void
+release_index(lineidx_t *idx)
+{
+	pthread_mutex_lock(&idx->lock);
+	const int last = (--idx->refs == 0);
+	pthread_mutex_unlock(&idx->lock);
+
+	if(!last)
+	{
+		return;
+	}
+
+	free(idx->checkpoints);
+	free(idx->path);
+	pthread_cond_destroy(&idx->cond);
+	pthread_mutex_destroy(&idx->lock);
+	free(idx);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,81 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__LINEIDX_H__
+#define VIFM__UTILS__LINEIDX_H__
+
+/* Index of lines of a text file which allows accessing any part of a file of
+ * arbitrary size without reading all of it.  Lines are identified by offsets
+ * at which they start.  A background thread counts lines and remembers offset
+ * of every 256-th of them, which is used to map line numbers to offsets and
+ * back.  Lines longer than 16 KiB are broken into several lines. */
+
+#include <stdint.h> /* uint64_t */
+
+#include "string_array.h"
+
+/* Opaque type of an index. */
+typedef struct lineidx_t lineidx_t;
+
+/* Opens a file and starts indexing it.  Returns the index or NULL on error. */
+lineidx_t * lineidx_open(const char path[]);
+
+/* Frees the index.  Doesn't wait for the thread to finish.  idx can be
+ * NULL. */
+void lineidx_free(lineidx_t *idx);
+
+/* Checks whether size of the file has changed and makes new data available if
+ * it grew.  Returns 1 if the file grew, 0 if it's unchanged and -1 on error or
+ * if the file shrank (the index is unusable then). */
+int lineidx_refresh(lineidx_t *idx);
+
+/* Retrieves size of the file as of last check.  Returns the size. */
+uint64_t lineidx_size(lineidx_t *idx);
+
+/* Retrieves number of lines indexed so far.  *complete is set to non-zero if
+ * whole file was indexed.  Returns the number. */
+int lineidx_nlines(lineidx_t *idx, int *complete);
+
+/* Finds offset of a line by its zero-based number.  Returns zero on success and
+ * non-zero if this part of the file wasn't indexed yet. */
+int lineidx_line_offset(lineidx_t *idx, int line, uint64_t *offset);
+
+/* Finds zero-based number of the line that starts at the offset.  Returns the
+ * number or -1 if this part of the file wasn't indexed yet. */
+int lineidx_line_number(lineidx_t *idx, uint64_t offset);
+
+/* Finds offset of the beginning of the line that contains the offset.  Returns
+ * the offset. */
+uint64_t lineidx_line_start(lineidx_t *idx, uint64_t offset);
+
+/* Moves from a line that starts at the offset by count lines, which can be
+ * negative to move backward, stopping at the first and at the last line.
+ * *moved is set to number of lines passed (negative for backward movement).
+ * Returns offset of the line. */
+uint64_t lineidx_move(lineidx_t *idx, uint64_t offset, int count, int *moved);
+
+/* Reads at most count lines starting with the one at the offset.  Lines don't
+ * include line terminators.  *end is set to offset after the last read line.
+ * Returns the lines, which are empty on error. */
+strlist_t lineidx_read(lineidx_t *idx, uint64_t offset, int count,
+		uint64_t *end);
+
+#endif /* VIFM__UTILS__LINEIDX_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
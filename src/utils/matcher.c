@@ -20,15 +20,19 @@
 
 #include <regex.h> /* regex_t regexec() regfree() */
 
-#include <stddef.h> /* NULL */
-#include <stdlib.h> /* free() malloc() */
-#include <string.h> /* strcspn() strdup() strlen() strrchr() */
+#include <ctype.h> /* tolower() */
+#include <stddef.h> /* NULL size_t */
+#include <stdlib.h> /* free() malloc() qsort() */
+#include <string.h> /* memmove() strchr() strcspn() strdup() strlen() strrchr() */
+
+#include "../compat/reallocarray.h"
 
 #include "../int/file_magic.h"
 #include "globs.h"
 #include "path.h"
 #include "regexp.h"
 #include "str.h"
+#include "string_array.h"
 #include "test_helpers.h"
 
 /* Type of a matcher. */
@@ -40,6 +44,17 @@ typedef enum
 }
 MType;
 
+/* Single glob of "faster" globs in pre-parsed form.  Both parts are converted
+ * to lower case. */
+typedef struct
+{
+	const char *prefix; /* Part before asterisk or the whole glob for literals. */
+	const char *suffix; /* Part after asterisk or NULL for literals. */
+	size_t prefix_len;  /* Length of the prefix. */
+	size_t suffix_len;  /* Length of the suffix. */
+}
+fglob_t;
+
 /* Wrapper for a regular expression, its state and compiled form. */
 struct matcher_t
 {
@@ -53,6 +68,13 @@ struct matcher_t
 	unsigned int fglobs : 1;    /* Whether this matcher is a special case of
 	                               globs ("faster" globs) that is optimized. */
 	regex_t regex; /* The expression in compiled form, unless matcher is empty. */
+
+	/* Pre-parsed form of "faster" globs.  Literals come first and are sorted by
+	 * length, they are followed by globs with an asterisk. */
+	fglob_t *fglobs_list; /* Parsed globs. */
+	int fglobs_count;     /* Number of elements in fglobs_list. */
+	int fglobs_literals;  /* Number of literals at the start of fglobs_list. */
+	char *fglobs_text;    /* Storage for strings of fglobs_list. */
 };
 
 static matcher_t * alloc_matcher(matcher_t m, const char expr[], int cs_by_def,
@@ -64,10 +86,17 @@ static int compile_expr(matcher_t *m, int strip, int cs_by_def,
 		const char on_empty_re[], char **error);
 static int parse_glob(matcher_t *m, int strip, char **error);
 static int is_fglobs(char expr[]);
+static int parse_fglobs(matcher_t *m);
+static int fglob_cmp(const void *a, const void *b);
 static int parse_re(matcher_t *m, int strip, int cs_by_def,
 		const char on_empty_re[], char **error);
 static void free_matcher_items(matcher_t *matcher);
 static int fglobs_matches(const matcher_t *matcher, const char path[]);
+static int fglobs_match_literal(const matcher_t *matcher, const char path[],
+		size_t len);
+static int fglobs_match_pattern(const matcher_t *matcher, const char path[],
+		size_t len);
+static int equal_to_lowered(const char str[], const char lowered[], size_t n);
 static int fglobs_includes(const matcher_t *matcher, const matcher_t *like);
 static int is_negated(const char **expr);
 static int is_re_expr(const char expr[], int allow_empty);
@@ -273,6 +302,11 @@ parse_glob(matcher_t *m, int strip, char **error)
 	if(is_fglobs(m->raw))
 	{
 		m->fglobs = 1;
+		if(parse_fglobs(m) != 0)
+		{
+			replace_string(error, "Failed to allocate memory.");
+			return 1;
+		}
 		return 0;
 	}
 
@@ -323,6 +357,95 @@ is_fglobs(char expr[])
 	return (glob == NULL);
 }
 
+/* Splits "faster" globs into prefixes and suffixes to not do it on every match.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+parse_fglobs(matcher_t *m)
+{
+	char *const text = strdup(m->raw);
+	if(text == NULL)
+	{
+		return 1;
+	}
+
+	char *c;
+	for(c = text; *c != '\0'; ++c)
+	{
+		*c = tolower((unsigned char)*c);
+	}
+
+	fglob_t *list = NULL;
+	int count = 0;
+
+	char *glob = text, *state = NULL;
+	while((glob = split_and_get_dc(glob, &state)) != NULL)
+	{
+		fglob_t *const new_list = reallocarray(list, count + 1, sizeof(*list));
+		if(new_list == NULL)
+		{
+			free(list);
+			free(text);
+			return 1;
+		}
+		list = new_list;
+
+		fglob_t *const fglob = &list[count++];
+		fglob->prefix = glob;
+		fglob->suffix = NULL;
+
+		char *const asterisk = strchr(glob, '*');
+		if(asterisk != NULL && asterisk != glob && asterisk[-1] == '\\')
+		{
+			/* Literal with one escaped asterisk, drop the escaping. */
+			memmove(asterisk - 1, asterisk, strlen(asterisk) + 1);
+		}
+		else if(asterisk != NULL)
+		{
+			*asterisk = '\0';
+			fglob->suffix = asterisk + 1;
+			fglob->suffix_len = strlen(fglob->suffix);
+		}
+
+		fglob->prefix_len = strlen(fglob->prefix);
+	}
+
+	if(count != 0)
+	{
+		qsort(list, count, sizeof(*list), &fglob_cmp);
+	}
+
+	int literals = 0;
+	while(literals < count && list[literals].suffix == NULL)
+	{
+		++literals;
+	}
+
+	m->fglobs_list = list;
+	m->fglobs_count = count;
+	m->fglobs_literals = literals;
+	m->fglobs_text = text;
+	return 0;
+}
+
+/* qsort() comparer that puts literals first ordering them by length.  Returns
+ * standard -1, 0, 1 for comparisons. */
+static int
+fglob_cmp(const void *a, const void *b)
+{
+	const fglob_t *const x = a;
+	const fglob_t *const y = b;
+
+	if((x->suffix == NULL) != (y->suffix == NULL))
+	{
+		return (x->suffix == NULL ? -1 : 1);
+	}
+	if(x->suffix != NULL || x->prefix_len == y->prefix_len)
+	{
+		return 0;
+	}
+	return (x->prefix_len < y->prefix_len ? -1 : 1);
+}
+
 /* Parses regexp flags.  Returns zero on success or non-zero on error with
  * *error containing description of it. */
 static int
@@ -378,12 +501,21 @@ matcher_clone(const matcher_t *matcher)
 	clone->raw = strdup(matcher->raw);
 	clone->undec = strdup(matcher->undec);
 
+	clone->fglobs_list = NULL;
+	clone->fglobs_text = NULL;
+
 	if(clone->expr == NULL || clone->raw == NULL || clone->undec == NULL)
 	{
 		matcher_free(clone);
 		return NULL;
 	}
 
+	if(clone->fglobs && parse_fglobs(clone) != 0)
+	{
+		matcher_free(clone);
+		return NULL;
+	}
+
 	/* Don't compile regex for faster globs or empty matcher. */
 	if(!clone->fglobs && clone->raw[0] != '\0')
 	{
@@ -420,6 +552,8 @@ free_matcher_items(matcher_t *matcher)
 	free(matcher->expr);
 	free(matcher->raw);
 	free(matcher->undec);
+	free(matcher->fglobs_list);
+	free(matcher->fglobs_text);
 }
 
 int
@@ -457,56 +591,96 @@ matcher_matches(const matcher_t *matcher, const char path[])
 static int
 fglobs_matches(const matcher_t *matcher, const char path[])
 {
-	char *globs = strdup(matcher->raw);
-	char *glob = globs, *state = NULL;
-	while((glob = split_and_get_dc(glob, &state)) != NULL)
+	const size_t len = strlen(path);
+	const int matched = fglobs_match_literal(matcher, path, len)
+	                 || fglobs_match_pattern(matcher, path, len);
+	return matched^matcher->negated;
+}
+
+/* Checks whether path of specified length is equal to one of literals of a
+ * fglobs matcher ignoring case.  Returns non-zero if so, otherwise zero is
+ * returned. */
+static int
+fglobs_match_literal(const matcher_t *matcher, const char path[], size_t len)
+{
+	const fglob_t *const list = matcher->fglobs_list;
+
+	/* Find the first literal of the same length, literals are sorted by it. */
+	int l = 0, u = matcher->fglobs_literals;
+	while(l < u)
 	{
-		const char *asterisk = until_first(glob, '*');
+		const int i = l + (u - l)/2;
+		if(list[i].prefix_len < len)
+		{
+			l = i + 1;
+		}
+		else
+		{
+			u = i;
+		}
+	}
 
-		/* Literal with no special characters. */
-		if(*asterisk == '\0')
+	for(; l < matcher->fglobs_literals && list[l].prefix_len == len; ++l)
+	{
+		if(equal_to_lowered(path, list[l].prefix, len))
 		{
-			if(strcasecmp(path, glob) == 0)
-			{
-				break;
-			}
-			continue;
+			return 1;
 		}
+	}
+	return 0;
+}
 
-		size_t pos = asterisk - glob;
-		/* `*something` */
-		if(pos == 0)
+/* Checks whether path of specified length is matched by one of globs with an
+ * asterisk of a fglobs matcher ignoring case.  Returns non-zero if so,
+ * otherwise zero is returned. */
+static int
+fglobs_match_pattern(const matcher_t *matcher, const char path[], size_t len)
+{
+	int i;
+	for(i = matcher->fglobs_literals; i < matcher->fglobs_count; ++i)
+	{
+		const fglob_t *const fglob = &matcher->fglobs_list[i];
+
+		/* `*something` doesn't match dot files and requires at least one
+		 * character before the suffix. */
+		if(fglob->prefix_len == 0)
 		{
-			if(path[0] != '.' && ends_with_case(path + 1, glob + 1))
+			if(path[0] != '.' && len > fglob->suffix_len &&
+					equal_to_lowered(path + len - fglob->suffix_len, fglob->suffix,
+						fglob->suffix_len))
 			{
-				break;
+				return 1;
 			}
 			continue;
 		}
 
-		/* Literal with one escaped asterisk. */
-		if(asterisk[-1] == '\\')
+		/* Either `something*` or `some*thing`, parts can't overlap. */
+		if(len >= fglob->prefix_len + fglob->suffix_len &&
+				equal_to_lowered(path, fglob->prefix, fglob->prefix_len) &&
+				equal_to_lowered(path + len - fglob->suffix_len, fglob->suffix,
+					fglob->suffix_len))
 		{
-			/* Compare parts around '\\' to ignore it. */
-			--pos;
-			if(strncasecmp(path, glob, pos) == 0 &&
-					strcasecmp(path + pos, glob + pos + 1) == 0)
-			{
-				break;
-			}
-			continue;
+			return 1;
 		}
+	}
+	return 0;
+}
 
-		/* Either `something*` or `some*thing`.  First case work here by matching
-		 * its empty suffix. */
-		if(strncasecmp(path, glob, pos) == 0 &&
-				ends_with_case(path + pos, glob + pos + 1))
+/* Compares first n bytes of a string with a string in lower case ignoring case
+ * of the former the same way strcasecmp() does.  Returns non-zero if they are
+ * equal, otherwise zero is returned. */
+static int
+equal_to_lowered(const char str[], const char lowered[], size_t n)
+{
+	size_t i;
+	for(i = 0U; i < n; ++i)
+	{
+		if((char)tolower((unsigned char)str[i]) != lowered[i])
 		{
-			break;
+			return 0;
 		}
 	}
-	free(globs);
-	return (glob != NULL)^matcher->negated;
+	return 1;
 }
 
 int
@@ -628,6 +802,53 @@ matcher_is_full_path(const matcher_t *matcher)
 	return matcher->full_path;
 }
 
+char **
+matcher_get_simple_globs(const matcher_t *matcher, int *count)
+{
+	*count = 0;
+
+	if(!matcher->fglobs || matcher->negated || matcher->full_path ||
+			matcher_is_empty(matcher))
+	{
+		return NULL;
+	}
+
+	char *globs = strdup(matcher->raw);
+	if(globs == NULL)
+	{
+		return NULL;
+	}
+
+	char **list = NULL;
+	int len = 0;
+
+	char *glob = globs, *state = NULL;
+	while((glob = split_and_get_dc(glob, &state)) != NULL)
+	{
+		const char *asterisk = until_first(glob, '*');
+		if(*asterisk != '\0' && asterisk != glob)
+		{
+			break;
+		}
+
+		if(add_to_string_array(&list, len, glob) == len)
+		{
+			break;
+		}
+		++len;
+	}
+	free(globs);
+
+	if(glob != NULL)
+	{
+		free_string_array(list, len);
+		return NULL;
+	}
+
+	*count = len;
+	return list;
+}
+
 TSTATIC int
 matcher_is_fast(const matcher_t *matcher)
 {
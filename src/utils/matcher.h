@@ -72,6 +72,12 @@ int matcher_includes(const matcher_t *matcher, const matcher_t *like);
  * otherwise zero is returned. */
 int matcher_is_full_path(const matcher_t *matcher);
 
+/* Retrieves globs of a matcher that depends only on file name and consists of
+ * literal names and "*suffix" globs, all of which are matched ignoring case.
+ * "*suffix" globs don't match names that start with a dot.  Returns the list of
+ * length *count or NULL if matcher isn't like that. */
+char ** matcher_get_simple_globs(const matcher_t *matcher, int *count);
+
 TSTATIC_DEFS(
 	int matcher_is_fast(const matcher_t *matcher);
 )
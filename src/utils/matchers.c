@@ -210,6 +210,17 @@ matchers_get_expr(const matchers_t *matchers)
 	return matchers->expr;
 }
 
+char **
+matchers_get_simple_globs(const matchers_t *matchers, int *count)
+{
+	if(matchers->count != 1)
+	{
+		*count = 0;
+		return NULL;
+	}
+	return matcher_get_simple_globs(matchers->list[0], count);
+}
+
 int
 matchers_includes(const matchers_t *matchers, const matchers_t *like)
 {
@@ -46,6 +46,10 @@ int matchers_match_dir(const matchers_t *matchers, const char path[]);
 /* Retrieves original matcher expression.  Returns the expression. */
 const char * matchers_get_expr(const matchers_t *matchers);
 
+/* Same as matcher_get_simple_globs(), but for a list that consists of a single
+ * matcher. */
+char ** matchers_get_simple_globs(const matchers_t *matchers, int *count);
+
 /* Checks whether matchers matches at least superset of what like is matching.
  * Returns non-zero if so, otherwise zero is returned. */
 int matchers_includes(const matchers_t *matchers, const matchers_t *like);
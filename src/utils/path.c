@@ -717,6 +717,12 @@ find_cmd_in_path(const char cmd[], size_t path_len, char path[])
 	size_t paths_count;
 	char **paths;
 
+	/* Avoid checking every directory for commands that aren't there. */
+	if(!path_env_may_have(cmd))
+	{
+		return 1;
+	}
+
 	paths = get_paths(&paths_count);
 	for(i = 0; i < paths_count; i++)
 	{
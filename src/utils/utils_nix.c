@@ -37,7 +37,9 @@
 #include <sys/wait.h> /* WEXITSTATUS() WIFEXITED() WIFSIGNALED() waitpid() */
 #include <fcntl.h> /* open() close() */
 #include <grp.h> /* getgrnam() getgrgid_r() */
-#include <pthread.h> /* pthread_sigmask() */
+#include <poll.h> /* POLLERR POLLPRI poll() pollfd */
+#include <pthread.h> /* PTHREAD_MUTEX_INITIALIZER pthread_mutex_lock()
+                        pthread_mutex_unlock() pthread_sigmask() */
 #include <pwd.h> /* getpwnam() getpwuid_r() */
 #include <unistd.h> /* X_OK chown() close() dup() dup2() getpid() isatty()
                        pause() sysconf() ttyname() */
@@ -49,7 +51,7 @@
                        signal() */
 #include <stddef.h> /* NULL size_t */
 #include <stdio.h> /* FILE stderr fclose() fdopen() fprintf() snprintf() */
-#include <stdlib.h> /* atoi() free() */
+#include <stdlib.h> /* atoi() free() qsort() */
 #include <string.h> /* strchr() strdup() strerror() strlen() strncmp() */
 
 #include "../cfg/config.h"
@@ -73,7 +75,7 @@
 #include "str.h"
 #include "utils.h"
 
-/* Types of mount point information for get_mount_point_traverser_state. */
+/* Types of mount point information for get_mount_info(). */
 typedef enum
 {
 	MI_MOUNT_POINT, /* Path to the mount point. */
@@ -81,18 +83,29 @@ typedef enum
 }
 mntinfo;
 
-/* State for get_mount_point() traverser. */
+/* Snapshot of mount table.  It's shared by all threads and is freed when the
+ * last user releases it. */
 typedef struct
 {
-	mntinfo type;     /* Type of information to put into the buffer. */
-	const char *path; /* Path whose mount point we're looking for. */
-	size_t buf_len;   /* Output buffer length. */
-	char *buf;        /* Output buffer. */
-	size_t curr_len;  /* Max length among all found points (len of buf string). */
+	struct mntent *entries; /* Entries in the order of the mount table. */
+	unsigned int nentries;  /* Number of entries. */
+	unsigned int *by_dir;   /* Indexes of entries sorted by mount point. */
+	int refs;               /* Number of users of the snapshot. */
 }
-get_mount_point_traverser_state;
-
-static int get_mount_info_traverser(struct mntent *entry, void *arg);
+mnt_table_t;
+
+static int get_mount_info(const char path[], mntinfo type, size_t buf_len,
+		char buf[]);
+static const struct mntent * find_mount(const mnt_table_t *table,
+		const char path[]);
+static const struct mntent * find_mount_dir(const mnt_table_t *table,
+		const char dir[], size_t len);
+static mnt_table_t * acquire_mnt_table(void);
+static void release_mnt_table(mnt_table_t *table);
+static void free_mnt_table(mnt_table_t *table);
+static int mnt_table_changed(void);
+static mnt_table_t * make_mnt_table(void);
+static int by_dir_cmp(const void *a, const void *b);
 static void process_cancel_request(pid_t pid,
 		const cancellation_t *cancellation);
 static void free_mnt_entries(struct mntent *entries, unsigned int nentries);
@@ -102,6 +115,13 @@ static void free_mnt_entry(struct mntent *entry);
 static int starts_with_list_item(const char str[], const char list[]);
 static int find_path_prefix_index(const char path[], const char list[]);
 static int open_tty(void);
+
+/* Protects cached mount table and reference counters of all tables. */
+static pthread_mutex_t mnt_table_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Cached mount table, holds a reference to it. */
+static mnt_table_t *cached_mnt_table;
+/* Table whose entries are being sorted by make_mnt_table(). */
+static const mnt_table_t *by_dir_table;
 static void clone_timestamps(const char path[], const char from[],
 		const struct stat *st);
 static void clone_xattrs(const char path[], const char from[]);
@@ -330,6 +350,7 @@ prepare_for_exec(void)
 	{
 		view_t *view = tab_info.view;
 		fswatch_free(view->watch);
+		fswatch_set_free(view->tree_watch);
 		fswatch_free(view->left_column.watch);
 		fswatch_free(view->right_column.watch);
 	}
@@ -493,15 +514,6 @@ is_on_slow_fs(const char full_path[], const char slowfs_specs[])
 		return 0;
 	}
 
-	char fs_name[PATH_MAX + 1];
-	get_mount_point_traverser_state state = {
-		.type = MI_FS_TYPE,
-		.path = full_path,
-		.buf_len = sizeof(fs_name),
-		.buf = fs_name,
-		.curr_len = 0UL,
-	};
-
 	/* If slowfs equals "*" then all file systems are considered slow.  On cygwin
 	 * obtaining list of mounts from /etc/mtab, which is linked to /proc/mounts,
 	 * is very slow in presence of network drives. */
@@ -510,14 +522,12 @@ is_on_slow_fs(const char full_path[], const char slowfs_specs[])
 		return 1;
 	}
 
-	if(traverse_mount_points(&get_mount_info_traverser, &state) == 0)
+	char fs_name[PATH_MAX + 1];
+	if(get_mount_info(full_path, MI_FS_TYPE, sizeof(fs_name), fs_name) == 0)
 	{
-		if(state.curr_len > 0)
+		if(starts_with_list_item(fs_name, slowfs_specs))
 		{
-			if(starts_with_list_item(fs_name, slowfs_specs))
-			{
-				return 1;
-			}
+			return 1;
 		}
 	}
 
@@ -527,81 +537,309 @@ is_on_slow_fs(const char full_path[], const char slowfs_specs[])
 int
 get_mount_point(const char path[], size_t buf_len, char buf[])
 {
-	get_mount_point_traverser_state state = {
-		.type = MI_MOUNT_POINT,
-		.path = path,
-		.buf_len = buf_len,
-		.buf = buf,
-		.curr_len = 0UL,
-	};
-	return traverse_mount_points(&get_mount_info_traverser, &state);
+	return get_mount_info(path, MI_MOUNT_POINT, buf_len, buf);
 }
 
-/* traverse_mount_points client that gets mount point info for a given path. */
+/* Retrieves information about mount point of the path.  Returns zero on
+ * success, otherwise non-zero is returned. */
 static int
-get_mount_info_traverser(struct mntent *entry, void *arg)
+get_mount_info(const char path[], mntinfo type, size_t buf_len, char buf[])
+{
+	mnt_table_t *const table = acquire_mnt_table();
+	if(table == NULL)
+	{
+		return 1;
+	}
+
+	const struct mntent *const entry = find_mount(table, path);
+	if(entry != NULL)
+	{
+		switch(type)
+		{
+			case MI_MOUNT_POINT:
+				copy_str(buf, buf_len, entry->mnt_dir);
+				break;
+			case MI_FS_TYPE:
+				copy_str(buf, buf_len, entry->mnt_type);
+				break;
+
+			default:
+				assert(0 && "Unknown mount information type.");
+				break;
+		}
+	}
+
+	release_mnt_table(table);
+	return (entry == NULL);
+}
+
+/* Finds entry of mount table with the longest mount point that contains the
+ * path.  Checks every parent of the path via binary search, which makes the
+ * lookup independent of the size of the table.  Returns the entry or NULL. */
+static const struct mntent *
+find_mount(const mnt_table_t *table, const char path[])
 {
-	get_mount_point_traverser_state *const state = arg;
-	if(path_starts_with(state->path, entry->mnt_dir))
+	if(path[0] != '/')
+	{
+		return NULL;
+	}
+
+	size_t len = strlen(path);
+	while(len > 1U && path[len - 1U] == '/')
 	{
-		const size_t new_len = strlen(entry->mnt_dir);
-		if(new_len > state->curr_len)
+		--len;
+	}
+
+	while(len > 1U)
+	{
+		const struct mntent *const entry = find_mount_dir(table, path, len);
+		if(entry != NULL)
+		{
+			return entry;
+		}
+
+		/* Strip last path component along with slashes that precede it. */
+		while(len > 1U && path[len - 1U] != '/')
+		{
+			--len;
+		}
+		while(len > 1U && path[len - 1U] == '/')
 		{
-			state->curr_len = new_len;
-			switch(state->type)
+			--len;
+		}
+	}
+
+	return find_mount_dir(table, "/", 1U);
+}
+
+/* Looks up entry of mount table whose mount point matches first len characters
+ * of the dir.  If there are several such entries, the first one is picked.
+ * Returns the entry or NULL. */
+static const struct mntent *
+find_mount_dir(const mnt_table_t *table, const char dir[], size_t len)
+{
+	const struct mntent *found = NULL;
+
+	unsigned int l = 0U, r = table->nentries;
+	while(l < r)
+	{
+		const unsigned int m = l + (r - l)/2U;
+		const struct mntent *const entry = &table->entries[table->by_dir[m]];
+
+		int cmp = strncmp(entry->mnt_dir, dir, len);
+		if(cmp == 0 && entry->mnt_dir[len] != '\0')
+		{
+			cmp = 1;
+		}
+
+		if(cmp < 0)
+		{
+			l = m + 1U;
+		}
+		else
+		{
+			/* Continue to the left to find the first of equal entries. */
+			if(cmp == 0)
 			{
-				case MI_MOUNT_POINT:
-					copy_str(state->buf, state->buf_len, entry->mnt_dir);
-					break;
-				case MI_FS_TYPE:
-					copy_str(state->buf, state->buf_len, entry->mnt_type);
-					break;
-
-				default:
-					assert(0 && "Unknown mount information type.");
-					break;
+				found = entry;
 			}
+			r = m;
 		}
 	}
-	return 0;
+
+	return found;
 }
 
 int
 traverse_mount_points(mptraverser client, void *arg)
 {
-	/* Cached mount entries, updated only when /etc/mtab changes. */
-	static filemon_t mtab_mon;
-	static struct mntent *entries;
-	static unsigned int nentries;
+	mnt_table_t *const table = acquire_mnt_table();
+	if(table == NULL)
+	{
+		return 1;
+	}
 
-	filemon_t mon;
 	unsigned int i;
+	for(i = 0U; i < table->nentries; ++i)
+	{
+		if(client(&table->entries[i], arg))
+		{
+			break;
+		}
+	}
 
-	/* Check for cache validity. */
-	if(filemon_from_file("/etc/mtab", FMT_MODIFIED, &mon) != 0 ||
-			!filemon_equal(&mon, &mtab_mon))
+	release_mnt_table(table);
+	return 0;
+}
+
+/* Retrieves up-to-date snapshot of mount table, which must be released with
+ * release_mnt_table().  Returns the snapshot or NULL if there are no mount
+ * points. */
+static mnt_table_t *
+acquire_mnt_table(void)
+{
+	mnt_table_t *stale = NULL;
+
+	pthread_mutex_lock(&mnt_table_lock);
+
+	if(cached_mnt_table == NULL || mnt_table_changed())
 	{
-		mtab_mon = mon;
-		free_mnt_entries(entries, nentries);
-		entries = read_mnt_entries(&nentries);
+		mnt_table_t *const table = make_mnt_table();
+		if(table != NULL)
+		{
+			if(cached_mnt_table != NULL && --cached_mnt_table->refs == 0)
+			{
+				stale = cached_mnt_table;
+			}
+			cached_mnt_table = table;
+		}
 	}
 
-	if(nentries == 0U)
+	mnt_table_t *const table = cached_mnt_table;
+	if(table != NULL)
 	{
-		return 1;
+		++table->refs;
 	}
 
-	for(i = 0; i < nentries; ++i)
+	pthread_mutex_unlock(&mnt_table_lock);
+
+	if(stale != NULL)
+	{
+		free_mnt_table(stale);
+	}
+
+	if(table != NULL && table->nentries == 0U)
+	{
+		release_mnt_table(table);
+		return NULL;
+	}
+	return table;
+}
+
+/* Drops a reference to mount table snapshot freeing it if necessary. */
+static void
+release_mnt_table(mnt_table_t *table)
+{
+	pthread_mutex_lock(&mnt_table_lock);
+	const int unused = (--table->refs == 0);
+	pthread_mutex_unlock(&mnt_table_lock);
+
+	if(unused)
+	{
+		free_mnt_table(table);
+	}
+}
+
+/* Frees mount table snapshot that has no users. */
+static void
+free_mnt_table(mnt_table_t *table)
+{
+	free_mnt_entries(table->entries, table->nentries);
+	free(table->by_dir);
+	free(table);
+}
+
+/* Checks whether mount table might have changed since the last call.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+mnt_table_changed(void)
+{
+#ifdef __linux__
+	/* Descriptor of mounts file, which becomes "exceptional" on changes of mount
+	 * table. */
+	static int mounts_fd = -2;
+	if(mounts_fd == -2)
 	{
-		if(client(&entries[i], arg))
+		mounts_fd = open("/proc/self/mounts", O_RDONLY | O_CLOEXEC);
+		if(mounts_fd != -1)
 		{
-			break;
+			/* The table might have been read before the file was opened. */
+			return 1;
 		}
 	}
 
+	if(mounts_fd != -1)
+	{
+		struct pollfd pfd = { .fd = mounts_fd, .events = POLLPRI };
+		/* Kernel re-arms the notification on each poll().  Zero means that
+		 * nothing has happened. */
+		const int r = poll(&pfd, 1, 0);
+		return r < 0 || (r > 0 && (pfd.revents & (POLLERR | POLLPRI)) != 0);
+	}
+#endif
+
+	/* Cached timestamp of /etc/mtab, which is used when mounts file can't be
+	 * polled. */
+	static filemon_t mtab_mon;
+
+	filemon_t mon;
+	if(filemon_from_file("/etc/mtab", FMT_MODIFIED, &mon) != 0 ||
+			!filemon_equal(&mon, &mtab_mon))
+	{
+		mtab_mon = mon;
+		return 1;
+	}
 	return 0;
 }
 
+/* Reads mount table and builds an index for it.  Returns the table with a
+ * single reference or NULL on memory allocation error. */
+static mnt_table_t *
+make_mnt_table(void)
+{
+	mnt_table_t *const table = calloc(1, sizeof(*table));
+	if(table == NULL)
+	{
+		return NULL;
+	}
+
+	table->refs = 1;
+	table->entries = read_mnt_entries(&table->nentries);
+	if(table->nentries == 0U)
+	{
+		return table;
+	}
+
+	table->by_dir = reallocarray(NULL, table->nentries, sizeof(*table->by_dir));
+	if(table->by_dir == NULL)
+	{
+		free_mnt_table(table);
+		return NULL;
+	}
+
+	unsigned int i;
+	for(i = 0U; i < table->nentries; ++i)
+	{
+		table->by_dir[i] = i;
+	}
+
+	/* qsort() doesn't have access to the table, so pass it through a global
+	 * variable under the lock held by the caller. */
+	by_dir_table = table;
+	qsort(table->by_dir, table->nentries, sizeof(*table->by_dir), &by_dir_cmp);
+	by_dir_table = NULL;
+
+	return table;
+}
+
+/* qsort() comparer of indexes of mount table entries that orders them by mount
+ * point keeping order of the table for equal mount points.  Returns standard
+ * -1, 0, 1 for comparisons. */
+static int
+by_dir_cmp(const void *a, const void *b)
+{
+	const unsigned int lhs = *(const unsigned int *)a;
+	const unsigned int rhs = *(const unsigned int *)b;
+
+	const int cmp = strcmp(by_dir_table->entries[lhs].mnt_dir,
+			by_dir_table->entries[rhs].mnt_dir);
+	if(cmp != 0)
+	{
+		return cmp;
+	}
+	return (lhs > rhs) - (lhs < rhs);
+}
+
 /* Frees array of mount entries. */
 static void
 free_mnt_entries(struct mntent *entries, unsigned int nentries)
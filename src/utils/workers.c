@@ -0,0 +1,161 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "workers.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h> /* sysconf() */
+#endif
+
+#include <stdlib.h> /* free() */
+
+#include "../compat/pthread.h"
+#include "../compat/reallocarray.h"
+
+/* State shared by all threads processing the same range. */
+typedef struct
+{
+	pthread_mutex_t lock; /* Protects next field. */
+	int next;             /* Index of the first item that's not taken yet. */
+	int count;            /* Total number of items. */
+	int chunk;            /* Maximum number of items processed at once. */
+	workers_func func;    /* Item processor. */
+	void *arg;            /* Argument for the processor. */
+}
+range_t;
+
+static void * worker_thread(void *arg);
+static void process_range(range_t *range);
+static int take_chunk(range_t *range, int *from, int *to);
+
+void
+workers_for(int count, int chunk, int max_workers, workers_func func,
+		void *arg)
+{
+	if(count <= 0)
+	{
+		return;
+	}
+
+	if(chunk < 1)
+	{
+		chunk = 1;
+	}
+
+	int nchunks = (count + chunk - 1)/chunk;
+	int nworkers = (max_workers < nchunks ? max_workers : nchunks);
+	if(nworkers <= 1)
+	{
+		func(arg, 0, count);
+		return;
+	}
+
+	range_t range = {
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.count = count,
+		.chunk = chunk,
+		.func = func,
+		.arg = arg,
+	};
+
+	/* The calling thread is one of the workers. */
+	pthread_t *threads = reallocarray(NULL, nworkers - 1, sizeof(*threads));
+	int nthreads = 0;
+	if(threads != NULL)
+	{
+		while(nthreads < nworkers - 1)
+		{
+			if(pthread_create(&threads[nthreads], NULL, &worker_thread,
+						&range) != 0)
+			{
+				break;
+			}
+			++nthreads;
+		}
+	}
+
+	process_range(&range);
+
+	int i;
+	for(i = 0; i < nthreads; ++i)
+	{
+		(void)pthread_join(threads[i], NULL);
+	}
+
+	free(threads);
+	pthread_mutex_destroy(&range.lock);
+}
+
+/* Entry point of a worker thread.  Returns NULL. */
+static void *
+worker_thread(void *arg)
+{
+	process_range(arg);
+	return NULL;
+}
+
+/* Processes chunks of the range until there are none left. */
+static void
+process_range(range_t *range)
+{
+	int from, to;
+	while(take_chunk(range, &from, &to))
+	{
+		range->func(range->arg, from, to);
+	}
+}
+
+/* Reserves next chunk of the range for the calling thread.  Returns non-zero if
+ * *from and *to were set, otherwise zero is returned. */
+static int
+take_chunk(range_t *range, int *from, int *to)
+{
+	int taken = 0;
+
+	pthread_mutex_lock(&range->lock);
+	if(range->next < range->count)
+	{
+		*from = range->next;
+		*to = (range->count - *from > range->chunk)
+		    ? *from + range->chunk
+		    : range->count;
+		range->next = *to;
+		taken = 1;
+	}
+	pthread_mutex_unlock(&range->lock);
+
+	return taken;
+}
+
+int
+workers_cpu_count(void)
+{
+#ifndef _WIN32
+	const long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return (count > 0 ? (int)count : 1);
+#else
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1);
+#endif
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,44 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__WORKERS_H__
+#define VIFM__UTILS__WORKERS_H__
+
+/* Bounded pool of short-lived threads for processing ranges of items in
+ * parallel.  The calling thread takes part in processing and the call returns
+ * only after all items are processed. */
+
+/* Callback that processes items with indexes in the [from, to) range.  Might be
+ * called concurrently from several threads for non-overlapping ranges. */
+typedef void (*workers_func)(void *arg, int from, int to);
+
+/* Processes items with indexes in the [0, count) range by handing out chunks of
+ * at most chunk items to up to max_workers threads (including the calling
+ * one).  Falls back to processing everything in the calling thread if creating
+ * threads fails or isn't worth it. */
+void workers_for(int count, int chunk, int max_workers, workers_func func,
+		void *arg);
+
+/* Retrieves number of processors available to the application.  Returns the
+ * number, which is at least one. */
+int workers_cpu_count(void);
+
+#endif /* VIFM__UTILS__WORKERS_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
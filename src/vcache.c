@@ -20,9 +20,12 @@
 
 #include <fcntl.h> /* F_GETFL F_SETFL O_NONBLOCK fcntl() */
 
+#include <ctype.h> /* tolower() */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
 #include <stdio.h> /* FILE */
-#include <stdlib.h> /* free() */
-#include <string.h> /* memmove() memset() strcmp() */
+#include <stdlib.h> /* calloc() free() */
+#include <string.h> /* strcmp() strlen() */
 #include <time.h> /* time_t time() */
 
 #include "cfg/config.h"
@@ -31,7 +34,6 @@
 #include "ui/cancellation.h"
 #include "ui/quickview.h"
 #include "ui/ui.h"
-#include "utils/darray.h"
 #include "utils/file_streams.h"
 #include "utils/filemon.h"
 #include "utils/fs.h"
@@ -50,9 +52,20 @@ enum { MAX_RUN_TIME_S = 60 };
 /* Maximum number of seconds to wait for process to cancel. */
 enum { MAX_KILL_DELAY_S = 2 };
 
+/* Maximum number of viewers running at the same time for prefetching. */
+enum { MAX_PREFETCH_JOBS = 2 };
+
+/* Initial number of buckets of the hash table. */
+enum { MIN_BUCKETS = 64 };
+
 /* Cached output of a specific previewer for a specific file. */
 typedef struct vcache_entry_t
 {
+	struct vcache_entry_t *prev; /* Less recently used entry or NULL. */
+	struct vcache_entry_t *next; /* More recently used entry or NULL. */
+	struct vcache_entry_t *hnext; /* Next entry in the same bucket or NULL. */
+	uint64_t hash;                /* Hash of path and viewer. */
+
 	char *path;        /* Full path to the file. */
 	char *viewer;      /* Viewer of the file. */
 	bg_job_t *job;     /* If not NULL, source of file contents. */
@@ -60,7 +73,7 @@ typedef struct vcache_entry_t
 	strlist_t lines;   /* Top lines of preview contents. */
 	time_t started_at; /* Since when we're waiting for the data. */
 	time_t kill_timer; /* Since when we're waiting for the job to die or zero. */
-	size_t size;       /* Size taken up by this entry (lower bound). */
+	size_t size;       /* Size taken up by this entry in bytes. */
 	int max_lines;     /* Number of lines requested. */
 
 	/* Value of maxtreedepth for this entry. */
@@ -71,16 +84,30 @@ typedef struct vcache_entry_t
 	unsigned int truncated : 1;
 	/* Value of toptreestats for this entry. */
 	unsigned int top_tree_stats : 1;
+	/* Whether entry was created speculatively and wasn't looked up yet. */
+	unsigned int prefetched : 1;
+	/* Whether prefetched entry was requested during current round. */
+	unsigned int wanted : 1;
 }
 vcache_entry_t;
 
-TSTATIC size_t vcache_entry_size(void);
+TSTATIC size_t vcache_entry_size(const char path[], const char viewer[]);
 static void wait_async_finish(vcache_entry_t *centry);
+static int can_prefetch(const char viewer[], MacroFlags flags,
+		ViewerKind kind);
+static int count_prefetch_jobs(void);
 static vcache_entry_t * find_cache_entry(const char full_path[],
-		const char viewer[], int max_lines);
-static vcache_entry_t * alloc_cache_entry(void);
+		const char viewer[]);
+static vcache_entry_t * alloc_cache_entry(const char full_path[],
+		const char viewer[]);
 static void compact_cache(void);
-static vcache_entry_t * new_cache_entry(void);
+static vcache_entry_t * new_cache_entry(const char full_path[],
+		const char viewer[], int most_recent);
+static void grow_table(void);
+static void link_entry(vcache_entry_t *centry, int most_recent);
+static void unlink_entry(vcache_entry_t *centry);
+static void remove_cache_entry(vcache_entry_t *centry);
+static uint64_t hash_key(const char path[], const char viewer[]);
 TSTATIC void vcache_reset(size_t max_size);
 static void free_cache_entry(vcache_entry_t *centry);
 static int is_cache_match(const vcache_entry_t *centry, const char path[],
@@ -103,11 +130,17 @@ static strlist_t view_external(vcache_entry_t *centry, MacroFlags flags,
 		const char **error);
 TSTATIC strlist_t read_lines(FILE *fp, int max_lines, int *complete);
 
-/* Cache of viewers' output.  Ordered from least to most recently used. */
-static vcache_entry_t **cache;
-/* Declarations to enable use of DA_* on cache. */
-static DA_INSTANCE(cache);
-/* Amount of memory taken up by the cache (lower bound). */
+/* List of entries of the cache of viewers' output ordered from least to most
+ * recently used. */
+static vcache_entry_t *lru_first, *lru_last;
+/* Hash table of the entries keyed by path and viewer, chained through hnext
+ * field. */
+static vcache_entry_t **buckets;
+/* Number of buckets, always a power of two or zero. */
+static size_t nbuckets;
+/* Number of entries in the cache. */
+static size_t nentries;
+/* Amount of memory taken up by the cache in bytes. */
 static size_t cache_size;
 /* Maximum size of the cache. */
 static size_t max_cache_size = 3U*1024*1024;
@@ -115,15 +148,15 @@ static size_t max_cache_size = 3U*1024*1024;
 void
 vcache_finish(void)
 {
-	size_t i;
-	for(i = 0U; i < DA_SIZE(cache); ++i)
+	vcache_entry_t *centry;
+	for(centry = lru_first; centry != NULL; centry = centry->next)
 	{
-		if(cache[i]->job != NULL)
+		if(centry->job != NULL)
 		{
-			bg_job_cancel(cache[i]->job);
-			bg_job_terminate(cache[i]->job);
-			bg_job_decref(cache[i]->job);
-			cache[i]->job = NULL;
+			bg_job_cancel(centry->job);
+			bg_job_terminate(centry->job);
+			bg_job_decref(centry->job);
+			centry->job = NULL;
 		}
 	}
 }
@@ -134,10 +167,16 @@ vcache_size(void)
 	return cache_size;
 }
 
+/* Computes size of an entry that has no lines.  Returns the size. */
 TSTATIC size_t
-vcache_entry_size(void)
+vcache_entry_size(const char path[], const char viewer[])
 {
-	return sizeof(vcache_entry_t);
+	size_t size = sizeof(vcache_entry_t) + strlen(path) + 1U;
+	if(viewer != NULL)
+	{
+		size += strlen(viewer) + 1U;
+	}
+	return size;
 }
 
 int
@@ -147,12 +186,12 @@ vcache_check(vcache_is_previewed_cb is_previewed)
 
 	/* TODO: consider doing this in a separate thread. */
 
-	size_t i;
-	for(i = 0U; i < DA_SIZE(cache); ++i)
+	vcache_entry_t *centry;
+	for(centry = lru_first; centry != NULL; centry = centry->next)
 	{
-		if(cache[i]->job != NULL)
+		if(centry->job != NULL)
 		{
-			changed |= (pull_async(cache[i]) && is_previewed(cache[i]->path));
+			changed |= (pull_async(centry) && is_previewed(centry->path));
 		}
 	}
 
@@ -182,7 +221,16 @@ vcache_lookup(const char full_path[], const char viewer[], MacroFlags flags,
 		return non_cache.lines;
 	}
 
-	vcache_entry_t *centry = find_cache_entry(full_path, viewer, max_lines);
+	vcache_entry_t *centry = find_cache_entry(full_path, viewer);
+	if(centry != NULL)
+	{
+		/* Make it the most recently used entry. */
+		unlink_entry(centry);
+		link_entry(centry, /*most_recent=*/1);
+
+		/* The entry is no longer speculative. */
+		centry->prefetched = 0;
+	}
 	if(centry != NULL && is_cache_valid(centry, full_path, viewer, max_lines))
 	{
 		return centry->lines;
@@ -190,7 +238,7 @@ vcache_lookup(const char full_path[], const char viewer[], MacroFlags flags,
 
 	if(centry == NULL)
 	{
-		centry = alloc_cache_entry();
+		centry = alloc_cache_entry(full_path, viewer);
 		if(centry == NULL)
 		{
 			*error = "Failed to allocate cache entry";
@@ -204,6 +252,7 @@ vcache_lookup(const char full_path[], const char viewer[], MacroFlags flags,
 	if(sync)
 	{
 		wait_async_finish(centry);
+		update_sizes(centry);
 	}
 
 	if(kind != VK_PASS_THROUGH && centry->lines.nitems == 0 &&
@@ -218,6 +267,96 @@ vcache_lookup(const char full_path[], const char viewer[], MacroFlags flags,
 	return centry->lines;
 }
 
+void
+vcache_prefetch_begin(void)
+{
+	vcache_entry_t *centry;
+	for(centry = lru_first; centry != NULL; centry = centry->next)
+	{
+		centry->wanted = 0;
+	}
+}
+
+void
+vcache_prefetch(const char full_path[], const char viewer[], MacroFlags flags,
+		ViewerKind kind, int max_lines)
+{
+	if(!can_prefetch(viewer, flags, kind))
+	{
+		return;
+	}
+
+	vcache_entry_t *centry = find_cache_entry(full_path, viewer);
+	if(centry != NULL)
+	{
+		centry->wanted = 1;
+		return;
+	}
+
+	/* Speculative entries don't push out entries that were actually viewed. */
+	if(cache_size >= max_cache_size || count_prefetch_jobs() >= MAX_PREFETCH_JOBS)
+	{
+		return;
+	}
+
+	/* Make it the least recently used entry to be the first one to go. */
+	centry = new_cache_entry(full_path, viewer, /*most_recent=*/0);
+	if(centry == NULL)
+	{
+		return;
+	}
+
+	centry->prefetched = 1;
+	centry->wanted = 1;
+
+	const char *error;
+	update_cache_entry(centry, full_path, viewer, flags, max_lines, &error);
+}
+
+void
+vcache_prefetch_end(void)
+{
+	vcache_entry_t *centry;
+	for(centry = lru_first; centry != NULL; centry = centry->next)
+	{
+		if(centry->prefetched && !centry->wanted && centry->job != NULL &&
+				centry->kill_timer == 0)
+		{
+			cancel_job(centry);
+		}
+	}
+}
+
+/* Checks whether output of the viewer can be computed ahead of time.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+can_prefetch(const char viewer[], MacroFlags flags, ViewerKind kind)
+{
+	/* Builtin viewer and plugins run synchronously, so there is nothing to gain
+	 * by running them in advance. */
+	return kind == VK_TEXTUAL
+	    && flags == MF_NONE
+	    && !is_null_or_empty(viewer)
+	    && !vlua_handler_cmd(curr_stats.vlua, viewer);
+}
+
+/* Counts running viewers that were started speculatively.  Returns the
+ * number. */
+static int
+count_prefetch_jobs(void)
+{
+	int count = 0;
+
+	const vcache_entry_t *centry;
+	for(centry = lru_first; centry != NULL; centry = centry->next)
+	{
+		count += (centry->prefetched && centry->job != NULL &&
+				centry->kill_timer == 0);
+	}
+
+	return count;
+}
+
 /* Waits for asynchronous job to be done. */
 static void
 wait_async_finish(vcache_entry_t *centry)
@@ -269,33 +408,35 @@ wait_async_finish(vcache_entry_t *centry)
 	centry->job = NULL;
 }
 
-/* Looks up existing cache entry that matches specified set of parameters.
- * Returns the entry or NULL. */
+/* Looks up existing cache entry for the file and viewer without affecting
+ * order of entries.  Returns the entry or NULL. */
 static vcache_entry_t *
-find_cache_entry(const char full_path[], const char viewer[], int max_lines)
+find_cache_entry(const char full_path[], const char viewer[])
 {
-	size_t i;
-	for(i = 0U; i < DA_SIZE(cache); ++i)
+	if(nbuckets == 0U)
 	{
-		if(is_cache_match(cache[i], full_path, viewer))
-		{
-			vcache_entry_t *centry = cache[i];
+		return NULL;
+	}
 
-			/* Make the most recently used entry the last one. */
-			memmove(cache + i, cache + i + 1,
-					sizeof(*cache)*(DA_SIZE(cache) - 1U - i));
-			cache[DA_SIZE(cache) - 1U] = centry;
+	const uint64_t hash = hash_key(full_path, viewer);
 
+	vcache_entry_t *centry = buckets[hash & (nbuckets - 1U)];
+	while(centry != NULL)
+	{
+		if(centry->hash == hash && is_cache_match(centry, full_path, viewer))
+		{
 			return centry;
 		}
+		centry = centry->hnext;
 	}
 	return NULL;
 }
 
-/* Allocates a zero-initialized cache entry.  When cache size limit is reached
- * older cache entries are reused.  Returns the entry or NULL. */
+/* Allocates a zero-initialized cache entry as the most recently used one.  When
+ * cache size limit is reached older cache entries are dropped.  Returns the
+ * entry or NULL. */
 static vcache_entry_t *
-alloc_cache_entry(void)
+alloc_cache_entry(const char full_path[], const char viewer[])
 {
 	if(max_cache_size == 0U)
 	{
@@ -303,71 +444,189 @@ alloc_cache_entry(void)
 	}
 
 	compact_cache();
-	return new_cache_entry();
+	return new_cache_entry(full_path, viewer, /*most_recent=*/1);
 }
 
 /* Shrinks cache if its size is larger than the limit. */
 static void
 compact_cache(void)
 {
-	if(cache == NULL)
+	vcache_entry_t *centry = lru_first;
+	while(centry != NULL && cache_size >= max_cache_size)
 	{
-		return;
-	}
-
-	size_t i;
-	size_t j = 0U;
-	for(i = 0U; i < DA_SIZE(cache) && cache_size >= max_cache_size; ++i)
-	{
-		vcache_entry_t *centry = cache[i];
+		vcache_entry_t *const next = centry->next;
 		if(centry->job != NULL)
 		{
-			cache[j++] = centry;
 			/* Give it a chance to finish gracefully. */
 			cancel_job(centry);
-			continue;
 		}
-
-		cache_size -= centry->size;
-		free_cache_entry(centry);
-		free(centry);
+		else
+		{
+			remove_cache_entry(centry);
+		}
+		centry = next;
 	}
-
-	memmove(cache + j, cache + i, sizeof(*cache)*(DA_SIZE(cache) - i));
-	DA_REMOVE_AFTER(cache, cache + j + DA_SIZE(cache) - i);
 }
 
-/* Allocates a new cache entry unconditionally.  Returns the entry. */
+/* Allocates a new cache entry for the file and viewer unconditionally and puts
+ * it either at the most or at the least recently used end of the list.  Returns
+ * the entry or NULL. */
 static vcache_entry_t *
-new_cache_entry(void)
+new_cache_entry(const char full_path[], const char viewer[], int most_recent)
 {
-	vcache_entry_t **centry = DA_EXTEND(cache);
+	if(nentries >= nbuckets)
+	{
+		grow_table();
+		if(nbuckets == 0U)
+		{
+			return NULL;
+		}
+	}
+
+	vcache_entry_t *centry = calloc(1, sizeof(*centry));
 	if(centry == NULL)
 	{
 		return NULL;
 	}
 
-	*centry = calloc(1, sizeof(**centry));
-	if(*centry == NULL)
+	if(replace_string(&centry->path, full_path) != 0 ||
+			update_string(&centry->viewer, viewer) != 0)
 	{
+		free_cache_entry(centry);
+		free(centry);
 		return NULL;
 	}
 
-	DA_COMMIT(cache);
-	return *centry;
+	centry->hash = hash_key(full_path, viewer);
+
+	vcache_entry_t **const bucket = &buckets[centry->hash & (nbuckets - 1U)];
+	centry->hnext = *bucket;
+	*bucket = centry;
+
+	link_entry(centry, most_recent);
+	++nentries;
+
+	update_sizes(centry);
+	return centry;
+}
+
+/* Doubles number of buckets of the hash table redistributing entries.  Leaves
+ * the table as is on failure. */
+static void
+grow_table(void)
+{
+	const size_t new_nbuckets = (nbuckets == 0U ? MIN_BUCKETS : nbuckets*2U);
+	vcache_entry_t **const new_buckets = calloc(new_nbuckets,
+			sizeof(*new_buckets));
+	if(new_buckets == NULL)
+	{
+		return;
+	}
+
+	vcache_entry_t *centry;
+	for(centry = lru_first; centry != NULL; centry = centry->next)
+	{
+		vcache_entry_t **const bucket = &new_buckets[centry->hash &
+			(new_nbuckets - 1U)];
+		centry->hnext = *bucket;
+		*bucket = centry;
+	}
+
+	free(buckets);
+	buckets = new_buckets;
+	nbuckets = new_nbuckets;
+}
+
+/* Puts unlinked entry at one of the ends of the list of entries. */
+static void
+link_entry(vcache_entry_t *centry, int most_recent)
+{
+	if(most_recent)
+	{
+		centry->prev = lru_last;
+		centry->next = NULL;
+		*(lru_last == NULL ? &lru_first : &lru_last->next) = centry;
+		lru_last = centry;
+	}
+	else
+	{
+		centry->prev = NULL;
+		centry->next = lru_first;
+		*(lru_first == NULL ? &lru_last : &lru_first->prev) = centry;
+		lru_first = centry;
+	}
+}
+
+/* Removes entry from the list of entries. */
+static void
+unlink_entry(vcache_entry_t *centry)
+{
+	*(centry->prev == NULL ? &lru_first : &centry->prev->next) = centry->next;
+	*(centry->next == NULL ? &lru_last : &centry->next->prev) = centry->prev;
+	centry->prev = NULL;
+	centry->next = NULL;
+}
+
+/* Removes entry from the cache and frees it. */
+static void
+remove_cache_entry(vcache_entry_t *centry)
+{
+	vcache_entry_t **link = &buckets[centry->hash & (nbuckets - 1U)];
+	while(*link != centry)
+	{
+		link = &(*link)->hnext;
+	}
+	*link = centry->hnext;
+
+	unlink_entry(centry);
+	--nentries;
+
+	cache_size -= centry->size;
+	free_cache_entry(centry);
+	free(centry);
+}
+
+/* Computes hash of the key of an entry consistently with is_cache_match().
+ * Returns the hash. */
+static uint64_t
+hash_key(const char path[], const char viewer[])
+{
+	/* Some additional space is allocated for adding slashes. */
+	char canonic[strlen(path) + 8];
+	canonicalize_path(path, canonic, sizeof(canonic));
+
+	/* FNV-1a, path and viewer are separated by a character that can't appear in
+	 * a path. */
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	const char *p;
+	for(p = canonic; *p != '\0'; ++p)
+	{
+#ifndef _WIN32
+		hash = (hash ^ (unsigned char)*p)*0x100000001b3ULL;
+#else
+		hash = (hash ^ (unsigned char)tolower(*p))*0x100000001b3ULL;
+#endif
+	}
+	hash = (hash ^ (viewer == NULL ? 0xffU : 0x00U))*0x100000001b3ULL;
+	for(p = (viewer == NULL ? "" : viewer); *p != '\0'; ++p)
+	{
+		hash = (hash ^ (unsigned char)*p)*0x100000001b3ULL;
+	}
+	return hash;
 }
 
 /* Invalidates all cache entries and changes size limit. */
 TSTATIC void
 vcache_reset(size_t max_size)
 {
-	size_t i;
-	for(i = 0U; i < DA_SIZE(cache); ++i)
+	while(lru_first != NULL)
 	{
-		free_cache_entry(cache[i]);
-		free(cache[i]);
+		remove_cache_entry(lru_first);
 	}
-	DA_REMOVE_ALL(cache);
+
+	free(buckets);
+	buckets = NULL;
+	nbuckets = 0U;
 
 	max_cache_size = max_size;
 	cache_size = 0;
@@ -452,13 +711,13 @@ update_cache_entry(vcache_entry_t *centry, const char path[],
 	{
 		free_string_array(centry->lines.items, centry->lines.nitems);
 		centry->lines = view_entry(centry, flags, error);
-
-		update_sizes(centry);
 	}
 	else
 	{
 		(void)pull_async(centry);
 	}
+
+	update_sizes(centry);
 }
 
 /* Computes size occupied by the entry updating total cache size too. */
@@ -468,12 +727,13 @@ update_sizes(vcache_entry_t *centry)
 	cache_size -= centry->size;
 
 	/* This isn't zero to make even empty preview result take up space. */
-	centry->size = sizeof(*centry);
+	centry->size = vcache_entry_size(centry->path, centry->viewer)
+	             + sizeof(*centry->lines.items)*centry->lines.nitems;
 
 	int i;
 	for(i = 0; i < centry->lines.nitems; ++i)
 	{
-		centry->size += strlen(centry->lines.items[i]);
+		centry->size += strlen(centry->lines.items[i]) + 1U;
 	}
 
 	cache_size += centry->size;
@@ -522,6 +782,11 @@ pull_async(vcache_entry_t *centry)
 		changed = 1;
 	}
 
+	if(changed)
+	{
+		update_sizes(centry);
+	}
+
 	return changed;
 }
 
@@ -574,8 +839,6 @@ read_async_output(vcache_entry_t *centry)
 	}
 
 	clearerr(centry->job->output);
-	centry->size += len;
-	cache_size += len;
 
 	int new_truncated = (len > 0)
 	                 && (piece[len - 1] != '\r' && piece[len - 1] != '\n');
@@ -46,7 +46,7 @@ struct strlist_t;
 /* Kills all asynchronous viewers. */
 void vcache_finish(void);
 
-/* Retrieves size of the cache (lower bound).  Returns the size. */
+/* Retrieves size of the cache in bytes.  Returns the size. */
 size_t vcache_size(void);
 
 /* Checks updates of asynchronous viewers.  Returns non-zero is screen needs to
@@ -61,10 +61,25 @@ struct strlist_t vcache_lookup(const char full_path[], const char viewer[],
 		MacroFlags flags, ViewerKind kind, int max_lines, int sync,
 		const char **error);
 
+/* Starts a round of prefetching.  Viewers started speculatively for files that
+ * aren't passed to vcache_prefetch() again until vcache_prefetch_end() are
+ * cancelled. */
+void vcache_prefetch_begin(void);
+
+/* Speculatively starts viewer of a file in background if its output isn't
+ * cached yet.  Only external textual viewers are started this way and only
+ * while cache isn't full and there are less than two of them running. */
+void vcache_prefetch(const char full_path[], const char viewer[],
+		MacroFlags flags, ViewerKind kind, int max_lines);
+
+/* Finishes a round of prefetching cancelling viewers of files that are no
+ * longer of interest. */
+void vcache_prefetch_end(void);
+
 TSTATIC_DEFS(
 	struct strlist_t read_lines(FILE *fp, int max_lines, int *complete);
 	void vcache_reset(size_t max_size);
-	size_t vcache_entry_size(void);
+	size_t vcache_entry_size(const char path[], const char viewer[]);
 )
 
 #endif /* VIFM__VCACHE_H__ */
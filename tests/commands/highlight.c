@@ -16,6 +16,8 @@
 #include "../../src/filelist.h"
 #include "../../src/status.h"
 
+static int get_file_hi(const char fname[]);
+
 SETUP_ONCE()
 {
 	cmds_init();
@@ -576,5 +578,114 @@ TEST(tabs_are_allowed)
 	}
 }
 
+TEST(first_matching_file_hi_wins)
+{
+	assert_success(cmds_dispatch("highlight {*.txt} cterm=bold", &lwin,
+				CIT_COMMAND));
+	assert_success(cmds_dispatch("highlight /^a/ cterm=bold", &lwin,
+				CIT_COMMAND));
+	assert_success(cmds_dispatch("highlight {a.txt,b.c} cterm=bold", &lwin,
+				CIT_COMMAND));
+	assert_success(cmds_dispatch("highlight {*.c} cterm=bold", &lwin,
+				CIT_COMMAND));
+
+	assert_int_equal(0, get_file_hi("a.txt"));
+	assert_int_equal(1, get_file_hi("a.c"));
+	assert_int_equal(1, get_file_hi("abc"));
+	assert_int_equal(2, get_file_hi("b.c"));
+	assert_int_equal(3, get_file_hi("c.c"));
+	assert_int_equal(INT_MAX, get_file_hi("c.h"));
+}
+
+TEST(file_hi_globs_ignore_case)
+{
+	assert_success(cmds_dispatch("highlight {README,*.txt} cterm=bold", &lwin,
+				CIT_COMMAND));
+
+	assert_int_equal(0, get_file_hi("readme"));
+	assert_int_equal(0, get_file_hi("ReadMe"));
+	assert_int_equal(0, get_file_hi("FILE.TXT"));
+	assert_int_equal(INT_MAX, get_file_hi("readme.md"));
+}
+
+TEST(file_hi_suffix_globs_skip_dot_files)
+{
+	assert_success(cmds_dispatch("highlight {*.txt,.vimrc} cterm=bold", &lwin,
+				CIT_COMMAND));
+
+	assert_int_equal(0, get_file_hi("a.txt"));
+	assert_int_equal(0, get_file_hi(".vimrc"));
+	assert_int_equal(INT_MAX, get_file_hi(".txt"));
+	assert_int_equal(INT_MAX, get_file_hi(".a.txt"));
+}
+
+TEST(file_hi_matches_last_path_component)
+{
+	assert_success(cmds_dispatch("highlight {*.txt,dir/} cterm=bold", &lwin,
+				CIT_COMMAND));
+	assert_success(cmds_dispatch("highlight {{/tmp/*.c}} cterm=bold", &lwin,
+				CIT_COMMAND));
+
+	assert_int_equal(0, get_file_hi("/path/a.txt"));
+	assert_int_equal(0, get_file_hi("/path/dir/"));
+	assert_int_equal(1, get_file_hi("/tmp/a.c"));
+	assert_int_equal(INT_MAX, get_file_hi("/path/a.c"));
+}
+
+TEST(file_hi_lookup_reflects_changes_of_rules)
+{
+	assert_success(cmds_dispatch("highlight {*.txt} cterm=bold", &lwin,
+				CIT_COMMAND));
+	assert_int_equal(INT_MAX, get_file_hi("a.c"));
+
+	assert_success(cmds_dispatch("highlight {*.c} cterm=bold", &lwin,
+				CIT_COMMAND));
+	assert_int_equal(1, get_file_hi("a.c"));
+
+	assert_success(cmds_dispatch("highlight clear {*.txt}", &lwin,
+				CIT_COMMAND));
+	assert_int_equal(0, get_file_hi("a.c"));
+	assert_int_equal(INT_MAX, get_file_hi("a.txt"));
+}
+
+TEST(benchmark_file_hi_lookup, IF(benchmarks_enabled))
+{
+	enum { RULES = 200, NAMES = 1000000 };
+
+	int i;
+	for(i = 0; i < RULES; ++i)
+	{
+		char cmd[64];
+		snprintf(cmd, sizeof(cmd), "highlight {*.ext%d,name%d} cterm=bold", i, i);
+		assert_success(cmds_dispatch(cmd, &lwin, CIT_COMMAND));
+	}
+	assert_success(cmds_dispatch("highlight /^x.*y$/ cterm=bold", &lwin,
+				CIT_COMMAND));
+
+	int matched = 0;
+	const double start = bench_time();
+	for(i = 0; i < NAMES; ++i)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "file%d.ext%d", i, i%(2*RULES));
+		matched += (get_file_hi(name) != INT_MAX);
+	}
+	const double elapsed = bench_time() - start;
+
+	assert_int_equal(NAMES/2, matched);
+	printf("Classifying %d names against %d rules: %.3fs\n", NAMES, RULES + 1,
+			elapsed);
+}
+
+/* Looks up file highlight for the file.  Returns index of the rule or
+ * INT_MAX. */
+static int
+get_file_hi(const char fname[])
+{
+	int hi_hint = -1;
+	(void)cs_get_file_hi(curr_stats.cs, fname, &hi_hint);
+	return hi_hint;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
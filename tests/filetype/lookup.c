@@ -0,0 +1,100 @@
+#include <stic.h>
+
+#include <stdio.h> /* snprintf() */
+#include <string.h> /* memset() */
+
+#include <test-utils.h>
+
+#include "../../src/compat/fs_limits.h"
+#include "../../src/filetype.h"
+
+static void check_viewers(const char file[], int count, const char *viewers[]);
+
+TEST(order_of_associations_is_preserved)
+{
+	assoc_viewers("{*.c}", "prog1");
+	assoc_viewers("/^a/", "prog2");
+	assoc_viewers("{a.c,*.h},{*.C}", "prog3");
+	assoc_viewers("{*}", "prog4");
+	assoc_viewers("!{*.c}", "prog5");
+
+	check_viewers("a.c", 4, (const char *[]){ "prog1", "prog2", "prog3",
+			"prog4" });
+	check_viewers("b.h", 3, (const char *[]){ "prog3", "prog4", "prog5" });
+	check_viewers("b.c", 3, (const char *[]){ "prog1", "prog3", "prog4" });
+	check_viewers(".a", 1, (const char *[]){ "prog5" });
+	check_viewers("/path/to/A.C", 4, (const char *[]){ "prog1", "prog2",
+			"prog3", "prog4" });
+}
+
+TEST(first_existing_program_is_found)
+{
+	assoc_programs("{*.txt}", "prog1", 0, 0);
+	assoc_programs("{*.txt,readme}", "prog2", 0, 0);
+	assoc_programs("/.*/", "prog3", 0, 0);
+
+	assert_string_equal("prog1", ft_get_program("a.txt"));
+	assert_string_equal("prog2", ft_get_program("README"));
+	assert_string_equal("prog3", ft_get_program("a.md"));
+}
+
+TEST(lookup_reflects_changes_of_associations)
+{
+	assoc_viewers("{*.c}", "prog1");
+	check_viewers("a.h", 0, NULL);
+
+	assoc_viewers("{*.h}", "prog2");
+	check_viewers("a.h", 1, (const char *[]){ "prog2" });
+
+	assoc_viewers("{*.h}", "prog3");
+	ft_move_viewer_to_top("a.h", "prog3");
+	check_viewers("a.h", 2, (const char *[]){ "prog3", "prog2" });
+
+	ft_reset(0);
+	check_viewers("a.h", 0, NULL);
+}
+
+TEST(directories_are_matched)
+{
+	assert_string_equal(VIFM_PSEUDO_CMD, ft_get_program("dir/"));
+	assert_string_equal(VIFM_PSEUDO_CMD, ft_get_program("/path/dir/"));
+	assert_null(ft_get_program("file"));
+}
+
+TEST(long_literals_do_not_disable_index)
+{
+	char long_name[NAME_MAX + 64];
+	memset(long_name, 'x', sizeof(long_name) - 1);
+	long_name[sizeof(long_name) - 1] = '\0';
+
+	char pattern[sizeof(long_name) + 16];
+	snprintf(pattern, sizeof(pattern), "{a.c,%s}", long_name);
+
+	assoc_viewers(pattern, "prog1");
+	assoc_viewers("{*.c}", "prog2");
+	assoc_viewers("{b.h}", "prog3");
+
+	check_viewers("a.c", 2, (const char *[]){ "prog1", "prog2" });
+	check_viewers(long_name, 1, (const char *[]){ "prog1" });
+	check_viewers("b.h", 1, (const char *[]){ "prog3" });
+	assert_true(ft_viewers_are_indexed());
+}
+
+/* Checks that list of viewers of the file matches expectation. */
+static void
+check_viewers(const char file[], int count, const char *viewers[])
+{
+	assoc_records_t records = ft_get_all_viewers(file);
+	assert_int_equal(count, records.count);
+
+	int i;
+	for(i = 0; i < count && i < records.count; ++i)
+	{
+		assert_string_equal(viewers[i], records.list[i].command);
+	}
+
+	ft_assoc_records_free(&records);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
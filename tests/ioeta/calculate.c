@@ -1,12 +1,16 @@
 #include <stic.h>
 
 #include <stddef.h> /* NULL */
+#include <stdio.h> /* snprintf() */
+#include <string.h> /* strlen() */
 
 #include <test-utils.h>
 
 #include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
 #include "../../src/io/private/ioeta.h"
 #include "../../src/io/ioeta.h"
+#include "../../src/io/ior.h"
 #include "../../src/io/iop.h"
 
 static const io_cancellation_t no_cancellation;
@@ -55,6 +59,45 @@ TEST(non_empty_files_are_ok)
 	ioeta_free(estim);
 }
 
+TEST(deep_hierarchy_is_estimated_completely)
+{
+	char path[PATH_MAX + 1] = SANDBOX_PATH "/dir";
+	int i;
+
+	/* A chain of directories with a file and a sibling directory at each
+	 * level. */
+	for(i = 0; i < 20; ++i)
+	{
+		assert_success(os_mkdir(path, 0700));
+
+		char other[PATH_MAX + 1];
+		snprintf(other, sizeof(other), "%s/other", path);
+		assert_success(os_mkdir(other, 0700));
+		snprintf(other, sizeof(other), "%s/other/file", path);
+		make_file(other, "12345");
+
+		snprintf(path + strlen(path), sizeof(path) - strlen(path), "/sub");
+	}
+
+	ioeta_estim_t *const estim = ioeta_alloc(NULL, no_cancellation);
+
+	ioeta_calculate(estim, SANDBOX_PATH "/dir", /*shallow=*/0, /*deep=*/0);
+
+	assert_int_equal(60, estim->total_items);
+	assert_int_equal(0, estim->current_item);
+	assert_int_equal(100, estim->total_bytes);
+	assert_int_equal(0, estim->current_byte);
+
+	ioeta_free(estim);
+
+	{
+		io_args_t args = {
+			.arg1.path = SANDBOX_PATH "/dir",
+		};
+		assert_int_equal(IO_RES_SUCCEEDED, ior_rm(&args));
+	}
+}
+
 TEST(shallow_estimation_does_not_recur)
 {
 	ioeta_estim_t *const estim = ioeta_alloc(NULL, no_cancellation);
@@ -6,9 +6,11 @@
 #endif
 #include <sys/stat.h> /* chmod() stat */
 #include <sys/types.h> /* stat */
-#include <unistd.h> /* _Exit() lstat() */
+#include <fcntl.h> /* O_CREAT O_WRONLY open() */
+#include <unistd.h> /* _Exit() close() ftruncate() lstat() pwrite() */
 
 #include <signal.h> /* SIGXFSZ SIG_IGN signal() */
+#include <stdio.h> /* EOF FILE fclose() fopen() fputc() */
 #include <stdlib.h> /* EXIT_FAILURE EXIT_SUCCESS */
 
 #include <test-utils.h>
@@ -22,6 +24,7 @@
 #include "utils.h"
 
 static void file_is_copied(const char original[]);
+static int has_proc_fs(void);
 
 TEST(dir_is_not_copied)
 {
@@ -157,6 +160,42 @@ TEST(double_block_size_plus_one_file_is_copied)
 			"/various-sizes/double-block-size-plus-one-file");
 }
 
+TEST(file_larger_than_several_blocks_is_copied)
+{
+	/* Make it larger than a couple of chunks in any copying mode. */
+	enum { SIZE = 3*1024*1024 + 1 };
+
+	FILE *const f = fopen(SANDBOX_PATH "/large", "wb");
+	assert_non_null(f);
+	int i;
+	for(i = 0; i < SIZE; ++i)
+	{
+		assert_true(fputc(i%251, f) != EOF);
+	}
+	assert_success(fclose(f));
+
+	file_is_copied(SANDBOX_PATH "/large");
+
+	delete_test_file(SANDBOX_PATH "/large");
+}
+
+TEST(file_of_pseudo_fs_is_copied, IF(has_proc_fs))
+{
+	/* Such files report zero size and can't be copied by some system calls. */
+	io_args_t args = {
+		.arg1.src = "/proc/self/mounts",
+		.arg2.dst = SANDBOX_PATH "/copy",
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_true(get_file_size(SANDBOX_PATH "/copy") > 0);
+
+	delete_test_file(SANDBOX_PATH "/copy");
+}
+
 static void
 file_is_copied(const char original[])
 {
@@ -257,6 +296,12 @@ TEST(appending_does_not_shrink_files)
 	}
 }
 
+static int
+has_proc_fs(void)
+{
+	return path_exists("/proc/self/mounts", DEREF);
+}
+
 /* Windows doesn't support Unix-style permissions. */
 TEST(file_permissions_are_preserved, IF(not_windows))
 {
@@ -568,6 +613,62 @@ TEST(socket_is_copied, IF(can_create_sockets))
 	assert_int_equal(0, args.result.errors.error_count);
 }
 
+TEST(sparse_file_is_copied_with_holes)
+{
+	enum { SIZE = 8*1024*1024, DATA_OFFSET = 4*1024*1024 };
+
+	int fd = open(SANDBOX_PATH "/sparse", O_WRONLY | O_CREAT, 0600);
+	assert_true(fd >= 0);
+	assert_int_equal(4, pwrite(fd, "data", 4, DATA_OFFSET));
+	assert_success(ftruncate(fd, SIZE));
+	assert_success(close(fd));
+
+	struct stat src_st;
+	assert_success(stat(SANDBOX_PATH "/sparse", &src_st));
+
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/sparse",
+		.arg2.dst = SANDBOX_PATH "/copy",
+		.arg4.sparse_copying = 1,
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_true(files_are_identical(SANDBOX_PATH "/sparse",
+				SANDBOX_PATH "/copy"));
+
+	struct stat dst_st;
+	assert_success(stat(SANDBOX_PATH "/copy", &dst_st));
+	assert_int_equal(SIZE, dst_st.st_size);
+	/* Holes are preserved if file system supports them. */
+	if(src_st.st_blocks*512 < SIZE)
+	{
+		assert_true(dst_st.st_blocks*512 < SIZE);
+	}
+
+	delete_test_file(SANDBOX_PATH "/sparse");
+	delete_test_file(SANDBOX_PATH "/copy");
+}
+
+TEST(file_ending_with_data_is_copied_in_sparse_mode)
+{
+	io_args_t args = {
+		.arg1.src = TEST_DATA_PATH "/various-sizes/double-block-size-file",
+		.arg2.dst = SANDBOX_PATH "/copy",
+		.arg4.sparse_copying = 1,
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_true(files_are_identical(args.arg1.src, SANDBOX_PATH "/copy"));
+
+	delete_test_file(SANDBOX_PATH "/copy");
+}
+
 TEST(append_truncates_destination_files_on_error, IF(not_windows))
 {
 	int status;
@@ -4,9 +4,13 @@
 #include <sys/types.h> /* stat */
 #include <unistd.h> /* F_OK access() */
 
+#include <stdio.h> /* snprintf() */
+
 #include <test-utils.h>
 
+#include "../../src/compat/fs_limits.h"
 #include "../../src/compat/os.h"
+#include "../../src/io/ioeta.h"
 #include "../../src/io/iop.h"
 #include "../../src/io/ior.h"
 #include "../../src/utils/fs.h"
@@ -550,6 +554,59 @@ TEST(permissions_are_set_in_correct_order)
 	}
 }
 
+TEST(many_files_are_copied_and_accounted)
+{
+	char path[PATH_MAX + 1];
+	int i;
+
+	create_empty_dir(SANDBOX_PATH "/dir");
+	create_empty_dir(SANDBOX_PATH "/dir/sub");
+	for(i = 0; i < 100; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/dir/%s/file%d", SANDBOX_PATH,
+				(i%2 == 0 ? "." : "sub"), i);
+		make_file(path, "content");
+	}
+	assert_success(chmod(SANDBOX_PATH "/dir/sub", 0500));
+
+	const io_cancellation_t no_cancellation = {};
+	ioeta_estim_t *const estim = ioeta_alloc(NULL, no_cancellation);
+	ioeta_calculate(estim, SANDBOX_PATH "/dir", /*shallow=*/0, /*deep=*/0);
+
+	{
+		io_args_t args = {
+			.arg1.src = SANDBOX_PATH "/dir",
+			.arg2.dst = SANDBOX_PATH "/dir-copy",
+
+			.estim = estim,
+		};
+		ioe_errlst_init(&args.result.errors);
+
+		assert_int_equal(IO_RES_SUCCEEDED, ior_cp(&args));
+		assert_int_equal(0, args.result.errors.error_count);
+	}
+
+	assert_int_equal(estim->total_items, estim->current_item);
+	assert_ulong_equal(estim->total_bytes, estim->current_byte);
+	ioeta_free(estim);
+
+	for(i = 0; i < 100; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/dir-copy/%s/file%d", SANDBOX_PATH,
+				(i%2 == 0 ? "." : "sub"), i);
+		assert_true(file_exists(path));
+	}
+
+	struct stat st;
+	assert_success(os_stat(SANDBOX_PATH "/dir-copy/sub", &st));
+	assert_int_equal(0500, st.st_mode & 0777);
+
+	assert_success(chmod(SANDBOX_PATH "/dir/sub", 0700));
+	assert_success(chmod(SANDBOX_PATH "/dir-copy/sub", 0700));
+	delete_tree(SANDBOX_PATH "/dir");
+	delete_tree(SANDBOX_PATH "/dir-copy");
+}
+
 static int
 confirm_overwrite(io_args_t *args, const char src[], const char dst[])
 {
@@ -1,8 +1,15 @@
 #include <stic.h>
 
+#include <sys/stat.h> /* chmod() */
 #include <unistd.h> /* F_OK access() */
 
+#include <stdio.h> /* snprintf() */
+
+#include <test-utils.h>
+
+#include "../../src/compat/fs_limits.h"
 #include "../../src/compat/os.h"
+#include "../../src/io/ioeta.h"
 #include "../../src/io/ior.h"
 #include "../../src/utils/fs.h"
 
@@ -65,5 +72,74 @@ TEST(non_empty_directory_is_removed)
 	assert_failure(access(DIRECTORY_NAME, F_OK));
 }
 
+TEST(tree_of_directories_is_removed_and_accounted)
+{
+	char path[PATH_MAX + 1];
+	int i, j;
+
+	create_empty_dir(DIRECTORY_NAME);
+	for(i = 0; i < 10; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/sub%d", DIRECTORY_NAME, i);
+		create_empty_dir(path);
+		snprintf(path, sizeof(path), "%s/sub%d/nested", DIRECTORY_NAME, i);
+		create_empty_dir(path);
+
+		for(j = 0; j < 10; ++j)
+		{
+			snprintf(path, sizeof(path), "%s/sub%d/%sfile%d", DIRECTORY_NAME, i,
+					(j%2 == 0 ? "" : "nested/"), j);
+			make_file(path, "content");
+		}
+	}
+
+	const io_cancellation_t no_cancellation = {};
+	ioeta_estim_t *const estim = ioeta_alloc(NULL, no_cancellation);
+	ioeta_calculate(estim, DIRECTORY_NAME, /*shallow=*/0, /*deep=*/0);
+	assert_int_equal(121, estim->total_items);
+	assert_ulong_equal(700, estim->total_bytes);
+
+	{
+		io_args_t args = {
+			.arg1.path = DIRECTORY_NAME,
+
+			.estim = estim,
+		};
+		ioe_errlst_init(&args.result.errors);
+
+		assert_int_equal(IO_RES_SUCCEEDED, ior_rm(&args));
+		assert_int_equal(0, args.result.errors.error_count);
+	}
+
+	assert_int_equal(estim->total_items, estim->current_item);
+	assert_ulong_equal(estim->total_bytes, estim->current_byte);
+	ioeta_free(estim);
+
+	assert_failure(access(DIRECTORY_NAME, F_OK));
+}
+
+TEST(errors_of_parallel_removal_are_collected, IF(regular_unix_user))
+{
+	create_empty_dir(DIRECTORY_NAME);
+	create_empty_dir(DIRECTORY_NAME "/ro");
+	create_empty_file(DIRECTORY_NAME "/ro/" FILE_NAME);
+	assert_success(chmod(DIRECTORY_NAME "/ro", 0500));
+
+	{
+		io_args_t args = {
+			.arg1.path = DIRECTORY_NAME,
+		};
+		ioe_errlst_init(&args.result.errors);
+
+		assert_int_equal(IO_RES_FAILED, ior_rm(&args));
+		assert_true(args.result.errors.error_count != 0);
+
+		ioe_errlst_free(&args.result.errors);
+	}
+
+	assert_success(chmod(DIRECTORY_NAME "/ro", 0700));
+	delete_tree(DIRECTORY_NAME);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
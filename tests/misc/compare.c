@@ -10,10 +10,14 @@
 
 #include "../../src/ui/ui.h"
 #include "../../src/compare.h"
+#include "../../src/hcache.h"
 
 /* These tests are about comparison strategies and not about handling of unusual
  * situations or results of operations in compare views. */
 
+static void write_contents(const char path[], const char contents[],
+		size_t len);
+
 SETUP()
 {
 	curr_view = &lwin;
@@ -30,6 +34,7 @@ SETUP()
 
 TEARDOWN()
 {
+	hcache_reset(0);
 	columns_teardown();
 
 	view_teardown(&lwin);
@@ -494,6 +499,150 @@ TEST(files_with_identical_fingerprints_are_handled_well)
 	remove_dir(SANDBOX_PATH "/b");
 }
 
+TEST(difference_past_first_hashing_block_is_detected)
+{
+	static char contents[3*1024*1024/2];
+	memset(contents, 'a', sizeof(contents));
+
+	create_dir(SANDBOX_PATH "/a");
+	create_dir(SANDBOX_PATH "/b");
+	write_contents(SANDBOX_PATH "/a/1", contents, sizeof(contents));
+	write_contents(SANDBOX_PATH "/b/1", contents, sizeof(contents));
+	contents[sizeof(contents) - 1] = 'b';
+	write_contents(SANDBOX_PATH "/a/2", contents, sizeof(contents));
+
+	strcpy(lwin.curr_dir, SANDBOX_PATH "/a");
+	strcpy(rwin.curr_dir, SANDBOX_PATH "/b");
+	compare_two_panes(CT_CONTENTS, LT_ALL, CF_SHOW | CF_GROUP_PATHS);
+
+	assert_int_equal(2, lwin.list_rows);
+	assert_int_equal(2, rwin.list_rows);
+
+	assert_string_equal("1", lwin.dir_entry[0].name);
+	assert_string_equal("1", rwin.dir_entry[0].name);
+	assert_int_equal(1, lwin.dir_entry[0].id);
+	assert_int_equal(1, rwin.dir_entry[0].id);
+	assert_string_equal("2", lwin.dir_entry[1].name);
+	assert_int_equal(2, lwin.dir_entry[1].id);
+
+	remove_file(SANDBOX_PATH "/a/1");
+	remove_file(SANDBOX_PATH "/b/1");
+	remove_file(SANDBOX_PATH "/a/2");
+	remove_dir(SANDBOX_PATH "/a");
+	remove_dir(SANDBOX_PATH "/b");
+}
+
+TEST(cached_digests_are_used, IF(not_windows))
+{
+	/* Prefixes are the same, so full digests are needed. */
+	static char contents[8*1024];
+	memset(contents, 'a', sizeof(contents));
+
+	create_dir(SANDBOX_PATH "/a");
+	create_dir(SANDBOX_PATH "/b");
+	write_contents(SANDBOX_PATH "/a/file", contents, sizeof(contents));
+	contents[sizeof(contents) - 1] = 'b';
+	write_contents(SANDBOX_PATH "/b/file", contents, sizeof(contents));
+
+	/* Make the cache claim that contents of the files is the same. */
+	const hcache_digest_t digest = { .high = 1, .low = 2 };
+	hcache_key_t key;
+	assert_success(hcache_key_of(SANDBOX_PATH "/a/file", &key));
+	hcache_put(&key, &digest);
+	assert_success(hcache_key_of(SANDBOX_PATH "/b/file", &key));
+	hcache_put(&key, &digest);
+
+	strcpy(lwin.curr_dir, SANDBOX_PATH "/a");
+	strcpy(rwin.curr_dir, SANDBOX_PATH "/b");
+	compare_two_panes(CT_CONTENTS, LT_ALL, CF_SHOW | CF_GROUP_PATHS);
+
+	assert_int_equal(1, lwin.list_rows);
+	assert_int_equal(1, rwin.list_rows);
+	assert_int_equal(1, lwin.dir_entry[0].id);
+	assert_int_equal(1, rwin.dir_entry[0].id);
+
+	remove_file(SANDBOX_PATH "/a/file");
+	remove_file(SANDBOX_PATH "/b/file");
+	remove_dir(SANDBOX_PATH "/a");
+	remove_dir(SANDBOX_PATH "/b");
+}
+
+TEST(cached_digests_of_prefixes_are_used, IF(not_windows))
+{
+	static char contents[8*1024];
+	memset(contents, 'a', sizeof(contents));
+
+	create_dir(SANDBOX_PATH "/a");
+	create_dir(SANDBOX_PATH "/b");
+	write_contents(SANDBOX_PATH "/a/file", contents, sizeof(contents));
+	write_contents(SANDBOX_PATH "/b/file", contents, sizeof(contents));
+
+	/* Make the cache claim that prefixes of the files are different. */
+	hcache_digest_t digest = { .high = 1, .low = 2 };
+	hcache_key_t key;
+	assert_success(hcache_key_of(SANDBOX_PATH "/a/file", &key));
+	key.prefix = 4*1024;
+	hcache_put(&key, &digest);
+	digest.low = 3;
+	assert_success(hcache_key_of(SANDBOX_PATH "/b/file", &key));
+	key.prefix = 4*1024;
+	hcache_put(&key, &digest);
+
+	strcpy(lwin.curr_dir, SANDBOX_PATH "/a");
+	strcpy(rwin.curr_dir, SANDBOX_PATH "/b");
+	compare_two_panes(CT_CONTENTS, LT_ALL, CF_SHOW | CF_GROUP_PATHS);
+
+	assert_int_equal(1, lwin.list_rows);
+	assert_int_equal(1, rwin.list_rows);
+	assert_true(lwin.dir_entry[0].id != rwin.dir_entry[0].id);
+
+	remove_file(SANDBOX_PATH "/a/file");
+	remove_file(SANDBOX_PATH "/b/file");
+	remove_dir(SANDBOX_PATH "/a");
+	remove_dir(SANDBOX_PATH "/b");
+}
+
+TEST(files_with_different_prefixes_are_not_hashed_in_full, IF(not_windows))
+{
+	static char contents[64*1024];
+	memset(contents, 'a', sizeof(contents));
+
+	create_dir(SANDBOX_PATH "/a");
+	create_dir(SANDBOX_PATH "/b");
+	write_contents(SANDBOX_PATH "/a/same", contents, sizeof(contents));
+	write_contents(SANDBOX_PATH "/b/same", contents, sizeof(contents));
+	contents[0] = 'b';
+	write_contents(SANDBOX_PATH "/a/other", contents, sizeof(contents));
+
+	strcpy(lwin.curr_dir, SANDBOX_PATH "/a");
+	strcpy(rwin.curr_dir, SANDBOX_PATH "/b");
+	compare_two_panes(CT_CONTENTS, LT_ALL, CF_SHOW | CF_GROUP_PATHS);
+
+	assert_int_equal(2, lwin.list_rows);
+	assert_string_equal("other", lwin.dir_entry[0].name);
+	assert_string_equal("same", lwin.dir_entry[1].name);
+	assert_string_equal("same", rwin.dir_entry[1].name);
+	assert_true(lwin.dir_entry[0].id != lwin.dir_entry[1].id);
+	assert_int_equal(lwin.dir_entry[1].id, rwin.dir_entry[1].id);
+
+	/* Digests of prefixes are cached for all files, full ones only for files
+	 * with matching prefixes. */
+	hcache_key_t key;
+	hcache_digest_t digest;
+	assert_success(hcache_key_of(SANDBOX_PATH "/a/same", &key));
+	assert_true(hcache_get(&key, &digest));
+	assert_success(hcache_key_of(SANDBOX_PATH "/a/other", &key));
+	assert_false(hcache_get(&key, &digest));
+	key.prefix = 4*1024;
+	assert_true(hcache_get(&key, &digest));
+
+	remove_file(SANDBOX_PATH "/a/same");
+	remove_file(SANDBOX_PATH "/b/same");
+	remove_file(SANDBOX_PATH "/a/other");
+	remove_dir(SANDBOX_PATH "/a");
+	remove_dir(SANDBOX_PATH "/b");
+}
+
 /* Because of mkfifo() */
 #ifndef _WIN32
 
@@ -522,5 +671,15 @@ TEST(non_regular_files_are_not_read)
 
 #endif
 
+/* Creates file with specified contents. */
+static void
+write_contents(const char path[], const char contents[], size_t len)
+{
+	FILE *fp = fopen(path, "wb");
+	assert_non_null(fp);
+	assert_int_equal(len, fwrite(contents, 1, len, fp));
+	fclose(fp);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
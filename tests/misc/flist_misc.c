@@ -3,6 +3,7 @@
 #include <sys/stat.h> /* chmod() */
 
 #include <limits.h> /* INT_MAX */
+#include <stdio.h> /* snprintf() */
 #include <string.h> /* memset() strcpy() */
 #include <time.h> /* time() */
 #include <unistd.h> /* usleep() */
@@ -399,6 +400,56 @@ TEST(fentry_get_recalculates_size)
 	update_string(&cfg.shell, NULL);
 }
 
+TEST(sizes_of_all_subdirectories_are_calculated_and_cached)
+{
+	char path[PATH_MAX + 1];
+	int i;
+
+	update_string(&cfg.shell, "");
+	assert_success(stats_init(&cfg));
+
+	for(i = 0; i < 12; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/dir%d", SANDBOX_PATH, i);
+		assert_success(os_mkdir(path, 0700));
+		snprintf(path, sizeof(path), "%s/dir%d/nested", SANDBOX_PATH, i);
+		assert_success(os_mkdir(path, 0700));
+		snprintf(path, sizeof(path), "%s/dir%d/nested/file", SANDBOX_PATH, i);
+		make_file(path, "1234567890");
+		snprintf(path, sizeof(path), "%s/dir%d/file", SANDBOX_PATH, i);
+		make_file(path, "12345");
+	}
+
+	assert_ulong_equal(12*15, fops_dir_size(SANDBOX_PATH, 0, &no_cancellation));
+
+	for(i = 0; i < 12; ++i)
+	{
+		uint64_t size;
+		struct stat st;
+
+		snprintf(path, sizeof(path), "%s/dir%d", SANDBOX_PATH, i);
+		assert_success(os_stat(path, &st));
+		dcache_get_at(path, st.st_mtime - 10, st.st_ino, &size, NULL);
+		assert_ulong_equal(15, size);
+
+		snprintf(path, sizeof(path), "%s/dir%d/nested", SANDBOX_PATH, i);
+		assert_success(os_stat(path, &st));
+		dcache_get_at(path, st.st_mtime - 10, st.st_ino, &size, NULL);
+		assert_ulong_equal(10, size);
+
+		snprintf(path, sizeof(path), "%s/dir%d/nested/file", SANDBOX_PATH, i);
+		remove_file(path);
+		snprintf(path, sizeof(path), "%s/dir%d/nested", SANDBOX_PATH, i);
+		remove_dir(path);
+		snprintf(path, sizeof(path), "%s/dir%d/file", SANDBOX_PATH, i);
+		remove_file(path);
+		snprintf(path, sizeof(path), "%s/dir%d", SANDBOX_PATH, i);
+		remove_dir(path);
+	}
+
+	update_string(&cfg.shell, NULL);
+}
+
 TEST(fentry_get_nitems_calculates_number_of_items)
 {
 	char origin[] = TEST_DATA_PATH;
@@ -0,0 +1,140 @@
+#include <stic.h>
+
+#include <limits.h> /* INT_MAX */
+#include <stdio.h> /* printf() snprintf() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* strdup() */
+
+#include <test-utils.h>
+
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/str.h"
+#include "../../src/filelist.h"
+#include "../../src/flist_pos.h"
+
+/* Number of files used in benchmark. */
+#define BENCH_FILES 20000
+
+static void create_files(int count);
+static void remove_files(int count);
+static double load_time(int threshold, int times);
+
+static view_t *const view = &lwin;
+
+SETUP()
+{
+	view_setup(view);
+	copy_str(view->curr_dir, sizeof(view->curr_dir), SANDBOX_PATH);
+}
+
+TEARDOWN()
+{
+	view_teardown(view);
+	set_parallel_stat_threshold(256);
+}
+
+TEST(parallel_and_serial_loading_produce_the_same_list, IF(not_windows))
+{
+	create_files(300);
+	create_dir(SANDBOX_PATH "/dir");
+	create_executable(SANDBOX_PATH "/exec");
+	assert_success(make_symlink("dir", SANDBOX_PATH "/link-to-dir"));
+	assert_success(make_symlink("no-such-file", SANDBOX_PATH "/broken-link"));
+
+	set_parallel_stat_threshold(INT_MAX);
+	assert_success(populate_dir_list(view, 0));
+
+	int serial_rows = view->list_rows;
+	dir_entry_t *serial = view->dir_entry;
+	view->dir_entry = NULL;
+	view->list_rows = 0;
+
+	set_parallel_stat_threshold(0);
+	assert_success(populate_dir_list(view, 0));
+
+	assert_int_equal(300 + 4, serial_rows);
+	assert_int_equal(serial_rows, view->list_rows);
+
+	int i;
+	for(i = 0; i < serial_rows; ++i)
+	{
+		const dir_entry_t *a = &serial[i];
+		const dir_entry_t *b = &view->dir_entry[i];
+		assert_string_equal(a->name, b->name);
+		assert_int_equal(a->type, b->type);
+		assert_int_equal(a->size, b->size);
+		assert_int_equal(a->mode, b->mode);
+		assert_int_equal(a->inode, b->inode);
+		assert_int_equal(a->mtime, b->mtime);
+		assert_int_equal(a->dir_link, b->dir_link);
+	}
+
+	int pos = fpos_find_by_name(view, "link-to-dir");
+	assert_true(pos >= 0);
+	assert_true(view->dir_entry[pos].dir_link);
+
+	free_dir_entries(&serial, &serial_rows);
+
+	remove_files(300);
+	remove_dir(SANDBOX_PATH "/dir");
+	remove_file(SANDBOX_PATH "/exec");
+	remove_file(SANDBOX_PATH "/link-to-dir");
+	remove_file(SANDBOX_PATH "/broken-link");
+}
+
+TEST(benchmark_parallel_stat, IF(benchmarks_enabled))
+{
+	create_files(BENCH_FILES);
+
+	const double serial = load_time(INT_MAX, 5);
+	const double parallel = load_time(0, 5);
+	printf("Loading %d files: serial %.3fs, parallel %.3fs\n", BENCH_FILES,
+			serial, parallel);
+
+	remove_files(BENCH_FILES);
+}
+
+static void
+create_files(int count)
+{
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		char path[PATH_MAX + 1];
+		snprintf(path, sizeof(path), "%s/file%05d", SANDBOX_PATH, i);
+		create_file(path);
+	}
+}
+
+static void
+remove_files(int count)
+{
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		char path[PATH_MAX + 1];
+		snprintf(path, sizeof(path), "%s/file%05d", SANDBOX_PATH, i);
+		remove_file(path);
+	}
+}
+
+/* Measures total time it takes to load directory several times.  Returns the
+ * time. */
+static double
+load_time(int threshold, int times)
+{
+	set_parallel_stat_threshold(threshold);
+
+	const double start = bench_time();
+	while(times-- > 0)
+	{
+		assert_success(populate_dir_list(view, 0));
+	}
+	return bench_time() - start;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,239 @@
+#include <stic.h>
+
+#include <sys/stat.h> /* stat */
+#include <unistd.h> /* chdir() usleep() */
+
+#include <stdio.h> /* remove() */
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/dirpoll.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/macros.h"
+#include "../../src/utils/str.h"
+#include "../../src/filelist.h"
+#include "../../src/flist_pos.h"
+
+static void check_names(const char *names[], int count);
+static int using_inotify(void);
+
+static view_t *const view = &lwin;
+static char *saved_cwd;
+
+SETUP()
+{
+	char cwd[PATH_MAX + 1];
+
+	saved_cwd = save_cwd();
+	assert_success(chdir(SANDBOX_PATH));
+	assert_true(get_cwd(cwd, sizeof(cwd)) == cwd);
+
+	view_setup(view);
+	copy_str(view->curr_dir, sizeof(view->curr_dir), cwd);
+
+	cfg.dot_dirs = 0;
+
+	create_file("a");
+	create_file("c");
+	create_dir("d");
+
+	populate_dir_list(view, 0);
+	(void)ui_view_query_scheduled_event(view);
+}
+
+TEARDOWN()
+{
+	view_teardown(view);
+
+	(void)remove("a");
+	(void)remove("b");
+	(void)remove("c");
+	(void)remove("d");
+	(void)remove("e");
+	(void)remove(".hidden");
+
+	restore_cwd(saved_cwd);
+}
+
+TEST(created_files_are_inserted_in_sorted_order, IF(using_inotify))
+{
+	view->list_pos = fpos_find_by_name(view, "c");
+
+	create_file("b");
+	check_if_filelist_has_changed(view);
+	assert_int_equal(UUE_REDRAW, ui_view_query_scheduled_event(view));
+
+	const char *names[] = { "d", "a", "b", "c" };
+	check_names(names, ARRAY_LEN(names));
+	assert_string_equal("c", get_current_file_name(view));
+}
+
+TEST(renames_and_removals_are_applied, IF(using_inotify))
+{
+	view->list_pos = fpos_find_by_name(view, "a");
+	view->dir_entry[view->list_pos].selected = 1;
+	view->selected_files = 1;
+
+	assert_success(os_rename("a", "e"));
+	assert_success(remove("c"));
+	check_if_filelist_has_changed(view);
+	assert_int_equal(UUE_REDRAW, ui_view_query_scheduled_event(view));
+
+	const char *names[] = { "d", "e" };
+	check_names(names, ARRAY_LEN(names));
+	assert_int_equal(0, view->selected_files);
+}
+
+TEST(modified_files_are_updated_preserving_state, IF(using_inotify))
+{
+	const int pos = fpos_find_by_name(view, "c");
+	view->dir_entry[pos].selected = 1;
+	view->selected_files = 1;
+
+	make_file("c", "contents");
+	check_if_filelist_has_changed(view);
+	assert_int_equal(UUE_REDRAW, ui_view_query_scheduled_event(view));
+
+	const char *names[] = { "d", "a", "c" };
+	check_names(names, ARRAY_LEN(names));
+	assert_int_equal(8, view->dir_entry[2].size);
+	assert_true(view->dir_entry[2].selected);
+	assert_int_equal(1, view->selected_files);
+}
+
+TEST(filtered_files_are_accounted, IF(using_inotify))
+{
+	view->hide_dot = 1;
+
+	create_file(".hidden");
+	check_if_filelist_has_changed(view);
+	assert_int_equal(UUE_REDRAW, ui_view_query_scheduled_event(view));
+	assert_int_equal(3, view->list_rows);
+	assert_int_equal(1, view->filtered);
+
+	assert_success(remove(".hidden"));
+	check_if_filelist_has_changed(view);
+	assert_int_equal(UUE_REDRAW, ui_view_query_scheduled_event(view));
+	assert_int_equal(3, view->list_rows);
+	assert_int_equal(0, view->filtered);
+}
+
+TEST(change_of_directory_itself_causes_reload, IF(using_inotify))
+{
+	struct stat st;
+	assert_success(os_stat(".", &st));
+
+	assert_success(os_chmod(".", st.st_mode & 07777));
+	check_if_filelist_has_changed(view);
+	assert_int_equal(UUE_RELOAD, ui_view_query_scheduled_event(view));
+}
+
+#ifndef _WIN32
+
+TEST(slow_file_systems_are_polled_in_background)
+{
+	dirpoll_set_unit(5);
+	cfg.slow_fs_poll = 1;
+	view->on_slow_fs = 1;
+
+	/* Starts the poller. */
+	check_if_filelist_has_changed(view);
+	assert_non_null(view->slow_watch);
+	usleep(20000);
+
+	create_file("b");
+
+	int i;
+	for(i = 0; i < 200; ++i)
+	{
+		check_if_filelist_has_changed(view);
+		if(ui_view_query_scheduled_event(view) != UUE_NONE)
+		{
+			break;
+		}
+		usleep(5000);
+	}
+
+	const char *names[] = { "d", "a", "b", "c" };
+	check_names(names, ARRAY_LEN(names));
+
+	view->on_slow_fs = 0;
+	check_if_filelist_has_changed(view);
+	assert_null(view->slow_watch);
+
+	cfg.slow_fs_poll = 10;
+	dirpoll_set_unit(1000);
+}
+
+TEST(links_on_slow_file_systems_are_patched_without_accessing_them)
+{
+	dirpoll_set_unit(5);
+	cfg.slow_fs_poll = 1;
+	view->on_slow_fs = 1;
+
+	check_if_filelist_has_changed(view);
+	assert_non_null(view->slow_watch);
+	usleep(20000);
+
+	assert_success(make_symlink("d", "b"));
+
+	/* Relative paths mustn't be resolved against current directory. */
+	assert_success(chdir("/"));
+
+	int i;
+	for(i = 0; i < 200; ++i)
+	{
+		check_if_filelist_has_changed(view);
+		if(ui_view_query_scheduled_event(view) != UUE_NONE)
+		{
+			break;
+		}
+		usleep(5000);
+	}
+
+	assert_success(chdir(view->curr_dir));
+
+	/* Link to a directory is sorted along with directories. */
+	const char *names[] = { "b", "d", "a", "c" };
+	check_names(names, ARRAY_LEN(names));
+	assert_true(view->dir_entry[0].dir_link);
+	assert_true(S_ISDIR(view->dir_entry[0].mode));
+
+	view->on_slow_fs = 0;
+	check_if_filelist_has_changed(view);
+
+	cfg.slow_fs_poll = 10;
+	dirpoll_set_unit(1000);
+}
+
+#endif
+
+/* Checks that file list consists of specified names. */
+static void
+check_names(const char *names[], int count)
+{
+	assert_int_equal(count, view->list_rows);
+
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		assert_string_equal(names[i], view->dir_entry[i].name);
+	}
+}
+
+static int
+using_inotify(void)
+{
+#ifdef HAVE_INOTIFY
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
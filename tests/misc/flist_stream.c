@@ -0,0 +1,165 @@
+#include <stic.h>
+
+#include <sys/stat.h> /* S_ISDIR() */
+#include <unistd.h> /* symlink() usleep() */
+
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* strdup() */
+
+#include <test-utils.h>
+
+#include "../../src/compat/fs_limits.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/str.h"
+#include "../../src/filelist.h"
+#include "../../src/flist_pos.h"
+
+static void create_files(const char dir[], int count);
+static void remove_files(const char dir[], int count);
+static void wait_for_stream(void);
+
+static view_t *const view = &lwin;
+
+SETUP()
+{
+	view_setup(view);
+	copy_str(view->curr_dir, sizeof(view->curr_dir), SANDBOX_PATH);
+
+	set_dir_stream_threshold(10);
+	create_files(SANDBOX_PATH, 100);
+}
+
+TEARDOWN()
+{
+	view_teardown(view);
+	set_dir_stream_threshold(10000);
+
+	remove_files(SANDBOX_PATH, 100);
+}
+
+TEST(huge_directory_is_read_in_background, IF(not_windows))
+{
+	assert_success(populate_dir_list(view, 0));
+	assert_int_equal(10, view->list_rows);
+	assert_non_null(view->dir_stream);
+
+	wait_for_stream();
+	assert_null(view->dir_stream);
+	assert_int_equal(100, view->list_rows);
+
+	int i;
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		char name[16];
+		snprintf(name, sizeof(name), "file%03d", i);
+		assert_string_equal(name, view->dir_entry[i].name);
+	}
+}
+
+TEST(cursor_stays_on_file_chosen_by_user, IF(not_windows))
+{
+	assert_success(populate_dir_list(view, 0));
+
+	view->list_pos = 5;
+	char *const name = strdup(get_current_file_name(view));
+
+	wait_for_stream();
+	assert_string_equal(name, get_current_file_name(view));
+
+	free(name);
+}
+
+TEST(reload_reads_everything_at_once, IF(not_windows))
+{
+	assert_success(populate_dir_list(view, 1));
+	assert_null(view->dir_stream);
+	assert_int_equal(100, view->list_rows);
+}
+
+TEST(leaving_directory_stops_reading, IF(not_windows))
+{
+	create_dir(SANDBOX_PATH "/dir");
+
+	assert_success(populate_dir_list(view, 0));
+	assert_non_null(view->dir_stream);
+
+	copy_str(view->curr_dir, sizeof(view->curr_dir), SANDBOX_PATH "/dir");
+	assert_success(populate_dir_list(view, 0));
+	assert_null(view->dir_stream);
+
+	remove_dir(SANDBOX_PATH "/dir");
+}
+
+TEST(stream_is_dropped_if_view_has_changed_directory, IF(not_windows))
+{
+	assert_success(populate_dir_list(view, 0));
+	assert_non_null(view->dir_stream);
+
+	copy_str(view->curr_dir, sizeof(view->curr_dir), TEST_DATA_PATH);
+	assert_false(flist_stream_check(view));
+	assert_null(view->dir_stream);
+}
+
+TEST(targets_of_links_are_queried_relative_to_streamed_dir, IF(not_windows))
+{
+	create_dir(SANDBOX_PATH "/zdir");
+	assert_success(symlink("zdir", SANDBOX_PATH "/zlink"));
+
+	assert_success(populate_dir_list(view, 0));
+	wait_for_stream();
+	assert_int_equal(102, view->list_rows);
+
+	int i;
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		if(strcmp(view->dir_entry[i].name, "zlink") == 0)
+		{
+			assert_int_equal(FT_LINK, view->dir_entry[i].type);
+			assert_true(S_ISDIR(view->dir_entry[i].mode));
+			break;
+		}
+	}
+	assert_true(i < view->list_rows);
+
+	remove_file(SANDBOX_PATH "/zlink");
+	remove_dir(SANDBOX_PATH "/zdir");
+}
+
+static void
+create_files(const char dir[], int count)
+{
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		char path[PATH_MAX + 1];
+		snprintf(path, sizeof(path), "%s/file%03d", dir, i);
+		create_file(path);
+	}
+}
+
+static void
+remove_files(const char dir[], int count)
+{
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		char path[PATH_MAX + 1];
+		snprintf(path, sizeof(path), "%s/file%03d", dir, i);
+		remove_file(path);
+	}
+}
+
+static void
+wait_for_stream(void)
+{
+	int i;
+	for(i = 0; i < 5000 && view->dir_stream != NULL; ++i)
+	{
+		(void)flist_stream_check(view);
+		usleep(1000);
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -32,6 +32,7 @@ static void verify_tree_node(column_data_t *cdt, int idx,
 static void column_line_print(const char buf[], int offset, AlignType align,
 		const char full_column[], const format_info_t *info);
 static int remove_selected(view_t *view, const dir_entry_t *entry, void *arg);
+static int using_inotify(void);
 
 static char cwd[PATH_MAX + 1], test_data[PATH_MAX + 1];
 
@@ -183,6 +184,30 @@ TEST(tree_is_reloaded_automatically_with_file_updates)
 	assert_success(remove(SANDBOX_PATH "/a"));
 }
 
+TEST(nested_directory_changes_are_watched, IF(using_inotify))
+{
+	assert_success(os_mkdir(SANDBOX_PATH "/nested-dir", 0700));
+	create_file(SANDBOX_PATH "/nested-dir/a");
+
+	assert_success(load_tree(&lwin, SANDBOX_PATH, cwd));
+	assert_int_equal(2, lwin.list_rows);
+	assert_non_null(lwin.tree_watch);
+
+	check_if_filelist_has_changed(&lwin);
+	(void)ui_view_query_scheduled_event(&lwin);
+	check_if_filelist_has_changed(&lwin);
+	assert_int_equal(UUE_NONE, ui_view_query_scheduled_event(&lwin));
+
+	/* No need to wait for modification time to change. */
+	create_file(SANDBOX_PATH "/nested-dir/b");
+	check_if_filelist_has_changed(&lwin);
+	assert_int_equal(UUE_RELOAD, ui_view_query_scheduled_event(&lwin));
+
+	assert_success(remove(SANDBOX_PATH "/nested-dir/a"));
+	assert_success(remove(SANDBOX_PATH "/nested-dir/b"));
+	assert_success(rmdir(SANDBOX_PATH "/nested-dir"));
+}
+
 TEST(nested_directory_change_detection)
 {
 	struct stat st1, st2;
@@ -678,5 +703,15 @@ remove_selected(view_t *view, const dir_entry_t *entry, void *arg)
 	return !entry->selected;
 }
 
+static int
+using_inotify(void)
+{
+#ifdef HAVE_INOTIFY
+	return 1;
+#else
+	return 0;
+#endif
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
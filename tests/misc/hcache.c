@@ -0,0 +1,162 @@
+#include <stic.h>
+
+#include <string.h> /* memcmp() */
+
+#include <test-utils.h>
+
+#include "../../src/compat/os.h"
+#include "../../src/hcache.h"
+
+static hcache_key_t make_key(uint64_t inode);
+
+SETUP()
+{
+	hcache_reset(4);
+}
+
+TEARDOWN()
+{
+	hcache_reset(0);
+}
+
+TEST(digests_are_found_by_their_keys)
+{
+	const hcache_key_t key = make_key(1);
+	const hcache_digest_t digest = { .high = 10, .low = 20 };
+	hcache_put(&key, &digest);
+
+	hcache_digest_t found;
+	assert_true(hcache_get(&key, &found));
+	assert_ulong_equal(10, found.high);
+	assert_ulong_equal(20, found.low);
+
+	hcache_key_t other_key = key;
+	other_key.mtime_ns += 1;
+	assert_false(hcache_get(&other_key, &found));
+}
+
+TEST(least_recently_used_entries_are_evicted)
+{
+	const hcache_digest_t digest = { .high = 1, .low = 2 };
+
+	int i;
+	for(i = 1; i <= 5; ++i)
+	{
+		const hcache_key_t key = make_key(i);
+		hcache_restore(&key, &digest, i);
+	}
+
+	hcache_digest_t found;
+	hcache_key_t key = make_key(1);
+	assert_false(hcache_get(&key, &found));
+	for(i = 2; i <= 5; ++i)
+	{
+		key = make_key(i);
+		assert_true(hcache_get(&key, &found));
+	}
+}
+
+TEST(prefixes_of_files_have_separate_entries)
+{
+	hcache_key_t key = make_key(1);
+	const hcache_digest_t full_digest = { .high = 1, .low = 1 };
+	const hcache_digest_t prefix_digest = { .high = 2, .low = 2 };
+	hcache_put(&key, &full_digest);
+	key.prefix = 10;
+	hcache_put(&key, &prefix_digest);
+
+	hcache_digest_t found;
+	assert_true(hcache_get(&key, &found));
+	assert_ulong_equal(2, found.high);
+	key.prefix = 0;
+	assert_true(hcache_get(&key, &found));
+	assert_ulong_equal(1, found.high);
+}
+
+TEST(reserved_entries_are_not_evicted)
+{
+	const hcache_digest_t digest = { .high = 1, .low = 2 };
+
+	hcache_key_t key = make_key(1);
+	hcache_put(&key, &digest);
+
+	hcache_reserve(8);
+	assert_int_equal(8, hcache_capacity());
+	hcache_reserve(2);
+	assert_int_equal(8, hcache_capacity());
+
+	int i;
+	for(i = 2; i <= 8; ++i)
+	{
+		key = make_key(i);
+		hcache_put(&key, &digest);
+	}
+
+	hcache_digest_t found;
+	for(i = 1; i <= 8; ++i)
+	{
+		key = make_key(i);
+		assert_true(hcache_get(&key, &found));
+	}
+}
+
+TEST(restoring_does_not_override_more_recent_entries)
+{
+	const hcache_key_t key = make_key(1);
+	const hcache_digest_t new_digest = { .high = 1, .low = 1 };
+	const hcache_digest_t old_digest = { .high = 2, .low = 2 };
+	hcache_restore(&key, &new_digest, 20);
+	hcache_restore(&key, &old_digest, 10);
+
+	hcache_digest_t found;
+	assert_true(hcache_get(&key, &found));
+	assert_ulong_equal(1, found.high);
+}
+
+TEST(key_reflects_changes_of_a_file, IF(not_windows))
+{
+	hcache_key_t before, after;
+
+	make_file(SANDBOX_PATH "/file", "a");
+	assert_success(hcache_key_of(SANDBOX_PATH "/file", &before));
+	assert_success(hcache_key_of(SANDBOX_PATH "/file", &after));
+	assert_true(memcmp(&before, &after, sizeof(before)) == 0);
+
+	make_file(SANDBOX_PATH "/file", "ab");
+	assert_success(hcache_key_of(SANDBOX_PATH "/file", &after));
+	assert_false(memcmp(&before, &after, sizeof(before)) == 0);
+
+	remove_file(SANDBOX_PATH "/file");
+
+	assert_failure(hcache_key_of(SANDBOX_PATH "/file", &after));
+}
+
+TEST(key_reflects_changes_of_status_of_a_file, IF(not_windows))
+{
+	hcache_key_t before, after;
+
+	make_file(SANDBOX_PATH "/file", "a");
+	assert_success(hcache_key_of(SANDBOX_PATH "/file", &before));
+
+	/* Changes ctime, but not mtime. */
+	assert_success(os_chmod(SANDBOX_PATH "/file", 0600));
+	assert_success(os_chmod(SANDBOX_PATH "/file", 0640));
+	assert_success(hcache_key_of(SANDBOX_PATH "/file", &after));
+	assert_true(before.mtime_ns == after.mtime_ns);
+	assert_false(memcmp(&before, &after, sizeof(before)) == 0);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+/* Makes key that differs from others only by inode number. */
+static hcache_key_t
+make_key(uint64_t inode)
+{
+	const hcache_key_t key = {
+		.dev = 1, .inode = inode, .size = 100, .mtime_ns = 1000
+	};
+	return key;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -615,6 +615,13 @@ TEST(iooptions)
 	assert_success(cmds_dispatch("set iooptions=datasync", &lwin, CIT_COMMAND));
 	assert_false(cfg.fast_file_cloning);
 	assert_true(cfg.data_sync);
+	assert_false(cfg.sparse_files);
+
+	assert_success(cmds_dispatch("set iooptions=sparsefiles", &lwin,
+				CIT_COMMAND));
+	assert_false(cfg.fast_file_cloning);
+	assert_false(cfg.data_sync);
+	assert_true(cfg.sparse_files);
 }
 
 TEST(mouse)
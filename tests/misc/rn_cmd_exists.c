@@ -1,7 +1,16 @@
 #include <stic.h>
 
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* strdup() */
+#include <unistd.h> /* chdir() */
+
 #include <test-utils.h>
 
+#include "../../src/compat/fs_limits.h"
+#include "../../src/int/path_env.h"
+#include "../../src/utils/env.h"
+#include "../../src/utils/fs.h"
 #include "../../src/filetype.h"
 #include "../../src/running.h"
 #include "../../src/status.h"
@@ -39,5 +48,89 @@ TEST(exe_path_with_backslashes, IF(windows))
 	ft_init(NULL);
 }
 
+TEST(new_and_removed_executables_in_path_are_noticed, IF(not_windows))
+{
+	char dir[PATH_MAX + 1];
+	make_abs_path(dir, sizeof(dir), SANDBOX_PATH, "dir", NULL);
+	create_dir(dir);
+
+	char *const saved_path_env = strdup(env_get("PATH"));
+	env_set("PATH", dir);
+	update_path_env(1);
+	path_env_set_check_interval(0);
+
+	assert_false(rn_cmd_exists("exe"));
+
+	create_executable(SANDBOX_PATH "/dir/exe");
+	assert_true(rn_cmd_exists("exe"));
+	assert_true(rn_cmd_exists("!!exe"));
+
+	remove_file(SANDBOX_PATH "/dir/exe");
+	assert_false(rn_cmd_exists("exe"));
+
+	path_env_set_check_interval(1);
+	env_set("PATH", saved_path_env);
+	update_path_env(1);
+	free(saved_path_env);
+
+	remove_dir(dir);
+}
+
+TEST(update_of_path_is_noticed, IF(not_windows))
+{
+	char dir[PATH_MAX + 1];
+	make_abs_path(dir, sizeof(dir), SANDBOX_PATH, "dir", NULL);
+	create_dir(dir);
+	create_executable(SANDBOX_PATH "/dir/exe");
+
+	char *const saved_path_env = strdup(env_get("PATH"));
+	assert_false(rn_cmd_exists("exe"));
+
+	env_set("PATH", dir);
+	update_path_env(1);
+	assert_true(rn_cmd_exists("exe"));
+
+	env_set("PATH", saved_path_env);
+	update_path_env(1);
+	assert_false(rn_cmd_exists("exe"));
+	free(saved_path_env);
+
+	remove_file(SANDBOX_PATH "/dir/exe");
+	remove_dir(dir);
+}
+
+TEST(relative_path_entries_disable_index_until_path_changes, IF(not_windows))
+{
+	char dir[PATH_MAX + 1];
+	make_abs_path(dir, sizeof(dir), SANDBOX_PATH, "dir", NULL);
+	create_dir(dir);
+	create_executable(SANDBOX_PATH "/exe");
+
+	char cwd[PATH_MAX + 1];
+	assert_non_null(get_cwd(cwd, sizeof(cwd)));
+	assert_success(chdir(SANDBOX_PATH));
+
+	char path_env[PATH_MAX + 16];
+	snprintf(path_env, sizeof(path_env), "%s:.", dir);
+
+	char *const saved_path_env = strdup(env_get("PATH"));
+	env_set("PATH", path_env);
+	update_path_env(1);
+	assert_true(rn_cmd_exists("exe"));
+	assert_true(rn_cmd_exists("exe"));
+
+	env_set("PATH", dir);
+	update_path_env(1);
+	assert_false(rn_cmd_exists("exe"));
+
+	env_set("PATH", saved_path_env);
+	update_path_env(1);
+	free(saved_path_env);
+
+	assert_success(chdir(cwd));
+	remove_file(SANDBOX_PATH "/exe");
+	remove_dir(dir);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -2,17 +2,24 @@
 
 #include <unistd.h> /* chdir() */
 
-#include <string.h> /* strcpy() */
+#include <limits.h> /* INT_MAX */
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* free() malloc() */
+#include <string.h> /* strcpy() strdup() */
 
 #include <test-utils.h>
 
 #include "../../src/cfg/config.h"
 #include "../../src/modes/normal.h"
+#include "../../src/utils/dynarray.h"
 #include "../../src/utils/fs.h"
 #include "../../src/filelist.h"
 #include "../../src/search.h"
 
 static void set_pos_in_curr_view(int pos);
+static void make_file_list(view_t *view, int count);
+static int * full_search(view_t *view, const char pattern[]);
+static void check_matches(const view_t *view, const int expected[]);
 
 static char *saved_cwd;
 
@@ -47,6 +54,8 @@ TEARDOWN()
 	view_teardown(&rwin);
 
 	restore_cwd(saved_cwd);
+
+	set_parallel_search(-1, 0);
 }
 
 TEST(matches_can_be_highlighted)
@@ -244,11 +253,140 @@ TEST(matching_directories)
 	cfg.hl_search = 0;
 }
 
+TEST(extending_literal_pattern_refines_matches)
+{
+	view_teardown(&lwin);
+	view_setup(&lwin);
+	make_file_list(&lwin, 1000);
+
+	int *const expected = full_search(&lwin, "file12");
+
+	search_pattern(&lwin, "file1", /*stash_selection=*/0, /*select_matches=*/0);
+	assert_int_equal(111, lwin.matches);
+
+	/* Entry that didn't match is changed behind the back of search, refined
+	 * search doesn't look at it. */
+	assert_int_equal(0, lwin.dir_entry[500].search_match);
+	free(lwin.dir_entry[500].name);
+	lwin.dir_entry[500].name = strdup("file12x");
+
+	search_pattern(&lwin, "file12", /*stash_selection=*/0, /*select_matches=*/0);
+	assert_int_equal(11, lwin.matches);
+	check_matches(&lwin, expected);
+
+	free(expected);
+}
+
+TEST(non_literal_patterns_are_not_refined)
+{
+	view_teardown(&lwin);
+	view_setup(&lwin);
+	make_file_list(&lwin, 1000);
+
+	search_pattern(&lwin, "file1", /*stash_selection=*/0, /*select_matches=*/0);
+	assert_int_equal(111, lwin.matches);
+	search_pattern(&lwin, "file1|file2", /*stash_selection=*/0,
+			/*select_matches=*/0);
+	assert_int_equal(222, lwin.matches);
+
+	search_pattern(&lwin, "file1.", /*stash_selection=*/0, /*select_matches=*/0);
+	assert_int_equal(110, lwin.matches);
+	search_pattern(&lwin, "file1.3", /*stash_selection=*/0,
+			/*select_matches=*/0);
+	assert_int_equal(10, lwin.matches);
+}
+
+TEST(renamed_entries_are_found_by_extended_pattern)
+{
+	view_teardown(&lwin);
+	view_setup(&lwin);
+	make_file_list(&lwin, 100);
+
+	search_pattern(&lwin, "file1", /*stash_selection=*/0, /*select_matches=*/0);
+	assert_int_equal(11, lwin.matches);
+	assert_int_equal(0, lwin.dir_entry[20].search_match);
+
+	fentry_rename(&lwin, &lwin.dir_entry[20], "file10x");
+	search_pattern(&lwin, "file10", /*stash_selection=*/0, /*select_matches=*/0);
+	assert_int_equal(2, lwin.matches);
+	assert_int_equal(2, lwin.dir_entry[20].search_match);
+}
+
+TEST(parallel_search_agrees_with_sequential_one)
+{
+	view_teardown(&lwin);
+	view_setup(&lwin);
+	make_file_list(&lwin, 1000);
+
+	int *const expected = full_search(&lwin, "e[0-9]*7/?$");
+
+	set_parallel_search(0, 4);
+	search_pattern(&lwin, "e[0-9]*7/?$", /*stash_selection=*/0,
+			/*select_matches=*/1);
+	assert_int_equal(100, lwin.matches);
+	assert_int_equal(100, lwin.selected_files);
+	check_matches(&lwin, expected);
+
+	free(expected);
+}
+
 static void
 set_pos_in_curr_view(int pos)
 {
 	curr_view->list_pos = pos;
 }
 
+/* Fills the view with count entries, every fifth of which is a directory. */
+static void
+make_file_list(view_t *view, int count)
+{
+	view->list_rows = count;
+	view->dir_entry = dynarray_cextend(NULL,
+			view->list_rows*sizeof(*view->dir_entry));
+
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "file%d", i);
+		view->dir_entry[i].name = strdup(name);
+		view->dir_entry[i].type = (i%5 == 0 ? FT_DIR : FT_REG);
+		view->dir_entry[i].origin = view->curr_dir;
+	}
+}
+
+/* Searches for the pattern by checking every entry in a single thread.  Returns
+ * match numbers of entries, which should be freed by the caller. */
+static int *
+full_search(view_t *view, const char pattern[])
+{
+	set_parallel_search(INT_MAX, 1);
+	search_list_changed(view);
+	search_pattern(view, pattern, /*stash_selection=*/0, /*select_matches=*/0);
+	assert_true(view->matches > 0);
+
+	int *const matches = malloc(sizeof(*matches)*view->list_rows);
+	int i;
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		matches[i] = view->dir_entry[i].search_match;
+	}
+
+	reset_search_results(view);
+	set_parallel_search(-1, 0);
+	return matches;
+}
+
+/* Checks that entries of the view are matched and numbered as expected. */
+static void
+check_matches(const view_t *view, const int expected[])
+{
+	int i;
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		assert_int_equal(expected[i], view->dir_entry[i].search_match);
+	}
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -2,8 +2,10 @@
 
 #include <unistd.h> /* chdir() unlink() */
 
+#include <limits.h> /* INT_MAX */
 #include <stdarg.h> /* va_list va_arg() va_copy() va_end() va_start() */
-#include <string.h> /* strcpy() */
+#include <stdio.h> /* printf() snprintf() */
+#include <string.h> /* strcmp() strcpy() strdup() */
 
 #include <test-utils.h>
 
@@ -16,11 +18,16 @@
 #include "../../src/sort.h"
 #include "../../src/status.h"
 
+/* Number of entries used in benchmark. */
+#define BENCH_FILES 100000
+
 #define SIGN(n) ({__typeof(n) _n = (n); (_n < 0) ? -1 : (_n > 0);})
 #define ASSERT_STRCMP_EQUAL(a, b) \
 		do { assert_int_equal(SIGN(a), SIGN(b)); } while(0)
 
 static void set_file_list(view_t *view, FileType def_ftype, ...);
+static void make_file_list(view_t *view, int count);
+static double sort_time(int threshold, int times);
 static int on_case_sensitive_fs(void);
 
 SETUP_ONCE()
@@ -43,6 +50,7 @@ SETUP()
 
 TEARDOWN()
 {
+	set_parallel_sort(-1, 0);
 	update_string(&cfg.shell, NULL);
 
 	view_teardown(&lwin);
@@ -391,6 +399,30 @@ TEST(groups_sorting_works)
 	assert_string_equal("3-done", lwin.dir_entry[6].name);
 }
 
+TEST(change_of_groups_is_picked_up)
+{
+	view_teardown(&lwin);
+	view_setup(&lwin);
+
+	set_file_list(&lwin, FT_REG, "a2", "b1", NULL);
+	view_set_sort(lwin.sort, SK_BY_GROUPS, SK_NONE);
+
+	update_string(&lwin.sort_groups, "([0-9])");
+	sort_view(&lwin);
+	assert_string_equal("b1", lwin.dir_entry[0].name);
+	assert_string_equal("a2", lwin.dir_entry[1].name);
+
+	update_string(&lwin.sort_groups, "([a-z])");
+	sort_view(&lwin);
+	assert_string_equal("a2", lwin.dir_entry[0].name);
+	assert_string_equal("b1", lwin.dir_entry[1].name);
+
+	update_string(&lwin.sort_groups, "([0-9]),([a-z])");
+	sort_view(&lwin);
+	assert_string_equal("b1", lwin.dir_entry[0].name);
+	assert_string_equal("a2", lwin.dir_entry[1].name);
+}
+
 TEST(global_groups_sorts_entries_list)
 {
 	update_string(&lwin.sort_groups_g, "([0-9])");
@@ -519,6 +551,162 @@ TEST(custom_view_is_sorted_by_short_paths, IF(on_case_sensitive_fs))
 	remove_dir(SANDBOX_PATH "/D");
 }
 
+TEST(equal_entries_keep_their_order)
+{
+	view_teardown(&lwin);
+	view_setup(&lwin);
+
+	set_file_list(&lwin, FT_REG, "c", "a", "b", NULL);
+	lwin.dir_entry[0].size = 1;
+	lwin.dir_entry[1].size = 2;
+	lwin.dir_entry[2].size = 1;
+
+	view_set_sort(lwin.sort, SK_BY_SIZE, SK_NONE);
+	sort_view(&lwin);
+
+	assert_string_equal("c", lwin.dir_entry[0].name);
+	assert_string_equal("b", lwin.dir_entry[1].name);
+	assert_string_equal("a", lwin.dir_entry[2].name);
+
+	view_set_sort(lwin.sort, -SK_BY_SIZE, SK_NONE);
+	sort_view(&lwin);
+
+	assert_string_equal("a", lwin.dir_entry[0].name);
+	assert_string_equal("c", lwin.dir_entry[1].name);
+	assert_string_equal("b", lwin.dir_entry[2].name);
+}
+
+TEST(negative_times_are_sorted_correctly)
+{
+	view_teardown(&lwin);
+	view_setup(&lwin);
+
+	set_file_list(&lwin, FT_REG, "a", "b", "c", NULL);
+	lwin.dir_entry[0].mtime = 10;
+	lwin.dir_entry[1].mtime = -5;
+	lwin.dir_entry[2].mtime = 0;
+
+	view_set_sort(lwin.sort, SK_BY_TIME_MODIFIED, SK_NONE);
+	sort_view(&lwin);
+
+	assert_string_equal("b", lwin.dir_entry[0].name);
+	assert_string_equal("c", lwin.dir_entry[1].name);
+	assert_string_equal("a", lwin.dir_entry[2].name);
+}
+
+TEST(parent_directory_stays_first)
+{
+	view_teardown(&lwin);
+	view_setup(&lwin);
+
+	set_file_list(&lwin, FT_DIR, "a", "..", "b", NULL);
+	lwin.dir_entry[0].mtime = 2;
+	lwin.dir_entry[1].mtime = 3;
+	lwin.dir_entry[2].mtime = 1;
+
+	view_set_sort(lwin.sort, -SK_BY_NAME, SK_NONE);
+	sort_view(&lwin);
+
+	assert_string_equal("..", lwin.dir_entry[0].name);
+	assert_string_equal("b", lwin.dir_entry[1].name);
+	assert_string_equal("a", lwin.dir_entry[2].name);
+
+	view_set_sort(lwin.sort, SK_BY_TIME_MODIFIED, SK_NONE);
+	sort_view(&lwin);
+
+	assert_string_equal("..", lwin.dir_entry[0].name);
+	assert_string_equal("b", lwin.dir_entry[1].name);
+	assert_string_equal("a", lwin.dir_entry[2].name);
+}
+
+TEST(sorting_by_several_keys_agrees_with_comparison)
+{
+	view_teardown(&lwin);
+	view_setup(&lwin);
+	assert_success(stats_init(&cfg));
+
+	make_file_list(&lwin, 1000);
+
+	view_set_sort(lwin.sort, -SK_BY_SIZE, SK_BY_NAME);
+	sort_view(&lwin);
+
+	int i;
+	for(i = 1; i < lwin.list_rows; ++i)
+	{
+		assert_true(sort_compare_entries(&lwin, &lwin.dir_entry[i - 1],
+					&lwin.dir_entry[i]) < 0);
+	}
+}
+
+TEST(parallel_sorting_agrees_with_comparison)
+{
+	view_teardown(&lwin);
+	view_setup(&lwin);
+	assert_success(stats_init(&cfg));
+
+	make_file_list(&lwin, 1000);
+
+	set_parallel_sort(0, 4);
+	view_set_sort(lwin.sort, SK_BY_DIR, -SK_BY_SIZE);
+	sort_view(&lwin);
+
+	int i;
+	for(i = 1; i < lwin.list_rows; ++i)
+	{
+		assert_true(sort_compare_entries(&lwin, &lwin.dir_entry[i - 1],
+					&lwin.dir_entry[i]) <= 0);
+	}
+}
+
+TEST(parallel_sorting_is_stable)
+{
+	view_teardown(&lwin);
+	view_setup(&lwin);
+
+	make_file_list(&lwin, 999);
+
+	/* Names are unique and don't take part in sorting, they track positions. */
+	int i;
+	for(i = 0; i < lwin.list_rows; ++i)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%04d", i);
+		replace_string(&lwin.dir_entry[i].name, name);
+		lwin.dir_entry[i].type = FT_REG;
+	}
+
+	set_parallel_sort(0, 4);
+	view_set_sort(lwin.sort, SK_BY_SIZE, SK_NONE);
+	sort_view(&lwin);
+
+	for(i = 1; i < lwin.list_rows; ++i)
+	{
+		const dir_entry_t *prev = &lwin.dir_entry[i - 1];
+		const dir_entry_t *curr = &lwin.dir_entry[i];
+		assert_true(prev->size <= curr->size);
+		if(prev->size == curr->size)
+		{
+			assert_true(strcmp(prev->name, curr->name) < 0);
+		}
+	}
+}
+
+TEST(benchmark_sorting_by_several_keys, IF(benchmarks_enabled))
+{
+	view_teardown(&lwin);
+	view_setup(&lwin);
+	assert_success(stats_init(&cfg));
+
+	make_file_list(&lwin, BENCH_FILES);
+
+	view_set_sort(lwin.sort, SK_BY_TYPE, -SK_BY_SIZE);
+
+	const double serial = sort_time(INT_MAX, 10);
+	const double parallel = sort_time(0, 10);
+	printf("Sorting %d entries 10 times: serial %.3fs, parallel %.3fs\n",
+			BENCH_FILES, serial, parallel);
+}
+
 #ifndef _WIN32
 
 TEST(inode_sorting_works)
@@ -576,6 +764,49 @@ set_file_list(view_t *view, FileType def_ftype, ...)
 	va_end(aq);
 }
 
+/* Fills the view with files and directories of various sizes. */
+static void
+make_file_list(view_t *view, int count)
+{
+	view->list_rows = count;
+	view->dir_entry = dynarray_cextend(NULL,
+			view->list_rows*sizeof(*view->dir_entry));
+
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "file%d", (i*7919)%count);
+		view->dir_entry[i].name = strdup(name);
+		view->dir_entry[i].type = (i%5 == 0 ? FT_DIR : FT_REG);
+		view->dir_entry[i].size = i%13;
+		view->dir_entry[i].origin = view->curr_dir;
+	}
+}
+
+/* Measures total time it takes to sort reversed list of the left view several
+ * times.  Returns the time. */
+static double
+sort_time(int threshold, int times)
+{
+	set_parallel_sort(threshold, 0);
+
+	const double start = bench_time();
+	while(times-- > 0)
+	{
+		/* Reverse the list to not sort an already sorted one. */
+		int i;
+		for(i = 0; i < lwin.list_rows/2; ++i)
+		{
+			dir_entry_t tmp = lwin.dir_entry[i];
+			lwin.dir_entry[i] = lwin.dir_entry[lwin.list_rows - 1 - i];
+			lwin.dir_entry[lwin.list_rows - 1 - i] = tmp;
+		}
+		sort_view(&lwin);
+	}
+	return bench_time() - start;
+}
+
 /* Checks that sandbox directory is located on a file-system that allows files
  * that differ only by character case.  Returns non-zero if so. */
 static int
@@ -3,6 +3,7 @@
 #include <sys/stat.h> /* chmod() */
 #include <unistd.h> /* usleep() */
 
+#include <stdio.h> /* snprintf() */
 #include <string.h> /* strlen() */
 
 #include <test-utils.h>
@@ -229,7 +230,8 @@ TEST(failure_to_allocate_cache_entry_is_handled)
 
 TEST(cache_entries_are_reused)
 {
-	vcache_reset((vcache_entry_size() + 20)*2);
+	vcache_reset((vcache_entry_size(TEST_DATA_PATH "/read/dos-line-endings",
+			NULL) + 20)*2);
 
 	/* Two lines are cached. */
 	strlist_t lines = vcache_lookup(TEST_DATA_PATH "/read/dos-line-endings", NULL,
@@ -258,6 +260,52 @@ TEST(cache_entries_are_reused)
 	assert_string_equal("first line", lines.items[0]);
 }
 
+TEST(size_of_entries_is_exact)
+{
+	strlist_t lines = vcache_lookup(TEST_DATA_PATH "/read/two-lines", NULL,
+			MF_NONE, VK_TEXTUAL, 10, VC_SYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(2, lines.nitems);
+
+	assert_int_equal(vcache_entry_size(TEST_DATA_PATH "/read/two-lines", NULL) +
+			2*sizeof(char *) + strlen("1st line") + 1 + strlen("2nd line") + 1,
+			vcache_size());
+}
+
+TEST(many_entries_are_found)
+{
+	vcache_reset(1024*1024);
+
+	enum { N = 300 };
+	char **items[N];
+
+	int i;
+	for(i = 0; i < N; ++i)
+	{
+		char path[64];
+		snprintf(path, sizeof(path), "%s/file%d", SANDBOX_PATH, i);
+		make_file(path, "line");
+
+		strlist_t lines = vcache_lookup(path, NULL, MF_NONE, VK_TEXTUAL, 10,
+				VC_SYNC, &error);
+		assert_int_equal(1, lines.nitems);
+		items[i] = lines.items;
+	}
+
+	for(i = 0; i < N; ++i)
+	{
+		char path[64];
+		snprintf(path, sizeof(path), "%s/file%d", SANDBOX_PATH, i);
+
+		/* Output is taken from the cache as is. */
+		strlist_t lines = vcache_lookup(path, NULL, MF_NONE, VK_TEXTUAL, 10,
+				VC_SYNC, &error);
+		assert_true(lines.items == items[i]);
+
+		remove_file(path);
+	}
+}
+
 TEST(viewers_are_cached_independently)
 {
 	strlist_t lines1 = vcache_lookup(TEST_DATA_PATH "/read/two-lines", "echo aaa",
@@ -403,6 +451,79 @@ TEST(kill_all_async_previews_on_exit, IF(not_windows))
 	wait_for_all_bg();
 }
 
+TEST(prefetched_output_is_used)
+{
+	vcache_prefetch_begin();
+	vcache_prefetch(TEST_DATA_PATH "/read/two-lines", "echo aaa", MF_NONE,
+			VK_TEXTUAL, 10);
+	vcache_prefetch_end();
+
+	assert_true(wait_for_cache());
+
+	strlist_t lines = vcache_lookup(TEST_DATA_PATH "/read/two-lines", "echo aaa",
+			MF_NONE, VK_TEXTUAL, 10, VC_ASYNC, &error);
+	assert_string_equal(NULL, error);
+	assert_int_equal(1, lines.nitems);
+	assert_string_equal("aaa", lines.items[0]);
+}
+
+TEST(only_external_textual_viewers_are_prefetched)
+{
+	vcache_reset(1024*1024);
+
+	vcache_prefetch_begin();
+	vcache_prefetch(TEST_DATA_PATH "/read/two-lines", NULL, MF_NONE, VK_TEXTUAL,
+			10);
+	vcache_prefetch(TEST_DATA_PATH "/read/two-lines", "echo a", MF_NONE,
+			VK_GRAPHICAL, 10);
+	vcache_prefetch(TEST_DATA_PATH "/read/two-lines", "echo b", MF_NO_CACHE,
+			VK_TEXTUAL, 10);
+	vcache_prefetch_end();
+
+	assert_int_equal(0, vcache_size());
+}
+
+TEST(prefetching_does_not_evict_entries)
+{
+	vcache_reset(0);
+
+	vcache_prefetch_begin();
+	vcache_prefetch(TEST_DATA_PATH "/read/two-lines", "echo aaa", MF_NONE,
+			VK_TEXTUAL, 10);
+	vcache_prefetch_end();
+
+	assert_int_equal(0, vcache_size());
+}
+
+TEST(number_of_prefetching_viewers_is_limited, IF(not_windows))
+{
+	vcache_reset(1024*1024);
+
+	vcache_prefetch_begin();
+	vcache_prefetch(TEST_DATA_PATH "/read/two-lines", "sleep 10", MF_NONE,
+			VK_TEXTUAL, 10);
+	vcache_prefetch(TEST_DATA_PATH "/read/two-lines", "sleep 11", MF_NONE,
+			VK_TEXTUAL, 10);
+	vcache_prefetch(TEST_DATA_PATH "/read/two-lines", "sleep 12", MF_NONE,
+			VK_TEXTUAL, 10);
+	vcache_prefetch_end();
+	assert_int_equal(2*vcache_entry_size(TEST_DATA_PATH "/read/two-lines",
+			"sleep 10"), vcache_size());
+
+	/* Viewers that are no longer needed are cancelled and don't count. */
+	vcache_prefetch_begin();
+	vcache_prefetch_end();
+	vcache_prefetch_begin();
+	vcache_prefetch(TEST_DATA_PATH "/read/two-lines", "sleep 12", MF_NONE,
+			VK_TEXTUAL, 10);
+	vcache_prefetch_end();
+	assert_int_equal(3*vcache_entry_size(TEST_DATA_PATH "/read/two-lines",
+			"sleep 10"), vcache_size());
+
+	vcache_finish();
+	wait_for_all_bg();
+}
+
 static int
 wait_for_cache(void)
 {
@@ -1,5 +1,9 @@
 #include <stic.h>
 
+#include <unistd.h> /* usleep() */
+
+#include <stdio.h> /* FILE fclose() fopen() fprintf() */
+
 #include <test-utils.h>
 
 #include "../../src/cfg/config.h"
@@ -24,6 +28,7 @@
 
 static int start_view_mode(const char pattern[], const char viewers[],
 		const char base_dir[], const char sub_path[]);
+static int wait_for_line(int line);
 
 SETUP_ONCE()
 {
@@ -62,6 +67,8 @@ TEARDOWN()
 
 	vle_keys_reset();
 	ft_reset(0);
+
+	modview_set_paging(32*1024*1024, 4096);
 }
 
 TEST(initialization, IF(not_windows))
@@ -303,6 +310,50 @@ TEST(searching_in_view_mode)
 	remove_file(SANDBOX_PATH "/file");
 }
 
+TEST(large_files_are_paged_through)
+{
+	FILE *const fp = fopen(SANDBOX_PATH "/file", "w");
+	int i;
+	for(i = 0; i < 100; ++i)
+	{
+		fprintf(fp, "line%d\n", i);
+	}
+	fclose(fp);
+
+	lwin.window_cols = 80;
+	modview_set_paging(0, 16);
+	assert_true(start_view_mode("*", NULL, SANDBOX_PATH, ""));
+
+	strlist_t lines = modview_lines(lwin.vi);
+	assert_int_equal(16, lines.nitems);
+	assert_string_equal("line0", lines.items[0]);
+
+	(void)vle_keys_exec_timed_out(WK_G);
+	assert_int_equal(99, wait_for_line(99));
+	lines = modview_lines(lwin.vi);
+	assert_string_equal("line99", lines.items[lines.nitems - 1]);
+
+	(void)vle_keys_exec_timed_out(L"50" WK_G);
+	assert_int_equal(49, modview_current_line(lwin.vi));
+	(void)vle_keys_exec_timed_out(WK_g WK_g);
+	assert_int_equal(0, modview_current_line(lwin.vi));
+	(void)vle_keys_exec_timed_out(L"20" WK_j);
+	assert_int_equal(20, modview_current_line(lwin.vi));
+	(void)vle_keys_exec_timed_out(L"3" WK_k);
+	assert_int_equal(17, modview_current_line(lwin.vi));
+
+	(void)vle_keys_exec_timed_out(L"/line7[0-9]");
+	(void)vle_keys_exec_timed_out(WK_CR);
+	assert_int_equal(70, modview_current_line(lwin.vi));
+	(void)vle_keys_exec_timed_out(WK_n);
+	assert_int_equal(71, modview_current_line(lwin.vi));
+	(void)vle_keys_exec_timed_out(L"?line1[0-9]");
+	(void)vle_keys_exec_timed_out(WK_CR);
+	assert_int_equal(19, modview_current_line(lwin.vi));
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
 TEST(operations_with_empty_output)
 {
 	assert_true(start_view_mode("*", "true", TEST_DATA_PATH, "read"));
@@ -471,5 +522,18 @@ start_view_mode(const char pattern[], const char viewers[],
 	return vle_mode_is(VIEW_MODE);
 }
 
+/* Waits for number of the current line to become known.  Returns the
+ * number. */
+static int
+wait_for_line(int line)
+{
+	int i;
+	for(i = 0; i < 1000 && modview_current_line(lwin.vi) != line; ++i)
+	{
+		usleep(5000);
+	}
+	return modview_current_line(lwin.vi);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
@@ -3,7 +3,7 @@
 #include <sys/stat.h> /* stat */
 #include <unistd.h> /* stat() */
 
-#include <stdio.h> /* fclose() fopen() fprintf() remove() */
+#include <stdio.h> /* FILE fclose() fopen() fprintf() remove() snprintf() */
 #include <stdlib.h> /* free() */
 
 #include <test-utils.h>
@@ -11,15 +11,19 @@
 #include "../../src/cfg/config.h"
 #include "../../src/cfg/info.h"
 #include "../../src/cfg/info_chars.h"
+#include "../../src/compat/os.h"
 #include "../../src/engine/keys.h"
 #include "../../src/ui/column_view.h"
 #include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
 #include "../../src/utils/matcher.h"
 #include "../../src/utils/parson.h"
 #include "../../src/utils/str.h"
+#include "../../src/utils/string_array.h"
 #include "../../src/cmd_core.h"
 #include "../../src/filetype.h"
 #include "../../src/flist_hist.h"
+#include "../../src/hcache.h"
 #include "../../src/instance.h"
 #include "../../src/opt_handlers.h"
 #include "../../src/status.h"
@@ -423,6 +427,129 @@ TEST(savedirs_works_on_its_own)
 	assert_string_equal("/rdir", rwin.curr_dir);
 }
 
+TEST(dcache_round_trip)
+{
+	cfg.vifm_info = VINFO_DCACHE;
+
+	update_string(&cfg.shell, "");
+	assert_success(stats_init(&cfg));
+
+	struct stat st;
+	assert_success(os_stat(TEST_DATA_PATH "/read", &st));
+	assert_success(dcache_set_at(TEST_DATA_PATH "/read", st.st_ino, 1234,
+				DCACHE_UNKNOWN));
+	write_info_file();
+
+	assert_success(stats_init(&cfg));
+	uint64_t size;
+	dcache_get_at(TEST_DATA_PATH "/read", st.st_mtime, st.st_ino, &size, NULL);
+	assert_ulong_equal(DCACHE_UNKNOWN, size);
+
+	state_load(0);
+	dcache_get_at(TEST_DATA_PATH "/read", st.st_mtime, st.st_ino, &size, NULL);
+	assert_ulong_equal(1234, size);
+
+	update_string(&cfg.shell, NULL);
+	assert_success(remove(SANDBOX_PATH "/vifminfo.json"));
+}
+
+TEST(only_newest_dcache_entries_are_stored)
+{
+	cfg.vifm_info = VINFO_DCACHE;
+	state_set_dcache_limit(2);
+
+	update_string(&cfg.shell, "");
+	assert_success(stats_init(&cfg));
+
+	const char *const dirs[] = { "read", "rename", "tree" };
+	char paths[3][PATH_MAX + 1];
+	struct stat st[3];
+	int i;
+	for(i = 0; i < 3; ++i)
+	{
+		char path[PATH_MAX + 1];
+		snprintf(path, sizeof(path), "%s/%s", TEST_DATA_PATH, dirs[i]);
+		assert_non_null(os_realpath(path, paths[i]));
+		assert_success(os_stat(paths[i], &st[i]));
+		/* Timestamps are in the past, so they don't hide sizes. */
+		assert_success(dcache_restore_size(paths[i], st[i].st_ino, 100 + i,
+					st[i].st_mtime + i));
+	}
+	write_info_file();
+
+	assert_success(stats_init(&cfg));
+	state_load(0);
+
+	uint64_t size;
+	dcache_get_at(paths[0], st[0].st_mtime, st[0].st_ino, &size, NULL);
+	assert_ulong_equal(DCACHE_UNKNOWN, size);
+	dcache_get_at(paths[1], st[1].st_mtime, st[1].st_ino, &size, NULL);
+	assert_ulong_equal(101, size);
+	dcache_get_at(paths[2], st[2].st_mtime, st[2].st_ino, &size, NULL);
+	assert_ulong_equal(102, size);
+
+	state_set_dcache_limit(10000);
+	update_string(&cfg.shell, NULL);
+	assert_success(remove(SANDBOX_PATH "/vifminfo.json"));
+}
+
+TEST(only_newest_dcache_entries_are_loaded)
+{
+	cfg.vifm_info = VINFO_DCACHE;
+	state_set_dcache_limit(1);
+
+	update_string(&cfg.shell, "");
+	assert_success(stats_init(&cfg));
+
+	char path[PATH_MAX + 1];
+	assert_non_null(os_realpath(TEST_DATA_PATH "/read", path));
+	struct stat st;
+	assert_success(os_stat(path, &st));
+
+	FILE *const f = fopen(SANDBOX_PATH "/vifminfo.json", "w");
+	fprintf(f, "{\"dcache\":{"
+			"\"/no/such/dir\":{\"size\":1,\"inode\":1,\"ts\":%lld},"
+			"\"%s\":{\"size\":2,\"inode\":%llu,\"ts\":%lld}}}",
+			(long long)st.st_mtime + 2, path, (unsigned long long)st.st_ino,
+			(long long)st.st_mtime + 1);
+	fclose(f);
+
+	state_load(0);
+
+	uint64_t size;
+	dcache_get_at(path, st.st_mtime, st.st_ino, &size, NULL);
+	assert_ulong_equal(DCACHE_UNKNOWN, size);
+
+	state_set_dcache_limit(10000);
+	update_string(&cfg.shell, NULL);
+	assert_success(remove(SANDBOX_PATH "/vifminfo.json"));
+}
+
+TEST(hashes_round_trip)
+{
+	cfg.vifm_info = VINFO_HASHES;
+
+	const hcache_key_t key = { .dev = 1, .inode = 2, .size = 3, .mtime_ns = 4 };
+	const hcache_digest_t digest = {
+		.high = 0xfedcba9876543210ULL, .low = 0x0123456789abcdefULL
+	};
+	hcache_reset(0);
+	hcache_put(&key, &digest);
+	write_info_file();
+
+	hcache_reset(0);
+	hcache_digest_t found;
+	assert_false(hcache_get(&key, &found));
+
+	state_load(0);
+	assert_true(hcache_get(&key, &found));
+	assert_true(found.high == digest.high);
+	assert_true(found.low == digest.low);
+
+	hcache_reset(0);
+	assert_success(remove(SANDBOX_PATH "/vifminfo.json"));
+}
+
 TEST(dhistory_is_merged_correctly)
 {
 	cfg.vifm_info = VINFO_DHISTORY;
@@ -539,6 +666,120 @@ TEST(active_pane_is_respected_both_ways)
 	remove_file(SANDBOX_PATH "/vifminfo.json");
 }
 
+TEST(changes_of_large_vifminfo_are_appended_to_journal)
+{
+	state_set_journal_threshold(0);
+	cfg.vifm_info = VINFO_CHISTORY | VINFO_SHISTORY;
+
+	hist_add(&curr_stats.cmd_hist, "command0", 0);
+	hist_add(&curr_stats.search_hist, "search0", 0);
+	write_info_file();
+
+	struct stat first, second;
+	assert_success(stat(SANDBOX_PATH "/vifminfo.json", &first));
+
+	hist_add(&curr_stats.cmd_hist, "command1", 1);
+	write_info_file();
+
+	/* vifminfo.json is left as is. */
+	assert_success(stat(SANDBOX_PATH "/vifminfo.json", &second));
+	assert_true(first.st_size == second.st_size);
+
+	/* Unchanged nodes aren't part of the record. */
+	FILE *fp = fopen(SANDBOX_PATH "/vifminfo.journal", "r");
+	assert_non_null(fp);
+	int nlines;
+	char **lines = read_file_lines(fp, &nlines);
+	fclose(fp);
+	assert_int_equal(2, nlines);
+	JSON_Value *record = json_parse_string(lines[1]);
+	free_string_array(lines, nlines);
+	assert_non_null(record);
+	JSON_Object *state = json_object_get_object(json_object(record), "state");
+	assert_true(json_object_has_value(state, "cmd-hist"));
+	assert_false(json_object_has_value(state, "search-hist"));
+	json_value_free(record);
+
+	cfg_resize_histories(0);
+	cfg_resize_histories(10);
+
+	state_load(0);
+	assert_int_equal(2, curr_stats.cmd_hist.size);
+	assert_string_equal("command1", curr_stats.cmd_hist.items[0].text);
+	assert_string_equal("command0", curr_stats.cmd_hist.items[1].text);
+	assert_int_equal(1, curr_stats.search_hist.size);
+	assert_string_equal("search0", curr_stats.search_hist.items[0].text);
+
+	state_set_journal_threshold(256*1024);
+	remove_file(SANDBOX_PATH "/vifminfo.journal");
+	remove_file(SANDBOX_PATH "/vifminfo.json");
+}
+
+TEST(journal_is_folded_into_vifminfo)
+{
+	state_set_journal_threshold(0);
+	cfg.vifm_info = VINFO_CHISTORY;
+
+	hist_add(&curr_stats.cmd_hist, "command0", 0);
+	write_info_file();
+
+	hist_add(&curr_stats.cmd_hist, "command1", 1);
+	write_info_file();
+	assert_true(path_exists(SANDBOX_PATH "/vifminfo.journal", NODEREF));
+
+	/* Journal keeps growing until it's large enough to be folded. */
+	int i;
+	for(i = 2; i < 10; ++i)
+	{
+		char cmd[16];
+		snprintf(cmd, sizeof(cmd), "command%d", i);
+		hist_add(&curr_stats.cmd_hist, cmd, i);
+		write_info_file();
+
+		if(!path_exists(SANDBOX_PATH "/vifminfo.journal", NODEREF))
+		{
+			break;
+		}
+	}
+	assert_true(i < 10);
+
+	JSON_Value *json = json_parse_file(SANDBOX_PATH "/vifminfo.json");
+	assert_non_null(json);
+	JSON_Array *hist = json_object_get_array(json_object(json), "cmd-hist");
+	assert_int_equal(i + 1, json_array_get_count(hist));
+	json_value_free(json);
+
+	state_set_journal_threshold(256*1024);
+	remove_file(SANDBOX_PATH "/vifminfo.json");
+}
+
+TEST(journal_of_different_vifminfo_is_ignored)
+{
+	state_set_journal_threshold(0);
+	cfg.vifm_info = VINFO_CHISTORY;
+
+	hist_add(&curr_stats.cmd_hist, "command", 0);
+	write_info_file();
+
+	make_file(SANDBOX_PATH "/vifminfo.journal",
+			"{\"info-size\":1,\"info-mtime\":1}\n"
+			"{\"vinfo\":512,\"state\":{\"cmd-hist\":[{\"text\":\"stale\"}]}}\n");
+
+	cfg_resize_histories(0);
+	cfg_resize_histories(10);
+
+	state_load(0);
+	assert_int_equal(1, curr_stats.cmd_hist.size);
+	assert_string_equal("command", curr_stats.cmd_hist.items[0].text);
+
+	/* Stale journal is dropped on writing. */
+	write_info_file();
+	assert_false(path_exists(SANDBOX_PATH "/vifminfo.journal", NODEREF));
+
+	state_set_journal_threshold(256*1024);
+	remove_file(SANDBOX_PATH "/vifminfo.json");
+}
+
 TEST(options_round_trip)
 {
 	opt_handlers_setup();
@@ -4,6 +4,7 @@
 
 #include "../../src/cfg/config.h"
 #include "../../src/cfg/info.h"
+#include "../../src/hcache.h"
 
 static void admixture_is_moved(const char import[]);
 static void admixture_is_inserted(const char source[], const char import[]);
@@ -60,6 +61,92 @@ TEST(bmarks_import)
 	admixture_is_moved(import);
 }
 
+TEST(dcache_import)
+{
+	const char *import = "{\"dcache\":{"
+		"\"\\/dir\":{\"size\":1024,\"inode\":12,\"ts\":1440801895}}"
+		"}";
+	admixture_is_moved(import);
+
+	admixture_is_inserted(
+			"{\"dcache\":{\"\\/dir\":{\"size\":1,\"inode\":12,\"ts\":10}}}",
+			import);
+}
+
+TEST(newer_dcache_entries_are_kept)
+{
+	const char *current = "{\"dcache\":{"
+		"\"\\/dir\":{\"size\":1024,\"inode\":12,\"ts\":1440801895}}"
+		"}";
+	JSON_Value *value = json_parse_string(current);
+	JSON_Value *admixture = json_parse_string(
+			"{\"dcache\":{\"\\/dir\":{\"size\":1,\"inode\":12,\"ts\":10}}}");
+	merge_states(FULL_VINFO, 0, json_object(value), json_object(admixture));
+	json_value_free(admixture);
+
+	char *result = json_serialize_to_string(value);
+	json_value_free(value);
+	assert_string_equal(current, result);
+	free(result);
+}
+
+TEST(oldest_dcache_entries_are_dropped_on_merge)
+{
+	state_set_dcache_limit(2);
+
+	JSON_Value *value = json_parse_string("{\"dcache\":{"
+			"\"\\/a\":{\"size\":1,\"inode\":1,\"ts\":30},"
+			"\"\\/b\":{\"size\":1,\"inode\":2,\"ts\":10}"
+			"}}");
+	JSON_Value *admixture = json_parse_string("{\"dcache\":{"
+			"\"\\/b\":{\"size\":1,\"inode\":2,\"ts\":15},"
+			"\"\\/c\":{\"size\":1,\"inode\":3,\"ts\":20}"
+			"}}");
+	merge_states(FULL_VINFO, 0, json_object(value), json_object(admixture));
+	json_value_free(admixture);
+
+	JSON_Object *dcache = json_object_get_object(json_object(value), "dcache");
+	assert_int_equal(2, json_object_get_count(dcache));
+	assert_non_null(json_object_get_object(dcache, "/a"));
+	assert_non_null(json_object_get_object(dcache, "/c"));
+
+	json_value_free(value);
+	state_set_dcache_limit(10000);
+}
+
+TEST(hashes_import)
+{
+	const char *import = "{\"hashes\":{"
+		"\"1:2:3:4\":{\"digest\":\"0123456789abcdef0123456789abcdef\","
+		"\"used\":1440801895}}"
+		"}";
+	admixture_is_moved(import);
+}
+
+TEST(least_recently_used_hashes_are_dropped_on_merge)
+{
+	hcache_reset(2);
+
+	JSON_Value *value = json_parse_string("{\"hashes\":{"
+			"\"1:1:1:1\":{\"digest\":\"\",\"used\":30},"
+			"\"2:2:2:2\":{\"digest\":\"\",\"used\":10}"
+			"}}");
+	JSON_Value *admixture = json_parse_string("{\"hashes\":{"
+			"\"2:2:2:2\":{\"digest\":\"\",\"used\":15},"
+			"\"3:3:3:3\":{\"digest\":\"\",\"used\":20}"
+			"}}");
+	merge_states(FULL_VINFO, 0, json_object(value), json_object(admixture));
+	json_value_free(admixture);
+
+	JSON_Object *hashes = json_object_get_object(json_object(value), "hashes");
+	assert_int_equal(2, json_object_get_count(hashes));
+	assert_non_null(json_object_get_object(hashes, "1:1:1:1"));
+	assert_non_null(json_object_get_object(hashes, "3:3:3:3"));
+	json_value_free(value);
+
+	hcache_reset(0);
+}
+
 TEST(marks_import)
 {
 	const char *import = "{\"marks\":{"
@@ -3,7 +3,7 @@
 #include <stic.h>
 
 #include <sys/stat.h> /* chmod() */
-#include <sys/time.h> /* timeval utimes() */
+#include <sys/time.h> /* gettimeofday() timeval utimes() */
 #include <unistd.h> /* access() geteuid() rmdir() symlink() usleep() */
 
 #ifdef _WIN32
@@ -13,7 +13,7 @@
 #include <locale.h> /* LC_ALL setlocale() */
 #include <stddef.h> /* NULL */
 #include <stdio.h> /* FILE fclose() fopen() fread() remove() */
-#include <stdlib.h> /* free() malloc() */
+#include <stdlib.h> /* free() getenv() malloc() */
 #include <string.h> /* memset() strcpy() strdup() */
 
 #include "../../src/cfg/config.h"
@@ -624,6 +624,20 @@ have_cat(void)
 	return (find_cmd_in_path("cat", 0, NULL) == 0);
 }
 
+int
+benchmarks_enabled(void)
+{
+	return (getenv("VIFM_BENCHMARKS") != NULL);
+}
+
+double
+bench_time(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec/1e6;
+}
+
 void
 try_enable_utf8_locale(void)
 {
@@ -136,6 +136,14 @@ int regular_unix_user(void);
  * so, otherwise zero is returned. */
 int have_cat(void);
 
+/* Whether benchmarks were requested by setting VIFM_BENCHMARKS environment
+ * variable.  Returns non-zero if so, otherwise zero is returned. */
+int benchmarks_enabled(void);
+
+/* Retrieves current time in seconds with sub-second precision for measuring
+ * duration of operations in benchmarks.  Returns the time. */
+double bench_time(void);
+
 struct matcher_t;
 
 /* Changes *matcher to have the value of the expr.  The operation is assumed to
@@ -0,0 +1,127 @@
+#include <stic.h>
+
+#ifndef _WIN32
+
+#include <sys/stat.h> /* S_ISLNK() S_ISREG() */
+#include <unistd.h> /* usleep() */
+
+#include <stdio.h> /* remove() */
+
+#include <test-utils.h>
+
+#include "../../src/utils/dirpoll.h"
+#include "../../src/utils/fswatch.h"
+
+static FSWatchState wait_for_changes(dirpoll_t *poller,
+		fswatch_changes_t *changes);
+
+static dirpoll_t *poller;
+
+SETUP()
+{
+	/* Make a second of the interval last for 5 milliseconds. */
+	dirpoll_set_unit(5);
+
+	create_file(SANDBOX_PATH "/file");
+	assert_non_null(poller = dirpoll_create(SANDBOX_PATH, 1));
+}
+
+TEARDOWN()
+{
+	dirpoll_free(poller);
+	dirpoll_set_unit(1000);
+
+	(void)remove(SANDBOX_PATH "/file");
+	(void)remove(SANDBOX_PATH "/new");
+}
+
+TEST(parameters_of_poller_are_matched)
+{
+	assert_true(dirpoll_matches(poller, SANDBOX_PATH, 1));
+	assert_false(dirpoll_matches(poller, SANDBOX_PATH, 2));
+	assert_false(dirpoll_matches(poller, SANDBOX_PATH "/file", 1));
+}
+
+TEST(unchanged_directory_produces_no_changes)
+{
+	fswatch_changes_t changes = {};
+	usleep(50000);
+	assert_int_equal(FSWS_UNCHANGED, dirpoll_poll(poller, &changes));
+	fswatch_changes_free(&changes);
+}
+
+TEST(new_files_are_reported_with_their_information)
+{
+	/* Give the thread a chance to take initial listing. */
+	usleep(20000);
+	create_file(SANDBOX_PATH "/new");
+
+	fswatch_changes_t changes = {};
+	assert_int_equal(FSWS_UPDATED, wait_for_changes(poller, &changes));
+	assert_true(changes.complete);
+	assert_int_equal(1, changes.count);
+	assert_string_equal("new", changes.items[0].name);
+	assert_false(changes.items[0].existed);
+	assert_true(changes.items[0].stated);
+	assert_true(changes.items[0].exists);
+	assert_true(S_ISREG(changes.items[0].s.st_mode));
+	fswatch_changes_free(&changes);
+}
+
+TEST(removed_and_modified_files_are_reported)
+{
+	usleep(20000);
+	make_file(SANDBOX_PATH "/file", "contents");
+
+	fswatch_changes_t changes = {};
+	assert_int_equal(FSWS_UPDATED, wait_for_changes(poller, &changes));
+	assert_int_equal(1, changes.count);
+	assert_true(changes.items[0].existed);
+	assert_true(changes.items[0].exists);
+	assert_int_equal(8, changes.items[0].s.st_size);
+	fswatch_changes_free(&changes);
+
+	remove_file(SANDBOX_PATH "/file");
+
+	assert_int_equal(FSWS_UPDATED, wait_for_changes(poller, &changes));
+	assert_int_equal(1, changes.count);
+	assert_true(changes.items[0].existed);
+	assert_false(changes.items[0].exists);
+	fswatch_changes_free(&changes);
+}
+
+TEST(targets_of_links_are_examined)
+{
+	usleep(20000);
+	assert_success(make_symlink("file", SANDBOX_PATH "/new"));
+
+	fswatch_changes_t changes = {};
+	assert_int_equal(FSWS_UPDATED, wait_for_changes(poller, &changes));
+	assert_int_equal(1, changes.count);
+	assert_true(S_ISLNK(changes.items[0].s.st_mode));
+	assert_string_equal(SANDBOX_PATH "/file", changes.items[0].target);
+	assert_true(changes.items[0].target_exists);
+	assert_true(S_ISREG(changes.items[0].target_s.st_mode));
+	fswatch_changes_free(&changes);
+}
+
+/* Waits for the poller to report changes.  Returns result of the last poll. */
+static FSWatchState
+wait_for_changes(dirpoll_t *poller, fswatch_changes_t *changes)
+{
+	int i;
+	for(i = 0; i < 200; ++i)
+	{
+		if(dirpoll_poll(poller, changes) == FSWS_UPDATED)
+		{
+			return FSWS_UPDATED;
+		}
+		usleep(5000);
+	}
+	return FSWS_UNCHANGED;
+}
+
+#endif
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -3,6 +3,7 @@
 #include <unistd.h> /* rmdir() */
 
 #include <stddef.h> /* NULL */
+#include <string.h> /* strcat() */
 
 #include "../../src/compat/os.h"
 #include "../../src/utils/fsdata.h"
@@ -17,6 +18,8 @@ static void visitor(void *data, void *arg);
 static int traverser(const char name[], int valid, const void *parent_data,
 		void *data, void *arg);
 
+static int lister(const char path[], void *data, void *arg);
+
 static int nnodes;
 
 TEST(freeing_null_fsdata_is_ok)
@@ -273,6 +276,21 @@ TEST(cancellation)
 	fsdata_free(fsd);
 }
 
+TEST(list_reports_full_paths_of_valid_nodes)
+{
+	int data = 0;
+	fsdata_t *const fsd = fsdata_create(0, 0);
+	assert_success(fsdata_set(fsd, ROOT "a/b", &data, sizeof(data)));
+	assert_success(fsdata_set(fsd, ROOT "a/b/c", &data, sizeof(data)));
+	assert_success(fsdata_set(fsd, ROOT "d", &data, sizeof(data)));
+
+	char paths[128] = "";
+	assert_success(fsdata_list(fsd, &lister, paths));
+	assert_string_equal(ROOT "a/b|" ROOT "a/b/c|" ROOT "d|", paths);
+
+	fsdata_free(fsd);
+}
+
 static void
 visitor(void *data, void *arg)
 {
@@ -287,5 +305,14 @@ traverser(const char name[], int valid, const void *parent_data, void *data,
 	return (++nnodes == 0);
 }
 
+static int
+lister(const char path[], void *data, void *arg)
+{
+	char *paths = arg;
+	strcat(paths, path);
+	strcat(paths, "|");
+	return 0;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
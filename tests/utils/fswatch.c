@@ -2,6 +2,8 @@
 
 #include <stdio.h> /* remove() snprintf() */
 
+#include <test-utils.h>
+
 #include "../../src/compat/fs_limits.h"
 #include "../../src/compat/os.h"
 #include "../../src/utils/fs.h"
@@ -182,6 +184,55 @@ TEST(file_recreation_removes_ban, IF(using_inotify))
 	assert_success(remove(SANDBOX_PATH "/testdir"));
 }
 
+TEST(names_of_changed_files_are_reported, IF(using_inotify))
+{
+	fswatch_t *watch;
+	assert_non_null(watch = fswatch_create(sandbox));
+
+	create_file(SANDBOX_PATH "/a");
+	create_file(SANDBOX_PATH "/b");
+	assert_int_equal(FSWS_UPDATED, fswatch_poll(watch));
+
+	fswatch_changes_t changes = {};
+	assert_success(os_rename(SANDBOX_PATH "/a", SANDBOX_PATH "/c"));
+	assert_success(remove(SANDBOX_PATH "/b"));
+	assert_int_equal(FSWS_UPDATED, fswatch_poll_changes(watch, &changes));
+
+	assert_true(changes.complete);
+	assert_int_equal(3, changes.count);
+	assert_string_equal("a", changes.items[0].name);
+	assert_true(changes.items[0].existed);
+	assert_string_equal("c", changes.items[1].name);
+	assert_false(changes.items[1].existed);
+	assert_string_equal("b", changes.items[2].name);
+	assert_true(changes.items[2].existed);
+
+	fswatch_changes_free(&changes);
+	assert_int_equal(0, changes.count);
+
+	fswatch_free(watch);
+
+	assert_success(remove(SANDBOX_PATH "/c"));
+}
+
+TEST(changes_of_directory_itself_are_incomplete, IF(using_inotify))
+{
+	assert_success(os_mkdir(SANDBOX_PATH "/testdir", 0700));
+
+	fswatch_t *watch;
+	assert_non_null(watch = fswatch_create(SANDBOX_PATH "/testdir"));
+
+	fswatch_changes_t changes = {};
+	assert_success(os_chmod(SANDBOX_PATH "/testdir", 0777));
+	assert_int_equal(FSWS_UPDATED, fswatch_poll_changes(watch, &changes));
+	assert_false(changes.complete);
+	fswatch_changes_free(&changes);
+
+	fswatch_free(watch);
+
+	assert_success(remove(SANDBOX_PATH "/testdir"));
+}
+
 static int
 using_inotify(void)
 {
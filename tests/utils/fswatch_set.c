@@ -0,0 +1,95 @@
+#include <stic.h>
+
+#include <unistd.h> /* rmdir() */
+
+#include <test-utils.h>
+
+#include "../../src/compat/os.h"
+#include "../../src/utils/fswatch_set.h"
+
+static int using_inotify(void);
+
+static fswatch_set_t *watch;
+
+SETUP()
+{
+	assert_success(os_mkdir(SANDBOX_PATH "/dir", 0700));
+	assert_non_null(watch = fswatch_set_create());
+}
+
+TEARDOWN()
+{
+	fswatch_set_free(watch);
+	fswatch_set_limit(-1);
+
+	assert_success(rmdir(SANDBOX_PATH "/dir"));
+}
+
+TEST(started_as_not_changed)
+{
+	assert_success(fswatch_set_add(watch, SANDBOX_PATH));
+	assert_success(fswatch_set_add(watch, SANDBOX_PATH "/dir"));
+	assert_int_equal(FSWS_UNCHANGED, fswatch_set_poll(watch));
+}
+
+TEST(changes_in_any_directory_are_reported, IF(using_inotify))
+{
+	assert_success(fswatch_set_add(watch, SANDBOX_PATH));
+	assert_success(fswatch_set_add(watch, SANDBOX_PATH "/dir"));
+	assert_int_equal(0, fswatch_set_polled(watch));
+
+	create_file(SANDBOX_PATH "/dir/file");
+	assert_int_equal(FSWS_UPDATED, fswatch_set_poll(watch));
+	assert_int_equal(FSWS_UNCHANGED, fswatch_set_poll(watch));
+
+	remove_file(SANDBOX_PATH "/dir/file");
+	assert_int_equal(FSWS_UPDATED, fswatch_set_poll(watch));
+	assert_int_equal(FSWS_UNCHANGED, fswatch_set_poll(watch));
+}
+
+TEST(modification_of_files_is_not_reported, IF(using_inotify))
+{
+	create_file(SANDBOX_PATH "/dir/file");
+
+	assert_success(fswatch_set_add(watch, SANDBOX_PATH "/dir"));
+	make_file(SANDBOX_PATH "/dir/file", "contents");
+	assert_int_equal(FSWS_UNCHANGED, fswatch_set_poll(watch));
+
+	remove_file(SANDBOX_PATH "/dir/file");
+}
+
+TEST(directories_over_the_limit_are_polled)
+{
+	fswatch_set_limit(0);
+	assert_success(fswatch_set_add(watch, SANDBOX_PATH "/dir"));
+	assert_int_equal(1, fswatch_set_polled(watch));
+	assert_int_equal(FSWS_UNCHANGED, fswatch_set_poll(watch));
+
+	/* Modification time has a granularity of a second. */
+	reset_timestamp(SANDBOX_PATH "/dir");
+	assert_int_equal(FSWS_UPDATED, fswatch_set_poll(watch));
+	assert_int_equal(FSWS_UNCHANGED, fswatch_set_poll(watch));
+}
+
+TEST(removal_of_polled_directory_is_reported)
+{
+	fswatch_set_limit(0);
+	assert_success(os_mkdir(SANDBOX_PATH "/dir/sub", 0700));
+	assert_success(fswatch_set_add(watch, SANDBOX_PATH "/dir/sub"));
+
+	assert_success(rmdir(SANDBOX_PATH "/dir/sub"));
+	assert_int_equal(FSWS_UPDATED, fswatch_set_poll(watch));
+}
+
+static int
+using_inotify(void)
+{
+#ifdef HAVE_INOTIFY
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
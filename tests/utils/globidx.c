@@ -0,0 +1,89 @@
+#include <stic.h>
+
+#include "../../src/utils/globidx.h"
+
+static int collect(int id, void *arg);
+static int take_first(int id, void *arg);
+
+static globidx_t *idx;
+static int ids[16];
+static int nids;
+
+SETUP()
+{
+	assert_non_null(idx = globidx_create());
+	nids = 0;
+}
+
+TEARDOWN()
+{
+	globidx_free(idx);
+}
+
+TEST(literals_and_suffixes_are_found_in_order)
+{
+	assert_success(globidx_add(idx, "*.c", 0));
+	assert_success(globidx_add(idx, "a.c", 1));
+	assert_success(globidx_add(idx, "*.C", 2));
+	assert_success(globidx_add(idx, "*c", 2));
+	assert_success(globidx_add(idx, "*", 3));
+
+	assert_success(globidx_find(idx, "A.c", &collect, NULL));
+	assert_int_equal(4, nids);
+	assert_int_equal(0, ids[0]);
+	assert_int_equal(1, ids[1]);
+	assert_int_equal(2, ids[2]);
+	assert_int_equal(3, ids[3]);
+}
+
+TEST(suffixes_do_not_match_dot_files)
+{
+	assert_success(globidx_add(idx, "*rc", 0));
+	assert_success(globidx_add(idx, "*", 1));
+	assert_success(globidx_add(idx, ".vimrc", 2));
+
+	assert_success(globidx_find(idx, ".vimrc", &collect, NULL));
+	assert_int_equal(1, nids);
+	assert_int_equal(2, ids[0]);
+
+	nids = 0;
+	assert_success(globidx_find(idx, "rc", &collect, NULL));
+	assert_int_equal(1, nids);
+	assert_int_equal(1, ids[0]);
+}
+
+TEST(search_can_be_stopped)
+{
+	assert_success(globidx_add(idx, "*.c", 4));
+	assert_success(globidx_add(idx, "a.c", 7));
+
+	assert_success(globidx_find(idx, "a.c", &take_first, NULL));
+	assert_int_equal(1, nids);
+	assert_int_equal(4, ids[0]);
+}
+
+TEST(non_simple_globs_are_rejected)
+{
+	assert_failure(globidx_add(idx, "a*b", 0));
+	assert_failure(globidx_add(idx, "*a*", 0));
+	assert_failure(globidx_add(idx, "", 0));
+}
+
+/* Collects all found numbers.  Returns zero. */
+static int
+collect(int id, void *arg)
+{
+	ids[nids++] = id;
+	return 0;
+}
+
+/* Collects the first found number.  Returns non-zero. */
+static int
+take_first(int id, void *arg)
+{
+	ids[nids++] = id;
+	return 1;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,211 @@
+#include <stic.h>
+
+#include <unistd.h> /* usleep() */
+
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* FILE fclose() fopen() fputs() */
+#include <string.h> /* memset() strlen() */
+
+#include <test-utils.h>
+
+#include "../../src/utils/lineidx.h"
+#include "../../src/utils/string_array.h"
+
+static int wait_for_index(lineidx_t *idx);
+static void append_to_file(const char path[], const char contents[]);
+
+static lineidx_t *idx;
+
+SETUP()
+{
+	idx = NULL;
+}
+
+TEARDOWN()
+{
+	lineidx_free(idx);
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(empty_file_has_no_lines)
+{
+	create_file(SANDBOX_PATH "/file");
+	assert_non_null(idx = lineidx_open(SANDBOX_PATH "/file"));
+	assert_int_equal(0, wait_for_index(idx));
+
+	uint64_t offset;
+	assert_failure(lineidx_line_offset(idx, 0, &offset));
+
+	uint64_t end;
+	strlist_t lines = lineidx_read(idx, 0, 10, &end);
+	assert_int_equal(0, lines.nitems);
+	free_string_array(lines.items, lines.nitems);
+}
+
+TEST(lines_are_located)
+{
+	make_file(SANDBOX_PATH "/file", "a\nbb\r\nccc");
+	assert_non_null(idx = lineidx_open(SANDBOX_PATH "/file"));
+	assert_int_equal(3, wait_for_index(idx));
+
+	uint64_t offset;
+	assert_success(lineidx_line_offset(idx, 1, &offset));
+	assert_int_equal(2, offset);
+	assert_success(lineidx_line_offset(idx, 2, &offset));
+	assert_int_equal(6, offset);
+	assert_failure(lineidx_line_offset(idx, 3, &offset));
+
+	assert_int_equal(0, lineidx_line_number(idx, 0));
+	assert_int_equal(1, lineidx_line_number(idx, 2));
+	assert_int_equal(2, lineidx_line_number(idx, 6));
+
+	assert_int_equal(2, lineidx_line_start(idx, 4));
+	assert_int_equal(6, lineidx_line_start(idx, 8));
+
+	uint64_t end;
+	strlist_t lines = lineidx_read(idx, 2, 10, &end);
+	assert_int_equal(2, lines.nitems);
+	assert_string_equal("bb", lines.items[0]);
+	assert_string_equal("ccc", lines.items[1]);
+	assert_int_equal(9, end);
+	free_string_array(lines.items, lines.nitems);
+}
+
+TEST(bom_is_skipped)
+{
+	make_file(SANDBOX_PATH "/file", "\xef\xbb\xbf" "line\n");
+	assert_non_null(idx = lineidx_open(SANDBOX_PATH "/file"));
+	assert_int_equal(1, wait_for_index(idx));
+
+	uint64_t end;
+	strlist_t lines = lineidx_read(idx, 0, 10, &end);
+	assert_int_equal(1, lines.nitems);
+	assert_string_equal("line", lines.items[0]);
+	free_string_array(lines.items, lines.nitems);
+}
+
+TEST(many_lines_are_indexed)
+{
+	FILE *const fp = fopen(SANDBOX_PATH "/file", "w");
+	int i;
+	for(i = 0; i < 10000; ++i)
+	{
+		fprintf(fp, "line%d\n", i);
+	}
+	fclose(fp);
+
+	assert_non_null(idx = lineidx_open(SANDBOX_PATH "/file"));
+	assert_int_equal(10000, wait_for_index(idx));
+
+	uint64_t offset, end;
+	assert_success(lineidx_line_offset(idx, 6001, &offset));
+	assert_int_equal(6001, lineidx_line_number(idx, offset));
+
+	strlist_t lines = lineidx_read(idx, offset, 1, &end);
+	assert_int_equal(1, lines.nitems);
+	assert_string_equal("line6001", lines.items[0]);
+	free_string_array(lines.items, lines.nitems);
+
+	int moved;
+	offset = lineidx_move(idx, offset, -3000, &moved);
+	assert_int_equal(-3000, moved);
+	assert_int_equal(3001, lineidx_line_number(idx, offset));
+
+	offset = lineidx_move(idx, offset, 10000, &moved);
+	assert_int_equal(6998, moved);
+	assert_int_equal(9999, lineidx_line_number(idx, offset));
+
+	offset = lineidx_move(idx, offset, -20000, &moved);
+	assert_int_equal(-9999, moved);
+	assert_int_equal(0, offset);
+}
+
+TEST(long_lines_are_broken)
+{
+	char line[40001];
+	memset(line, 'x', sizeof(line) - 1);
+	line[sizeof(line) - 1] = '\0';
+	make_file(SANDBOX_PATH "/file", line);
+	append_to_file(SANDBOX_PATH "/file", "\nshort\n");
+
+	assert_non_null(idx = lineidx_open(SANDBOX_PATH "/file"));
+	assert_int_equal(4, wait_for_index(idx));
+
+	uint64_t offset;
+	assert_success(lineidx_line_offset(idx, 3, &offset));
+	assert_int_equal(40001, offset);
+
+	int moved;
+	offset = lineidx_move(idx, offset, -1, &moved);
+	assert_int_equal(-1, moved);
+	assert_int_equal(2*16*1024, offset);
+
+	uint64_t end;
+	strlist_t lines = lineidx_read(idx, 0, 10, &end);
+	assert_int_equal(4, lines.nitems);
+	assert_int_equal(16*1024, strlen(lines.items[0]));
+	assert_int_equal(40000 - 2*16*1024, strlen(lines.items[2]));
+	assert_string_equal("short", lines.items[3]);
+	free_string_array(lines.items, lines.nitems);
+}
+
+TEST(appended_data_is_indexed)
+{
+	make_file(SANDBOX_PATH "/file", "a\nb");
+	assert_non_null(idx = lineidx_open(SANDBOX_PATH "/file"));
+	assert_int_equal(2, wait_for_index(idx));
+	assert_int_equal(0, lineidx_refresh(idx));
+
+	append_to_file(SANDBOX_PATH "/file", "b\nc\n");
+	assert_int_equal(1, lineidx_refresh(idx));
+	assert_int_equal(3, wait_for_index(idx));
+
+	uint64_t offset, end;
+	assert_success(lineidx_line_offset(idx, 1, &offset));
+	strlist_t lines = lineidx_read(idx, offset, 10, &end);
+	assert_int_equal(2, lines.nitems);
+	assert_string_equal("bb", lines.items[0]);
+	assert_string_equal("c", lines.items[1]);
+	free_string_array(lines.items, lines.nitems);
+}
+
+TEST(truncation_is_detected)
+{
+	make_file(SANDBOX_PATH "/file", "a\nb\n");
+	assert_non_null(idx = lineidx_open(SANDBOX_PATH "/file"));
+	assert_int_equal(2, wait_for_index(idx));
+
+	make_file(SANDBOX_PATH "/file", "a\n");
+	assert_int_equal(-1, lineidx_refresh(idx));
+}
+
+/* Waits for indexing to finish.  Returns number of lines. */
+static int
+wait_for_index(lineidx_t *idx)
+{
+	int i;
+	for(i = 0; i < 1000; ++i)
+	{
+		int complete;
+		const int nlines = lineidx_nlines(idx, &complete);
+		if(complete)
+		{
+			return nlines;
+		}
+		usleep(5000);
+	}
+	return -1;
+}
+
+/* Appends a string to a file. */
+static void
+append_to_file(const char path[], const char contents[])
+{
+	FILE *const fp = fopen(path, "a");
+	assert_non_null(fp);
+	fputs(contents, fp);
+	fclose(fp);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
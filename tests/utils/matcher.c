@@ -10,6 +10,7 @@
 #include "../../src/utils/fs.h"
 #include "../../src/utils/matcher.h"
 #include "../../src/utils/str.h"
+#include "../../src/utils/string_array.h"
 
 static void check_glob(matcher_t *m);
 static void check_fast_globs(matcher_t *m);
@@ -368,6 +369,90 @@ TEST(fast_globs)
 	matcher_free(m);
 }
 
+TEST(fast_globs_ignore_case)
+{
+	char *error;
+	matcher_t *m;
+
+	m = matcher_alloc("{*.TXT,Pre*Suf,ReadMe,mid\\*DLE}", 0, 1, "", &error);
+	assert_true(matcher_is_fast(m));
+
+	assert_true(matcher_matches(m, "a.txt"));
+	assert_true(matcher_matches(m, "A.Txt"));
+	assert_true(matcher_matches(m, "PREsuf"));
+	assert_true(matcher_matches(m, "presomethingSUF"));
+	assert_true(matcher_matches(m, "README"));
+	assert_true(matcher_matches(m, "MID*dle"));
+	assert_false(matcher_matches(m, "presu"));
+	assert_false(matcher_matches(m, "readme.txt0"));
+
+	matcher_free(m);
+}
+
+TEST(fast_globs_with_leading_asterisk_skip_dot_files)
+{
+	char *error;
+	matcher_t *m;
+
+	m = matcher_alloc("{*.txt,.vimrc,.*rc}", 0, 1, "", &error);
+	assert_true(matcher_is_fast(m));
+
+	assert_true(matcher_matches(m, "a.txt"));
+	assert_true(matcher_matches(m, ".vimrc"));
+	assert_true(matcher_matches(m, ".bashrc"));
+	assert_false(matcher_matches(m, ".txt"));
+	assert_false(matcher_matches(m, ".a.txt"));
+
+	matcher_free(m);
+}
+
+TEST(fast_globs_prefix_and_suffix_do_not_overlap)
+{
+	char *error;
+	matcher_t *m;
+
+	m = matcher_alloc("{ab*ba}", 0, 1, "", &error);
+	assert_true(matcher_is_fast(m));
+
+	assert_true(matcher_matches(m, "abba"));
+	assert_true(matcher_matches(m, "ab-ba"));
+	assert_false(matcher_matches(m, "aba"));
+	assert_false(matcher_matches(m, "ab"));
+
+	matcher_free(m);
+}
+
+TEST(fast_globs_are_cloned)
+{
+	char *error;
+	matcher_t *m, *clone;
+
+	m = matcher_alloc("{*suffix,prefix*,mid*dle,literal}", 0, 1, "", &error);
+	assert_non_null(clone = matcher_clone(m));
+	matcher_free(m);
+
+	assert_true(matcher_is_fast(clone));
+	check_fast_globs(clone);
+	matcher_free(clone);
+}
+
+TEST(full_path_fast_globs)
+{
+	char *error;
+	matcher_t *m;
+
+	m = matcher_alloc("{{/tmp/*.c,/etc/fstab}}", 0, 1, "", &error);
+	assert_true(matcher_is_fast(m));
+
+	assert_true(matcher_matches(m, "/tmp/a.c"));
+	assert_true(matcher_matches(m, "/tmp/dir/a.c"));
+	assert_true(matcher_matches(m, "/ETC/FSTAB"));
+	assert_false(matcher_matches(m, "/etc/fstab.bak"));
+	assert_false(matcher_matches(m, "/var/tmp/a.c"));
+
+	matcher_free(m);
+}
+
 TEST(regexps_are_cloned)
 {
 	char *error;
@@ -425,6 +510,38 @@ TEST(empty_forced_glob_matcher_matches_nothing)
 	matcher_free(m);
 }
 
+TEST(simple_globs_are_extracted)
+{
+	char *error;
+	matcher_t *m;
+	int count;
+	char **globs;
+
+	assert_non_null(m = matcher_alloc("{name,*.ext}", 0, 1, "", &error));
+	assert_non_null(globs = matcher_get_simple_globs(m, &count));
+	assert_int_equal(2, count);
+	assert_string_equal("name", globs[0]);
+	assert_string_equal("*.ext", globs[1]);
+	free_string_array(globs, count);
+	matcher_free(m);
+
+	assert_non_null(m = matcher_alloc("{name,a*b}", 0, 1, "", &error));
+	assert_null(matcher_get_simple_globs(m, &count));
+	matcher_free(m);
+
+	assert_non_null(m = matcher_alloc("!{*.ext}", 0, 1, "", &error));
+	assert_null(matcher_get_simple_globs(m, &count));
+	matcher_free(m);
+
+	assert_non_null(m = matcher_alloc("{{*.ext}}", 0, 1, "", &error));
+	assert_null(matcher_get_simple_globs(m, &count));
+	matcher_free(m);
+
+	assert_non_null(m = matcher_alloc("/^x*$/", 0, 1, "", &error));
+	assert_null(matcher_get_simple_globs(m, &count));
+	matcher_free(m);
+}
+
 TEST(mime_type_pattern, IF(has_mime_type_detection))
 {
 	char *error;
@@ -0,0 +1,162 @@
+#include <stic.h>
+
+#include <stdio.h> /* snprintf() */
+#include <string.h> /* strlen() */
+
+#include <test-utils.h>
+
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/mntent.h"
+#include "../../src/utils/macros.h"
+#include "../../src/utils/path.h"
+#include "../../src/utils/str.h"
+#include "../../src/utils/utils.h"
+
+/* State of brute-force lookup of mount point. */
+typedef struct
+{
+	const char *path;           /* Path whose mount point is looked up. */
+	char dir[PATH_MAX + 1];     /* Mount point found so far. */
+	char type[PATH_MAX + 1];    /* Type of file system found so far. */
+	size_t len;                 /* Length of dir. */
+}
+lookup_t;
+
+/* State for collecting paths to check. */
+typedef struct
+{
+	char paths[64][PATH_MAX + 1]; /* Mount points. */
+	int count;                    /* Number of elements in paths. */
+}
+dirs_t;
+
+static void check_path(const char path[]);
+static int lookup_traverser(struct mntent *entry, void *arg);
+static int collect_traverser(struct mntent *entry, void *arg);
+static int first_entry_traverser(struct mntent *entry, void *arg);
+
+TEST(mount_points_match_linear_search, IF(not_windows))
+{
+	static dirs_t dirs;
+	if(traverse_mount_points(&collect_traverser, &dirs) != 0)
+	{
+		return;
+	}
+
+	int i;
+	for(i = 0; i < dirs.count; ++i)
+	{
+		char path[PATH_MAX + 1];
+
+		check_path(dirs.paths[i]);
+
+		snprintf(path, sizeof(path), "%s/", dirs.paths[i]);
+		check_path(path);
+
+		snprintf(path, sizeof(path), "%s//sub/dir/", dirs.paths[i]);
+		check_path(path);
+
+		snprintf(path, sizeof(path), "%sx", dirs.paths[i]);
+		check_path(path);
+	}
+
+	check_path("/");
+	check_path(SANDBOX_PATH);
+	check_path("/no/such/path");
+}
+
+TEST(relative_paths_have_no_mount_point, IF(not_windows))
+{
+	char buf[PATH_MAX + 1];
+	assert_failure(get_mount_point("relative/path", sizeof(buf), buf));
+}
+
+TEST(slow_fs_is_determined_by_type_of_mount_point, IF(not_windows))
+{
+	lookup_t lookup = { .path = "/" };
+	if(traverse_mount_points(&lookup_traverser, &lookup) != 0 || lookup.len == 0)
+	{
+		return;
+	}
+
+	assert_false(is_on_slow_fs("/", ""));
+	assert_true(is_on_slow_fs("/", "*"));
+	assert_true(is_on_slow_fs("/", lookup.type));
+	assert_false(is_on_slow_fs("/", "no-such-fs-type"));
+}
+
+TEST(unchanged_mount_table_is_not_reread, IF(not_windows))
+{
+	/* The first traversal might need to read the table. */
+	const struct mntent *first = NULL;
+	if(traverse_mount_points(&first_entry_traverser, &first) != 0)
+	{
+		return;
+	}
+
+	/* A new snapshot is created while the old one is still alive, so entries
+	 * can't end up at the same address. */
+	const struct mntent *second = NULL;
+	assert_success(traverse_mount_points(&first_entry_traverser, &second));
+	const struct mntent *third = NULL;
+	assert_success(traverse_mount_points(&first_entry_traverser, &third));
+
+	assert_non_null(second);
+	assert_true(second == third);
+}
+
+/* Compares result of get_mount_point() against brute-force search. */
+static void
+check_path(const char path[])
+{
+	lookup_t lookup = { .path = path };
+	assert_success(traverse_mount_points(&lookup_traverser, &lookup));
+
+	char buf[PATH_MAX + 1];
+	if(lookup.len == 0)
+	{
+		assert_failure(get_mount_point(path, sizeof(buf), buf));
+		return;
+	}
+
+	assert_success(get_mount_point(path, sizeof(buf), buf));
+	assert_string_equal(lookup.dir, buf);
+}
+
+/* Finds the longest mount point containing the path. */
+static int
+lookup_traverser(struct mntent *entry, void *arg)
+{
+	lookup_t *const lookup = arg;
+	const size_t len = strlen(entry->mnt_dir);
+	if(len > lookup->len && path_starts_with(lookup->path, entry->mnt_dir))
+	{
+		lookup->len = len;
+		copy_str(lookup->dir, sizeof(lookup->dir), entry->mnt_dir);
+		copy_str(lookup->type, sizeof(lookup->type), entry->mnt_type);
+	}
+	return 0;
+}
+
+/* Collects mount points. */
+static int
+collect_traverser(struct mntent *entry, void *arg)
+{
+	dirs_t *const dirs = arg;
+	copy_str(dirs->paths[dirs->count], sizeof(dirs->paths[dirs->count]),
+			entry->mnt_dir);
+	++dirs->count;
+	return (dirs->count == (int)ARRAY_LEN(dirs->paths));
+}
+
+/* Remembers address of the first entry. */
+static int
+first_entry_traverser(struct mntent *entry, void *arg)
+{
+	const struct mntent **first = arg;
+	*first = entry;
+	return 1;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,96 @@
+#include <stic.h>
+
+#include <string.h> /* memset() */
+
+#include "../../src/compat/pthread.h"
+#include "../../src/utils/workers.h"
+
+#define NITEMS 1000
+
+static void count_items(void *arg, int from, int to);
+static void record_range(void *arg, int from, int to);
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static int calls;
+static int counts[NITEMS];
+static int last_from, last_to;
+
+SETUP()
+{
+	calls = 0;
+	memset(counts, 0, sizeof(counts));
+	last_from = -1;
+	last_to = -1;
+}
+
+TEST(nothing_is_done_for_empty_range)
+{
+	workers_for(0, 10, 4, &record_range, NULL);
+	assert_int_equal(0, calls);
+}
+
+TEST(each_item_is_processed_exactly_once)
+{
+	workers_for(NITEMS, 7, 8, &count_items, NULL);
+
+	int i;
+	for(i = 0; i < NITEMS; ++i)
+	{
+		assert_int_equal(1, counts[i]);
+	}
+	assert_int_equal((NITEMS + 6)/7, calls);
+}
+
+TEST(single_worker_processes_range_at_once)
+{
+	workers_for(NITEMS, 10, 1, &record_range, NULL);
+	assert_int_equal(1, calls);
+	assert_int_equal(0, last_from);
+	assert_int_equal(NITEMS, last_to);
+}
+
+TEST(single_chunk_is_processed_at_once)
+{
+	workers_for(5, 10, 4, &record_range, NULL);
+	assert_int_equal(1, calls);
+	assert_int_equal(0, last_from);
+	assert_int_equal(5, last_to);
+}
+
+TEST(invalid_chunk_size_is_corrected)
+{
+	workers_for(5, 0, 4, &count_items, NULL);
+	assert_int_equal(5, calls);
+	assert_int_equal(1, counts[0]);
+	assert_int_equal(1, counts[4]);
+}
+
+TEST(there_is_at_least_one_cpu)
+{
+	assert_true(workers_cpu_count() >= 1);
+}
+
+static void
+count_items(void *arg, int from, int to)
+{
+	int i;
+	for(i = from; i < to; ++i)
+	{
+		++counts[i];
+	}
+
+	pthread_mutex_lock(&lock);
+	++calls;
+	pthread_mutex_unlock(&lock);
+}
+
+static void
+record_range(void *arg, int from, int to)
+{
+	++calls;
+	last_from = from;
+	last_to = to;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */